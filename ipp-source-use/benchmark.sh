@@ -0,0 +1,199 @@
+#!/bin/sh
+#
+# File:     benchmark.sh
+# Purpose:  Build the programs listed in a suite file (see
+#           benchmarks.txt), run each over a grid of problem sizes and
+#           thread/process counts, several times, and report the run
+#           times, speedups, efficiencies and Karp-Flatt metrics (see
+#           scaling.awk).
+#
+# Usage:    ./benchmark.sh [-f suite] [-p "counts"] [-r runs] [-o dir]
+#              [-b baseline] [-t tolerance] [group or name ...]
+#           -f  suite file (default benchmarks.txt next to this script)
+#           -p  thread/process counts (default "1 2 4 8")
+#           -r  runs of each configuration (default 3)
+#           -o  directory for raw.csv and summary.csv (default
+#               ./bench_results)
+#           -b  summary.csv of an earlier run:  configurations whose
+#               median time is more than tolerance percent higher are
+#               reported, and the exit status is 1
+#           -t  tolerance in percent (default 10)
+#           With groups or names, only the matching lines of the suite
+#           are run.
+#
+# Output:   dir/raw.csv:      one line for each run
+#           dir/summary.csv:  one line for each program, size and count
+#           stdout:           the summary as a table for each group
+#
+# Environment:
+#    CC (gcc), MPICC (mpicc), CFLAGS (-O2), MPIEXEC (mpiexec).  On a
+#    box with fewer cores than the largest count, use, e.g.,
+#    MPIEXEC="mpiexec --oversubscribe".
+#
+# Notes:
+# 1.  The output of each run is discarded, except that the last lines
+#     are printed when a run fails.  A failed run is recorded in
+#     raw.csv with status failed, and isn't used in the summary.
+# 2.  Uses GNU date for the wall clock times.
+
+set -e
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+SUITE="$DIR/benchmarks.txt"
+COUNTS="1 2 4 8"
+RUNS=3
+OUT=bench_results
+BASELINE=
+TOLERANCE=10
+CC=${CC:-gcc}
+MPICC=${MPICC:-mpicc}
+CFLAGS=${CFLAGS:-"-O2"}
+MPIEXEC=${MPIEXEC:-mpiexec}
+
+usage() {
+    sed -n '/^# Usage:/,/^# Output:/p' "$0" | sed '$d; s/^# \{0,1\}//' >&2
+    exit 2
+}
+
+while getopts f:p:r:o:b:t:h opt; do
+    case $opt in
+        f) SUITE=$OPTARG ;;
+        p) COUNTS=$OPTARG ;;
+        r) RUNS=$OPTARG ;;
+        o) OUT=$OPTARG ;;
+        b) BASELINE=$OPTARG ;;
+        t) TOLERANCE=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+SELECTED=" $* "
+
+SUITE_DIR=$(cd "$(dirname "$SUITE")" && pwd)
+mkdir -p "$OUT"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+RAW="$OUT/raw.csv"
+echo "group,name,model,size,p,run,timer,seconds,status" > "$RAW"
+
+trim() {
+    printf '%s' "$1" | sed 's/^[[:space:]]*//; s/[[:space:]]*$//'
+}
+
+# Replace {p}, {n} and {tsp_matrix} in $1
+substitute() {
+    printf '%s' "$1" | sed "s|{p}|$p|g; s|{n}|$n|g; s|{tsp_matrix}|$BUILD/tsp_$n|g"
+}
+
+# A matrix of random costs 1-99 for $1 cities, in the format the tsp
+# programs read
+make_tsp_matrix() {
+    awk -v n="$1" 'BEGIN {
+        srand(n)
+        print n
+        for (i = 0; i < n; i++) {
+            line = ""
+            for (j = 0; j < n; j++)
+                line = line sprintf(" %2d", i == j ? 0 : 1 + int(99*rand()))
+            print line
+        }
+    }' > "$BUILD/tsp_$1"
+}
+
+# Build program $name from $sources with the compiler for $model
+build() {
+    case $model in
+        serial) compiler="$CC" ;;
+        omp)    compiler="$CC -fopenmp" ;;
+        pth)    compiler="$CC -pthread" ;;
+        mpi)    compiler="$MPICC" ;;
+        *)      echo "$name:  unknown model $model" >&2; return 1 ;;
+    esac
+    # shellcheck disable=SC2086
+    (cd "$SUITE_DIR" && $compiler $CFLAGS -o "$BUILD/$name" $sources -lm) \
+        > "$BUILD/build.log" 2>&1 || {
+        echo "$name:  build failed" >&2
+        tail -n 5 "$BUILD/build.log" >&2
+        return 1
+    }
+}
+
+# Run $name once with $p threads/processes and size $n, and set timer
+# and seconds
+run_once() {
+    rm -f "$BUILD/prof.csv"
+    # shellcheck disable=SC2046
+    if [ "$model" = mpi ]; then
+        set -- $MPIEXEC -n "$p" "$BUILD/$name" $(substitute "$args")
+    else
+        set -- "$BUILD/$name" $(substitute "$args")
+    fi
+    start=$(date +%s.%N)
+    if [ -n "$input" ]; then
+        substitute "$input" | OMP_NUM_THREADS=$p PROF_FORMAT=csv \
+            PROF_FILE="$BUILD/prof.csv" "$@" > "$BUILD/out" 2>&1
+    else
+        OMP_NUM_THREADS=$p PROF_FORMAT=csv PROF_FILE="$BUILD/prof.csv" \
+            "$@" < /dev/null > "$BUILD/out" 2>&1
+    fi
+    status=$?
+    finish=$(date +%s.%N)
+
+    if [ -s "$BUILD/prof.csv" ]; then
+        timer=prof
+        seconds=$(awk -F, 'NR == 2 { printf "%.9e", $6*$2/$3 }' "$BUILD/prof.csv")
+    else
+        timer=elapsed
+        seconds=$(awk '/[Ee]lapsed time (=|is)/ {
+            for (i = 1; i <= NF; i++)
+                if ($i ~ /^[0-9]+\.?[0-9]*([eE][-+]?[0-9]+)?$/) { print $i; exit }
+        }' "$BUILD/out")
+        if [ -z "$seconds" ]; then
+            timer=wall
+            seconds=$(awk -v s="$start" -v f="$finish" 'BEGIN { printf "%.9e", f - s }')
+        fi
+    fi
+    return $status
+}
+
+exec 3< "$SUITE"
+while IFS='|' read -r group name model sources args input sizes <&3; do
+    group=$(trim "$group")
+    case $group in ''|'#'*) continue ;; esac
+    name=$(trim "$name"); model=$(trim "$model"); sources=$(trim "$sources")
+    args=$(trim "$args"); input=$(trim "$input"); sizes=$(trim "$sizes")
+    case $SELECTED in
+        "  ") ;;
+        *" $group "*|*" $name "*) ;;
+        *) continue ;;
+    esac
+
+    build || continue
+    counts=$COUNTS
+    [ "$model" = serial ] && counts=1
+    for n in $sizes; do
+        case $args in
+            *'{tsp_matrix}'*) [ -f "$BUILD/tsp_$n" ] || make_tsp_matrix "$n" ;;
+        esac
+        for p in $counts; do
+            run=1
+            while [ "$run" -le "$RUNS" ]; do
+                if run_once; then
+                    state=ok
+                else
+                    state=failed
+                    echo "$name n=$n p=$p run $run failed:" >&2
+                    tail -n 5 "$BUILD/out" >&2
+                fi
+                echo "$group,$name,$model,$n,$p,$run,$timer,$seconds,$state" >> "$RAW"
+                echo "$name  size $n  p $p  run $run:  $seconds s ($timer)" >&2
+                run=$((run + 1))
+            done
+        done
+    done
+done
+exec 3<&-
+
+awk -f "$DIR/scaling.awk" -v format=csv "$RAW" > "$OUT/summary.csv"
+awk -f "$DIR/scaling.awk" -v format=text -v baseline="$BASELINE" \
+    -v tolerance="$TOLERANCE" "$RAW"
@@ -0,0 +1,281 @@
+/* File:     histo.c
+ *
+ * Purpose:  Bin lookup and counting for the parallel histogram
+ *           programs.
+ *
+ * Bins_init_uniform:  bins with the same width, as in histogram.c
+ * Bins_init_edges:    bins with arbitrary (increasing) upper edges
+ * Bins_read_edges:    bins with upper edges read from a text file
+ * Uniform_bin:        O(1) arithmetic bin lookup for uniform bins
+ * Search_bins:        branchless binary search for a block of
+ *                     measurements; vectorized across the block
+ * Count_bins:         add the measurements in an array to the bin
+ *                     counts
+ * Alloc_private_counts, Merge_counts:  per-thread bin arrays padded
+ *                     to a cache line, and their merge
+ * Print_histo:        print the counts and the cumulative counts, which
+ *                     are an inclusive scan (../ch4/scan.h) of the
+ *                     counts
+ *
+ * Notes:
+ * 1.  As in histogram.c, the measurement x belongs to bin i if
+ *     bin_maxes[i-1] <= x < bin_maxes[i] (bin_maxes[-1] = min_meas).
+ *     Measurements outside [min_meas, bin_maxes[bin_count-1]) aren't
+ *     counted:  Count_bins returns the number of them.
+ * 2.  Compile with -fopenmp-simd (or -fopenmp) so that the simd
+ *     directives are used, and with -I../ch4 for scan.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "histo.h"
+#include "scan.h"
+
+#define SUM(a, b) ((a) + (b))
+SCAN_KERNELS(Sum_long, long, SUM)
+
+/*---------------------------------------------------------------------
+ * Function:  Bins_init_uniform
+ * Purpose:   Set up bin_count bins of equal width between min_meas and
+ *            max_meas.  The edges are computed as in Gen_bins in
+ *            histogram.c.
+ */
+void Bins_init_uniform(bins_t* bins, int bin_count, float min_meas,
+      float max_meas) {
+   float bin_width = (max_meas - min_meas)/bin_count;
+   int i;
+
+   bins->bin_count = bin_count;
+   bins->min_meas = min_meas;
+   bins->bin_maxes = malloc(bin_count*sizeof(float));
+   for (i = 0; i < bin_count; i++)
+      bins->bin_maxes[i] = min_meas + (i+1)*bin_width;
+   bins->uniform = 1;
+   bins->inv_width = bin_count/(max_meas - min_meas);
+}  /* Bins_init_uniform */
+
+/*---------------------------------------------------------------------
+ * Function:  Bins_init_edges
+ * Purpose:   Set up bins with arbitrary upper edges.  bin_maxes should
+ *            be increasing, and it's copied.
+ */
+void Bins_init_edges(bins_t* bins, int bin_count, float min_meas,
+      float bin_maxes[]) {
+   int i;
+
+   bins->bin_count = bin_count;
+   bins->min_meas = min_meas;
+   bins->bin_maxes = malloc(bin_count*sizeof(float));
+   for (i = 0; i < bin_count; i++)
+      bins->bin_maxes[i] = bin_maxes[i];
+   bins->uniform = 0;
+   bins->inv_width = 0.0;
+}  /* Bins_init_edges */
+
+/*---------------------------------------------------------------------
+ * Function:  Bins_read_edges
+ * Purpose:   Read bin_count upper edges from fname, a text file of
+ *            floats separated by white space, and set up the bins
+ *            with Bins_init_edges
+ * Ret val:   1 if the bins were set up, 0 if the file can't be opened,
+ *            has fewer than bin_count edges, or the edges don't
+ *            increase from min_meas
+ */
+int Bins_read_edges(bins_t* bins, int bin_count, float min_meas,
+      char fname[]) {
+   FILE* fp = fopen(fname, "r");
+   float* edges;
+   int i, ok = 1;
+
+   if (fp == NULL) return 0;
+   edges = malloc(bin_count*sizeof(float));
+   for (i = 0; i < bin_count && ok; i++)
+      if (fscanf(fp, "%f", &edges[i]) != 1 ||
+            !(edges[i] > ((i == 0) ? min_meas : edges[i-1])))
+         ok = 0;
+   fclose(fp);
+
+   if (ok) Bins_init_edges(bins, bin_count, min_meas, edges);
+   free(edges);
+   return ok;
+}  /* Bins_read_edges */
+
+/*---------------------------------------------------------------------*/
+void Bins_free(bins_t* bins) {
+   free(bins->bin_maxes);
+   bins->bin_maxes = NULL;
+}  /* Bins_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Uniform_bin
+ * Purpose:   Compute the bin of a measurement directly
+ * In args:   x:     the measurement:  min_meas <= x < bin_maxes[last]
+ *            bins:  uniform bins
+ * Ret val:   the bin to which x belongs
+ * Note:      Rounding in (x - min_meas)*inv_width can be off by one
+ *            near an edge, so the result is checked against the
+ *            stored edges.  This makes the lookup agree exactly with
+ *            the binary search in histogram.c.
+ */
+int Uniform_bin(float x, bins_t* bins) {
+   float* bin_maxes = bins->bin_maxes;
+   int last = bins->bin_count - 1;
+   int b = (int) ((x - bins->min_meas)*bins->inv_width);
+
+   if (b > last) b = last;
+   if (b < 0) b = 0;
+   if (b > 0 && x < bin_maxes[b-1])
+      b--;
+   else if (x >= bin_maxes[b] && b < last)
+      b++;
+   return b;
+}  /* Uniform_bin */
+
+/*---------------------------------------------------------------------
+ * Function:  Search_bins
+ * Purpose:   Find the bins of count measurements with a branchless
+ *            binary search over bin_maxes
+ * In args:   data, count, bins
+ * Out arg:   bin_idx:  bin_idx[i] is the bin of data[i]
+ * Notes:
+ * 1.  bin i is the number of edges bin_maxes[j] <= x.  The search
+ *     halves the range len each step, so the number of steps depends
+ *     only on bin_count:  every measurement in the block takes the same
+ *     steps, and the loop over the block is a simd loop (the loads of
+ *     bin_maxes become gathers).
+ * 2.  count should be at most SEARCH_BLOCK so bin_idx stays in L1.
+ */
+void Search_bins(float data[], int count, bins_t* bins, int bin_idx[]) {
+   float* bin_maxes = bins->bin_maxes;
+   int len, half, i;
+
+   for (i = 0; i < count; i++)
+      bin_idx[i] = 0;
+
+   for (len = bins->bin_count; len > 1; len -= half) {
+      half = len/2;
+#     pragma omp simd
+      for (i = 0; i < count; i++)
+         bin_idx[i] += (bin_maxes[bin_idx[i] + half - 1] <= data[i]) ?
+            half : 0;
+   }
+
+#  pragma omp simd
+   for (i = 0; i < count; i++)
+      bin_idx[i] += (bin_maxes[bin_idx[i]] <= data[i]);
+}  /* Search_bins */
+
+/*---------------------------------------------------------------------
+ * Function:  Count_bins
+ * Purpose:   Add the measurements in data to bin_counts
+ * In args:   data, count, bins
+ *            use_search:  if nonzero, use Search_bins even for
+ *                         uniform bins
+ * In/out:    bin_counts
+ * Ret val:   number of measurements outside the bins (not counted)
+ */
+long Count_bins(float data[], long count, bins_t* bins,
+      long bin_counts[], int use_search) {
+   int bin_idx[SEARCH_BLOCK];
+   float min_meas = bins->min_meas;
+   float max_meas = bins->bin_maxes[bins->bin_count-1];
+   long i, out = 0;
+   int j, block;
+   float x;
+
+   if (bins->uniform && !use_search) {
+      for (i = 0; i < count; i++) {
+         x = data[i];
+         if (x < min_meas || !(x < max_meas))
+            out++;
+         else
+            bin_counts[Uniform_bin(x, bins)]++;
+      }
+   } else {
+      for (i = 0; i < count; i += SEARCH_BLOCK) {
+         block = (count - i < SEARCH_BLOCK) ? count - i : SEARCH_BLOCK;
+         Search_bins(data + i, block, bins, bin_idx);
+         for (j = 0; j < block; j++) {
+            x = data[i+j];
+            if (x < min_meas || !(x < max_meas))
+               out++;
+            else
+               bin_counts[bin_idx[j]]++;
+         }
+      }
+   }
+   return out;
+}  /* Count_bins */
+
+/*---------------------------------------------------------------------
+ * Function:  Alloc_private_counts
+ * Purpose:   Allocate and zero one array of bin counts for each thread.
+ *            Each array starts on its own cache line, so threads never
+ *            write to the same line.
+ * Out arg:   stride_p:  thread t's counts start at t*stride
+ * Ret val:   the arrays, or NULL if the allocation fails
+ */
+long* Alloc_private_counts(int thread_count, int bin_count, int* stride_p) {
+   int per_line = CACHE_LINE/sizeof(long);
+   int stride = ((bin_count + per_line - 1)/per_line)*per_line;
+   size_t bytes = (size_t) thread_count*stride*sizeof(long);
+   long* counts;
+   size_t i;
+
+   if (posix_memalign((void**) &counts, CACHE_LINE, bytes) != 0)
+      return NULL;
+   for (i = 0; i < (size_t) thread_count*stride; i++)
+      counts[i] = 0;
+   *stride_p = stride;
+   return counts;
+}  /* Alloc_private_counts */
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_counts
+ * Purpose:   Add the private counts of bins first_bin, ...,
+ *            last_bin-1 into bin_counts.  Different threads can merge
+ *            different ranges of bins at the same time.
+ */
+void Merge_counts(long private_counts[], int thread_count, int stride,
+      int first_bin, int last_bin, long bin_counts[]) {
+   int t, b;
+
+   for (b = first_bin; b < last_bin; b++)
+      bin_counts[b] = 0;
+   for (t = 0; t < thread_count; t++)
+      for (b = first_bin; b < last_bin; b++)
+         bin_counts[b] += private_counts[(size_t) t*stride + b];
+}  /* Merge_counts */
+
+/*---------------------------------------------------------------------
+ * Function:  Gen_chunk
+ * Purpose:   Generate random floats in the range min_meas <= x < max_meas
+ *            with the thread-safe rand_r
+ */
+void Gen_chunk(float data[], int count, float min_meas, float max_meas,
+      unsigned* seed_p) {
+   int i;
+
+   for (i = 0; i < count; i++)
+      data[i] = min_meas +
+         (max_meas - min_meas)*(rand_r(seed_p)/((double) RAND_MAX + 1.0));
+}  /* Gen_chunk */
+
+/*---------------------------------------------------------------------
+ * Function:  Print_histo
+ * Purpose:   Print the number of measurements in each bin, and the
+ *            number in it and the lower bins
+ */
+void Print_histo(bins_t* bins, long bin_counts[]) {
+   long* cum_counts = malloc(bins->bin_count*sizeof(long));
+   int i;
+   float bin_max, bin_min;
+
+   Sum_long_scan(bin_counts, cum_counts, bins->bin_count, 0, 1);
+   for (i = 0; i < bins->bin_count; i++) {
+      bin_max = bins->bin_maxes[i];
+      bin_min = (i == 0) ? bins->min_meas : bins->bin_maxes[i-1];
+      printf("%.3f-%.3f:\t%ld\t%ld\n", bin_min, bin_max, bin_counts[i],
+            cum_counts[i]);
+   }
+   free(cum_counts);
+}  /* Print_histo */
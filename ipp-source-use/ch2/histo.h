@@ -0,0 +1,47 @@
+/* File:     histo.h
+ * Purpose:  Header file for histo.c, which implements the bin lookup
+ *           and counting used by the parallel histogram programs
+ *           pth_histogram.c, omp_histogram.c and mpi_histogram.c.
+ */
+#ifndef _HISTO_H_
+#define _HISTO_H_
+
+/* Number of measurements processed together by Search_bins */
+#define SEARCH_BLOCK 256
+
+/* Number of floats read from a file with one call */
+#define CHUNK_FLOATS (1 << 16)
+
+/* Private bin arrays are padded to a multiple of a cache line */
+#define CACHE_LINE 64
+
+typedef struct {
+   int    bin_count;
+   float  min_meas;
+   float* bin_maxes;   /* bin_maxes[i] = upper edge of bin i        */
+   int    uniform;     /* 1 if all bins have the same width         */
+   float  inv_width;   /* bin_count/(max_meas - min_meas) if uniform */
+}  bins_t;
+
+void Bins_init_uniform(bins_t* bins, int bin_count, float min_meas,
+      float max_meas);
+void Bins_init_edges(bins_t* bins, int bin_count, float min_meas,
+      float bin_maxes[]);
+int  Bins_read_edges(bins_t* bins, int bin_count, float min_meas,
+      char fname[]);
+void Bins_free(bins_t* bins);
+
+int  Uniform_bin(float x, bins_t* bins);
+void Search_bins(float data[], int count, bins_t* bins, int bin_idx[]);
+long Count_bins(float data[], long count, bins_t* bins,
+      long bin_counts[], int use_search);
+
+long* Alloc_private_counts(int thread_count, int bin_count, int* stride_p);
+void Merge_counts(long private_counts[], int thread_count, int stride,
+      int first_bin, int last_bin, long bin_counts[]);
+
+void Gen_chunk(float data[], int count, float min_meas, float max_meas,
+      unsigned* seed_p);
+void Print_histo(bins_t* bins, long bin_counts[]);
+
+#endif
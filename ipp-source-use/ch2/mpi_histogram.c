@@ -0,0 +1,314 @@
+/* File:      mpi_histogram.c
+ * Purpose:   Build a histogram with MPI.  Each process counts the
+ *            measurements in a block of the data, and the local bin
+ *            counts are added with MPI_Reduce onto process 0.
+ *
+ * Compile:   mpicc -g -Wall -O3 -fopenmp-simd -I../ch4 -o mpi_histogram
+ *               mpi_histogram.c histo.c stream.c -lpthread
+ * Run:       mpiexec -n <p> ./mpi_histogram <bin_count> <min_meas>
+ *               <max_meas> <g|b|t> <data_count|file> [s | e <edges>]
+ *
+ * Input:     None in g mode:  data_count random measurements are
+ *               generated.
+ *            In b mode, the measurements are read from file, a binary
+ *               file of floats (native byte order, no header).  Each
+ *               process reads its own block with MPI_File_read_at.
+ *               f is the old name of b mode, and is still accepted.
+ *            In t mode, file is a text file of floats separated by
+ *               white space.  Each process reads its own part of the
+ *               file through a stream (stream.c).
+ *            If the optional last argument is "s", bins are found with
+ *               the branchless binary search instead of the O(1)
+ *               arithmetic lookup.
+ *            If the optional last arguments are "e" and a file name,
+ *               edges is a text file of bin_count increasing upper
+ *               edges of the bins, the last of which replaces
+ *               max_meas.  The bins are found with the binary search.
+ *               Every process reads it.
+ * Output:    The number of measurements in each bin and the cumulative
+ *            number up to and including the bin, the number that
+ *            are outside [min_meas, max_meas), and the elapsed time.
+ *            In b and t modes, also the time spent reading and the
+ *            read bandwidth, and the time spent counting.
+ *
+ * Notes:
+ * 1.  Measurements y in bin i satisfy bin_maxes[i-1] <= y < bin_maxes[i]
+ *     (bin_maxes[-1] = min_meas), as in histogram.c
+ * 2.  The data is never stored in full:  each process reads or
+ *     generates CHUNK_FLOATS measurements at a time, or, in t mode,
+ *     a chunk of STREAM_CHUNK bytes.
+ * 3.  Process 0 does all the output
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "histo.h"
+#include "stream.h"
+
+void Usage(char prog_name[]);
+void Get_args(int argc, char* argv[], int* bin_count_p, float* min_meas_p,
+      float* max_meas_p, char* g_f_p, long* data_count_p, char file_name[],
+      int* use_search_p, char edges_file[], int my_rank);
+long Count_block(long my_first, long my_count, bins_t* bins, char g_f,
+      MPI_File fh, int use_search, long loc_counts[], unsigned seed,
+      double* read_time_p);
+long Count_text(char file_name[], bins_t* bins, int use_search,
+      long loc_counts[], int my_rank, int comm_sz, long* my_count_p,
+      long* bytes_p, double* read_time_p, double* count_time_p);
+
+/*---------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int bin_count, use_search, my_rank, comm_sz;
+   float min_meas, max_meas;
+   char g_f, file_name[256], edges_file[256];
+   long data_count, quotient, remainder, my_first, my_count;
+   long loc_out, out, loc_bytes = 0, total_bytes;
+   long *loc_counts, *bin_counts = NULL;
+   bins_t bins;
+   MPI_File fh = MPI_FILE_NULL;
+   MPI_Offset file_size;
+   MPI_Comm comm;
+   double start, loc_elapsed, elapsed, loc_read, max_read, loc_comp,
+          max_comp;
+
+   MPI_Init(&argc, &argv);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+
+   Get_args(argc, argv, &bin_count, &min_meas, &max_meas, &g_f,
+         &data_count, file_name, &use_search, edges_file, my_rank);
+
+   if (g_f == 'b') {
+      if (MPI_File_open(comm, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL,
+               &fh) != MPI_SUCCESS) {
+         if (my_rank == 0) fprintf(stderr, "Can't open %s\n", file_name);
+         MPI_Finalize();
+         exit(-1);
+      }
+      MPI_File_get_size(fh, &file_size);
+      data_count = file_size/sizeof(float);
+   }
+
+   if (edges_file[0] == '\0') {
+      Bins_init_uniform(&bins, bin_count, min_meas, max_meas);
+   } else if (!Bins_read_edges(&bins, bin_count, min_meas, edges_file)) {
+      if (my_rank == 0)
+         fprintf(stderr, "Can't read %d increasing edges from %s\n",
+               bin_count, edges_file);
+      MPI_Finalize();
+      exit(-1);
+   }
+   loc_counts = calloc(bin_count, sizeof(long));
+   if (my_rank == 0) bin_counts = malloc(bin_count*sizeof(long));
+
+   /* Block distribution of the measurements */
+   quotient = data_count/comm_sz;
+   remainder = data_count % comm_sz;
+   if (my_rank < remainder) {
+      my_count = quotient + 1;
+      my_first = my_rank*my_count;
+   } else {
+      my_count = quotient;
+      my_first = my_rank*quotient + remainder;
+   }
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   if (g_f == 't') {
+      loc_out = Count_text(file_name, &bins, use_search, loc_counts,
+            my_rank, comm_sz, &my_count, &loc_bytes, &loc_read, &loc_comp);
+   } else {
+      loc_out = Count_block(my_first, my_count, &bins, g_f, fh, use_search,
+            loc_counts, my_rank + 1, &loc_read);
+      loc_comp = MPI_Wtime() - start - loc_read;
+      if (g_f == 'b') loc_bytes = my_count*sizeof(float);
+   }
+   MPI_Reduce(loc_counts, bin_counts, bin_count, MPI_LONG, MPI_SUM, 0,
+         comm);
+   MPI_Reduce(&loc_out, &out, 1, MPI_LONG, MPI_SUM, 0, comm);
+   MPI_Reduce(&my_count, &data_count, 1, MPI_LONG, MPI_SUM, 0, comm);
+   MPI_Reduce(&loc_bytes, &total_bytes, 1, MPI_LONG, MPI_SUM, 0, comm);
+   loc_elapsed = MPI_Wtime() - start;
+   MPI_Reduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+   MPI_Reduce(&loc_read, &max_read, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+   MPI_Reduce(&loc_comp, &max_comp, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+   if (my_rank == 0) {
+      Print_histo(&bins, bin_counts);
+      printf("Outside [%.3f, %.3f):\t%ld\n", min_meas,
+            bins.bin_maxes[bin_count-1], out);
+      printf("%ld measurements, elapsed time = %e seconds\n",
+            data_count, elapsed);
+      if (g_f != 'g') {
+         printf("Read:   %ld bytes, %e seconds, %.1f MB/s\n", total_bytes,
+               max_read, (max_read > 0.0) ? total_bytes/max_read/1.0e6
+               : 0.0);
+         printf("Count:  %e seconds\n", max_comp);
+      }
+   }
+#  ifdef DEBUG
+   int b;
+   for (b = 0; b < bin_count; b++)
+      printf("Proc %d > bin %d:  %ld\n", my_rank, b, loc_counts[b]);
+#  endif
+
+   if (fh != MPI_FILE_NULL) MPI_File_close(&fh);
+   free(loc_counts);
+   free(bin_counts);
+   Bins_free(&bins);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run program
+ * In arg:    prog_name:  the name of the program from the command line
+ * Note:      Only run by process 0
+ */
+void Usage(char prog_name[] /* in */) {
+   fprintf(stderr, "usage: mpiexec -n <p> %s ", prog_name);
+   fprintf(stderr, "<bin_count> <min_meas> <max_meas> ");
+   fprintf(stderr, "<g|b|t> <data_count|file> [s | e <edges>]\n");
+   fprintf(stderr, "   g: generate data_count random measurements\n");
+   fprintf(stderr, "   b: read binary floats from file (or f)\n");
+   fprintf(stderr, "   t: read text floats from file\n");
+   fprintf(stderr, "   s: use binary search instead of O(1) lookup\n");
+   fprintf(stderr, "   e: read the upper edges of the bins from edges\n");
+   fflush(stderr);
+}  /* Usage */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get the command line arguments.  If they're bad, process
+ *            0 prints a message and all the processes quit.
+ */
+void Get_args(int argc, char* argv[], int* bin_count_p, float* min_meas_p,
+      float* max_meas_p, char* g_f_p, long* data_count_p, char file_name[],
+      int* use_search_p, char edges_file[], int my_rank) {
+   int ok = 1;
+
+   *data_count_p = 0;
+   *use_search_p = 0;
+   edges_file[0] = '\0';
+   if (argc < 6 || argc > 8) {
+      ok = 0;
+   } else {
+      *bin_count_p = strtol(argv[1], NULL, 10);
+      *min_meas_p = strtof(argv[2], NULL);
+      *max_meas_p = strtof(argv[3], NULL);
+      *g_f_p = argv[4][0];
+      if (*g_f_p == 'g') {
+         *data_count_p = strtol(argv[5], NULL, 10);
+      } else if (*g_f_p == 'b' || *g_f_p == 'f' || *g_f_p == 't') {
+         if (*g_f_p == 'f') *g_f_p = 'b';
+         strncpy(file_name, argv[5], 255);
+         file_name[255] = '\0';
+      } else {
+         ok = 0;
+      }
+      if (argc == 7) {
+         if (argv[6][0] != 's') ok = 0;
+         *use_search_p = 1;
+      } else if (argc == 8) {
+         if (argv[6][0] != 'e') ok = 0;
+         strncpy(edges_file, argv[7], 255);
+         edges_file[255] = '\0';
+      }
+      if (*bin_count_p <= 0 || !(*min_meas_p < *max_meas_p) ||
+            *data_count_p < 0)
+         ok = 0;
+   }
+
+   if (!ok) {
+      if (my_rank == 0) Usage(argv[0]);
+      MPI_Finalize();
+      exit(0);
+   }
+}  /* Get_args */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Count_block
+ * Purpose:   Count the measurements my_first, ..., my_first+my_count-1,
+ *            reading or generating CHUNK_FLOATS of them at a time
+ * In args:   my_first, my_count, bins, g_f, fh, use_search, seed
+ * In/out:    loc_counts:   this process' bin counts
+ * Out arg:   read_time_p:  time spent in MPI_File_read_at
+ * Ret val:   number of measurements outside the bins
+ */
+long Count_block(long my_first, long my_count, bins_t* bins, char g_f,
+      MPI_File fh, int use_search, long loc_counts[], unsigned seed,
+      double* read_time_p) {
+   float* data = malloc(CHUNK_FLOATS*sizeof(float));
+   long done, out = 0;
+   int chunk;
+   double start;
+
+   *read_time_p = 0.0;
+   for (done = 0; done < my_count; done += chunk) {
+      chunk = (my_count - done < CHUNK_FLOATS) ? my_count - done
+         : CHUNK_FLOATS;
+      if (g_f == 'g')
+         Gen_chunk(data, chunk, bins->min_meas,
+               bins->bin_maxes[bins->bin_count-1], &seed);
+      else {
+         start = MPI_Wtime();
+         MPI_File_read_at(fh, (MPI_Offset) (my_first + done)*sizeof(float),
+               data, chunk, MPI_FLOAT, MPI_STATUS_IGNORE);
+         *read_time_p += MPI_Wtime() - start;
+      }
+      out += Count_bins(data, chunk, bins, loc_counts, use_search);
+   }
+
+   free(data);
+   return out;
+}  /* Count_block */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Count_text
+ * Purpose:   Count the measurements in the calling process' part of a
+ *            text file, reading it through a stream
+ * In args:   file_name, bins, use_search, my_rank, comm_sz
+ * In/out:    loc_counts:    this process' bin counts
+ * Out args:  my_count_p:    number of measurements in the part
+ *            bytes_p:       number of bytes read
+ *            read_time_p:   time spent reading
+ *            count_time_p:  time spent counting
+ * Ret val:   number of measurements outside the bins
+ * Note:      If the file can't be opened, all the processes are
+ *            aborted
+ */
+long Count_text(char file_name[], bins_t* bins, int use_search,
+      long loc_counts[], int my_rank, int comm_sz, long* my_count_p,
+      long* bytes_p, double* read_time_p, double* count_time_p) {
+   stream_t s;
+   float* data;
+   long chunk, my_count = 0, out = 0;
+   double start;
+
+   if (Stream_open(&s, file_name, STREAM_TEXT, STREAM_FLOAT, my_rank,
+            comm_sz) != 0) {
+      fprintf(stderr, "Proc %d > Can't open %s\n", my_rank, file_name);
+      MPI_Abort(MPI_COMM_WORLD, -1);
+   }
+
+   start = MPI_Wtime();
+   while ((chunk = Stream_next(&s, (void**) &data)) > 0) {
+      out += Count_bins(data, chunk, bins, loc_counts, use_search);
+      my_count += chunk;
+   }
+   *count_time_p = MPI_Wtime() - start;
+   Stream_close(&s);
+
+   *count_time_p -= s.wait_time;
+   *my_count_p = my_count;
+   *bytes_p = s.bytes_read;
+   *read_time_p = s.read_time;
+   return out;
+}  /* Count_text */
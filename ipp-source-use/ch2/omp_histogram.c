@@ -0,0 +1,270 @@
+/* File:      omp_histogram.c
+ * Purpose:   Build a histogram with OpenMP.  Each thread counts the
+ *            measurements in a block of the data in its own private
+ *            array of bin counts.  Then the private arrays are merged
+ *            with a parallel for over the bins.
+ *
+ * Compile:   gcc -g -Wall -O3 -fopenmp -I../ch4 -o omp_histogram
+ *               omp_histogram.c histo.c stream.c -lpthread
+ * Run:       ./omp_histogram <thread_count> <bin_count> <min_meas>
+ *               <max_meas> <g|b|t> <data_count|file> [s | e <edges>]
+ *
+ * Input:     None in g mode:  data_count random measurements are
+ *               generated.
+ *            In b mode, the measurements are read from file, a binary
+ *               file of floats (native byte order, no header).
+ *            In t mode, file is a text file of floats separated by
+ *               white space.
+ *            If the optional last argument is "s", bins are found with
+ *               the branchless binary search instead of the O(1)
+ *               arithmetic lookup.
+ *            If the optional last arguments are "e" and a file name,
+ *               edges is a text file of bin_count increasing upper
+ *               edges of the bins, the last of which replaces
+ *               max_meas.  The bins are found with the binary search.
+ * Output:    The number of measurements in each bin and the cumulative
+ *            number up to and including the bin, the number that
+ *            are outside [min_meas, max_meas), and the elapsed time.
+ *            In b and t modes, also the time spent reading and the
+ *            read bandwidth, and the time spent counting.
+ *
+ * Notes:
+ * 1.  Measurements y in bin i satisfy bin_maxes[i-1] <= y < bin_maxes[i]
+ *     (bin_maxes[-1] = min_meas), as in histogram.c
+ * 2.  The data is never stored in full:  each thread generates
+ *     CHUNK_FLOATS measurements at a time, or reads its part of the
+ *     file through a stream (stream.c) with a reader thread and two
+ *     buffers.
+ * 3.  DEBUG compile flag gives verbose output
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "histo.h"
+#include "stream.h"
+
+void Usage(char prog_name[]);
+void Get_args(int argc, char* argv[], int* thread_count_p,
+      int* bin_count_p, float* min_meas_p, float* max_meas_p, char* g_f_p,
+      long* data_count_p, char file_name[], int* use_search_p,
+      char edges_file[]);
+long Count_generated(long my_count, bins_t* bins, int use_search,
+      long my_counts[], unsigned seed);
+long Count_file(char file_name[], char g_f, bins_t* bins, int use_search,
+      long my_counts[], long* my_count_p, long* bytes_p, double* read_time_p,
+      double* count_time_p);
+
+/*---------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int thread_count, bin_count, use_search, stride, b;
+   float min_meas, max_meas;
+   char g_f, file_name[256], edges_file[256];
+   long data_count, total_count = 0, total_bytes = 0, out = 0;
+   bins_t bins;
+   long* private_counts;
+   long* bin_counts;
+   double start, finish, max_read = 0.0, max_count = 0.0;
+
+   Get_args(argc, argv, &thread_count, &bin_count, &min_meas, &max_meas,
+         &g_f, &data_count, file_name, &use_search, edges_file);
+
+   if (edges_file[0] == '\0') {
+      Bins_init_uniform(&bins, bin_count, min_meas, max_meas);
+   } else if (!Bins_read_edges(&bins, bin_count, min_meas, edges_file)) {
+      fprintf(stderr, "Can't read %d increasing edges from %s\n",
+            bin_count, edges_file);
+      exit(-1);
+   }
+   bin_counts = malloc(bin_count*sizeof(long));
+   private_counts = Alloc_private_counts(thread_count, bin_count, &stride);
+   if (bin_counts == NULL || private_counts == NULL) {
+      fprintf(stderr, "Can't allocate storage\n");
+      exit(-1);
+   }
+
+   start = omp_get_wtime();
+#  pragma omp parallel num_threads(thread_count) default(none) \
+      shared(bins, g_f, file_name, use_search, data_count, \
+            private_counts, stride, bin_counts, bin_count, thread_count) \
+      reduction(+: out, total_count, total_bytes) \
+      reduction(max: max_read, max_count)
+   {
+      int my_rank = omp_get_thread_num();
+      long* my_counts = private_counts + (size_t) my_rank*stride;
+      long my_count, my_bytes;
+      double my_read, my_time;
+
+      if (g_f == 'g') {
+         my_count = data_count/thread_count
+            + (my_rank < data_count % thread_count);
+         out += Count_generated(my_count, &bins, use_search, my_counts,
+               my_rank + 1);
+      } else {
+         out += Count_file(file_name, g_f, &bins, use_search, my_counts,
+               &my_count, &my_bytes, &my_read, &my_time);
+         total_bytes += my_bytes;
+         if (my_read > max_read) max_read = my_read;
+         if (my_time > max_count) max_count = my_time;
+      }
+      total_count += my_count;
+
+      /* Every private array must be complete before the merge */
+#     pragma omp barrier
+#     pragma omp for schedule(static)
+      for (b = 0; b < bin_count; b++)
+         Merge_counts(private_counts, thread_count, stride, b, b+1,
+               bin_counts);
+   }
+   finish = omp_get_wtime();
+
+   Print_histo(&bins, bin_counts);
+   printf("Outside [%.3f, %.3f):\t%ld\n", min_meas,
+         bins.bin_maxes[bin_count-1], out);
+   printf("%ld measurements, elapsed time = %e seconds\n",
+         total_count, finish - start);
+   if (g_f != 'g') {
+      printf("Read:   %ld bytes, %e seconds, %.1f MB/s\n", total_bytes,
+            max_read, (max_read > 0.0) ? total_bytes/max_read/1.0e6 : 0.0);
+      printf("Count:  %e seconds\n", max_count);
+   }
+
+   free(private_counts);
+   free(bin_counts);
+   Bins_free(&bins);
+   return 0;
+}  /* main */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run program and quit
+ * In arg:    prog_name:  the name of the program from the command line
+ */
+void Usage(char prog_name[] /* in */) {
+   fprintf(stderr, "usage: %s ", prog_name);
+   fprintf(stderr, "<thread_count> <bin_count> <min_meas> <max_meas> ");
+   fprintf(stderr, "<g|b|t> <data_count|file> [s | e <edges>]\n");
+   fprintf(stderr, "   g: generate data_count random measurements\n");
+   fprintf(stderr, "   b: read binary floats from file\n");
+   fprintf(stderr, "   t: read text floats from file\n");
+   fprintf(stderr, "   s: use binary search instead of O(1) lookup\n");
+   fprintf(stderr, "   e: read the upper edges of the bins from edges\n");
+   exit(0);
+}  /* Usage */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get the command line arguments
+ */
+void Get_args(int argc, char* argv[], int* thread_count_p,
+      int* bin_count_p, float* min_meas_p, float* max_meas_p, char* g_f_p,
+      long* data_count_p, char file_name[], int* use_search_p,
+      char edges_file[]) {
+
+   if (argc < 7 || argc > 9) Usage(argv[0]);
+   *thread_count_p = strtol(argv[1], NULL, 10);
+   *bin_count_p = strtol(argv[2], NULL, 10);
+   *min_meas_p = strtof(argv[3], NULL);
+   *max_meas_p = strtof(argv[4], NULL);
+   *g_f_p = argv[5][0];
+   *data_count_p = 0;
+   if (*g_f_p == 'g') {
+      *data_count_p = strtol(argv[6], NULL, 10);
+   } else if (*g_f_p == 'b' || *g_f_p == 't') {
+      strncpy(file_name, argv[6], 255);
+      file_name[255] = '\0';
+   } else {
+      Usage(argv[0]);
+   }
+   *use_search_p = 0;
+   edges_file[0] = '\0';
+   if (argc == 8) {
+      if (argv[7][0] != 's') Usage(argv[0]);
+      *use_search_p = 1;
+   } else if (argc == 9) {
+      if (argv[7][0] != 'e') Usage(argv[0]);
+      strncpy(edges_file, argv[8], 255);
+      edges_file[255] = '\0';
+   }
+   if (*thread_count_p <= 0 || *bin_count_p <= 0 ||
+         !(*min_meas_p < *max_meas_p) || *data_count_p < 0)
+      Usage(argv[0]);
+
+#  ifdef DEBUG
+   printf("thread_count = %d, bin_count = %d\n", *thread_count_p,
+         *bin_count_p);
+   printf("min_meas = %f, max_meas = %f\n", *min_meas_p, *max_meas_p);
+#  endif
+}  /* Get_args */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Count_generated
+ * Purpose:   Generate and count my_count random measurements,
+ *            CHUNK_FLOATS of them at a time
+ * In args:   my_count, bins, use_search, seed
+ * In/out:    my_counts:  this thread's private bin counts
+ * Ret val:   number of measurements outside the bins
+ */
+long Count_generated(long my_count, bins_t* bins, int use_search,
+      long my_counts[], unsigned seed) {
+   float* data = malloc(CHUNK_FLOATS*sizeof(float));
+   long done, out = 0;
+   int chunk;
+
+   for (done = 0; done < my_count; done += chunk) {
+      chunk = (my_count - done < CHUNK_FLOATS) ? my_count - done
+         : CHUNK_FLOATS;
+      Gen_chunk(data, chunk, bins->min_meas,
+            bins->bin_maxes[bins->bin_count-1], &seed);
+      out += Count_bins(data, chunk, bins, my_counts, use_search);
+   }
+
+   free(data);
+   return out;
+}  /* Count_generated */
+
+/*---------------------------------------------------------------------
+ * Function:  Count_file
+ * Purpose:   Count the measurements in the calling thread's part of
+ *            the file
+ * In args:   file_name, g_f, bins, use_search
+ * In/out:    my_counts:     this thread's private bin counts
+ * Out args:  my_count_p:    number of measurements in the part
+ *            bytes_p:       number of bytes read
+ *            read_time_p:   time spent reading
+ *            count_time_p:  time spent counting
+ * Ret val:   number of measurements outside the bins
+ */
+long Count_file(char file_name[], char g_f, bins_t* bins, int use_search,
+      long my_counts[], long* my_count_p, long* bytes_p, double* read_time_p,
+      double* count_time_p) {
+   stream_t s;
+   float* data;
+   long chunk, my_count = 0, out = 0;
+   double start, finish;
+
+   if (Stream_open(&s, file_name, (g_f == 'b') ? STREAM_BINARY :
+            STREAM_TEXT, STREAM_FLOAT, omp_get_thread_num(),
+            omp_get_num_threads()) != 0) {
+      fprintf(stderr, "Thread %d > Can't open %s\n", omp_get_thread_num(),
+            file_name);
+      exit(-1);
+   }
+
+   start = omp_get_wtime();
+   while ((chunk = Stream_next(&s, (void**) &data)) > 0) {
+      out += Count_bins(data, chunk, bins, my_counts, use_search);
+      my_count += chunk;
+   }
+   finish = omp_get_wtime();
+   Stream_close(&s);
+
+   *my_count_p = my_count;
+   *bytes_p = s.bytes_read;
+   *read_time_p = s.read_time;
+   *count_time_p = finish - start - s.wait_time;
+   return out;
+}  /* Count_file */
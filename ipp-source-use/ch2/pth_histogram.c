@@ -0,0 +1,314 @@
+/* File:      pth_histogram.c
+ * Purpose:   Build a histogram with Pthreads.  Each thread counts the
+ *            measurements in a block of the data in its own private
+ *            array of bin counts, and after a barrier the threads merge
+ *            the private arrays, each thread merging a block of bins.
+ *
+ * Compile:   gcc -g -Wall -O3 -fopenmp-simd -I../ch4 -o pth_histogram
+ *               pth_histogram.c histo.c stream.c -lpthread
+ * Run:       ./pth_histogram <thread_count> <bin_count> <min_meas>
+ *               <max_meas> <g|b|t> <data_count|file> [s | e <edges>]
+ *
+ * Input:     None in g mode:  data_count random measurements are
+ *               generated.
+ *            In b mode, the measurements are read from file, a binary
+ *               file of floats (native byte order, no header).
+ *            In t mode, file is a text file of floats separated by
+ *               white space.
+ *            If the optional last argument is "s", bins are found with
+ *               the branchless binary search instead of the O(1)
+ *               arithmetic lookup.
+ *            If the optional last arguments are "e" and a file name,
+ *               edges is a text file of bin_count increasing upper
+ *               edges of the bins, the last of which replaces
+ *               max_meas.  The bins are found with the binary search.
+ * Output:    The number of measurements in each bin and the cumulative
+ *            number up to and including the bin, the number that
+ *            are outside [min_meas, max_meas), and the elapsed time.
+ *            In b and t modes, also the time spent reading and the
+ *            read bandwidth, and the time spent counting.
+ *
+ * Notes:
+ * 1.  Measurements y in bin i satisfy bin_maxes[i-1] <= y < bin_maxes[i]
+ *     (bin_maxes[-1] = min_meas), as in histogram.c
+ * 2.  The data is never stored in full:  each thread generates
+ *     CHUNK_FLOATS measurements at a time, or reads its part of the
+ *     file through a stream (stream.c) with a reader thread and two
+ *     buffers, so the number of measurements is only limited by the
+ *     size of a long.
+ * 3.  DEBUG compile flag gives verbose output
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "histo.h"
+#include "stream.h"
+#include "timer.h"
+
+/* Global variables:  shared by the threads, not modified after the
+ * threads are started, except for the per-thread arrays, in which
+ * each thread only writes its own entries. */
+int      thread_count;
+bins_t   bins;
+char     g_f;
+char     file_name[256];
+char     edges_file[256] = "";
+long     data_count;
+int      use_search = 0;
+long*    private_counts;
+int      stride;
+long*    bin_counts;
+long*    out_counts;
+long*    my_data_counts;
+double*  read_times;
+double*  count_times;
+long*    bytes_read;
+pthread_barrier_t barrier;
+
+void Usage(char prog_name[]);
+void Get_args(int argc, char* argv[], int* bin_count_p, float* min_meas_p,
+      float* max_meas_p);
+long Count_generated(long my_rank, long my_counts[]);
+long Count_file(long my_rank, long my_counts[]);
+void* Thread_work(void* rank);
+
+/*---------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int bin_count, t;
+   float min_meas, max_meas;
+   long thread, out = 0, total_bytes = 0;
+   pthread_t* thread_handles;
+   double start, finish, max_read = 0.0, max_count = 0.0;
+
+   Get_args(argc, argv, &bin_count, &min_meas, &max_meas);
+
+   if (edges_file[0] == '\0') {
+      Bins_init_uniform(&bins, bin_count, min_meas, max_meas);
+   } else if (!Bins_read_edges(&bins, bin_count, min_meas, edges_file)) {
+      fprintf(stderr, "Can't read %d increasing edges from %s\n",
+            bin_count, edges_file);
+      exit(-1);
+   }
+   bin_counts = malloc(bin_count*sizeof(long));
+   out_counts = malloc(thread_count*sizeof(long));
+   my_data_counts = malloc(thread_count*sizeof(long));
+   read_times = malloc(thread_count*sizeof(double));
+   count_times = malloc(thread_count*sizeof(double));
+   bytes_read = malloc(thread_count*sizeof(long));
+   private_counts = Alloc_private_counts(thread_count, bin_count, &stride);
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   if (bin_counts == NULL || out_counts == NULL || my_data_counts == NULL
+         || read_times == NULL || count_times == NULL || bytes_read == NULL
+         || private_counts == NULL || thread_handles == NULL) {
+      fprintf(stderr, "Can't allocate storage\n");
+      exit(-1);
+   }
+   pthread_barrier_init(&barrier, NULL, thread_count);
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL, Thread_work,
+            (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+
+   data_count = 0;
+   for (t = 0; t < thread_count; t++) {
+      out += out_counts[t];
+      data_count += my_data_counts[t];
+      total_bytes += bytes_read[t];
+      if (read_times[t] > max_read) max_read = read_times[t];
+      if (count_times[t] > max_count) max_count = count_times[t];
+   }
+
+   Print_histo(&bins, bin_counts);
+   printf("Outside [%.3f, %.3f):\t%ld\n", min_meas,
+         bins.bin_maxes[bin_count-1], out);
+   printf("%ld measurements, elapsed time = %e seconds\n",
+         data_count, finish - start);
+   if (g_f != 'g') {
+      printf("Read:   %ld bytes, %e seconds, %.1f MB/s\n", total_bytes,
+            max_read, (max_read > 0.0) ? total_bytes/max_read/1.0e6 : 0.0);
+      printf("Count:  %e seconds\n", max_count);
+   }
+
+   pthread_barrier_destroy(&barrier);
+   free(thread_handles);
+   free(private_counts);
+   free(bytes_read);
+   free(count_times);
+   free(read_times);
+   free(my_data_counts);
+   free(out_counts);
+   free(bin_counts);
+   Bins_free(&bins);
+   return 0;
+}  /* main */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run program and quit
+ * In arg:    prog_name:  the name of the program from the command line
+ */
+void Usage(char prog_name[] /* in */) {
+   fprintf(stderr, "usage: %s ", prog_name);
+   fprintf(stderr, "<thread_count> <bin_count> <min_meas> <max_meas> ");
+   fprintf(stderr, "<g|b|t> <data_count|file> [s | e <edges>]\n");
+   fprintf(stderr, "   g: generate data_count random measurements\n");
+   fprintf(stderr, "   b: read binary floats from file\n");
+   fprintf(stderr, "   t: read text floats from file\n");
+   fprintf(stderr, "   s: use binary search instead of O(1) lookup\n");
+   fprintf(stderr, "   e: read the upper edges of the bins from edges\n");
+   exit(0);
+}  /* Usage */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get the command line arguments
+ * In args:   argc, argv
+ * Out args:  bin_count_p, min_meas_p, max_meas_p
+ * Globals:   thread_count, g_f, file_name, data_count, use_search,
+ *            edges_file
+ */
+void Get_args(int argc, char* argv[], int* bin_count_p, float* min_meas_p,
+      float* max_meas_p) {
+
+   if (argc < 7 || argc > 9) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   *bin_count_p = strtol(argv[2], NULL, 10);
+   *min_meas_p = strtof(argv[3], NULL);
+   *max_meas_p = strtof(argv[4], NULL);
+   g_f = argv[5][0];
+   if (g_f == 'g') {
+      data_count = strtol(argv[6], NULL, 10);
+   } else if (g_f == 'b' || g_f == 't') {
+      strncpy(file_name, argv[6], 255);
+      file_name[255] = '\0';
+   } else {
+      Usage(argv[0]);
+   }
+   if (argc == 8) {
+      if (argv[7][0] != 's') Usage(argv[0]);
+      use_search = 1;
+   } else if (argc == 9) {
+      if (argv[7][0] != 'e') Usage(argv[0]);
+      strncpy(edges_file, argv[8], 255);
+      edges_file[255] = '\0';
+   }
+   if (thread_count <= 0 || *bin_count_p <= 0 ||
+         !(*min_meas_p < *max_meas_p) || (g_f == 'g' && data_count < 0))
+      Usage(argv[0]);
+
+#  ifdef DEBUG
+   printf("thread_count = %d, bin_count = %d\n", thread_count,
+         *bin_count_p);
+   printf("min_meas = %f, max_meas = %f\n", *min_meas_p, *max_meas_p);
+#  endif
+}  /* Get_args */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Count_generated
+ * Purpose:   Generate and count this thread's block of data_count
+ *            random measurements
+ * In arg:    my_rank
+ * In/out:    my_counts:  this thread's private bin counts
+ * Ret val:   number of measurements outside the bins
+ */
+long Count_generated(long my_rank, long my_counts[]) {
+   long quotient = data_count/thread_count;
+   long remainder = data_count % thread_count;
+   long my_count, done, out = 0;
+   int chunk;
+   unsigned seed = my_rank + 1;
+   float* data = malloc(CHUNK_FLOATS*sizeof(float));
+
+   my_count = (my_rank < remainder) ? quotient + 1 : quotient;
+   for (done = 0; done < my_count; done += chunk) {
+      chunk = (my_count - done < CHUNK_FLOATS) ? my_count - done
+         : CHUNK_FLOATS;
+      Gen_chunk(data, chunk, bins.min_meas,
+            bins.bin_maxes[bins.bin_count-1], &seed);
+      out += Count_bins(data, chunk, &bins, my_counts, use_search);
+   }
+   my_data_counts[my_rank] = my_count;
+
+   free(data);
+   return out;
+}  /* Count_generated */
+
+/*---------------------------------------------------------------------
+ * Function:  Count_file
+ * Purpose:   Count the measurements in this thread's part of the file
+ * In arg:    my_rank
+ * In/out:    my_counts:  this thread's private bin counts
+ * Ret val:   number of measurements outside the bins
+ */
+long Count_file(long my_rank, long my_counts[]) {
+   stream_t s;
+   float* data;
+   long chunk, my_count = 0, out = 0;
+   double start, finish;
+
+   if (Stream_open(&s, file_name, (g_f == 'b') ? STREAM_BINARY :
+            STREAM_TEXT, STREAM_FLOAT, my_rank, thread_count) != 0) {
+      fprintf(stderr, "Thread %ld > Can't open %s\n", my_rank, file_name);
+      exit(-1);
+   }
+
+   GET_TIME(start);
+   while ((chunk = Stream_next(&s, (void**) &data)) > 0) {
+      out += Count_bins(data, chunk, &bins, my_counts, use_search);
+      my_count += chunk;
+   }
+   GET_TIME(finish);
+   Stream_close(&s);
+
+   my_data_counts[my_rank] = my_count;
+   read_times[my_rank] = s.read_time;
+   count_times[my_rank] = finish - start - s.wait_time;
+   bytes_read[my_rank] = s.bytes_read;
+   return out;
+}  /* Count_file */
+
+/*---------------------------------------------------------------------
+ * Function:  Thread_work
+ * Purpose:   Count the measurements in this thread's block of the
+ *            data, then merge this thread's block of bins
+ * In arg:    rank
+ * Globals in:   thread_count, bins, g_f, data_count, use_search, stride
+ * Globals out:  private_counts, bin_counts, out_counts, my_data_counts,
+ *               read_times, count_times, bytes_read
+ */
+void* Thread_work(void* rank) {
+   long my_rank = (long) rank;
+   long* my_counts = private_counts + my_rank*stride;
+   int bin_count = bins.bin_count;
+   int my_first_bin, my_last_bin;
+
+   read_times[my_rank] = count_times[my_rank] = 0.0;
+   bytes_read[my_rank] = 0;
+   if (g_f == 'g')
+      out_counts[my_rank] = Count_generated(my_rank, my_counts);
+   else
+      out_counts[my_rank] = Count_file(my_rank, my_counts);
+
+#  ifdef DEBUG
+   printf("Thread %ld > counted %ld measurements\n", my_rank,
+         my_data_counts[my_rank]);
+#  endif
+
+   pthread_barrier_wait(&barrier);
+
+   /* Block distribution of the bins for the merge */
+   my_first_bin = my_rank*bin_count/thread_count;
+   my_last_bin = (my_rank+1)*bin_count/thread_count;
+   Merge_counts(private_counts, thread_count, stride, my_first_bin,
+         my_last_bin, bin_counts);
+
+   return NULL;
+}  /* Thread_work */
@@ -0,0 +1,281 @@
+/* File:     stream.c
+ *
+ * Purpose:  Read ints or floats from a binary or a text file one
+ *           chunk at a time, so that files much larger than memory
+ *           can be processed.
+ *
+ * Stream_open:   Open part "part" of a file that is split into
+ *                part_count parts, and start a reader thread for it.
+ * Stream_next:   Get the next block of values.
+ * Stream_close:  Stop the reader thread and close the file.
+ *
+ * Notes:
+ * 1.  Each stream has a reader thread and two buffers.  The reader
+ *     fills one buffer with pread while the user works on the values
+ *     in the other, so reading overlaps computation.
+ * 2.  Binary files contain 4-byte ints or floats in native byte order
+ *     and no header.  The parts contain the same number of values,
+ *     give or take one.
+ * 3.  Text files contain values separated by white space.  A text file
+ *     is split into parts of the same number of bytes, and a value
+ *     belongs to the part containing its first character.
+ * 4.  read_time is the time the reader spent in pread, so bytes_read/
+ *     read_time is the read bandwidth.  wait_time is the time the user
+ *     spent waiting for the reader:  if it's small compared to the
+ *     user's total time, the computation is the bottleneck.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "stream.h"
+#include "timer.h"
+
+static off_t Skip_token(int fd, off_t off, off_t size);
+static void* Reader(void* arg);
+static long Parse_text(stream_t* s, char data[], size_t len, int last);
+
+/*---------------------------------------------------------------------
+ * Function:  Stream_open
+ * Purpose:   Open part "part" of fname and start reading it
+ * In args:   fname, fmt, type
+ *            part, part_count:  the file is split into part_count
+ *                parts; 0 <= part < part_count
+ * Out arg:   s
+ * Ret val:   0 on success, -1 if the file can't be opened
+ */
+int Stream_open(stream_t* s, char fname[], stream_fmt_t fmt,
+      stream_type_t type, int part, int part_count) {
+   struct stat st;
+   off_t size, start, end;
+   long count;
+   size_t val_size = (type == STREAM_INT) ? sizeof(int) : sizeof(float);
+   char c;
+   int b;
+
+   memset(s, 0, sizeof(stream_t));
+   s->fd = open(fname, O_RDONLY);
+   if (s->fd < 0 || fstat(s->fd, &st) != 0) return -1;
+   size = st.st_size;
+   s->fmt = fmt;
+   s->type = type;
+
+   if (fmt == STREAM_BINARY) {
+      count = size/val_size;
+      start = (off_t) ((double) count*part/part_count)*val_size;
+      end = (off_t) ((double) count*(part+1)/part_count)*val_size;
+   } else {
+      start = (off_t) ((double) size*part/part_count);
+      end = (off_t) ((double) size*(part+1)/part_count);
+      /* A token that starts in an earlier part belongs to that part */
+      if (start > 0 && pread(s->fd, &c, 1, start-1) == 1
+            && !isspace((unsigned char) c))
+         start = Skip_token(s->fd, start, size);
+      if (end > 0 && end < size && pread(s->fd, &c, 1, end-1) == 1
+            && !isspace((unsigned char) c))
+         end = Skip_token(s->fd, end, size);
+      s->values = malloc((STREAM_CHUNK/2 + STREAM_MAX_TOKEN)*val_size);
+   }
+   if (part == part_count-1) end = (fmt == STREAM_BINARY) ?
+      (off_t) ((size/val_size)*val_size) : size;
+   if (end < start) end = start;
+   s->pos = start;
+   s->end = end;
+
+   for (b = 0; b < 2; b++)
+      s->raw[b] = malloc(STREAM_MAX_TOKEN + STREAM_CHUNK + 1);
+   s->held = -1;
+   pthread_mutex_init(&s->mutex, NULL);
+   pthread_cond_init(&s->cond, NULL);
+   pthread_create(&s->reader, NULL, Reader, s);
+   return 0;
+}  /* Stream_open */
+
+/*---------------------------------------------------------------------
+ * Function:  Skip_token
+ * Purpose:   Return the offset of the first white space character at
+ *            or after off (or size if there isn't one)
+ */
+static off_t Skip_token(int fd, off_t off, off_t size) {
+   char buf[STREAM_MAX_TOKEN];
+   ssize_t got;
+   int i;
+
+   while (off < size) {
+      got = pread(fd, buf, STREAM_MAX_TOKEN, off);
+      if (got <= 0) return size;
+      for (i = 0; i < got; i++)
+         if (isspace((unsigned char) buf[i])) return off + i;
+      off += got;
+   }
+   return size;
+}  /* Skip_token */
+
+/*---------------------------------------------------------------------
+ * Function:  Reader
+ * Purpose:   Thread function:  fill the two buffers alternately until
+ *            the end of the part is reached
+ */
+static void* Reader(void* arg) {
+   stream_t* s = (stream_t*) arg;
+   int b = 0, last = 0, stop;
+   size_t len;
+   ssize_t got;
+   double start, finish;
+
+   while (!last) {
+      pthread_mutex_lock(&s->mutex);
+      while (s->full[b] && !s->stop)
+         pthread_cond_wait(&s->cond, &s->mutex);
+      stop = s->stop;
+      pthread_mutex_unlock(&s->mutex);
+      if (stop) break;
+
+      len = (s->end - s->pos < STREAM_CHUNK) ? s->end - s->pos
+         : STREAM_CHUNK;
+      GET_TIME(start);
+      got = (len > 0) ? pread(s->fd, s->raw[b] + STREAM_MAX_TOKEN, len,
+            s->pos) : 0;
+      GET_TIME(finish);
+      if (got < (ssize_t) len) {
+         fprintf(stderr, "Stream:  short read at offset %ld\n",
+               (long) s->pos);
+         len = (got > 0) ? got : 0;
+         last = 1;
+      }
+      s->pos += len;
+      s->read_time += finish - start;
+      s->bytes_read += len;
+      if (s->pos >= s->end) last = 1;
+
+      pthread_mutex_lock(&s->mutex);
+      s->raw_len[b] = len;
+      s->last[b] = last;
+      s->full[b] = 1;
+      pthread_cond_broadcast(&s->cond);
+      pthread_mutex_unlock(&s->mutex);
+      b = 1 - b;
+   }
+   return NULL;
+}  /* Reader */
+
+/*---------------------------------------------------------------------
+ * Function:  Stream_next
+ * Purpose:   Get the next block of values
+ * In/out:    s
+ * Out arg:   values_pp:  the values (ints or floats).  They're valid
+ *                        until the next call to Stream_next or
+ *                        Stream_close.
+ * Ret val:   the number of values, 0 at the end of the part
+ */
+long Stream_next(stream_t* s, void** values_pp) {
+   long count = 0;
+   int b;
+   double start, finish;
+
+   while (count == 0 && !s->done) {
+      /* Give the buffer we had back to the reader */
+      if (s->held >= 0) {
+         pthread_mutex_lock(&s->mutex);
+         s->full[s->held] = 0;
+         pthread_cond_broadcast(&s->cond);
+         pthread_mutex_unlock(&s->mutex);
+         s->held = -1;
+      }
+
+      b = s->next;
+      GET_TIME(start);
+      pthread_mutex_lock(&s->mutex);
+      while (!s->full[b])
+         pthread_cond_wait(&s->cond, &s->mutex);
+      pthread_mutex_unlock(&s->mutex);
+      GET_TIME(finish);
+      s->wait_time += finish - start;
+      s->held = b;
+      s->next = 1 - b;
+      if (s->last[b]) s->done = 1;
+
+      if (s->fmt == STREAM_BINARY) {
+         *values_pp = s->raw[b] + STREAM_MAX_TOKEN;
+         count = s->raw_len[b]/sizeof(int);
+      } else {
+         count = Parse_text(s, s->raw[b] + STREAM_MAX_TOKEN, s->raw_len[b],
+               s->last[b]);
+         *values_pp = s->values;
+      }
+   }
+   return count;
+}  /* Stream_next */
+
+/*---------------------------------------------------------------------
+ * Function:  Parse_text
+ * Purpose:   Convert the tokens in a text buffer to values.  A token
+ *            that runs off the end of the buffer is saved in s->carry
+ *            and put in front of the next buffer.
+ * In args:   data:  the buffer; there are STREAM_MAX_TOKEN free bytes
+ *                   in front of it and one after it
+ *            len:   number of bytes in data
+ *            last:  1 if this is the last buffer of the part
+ * Ret val:   number of values stored in s->values
+ */
+static long Parse_text(stream_t* s, char data[], size_t len, int last) {
+   char *p, *end, *tok;
+   int* ivals = (int*) s->values;
+   float* fvals = (float*) s->values;
+   long count = 0;
+
+   /* Put the end of the last buffer's partial token in front */
+   data -= s->carry_len;
+   memcpy(data, s->carry, s->carry_len);
+   len += s->carry_len;
+   s->carry_len = 0;
+   data[len] = '\0';
+   p = data;
+   end = data + len;
+
+   while (1) {
+      while (p < end && isspace((unsigned char) *p)) p++;
+      if (p == end) break;
+      tok = p;
+      while (p < end && !isspace((unsigned char) *p)) p++;
+      if (p == end && !last) {
+         s->carry_len = p - tok;
+         if (s->carry_len >= STREAM_MAX_TOKEN) {
+            fprintf(stderr, "Stream:  token longer than %d bytes\n",
+                  STREAM_MAX_TOKEN);
+            s->carry_len = STREAM_MAX_TOKEN - 1;
+         }
+         memcpy(s->carry, tok, s->carry_len);
+         break;
+      }
+      if (s->type == STREAM_INT)
+         ivals[count++] = strtol(tok, NULL, 10);
+      else
+         fvals[count++] = strtof(tok, NULL);
+   }
+   return count;
+}  /* Parse_text */
+
+/*---------------------------------------------------------------------
+ * Function:  Stream_close
+ * Purpose:   Stop the reader thread, close the file and free storage.
+ *            The statistics in s are still valid.
+ */
+void Stream_close(stream_t* s) {
+   pthread_mutex_lock(&s->mutex);
+   s->stop = 1;
+   pthread_cond_broadcast(&s->cond);
+   pthread_mutex_unlock(&s->mutex);
+   pthread_join(s->reader, NULL);
+
+   pthread_mutex_destroy(&s->mutex);
+   pthread_cond_destroy(&s->cond);
+   close(s->fd);
+   free(s->raw[0]);
+   free(s->raw[1]);
+   free(s->values);
+   s->values = NULL;
+}  /* Stream_close */
@@ -0,0 +1,59 @@
+/* File:     stream.h
+ * Purpose:  Header file for stream.c, which implements chunked,
+ *           double-buffered input of ints or floats from binary or
+ *           text files.
+ */
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+
+/* Bytes read from the file with one call */
+#define STREAM_CHUNK (1 << 20)
+
+/* Longest token allowed in a text file */
+#define STREAM_MAX_TOKEN 64
+
+typedef enum { STREAM_BINARY, STREAM_TEXT } stream_fmt_t;
+typedef enum { STREAM_INT, STREAM_FLOAT } stream_type_t;
+
+typedef struct {
+   int            fd;
+   stream_fmt_t   fmt;
+   stream_type_t  type;
+   off_t          pos;          /* Next byte the reader will read      */
+   off_t          end;          /* End of this stream's part           */
+
+   /* Double buffers:  raw[b] has STREAM_MAX_TOKEN bytes of headroom
+    * in front of the data, so a partial token from the previous
+    * buffer can be put in front of it without copying the data. */
+   char*          raw[2];
+   size_t         raw_len[2];   /* Bytes of data in raw[b]             */
+   int            full[2];      /* 1 if raw[b] is ready for the user   */
+   int            last[2];      /* 1 if raw[b] is the last buffer      */
+   int            next;         /* Buffer the user takes next          */
+   int            held;         /* Buffer the user has, or -1          */
+   int            done;         /* 1 after the last buffer was taken   */
+   int            stop;         /* 1 if the reader should quit early   */
+   pthread_t      reader;
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+
+   /* Text only */
+   char           carry[STREAM_MAX_TOKEN];
+   int            carry_len;
+   void*          values;       /* Parsed values                       */
+
+   /* Statistics */
+   long           bytes_read;
+   double         read_time;    /* Time the reader spent in pread      */
+   double         wait_time;    /* Time the user waited for the reader */
+}  stream_t;
+
+int  Stream_open(stream_t* s, char fname[], stream_fmt_t fmt,
+      stream_type_t type, int part, int part_count);
+long Stream_next(stream_t* s, void** values_pp);
+void Stream_close(stream_t* s);
+
+#endif
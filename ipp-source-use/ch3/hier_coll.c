@@ -0,0 +1,176 @@
+/* File:     hier_coll.c
+ *
+ * Purpose:  Two-level (node-aware) collectives for doubles.  With many
+ *           processes per node, a flat MPI_Reduce or MPI_Bcast on
+ *           MPI_COMM_WORLD sends messages between processes that could
+ *           just read each other's memory, and the tree it uses may
+ *           cross between nodes several times.  Here
+ *
+ *           Hier_reduce_sum:  each process writes its values into its
+ *              slot in a window shared by the processes on its node.
+ *              After a barrier on the node, the node's leader adds the
+ *              slots, and the leaders do an MPI_Reduce.
+ *           Hier_bcast:  the leaders do an MPI_Bcast, each leader
+ *              writes the values into its slot, and after a barrier
+ *              on the node, the other processes copy them.
+ *
+ *           So only one process per node takes part in inter-node
+ *           communication, and intra-node communication is a barrier
+ *           and loads and stores.
+ *
+ * Compile:  Add hier_coll.c to the compile command of the program
+ *
+ * Notes:
+ * 1.  The root of the collectives is process 0 in comm.  The node and
+ *     leader communicators are ordered by rank in comm, so process 0
+ *     is the leader of its node and process 0 among the leaders.
+ * 2.  The window is locked (MPI_Win_lock_all) for the lifetime of the
+ *     hier_comm_t.  Stores and loads are ordered with MPI_Win_sync
+ *     before and after the node barrier.
+ * 3.  Each slot has two halves, and consecutive operations use
+ *     different halves.  So a process can start the next operation
+ *     and write its slot while its leader is still reading the values
+ *     from this one:  it can't get two operations ahead, since the
+ *     barrier in the next operation waits for the leader.
+ * 4.  The sums on a node are added in node rank order, so the result
+ *     can differ in the last bits from MPI_Reduce's.
+ * 5.  Requires MPI-3.
+ *
+ * IPP:  Section 3.4 (pp. 101 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "hier_coll.h"
+
+static double* Half(hier_comm_t* h, int q);
+static void Node_sync(hier_comm_t* h);
+
+
+/*---------------------------------------------------------------------
+ * Function:  Hier_init
+ * Purpose:   Build the node and leader communicators and the shared
+ *            window for collectives on up to max_count doubles
+ * In args:   comm, max_count
+ * Out arg:   h
+ * Note:      Collective on comm
+ */
+void Hier_init(MPI_Comm comm, int max_count, hier_comm_t* h) {
+   int my_rank, q, disp_unit;
+   MPI_Aint size;
+   double* my_slot;
+
+   h->comm = comm;
+   h->max_count = max_count;
+   h->gen = 0;
+   MPI_Comm_rank(comm, &my_rank);
+
+   MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, my_rank,
+         MPI_INFO_NULL, &h->node_comm);
+   MPI_Comm_rank(h->node_comm, &h->node_rank);
+   MPI_Comm_size(h->node_comm, &h->node_sz);
+   MPI_Comm_split(comm, h->node_rank == 0 ? 0 : MPI_UNDEFINED, my_rank,
+         &h->leader_comm);
+   if (h->node_rank == 0)
+      MPI_Comm_size(h->leader_comm, &h->node_count);
+   MPI_Bcast(&h->node_count, 1, MPI_INT, 0, h->node_comm);
+
+   MPI_Win_allocate_shared(2*max_count*sizeof(double), sizeof(double),
+         MPI_INFO_NULL, h->node_comm, &my_slot, &h->win);
+   h->slots = malloc(h->node_sz*sizeof(double*));
+   for (q = 0; q < h->node_sz; q++)
+      MPI_Win_shared_query(h->win, q, &size, &disp_unit, &h->slots[q]);
+   MPI_Win_lock_all(MPI_MODE_NOCHECK, h->win);
+
+   h->node_sum = malloc(max_count*sizeof(double));
+}  /* Hier_init */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Hier_reduce_sum
+ * Purpose:   Add the count doubles in local over all the processes in
+ *            h->comm, and store the sums in total on process 0
+ * In args:   local, count (<= h->max_count)
+ * Out arg:   total (only significant on process 0)
+ * In/out:    h
+ */
+void Hier_reduce_sum(hier_comm_t* h, double local[], double total[],
+      int count) {
+   int q, i;
+   double* slot;
+
+   memcpy(Half(h, h->node_rank), local, count*sizeof(double));
+   Node_sync(h);
+
+   if (h->node_rank == 0) {
+      memcpy(h->node_sum, Half(h, 0), count*sizeof(double));
+      for (q = 1; q < h->node_sz; q++) {
+         slot = Half(h, q);
+         for (i = 0; i < count; i++)
+            h->node_sum[i] += slot[i];
+      }
+      if (h->node_count > 1)
+         MPI_Reduce(h->node_sum, total, count, MPI_DOUBLE, MPI_SUM, 0,
+               h->leader_comm);
+      else
+         memcpy(total, h->node_sum, count*sizeof(double));
+   }
+   h->gen++;
+}  /* Hier_reduce_sum */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Hier_bcast
+ * Purpose:   Broadcast count doubles from process 0 in h->comm
+ * In/out:    buf:  in on process 0, out on the other processes
+ *            h
+ */
+void Hier_bcast(hier_comm_t* h, double buf[], int count) {
+   if (h->node_rank == 0) {
+      if (h->node_count > 1)
+         MPI_Bcast(buf, count, MPI_DOUBLE, 0, h->leader_comm);
+      memcpy(Half(h, 0), buf, count*sizeof(double));
+   }
+   Node_sync(h);
+   if (h->node_rank != 0)
+      memcpy(buf, Half(h, 0), count*sizeof(double));
+   h->gen++;
+}  /* Hier_bcast */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Hier_free
+ * Purpose:   Free the window, communicators and storage
+ * Note:      Collective on h->comm
+ */
+void Hier_free(hier_comm_t* h) {
+   MPI_Win_unlock_all(h->win);
+   MPI_Win_free(&h->win);
+   free(h->slots);
+   free(h->node_sum);
+   if (h->leader_comm != MPI_COMM_NULL) MPI_Comm_free(&h->leader_comm);
+   MPI_Comm_free(&h->node_comm);
+}  /* Hier_free */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Half
+ * Purpose:   Return the half of node rank q's slot used by the current
+ *            operation
+ */
+static double* Half(hier_comm_t* h, int q) {
+   return h->slots[q] + (h->gen % 2)*h->max_count;
+}  /* Half */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Node_sync
+ * Purpose:   Make the stores to the window by each process on the node
+ *            visible to the others
+ */
+static void Node_sync(hier_comm_t* h) {
+   MPI_Win_sync(h->win);
+   MPI_Barrier(h->node_comm);
+   MPI_Win_sync(h->win);
+}  /* Node_sync */
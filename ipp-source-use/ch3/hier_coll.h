@@ -0,0 +1,35 @@
+/* File:     hier_coll.h
+ * Purpose:  Header file for hier_coll.c, which implements two-level
+ *           (node-aware) reduce and broadcast:  through shared memory
+ *           among the processes on a node, and with MPI among one
+ *           leader process per node.
+ */
+#ifndef _HIER_COLL_H_
+#define _HIER_COLL_H_
+
+#include <mpi.h>
+
+typedef struct {
+   MPI_Comm  comm;          /* The communicator the collectives use     */
+   MPI_Comm  node_comm;     /* Processes that share memory with me      */
+   MPI_Comm  leader_comm;   /* Node rank 0 of each node; MPI_COMM_NULL
+                             * on the other processes                   */
+   int       node_rank;
+   int       node_sz;
+   int       node_count;
+   int       max_count;     /* Doubles per operation                    */
+   MPI_Win   win;
+   double**  slots;         /* slots[q]:  2*max_count doubles belonging
+                             * to node rank q, in the shared window     */
+   double*   node_sum;      /* Leader's sum of the node's values        */
+   int       gen;           /* Number of operations done, mod 2 selects
+                             * the half of each slot to use             */
+}  hier_comm_t;
+
+void Hier_init(MPI_Comm comm, int max_count, hier_comm_t* h);
+void Hier_reduce_sum(hier_comm_t* h, double local[], double total[],
+      int count);
+void Hier_bcast(hier_comm_t* h, double buf[], int count);
+void Hier_free(hier_comm_t* h);
+
+#endif
@@ -0,0 +1,522 @@
+/* File:     local_sort.c
+ *
+ * Purpose:  Local sorting and merging for the odd-even sort programs
+ *
+ * Radix_sort:       LSD radix sort of ints
+ * Radix_sort_omp:   LSD radix sort of ints with OpenMP threads
+ * Local_sort:       Sort an array of ints with Radix_sort_omp if the
+ *                   program is compiled with OpenMP, and Radix_sort
+ *                   otherwise.  Replaces qsort(..., Compare).
+ * Merge_simd:       Merge two sorted arrays
+ * Merge_low_simd:   Put the smallest n keys of two sorted arrays of n
+ *                   keys in a third array.  Replaces Merge_low.
+ * Merge_high_simd:  Put the largest n keys of two sorted arrays of n
+ *                   keys in a third array.  Replaces Merge_high.
+ * Block_first:      Split n keys into blocks for the threads of the
+ *                   shared-memory block sorts
+ * Merge_low, Merge_high:  Scalar merge-splits of blocks of different
+ *                   sizes that skip blocks already in order
+ * Co_rank, Merge_range:  Merge part of two sorted arrays, so that
+ *                   several threads can share one merge
+ *
+ * Compile:  Add local_sort.c and -I../ch4 (for scan.h) to the compile
+ *           command of the program, and -O3 -march=native (or -msse4.1)
+ *           to use the SIMD merge.  Add -fopenmp to sort with several
+ *           threads.
+ *
+ * Notes:
+ * 1.  The radix sort uses 8-bit digits.  Each pass is a stable
+ *     counting sort on one digit.  A pass is skipped if all the keys
+ *     have the same digit:  e.g., if the keys are in [0, 65536), only
+ *     two of the four passes are done.  Negative keys are sorted
+ *     correctly:  the sign bit is flipped when the digits are taken.
+ *     In the OpenMP sort, the place of each thread's keys with each
+ *     digit is found with a parallel exclusive scan (../ch4/scan.h) of
+ *     the threads' digit counts, stored digit by digit.
+ * 2.  The merges use a bitonic merge network on SSE4.1 vectors of 4
+ *     ints.  Each step merges the 4 largest keys so far with the next
+ *     4 keys from the array with the smaller next key, and writes out
+ *     the 4 smallest, with no branches that depend on the keys.  The
+ *     last few keys are merged one at a time.  Without SSE4.1, all
+ *     the keys are merged one at a time.
+ * 3.  The merges write to a third array, so the caller can swap
+ *     pointers instead of copying the result back.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#ifdef __SSE4_1__
+#  include <smmintrin.h>
+#endif
+#include "local_sort.h"
+#include "scan.h"
+
+#define RADIX_BITS 8
+#define RADIX (1 << RADIX_BITS)
+#define PASSES (32/RADIX_BITS)
+
+/* Digit pass of key, with the sign bit flipped so negative keys come
+ * first */
+#define DIGIT(key, pass) \
+   ((((unsigned) (key) ^ 0x80000000u) >> ((pass)*RADIX_BITS)) & (RADIX-1))
+
+#define SUM(a, b) ((a) + (b))
+SCAN_KERNELS(Sum_long, long, SUM)
+
+static void Merge_first(const int a[], int na, const int b[], int nb,
+      int c[], int count);
+static void Merge_last(const int a[], int na, const int b[], int nb,
+      int c[], int count);
+
+/*---------------------------------------------------------------------
+ * Function:  Radix_sort
+ * Purpose:   Sort a[0], ..., a[n-1] in increasing order
+ * In/out:    a
+ * Scratch:   tmp:  storage for n ints
+ */
+void Radix_sort(int a[], int n, int tmp[]) {
+   long counts[PASSES][RADIX];
+   long offsets[RADIX], sum;
+   int *src = a, *dst = tmp, *t;
+   int i, pass, d;
+
+   if (n <= 1) return;
+
+   /* Count the digits of all the passes in one sweep */
+   memset(counts, 0, sizeof(counts));
+   for (i = 0; i < n; i++)
+      for (pass = 0; pass < PASSES; pass++)
+         counts[pass][DIGIT(a[i], pass)]++;
+
+   for (pass = 0; pass < PASSES; pass++) {
+      if (counts[pass][DIGIT(a[0], pass)] == n) continue;
+      for (d = 0, sum = 0; d < RADIX; d++) {
+         offsets[d] = sum;
+         sum += counts[pass][d];
+      }
+      for (i = 0; i < n; i++)
+         dst[offsets[DIGIT(src[i], pass)]++] = src[i];
+      t = src; src = dst; dst = t;
+   }
+
+   if (src != a) memcpy(a, src, n*sizeof(int));
+}  /* Radix_sort */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Radix_sort_omp
+ * Purpose:   Sort a[0], ..., a[n-1] in increasing order using
+ *            thread_count OpenMP threads.  Each thread counts the
+ *            digits in its block of the keys, and then moves its keys
+ *            to the places given by the counts of all the threads.
+ * In/out:    a
+ * Scratch:   tmp:  storage for n ints
+ * Note:      Without OpenMP, or for small n, this calls Radix_sort.
+ */
+void Radix_sort_omp(int a[], int n, int tmp[], int thread_count) {
+#  ifdef _OPENMP
+   long* counts;  /* counts[d*thread_count + t]:  keys in thread t's
+                     block with digit d.  After the scan, the place of
+                     the first of them. */
+   long* totals;  /* For the scan */
+   int *src = a, *dst = tmp;
+
+   if (thread_count <= 1 || n < 16*RADIX*thread_count) {
+      Radix_sort(a, n, tmp);
+      return;
+   }
+   counts = malloc(thread_count*RADIX*sizeof(long));
+   totals = malloc(thread_count*sizeof(long));
+
+#  pragma omp parallel num_threads(thread_count) default(none) \
+      shared(src, dst, counts, totals, n, thread_count)
+   {
+      int my_rank = omp_get_thread_num();
+      int my_first = (long) my_rank*n/thread_count;
+      int my_last = (long) (my_rank+1)*n/thread_count;
+      long scan_first = Scan_first(RADIX*thread_count, my_rank,
+            thread_count);
+      long scan_last = Scan_first(RADIX*thread_count, my_rank + 1,
+            thread_count);
+      long my_offsets[RADIX], sum;
+      int i, d, t, pass, skip;
+      int* tp;
+
+      for (pass = 0; pass < PASSES; pass++) {
+         memset(my_offsets, 0, RADIX*sizeof(long));
+         for (i = my_first; i < my_last; i++)
+            my_offsets[DIGIT(src[i], pass)]++;
+         for (d = 0; d < RADIX; d++)
+            counts[d*thread_count + my_rank] = my_offsets[d];
+#        pragma omp barrier
+
+         /* Every thread finds the same value of skip */
+         d = DIGIT(src[0], pass);
+         for (t = 0, sum = 0; t < thread_count; t++)
+            sum += counts[d*thread_count + t];
+         skip = (sum == n);
+
+         if (!skip) {
+            /* My keys with digit d go after all the keys with smaller
+             * digits, and the keys with digit d in lower ranked
+             * threads:  an exclusive scan of counts */
+            totals[my_rank] = Sum_long_reduce(counts, scan_first,
+                  scan_last, 0);
+#           pragma omp barrier
+            Sum_long_range(counts, counts, scan_first, scan_last,
+                  Sum_long_reduce(totals, 0, my_rank, 0), 0);
+#           pragma omp barrier
+            for (d = 0; d < RADIX; d++)
+               my_offsets[d] = counts[d*thread_count + my_rank];
+            for (i = my_first; i < my_last; i++)
+               dst[my_offsets[DIGIT(src[i], pass)]++] = src[i];
+         }
+#        pragma omp barrier
+#        pragma omp single
+         if (!skip) {
+            tp = src; src = dst; dst = tp;
+         }
+      }
+   }
+
+   if (src != a) memcpy(a, src, n*sizeof(int));
+   free(totals);
+   free(counts);
+#  else
+   (void) thread_count;
+   Radix_sort(a, n, tmp);
+#  endif
+}  /* Radix_sort_omp */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Local_sort
+ * Purpose:   Sort a[0], ..., a[n-1] in increasing order, with all the
+ *            available OpenMP threads if the program was compiled
+ *            with OpenMP and this isn't called in a parallel region
+ * In/out:    a
+ */
+void Local_sort(int a[], int n) {
+   int* tmp = malloc((n+1)*sizeof(int));
+
+#  ifdef _OPENMP
+   /* In a parallel region a nested team would have only one thread */
+   Radix_sort_omp(a, n, tmp, omp_in_parallel() ? 1 : omp_get_max_threads());
+#  else
+   Radix_sort(a, n, tmp);
+#  endif
+   free(tmp);
+}  /* Local_sort */
+
+
+#ifdef __SSE4_1__
+/*---------------------------------------------------------------------
+ * Function:  Bitonic_4x4
+ * Purpose:   Merge two sorted vectors of 4 ints with a bitonic merge
+ *            network
+ * In/out:    lo_p:  in, a sorted vector; out, the 4 smallest keys,
+ *                   sorted
+ *            hi_p:  in, a sorted vector; out, the 4 largest keys,
+ *                   sorted
+ */
+static inline void Bitonic_4x4(__m128i* lo_p, __m128i* hi_p) {
+   __m128i a = *lo_p, b, l, h, t1, t2;
+
+   /* a followed by b reversed is bitonic */
+   b = _mm_shuffle_epi32(*hi_p, _MM_SHUFFLE(0,1,2,3));
+   l = _mm_min_epi32(a, b);
+   h = _mm_max_epi32(a, b);
+
+   /* Compare keys 2 apart in l and in h */
+   t1 = _mm_unpacklo_epi64(l, h);
+   t2 = _mm_unpackhi_epi64(l, h);
+   l = _mm_min_epi32(t1, t2);
+   h = _mm_max_epi32(t1, t2);
+
+   /* Compare neighbors */
+   t1 = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(l),
+            _mm_castsi128_ps(h), _MM_SHUFFLE(2,0,2,0)));
+   t2 = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(l),
+            _mm_castsi128_ps(h), _MM_SHUFFLE(3,1,3,1)));
+   l = _mm_min_epi32(t1, t2);
+   h = _mm_max_epi32(t1, t2);
+
+   /* Put the keys back in order */
+   t1 = _mm_unpacklo_epi32(l, h);
+   t2 = _mm_unpackhi_epi32(l, h);
+   *lo_p = _mm_unpacklo_epi64(t1, t2);
+   *hi_p = _mm_unpackhi_epi64(t1, t2);
+}  /* Bitonic_4x4 */
+#endif
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_first
+ * Purpose:   Store the count smallest keys of the sorted arrays a and
+ *            b in c, in increasing order
+ * In args:   a, na, b, nb, count (count <= na + nb)
+ * Out arg:   c
+ */
+static void Merge_first(const int a[], int na, const int b[], int nb,
+      int c[], int count) {
+   int ia = 0, ib = 0, out = 0;
+   int hi[4], ih = 0, nh = 0;
+
+#  ifdef __SSE4_1__
+   __m128i lo_v, hi_v;
+
+   if (count >= 4 && na >= 4 && nb >= 4) {
+      lo_v = _mm_loadu_si128((const __m128i*) a);
+      hi_v = _mm_loadu_si128((const __m128i*) b);
+      ia = ib = 4;
+      Bitonic_4x4(&lo_v, &hi_v);
+      _mm_storeu_si128((__m128i*) c, lo_v);
+      out = 4;
+      while (out + 4 <= count) {
+         /* The next 4 keys come from the array with the smaller next
+          * key.  If it has fewer than 4 left, finish one at a time. */
+         if (ib >= nb || (ia < na && a[ia] <= b[ib])) {
+            if (ia + 4 > na) break;
+            lo_v = _mm_loadu_si128((const __m128i*) (a + ia));
+            ia += 4;
+         } else {
+            if (ib + 4 > nb) break;
+            lo_v = _mm_loadu_si128((const __m128i*) (b + ib));
+            ib += 4;
+         }
+         Bitonic_4x4(&lo_v, &hi_v);
+         _mm_storeu_si128((__m128i*) (c + out), lo_v);
+         out += 4;
+      }
+      _mm_storeu_si128((__m128i*) hi, hi_v);
+      nh = 4;
+   }
+#  endif
+
+   /* Merge hi[ih..nh-1], a[ia..na-1] and b[ib..nb-1] one at a time */
+   while (out < count) {
+      if (ih < nh && (ia >= na || hi[ih] <= a[ia])
+            && (ib >= nb || hi[ih] <= b[ib]))
+         c[out++] = hi[ih++];
+      else if (ia < na && (ib >= nb || a[ia] <= b[ib]))
+         c[out++] = a[ia++];
+      else
+         c[out++] = b[ib++];
+   }
+}  /* Merge_first */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_last
+ * Purpose:   Store the count largest keys of the sorted arrays a and
+ *            b in c, in increasing order
+ * In args:   a, na, b, nb, count (count <= na + nb)
+ * Out arg:   c
+ */
+static void Merge_last(const int a[], int na, const int b[], int nb,
+      int c[], int count) {
+   int ia = na, ib = nb, out = count;  /* Next free slot is out-1 */
+   int lo[4], il = 0;
+
+#  ifdef __SSE4_1__
+   __m128i lo_v, hi_v;
+
+   if (count >= 4 && na >= 4 && nb >= 4) {
+      lo_v = _mm_loadu_si128((const __m128i*) (a + na - 4));
+      hi_v = _mm_loadu_si128((const __m128i*) (b + nb - 4));
+      ia = na - 4;
+      ib = nb - 4;
+      Bitonic_4x4(&lo_v, &hi_v);
+      _mm_storeu_si128((__m128i*) (c + count - 4), hi_v);
+      out = count - 4;
+      while (out >= 4) {
+         /* The next 4 keys come from the array with the larger next
+          * key.  If it has fewer than 4 left, finish one at a time. */
+         if (ib <= 0 || (ia > 0 && a[ia-1] >= b[ib-1])) {
+            if (ia < 4) break;
+            hi_v = _mm_loadu_si128((const __m128i*) (a + ia - 4));
+            ia -= 4;
+         } else {
+            if (ib < 4) break;
+            hi_v = _mm_loadu_si128((const __m128i*) (b + ib - 4));
+            ib -= 4;
+         }
+         Bitonic_4x4(&lo_v, &hi_v);
+         _mm_storeu_si128((__m128i*) (c + out - 4), hi_v);
+         out -= 4;
+      }
+      _mm_storeu_si128((__m128i*) lo, lo_v);
+      il = 4;
+   }
+#  endif
+
+   /* Merge lo[0..il-1], a[0..ia-1] and b[0..ib-1] from the top, one
+    * at a time */
+   while (out > 0) {
+      if (il > 0 && (ia <= 0 || lo[il-1] >= a[ia-1])
+            && (ib <= 0 || lo[il-1] >= b[ib-1]))
+         c[--out] = lo[--il];
+      else if (ia > 0 && (ib <= 0 || a[ia-1] >= b[ib-1]))
+         c[--out] = a[--ia];
+      else
+         c[--out] = b[--ib];
+   }
+}  /* Merge_last */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_simd
+ * Purpose:   Merge the sorted arrays a and b into c
+ * In args:   a, na, b, nb
+ * Out arg:   c:  na + nb keys in increasing order
+ */
+void Merge_simd(const int a[], int na, const int b[], int nb, int c[]) {
+   Merge_first(a, na, b, nb, c, na + nb);
+}  /* Merge_simd */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_low_simd
+ * Purpose:   Store the smallest n keys of the sorted arrays a and b,
+ *            each with n keys, in c
+ * In args:   a, b, n
+ * Out arg:   c
+ */
+void Merge_low_simd(const int a[], const int b[], int c[], int n) {
+   Merge_first(a, n, b, n, c, n);
+}  /* Merge_low_simd */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_high_simd
+ * Purpose:   Store the largest n keys of the sorted arrays a and b,
+ *            each with n keys, in c
+ * In args:   a, b, n
+ * Out arg:   c
+ */
+void Merge_high_simd(const int a[], const int b[], int c[], int n) {
+   Merge_last(a, n, b, n, c, n);
+}  /* Merge_high_simd */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Block_first
+ * Purpose:   Find the subscript of the first key in block rank when n
+ *            keys are split into block_count blocks.  Block rank is
+ *            Block_first(rank, n, block_count), ...,
+ *            Block_first(rank+1, n, block_count) - 1.
+ * In args:   rank, n, block_count
+ * Note:      The blocks have ceil(n/block_count) keys, except for
+ *            the last nonempty block, and the empty blocks after it.
+ *            Block odd-even sort needs blocks of the same size:  think
+ *            of the missing keys as infinite.  They stay at the end of
+ *            the list, so the merge-splits don't change the sizes of
+ *            the blocks.
+ */
+int Block_first(int rank, int n, int block_count) {
+   long block = (n + block_count - 1)/block_count;
+   long first = rank*block;
+
+   return (first < n) ? first : n;
+}  /* Block_first */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_low
+ * Purpose:   Store the smallest na keys of the sorted lists a and b
+ *            in c
+ * In args:   a, na, b, nb
+ * Out arg:   c
+ * Ret val:   0 if the keys of a are already the smallest, and c
+ *            hasn't been written.  1 otherwise.
+ */
+int Merge_low(const int a[], int na, const int b[], int nb, int c[]) {
+   int ai = 0, bi = 0, ci = 0;
+
+   if (na == 0 || nb == 0 || a[na-1] <= b[0]) return 0;
+   while (ci < na) {
+      if (bi >= nb || a[ai] <= b[bi])
+         c[ci++] = a[ai++];
+      else
+         c[ci++] = b[bi++];
+   }
+   return 1;
+}  /* Merge_low */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_high
+ * Purpose:   Store the largest nb keys of the sorted lists a and b
+ *            in c
+ * In args:   a, na, b, nb
+ * Out arg:   c
+ * Ret val:   0 if the keys of b are already the largest, and c
+ *            hasn't been written.  1 otherwise.
+ */
+int Merge_high(const int a[], int na, const int b[], int nb, int c[]) {
+   int ai = na-1, bi = nb-1, ci = nb-1;
+
+   if (na == 0 || nb == 0 || a[na-1] <= b[0]) return 0;
+   while (ci >= 0) {
+      if (ai < 0 || b[bi] >= a[ai])
+         c[ci--] = b[bi--];
+      else
+         c[ci--] = a[ai--];
+   }
+   return 1;
+}  /* Merge_high */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Co_rank
+ * Purpose:   Find how many of the first k keys of the merge of the
+ *            sorted lists a and b come from a.  Keys of a go before
+ *            equal keys of b.
+ * In args:   k, a, m, b, n
+ * Ret val:   i such that the first k keys of the merge are a[0], ...,
+ *            a[i-1] and b[0], ..., b[k-i-1]
+ */
+int Co_rank(int k, const int a[], int m, const int b[], int n) {
+   int lo = (k > n) ? k - n : 0;
+   int hi = (k < m) ? k : m;
+   int i;
+
+   /* a[i] belongs in the first k keys iff a[i] <= b[k-i-1] */
+   while (lo < hi) {
+      i = lo + (hi - lo)/2;
+      if (a[i] <= b[k-i-1])
+         lo = i + 1;
+      else
+         hi = i;
+   }
+   return lo;
+}  /* Co_rank */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_range
+ * Purpose:   Store keys first, ..., last-1 of the merge of the sorted
+ *            lists a and b in c[first], ..., c[last-1]
+ * In args:   a, m, b, n, first, last
+ * Out arg:   c
+ */
+void Merge_range(const int a[], int m, const int b[], int n, int c[],
+      int first, int last) {
+   int ai = Co_rank(first, a, m, b, n);
+   int bi = first - ai;
+   int a_last = Co_rank(last, a, m, b, n);
+   int b_last = last - a_last;
+   int ci = first;
+
+   while (ai < a_last && bi < b_last) {
+      if (a[ai] <= b[bi])
+         c[ci++] = a[ai++];
+      else
+         c[ci++] = b[bi++];
+   }
+   while (ai < a_last) c[ci++] = a[ai++];
+   while (bi < b_last) c[ci++] = b[bi++];
+}  /* Merge_range */
@@ -0,0 +1,24 @@
+/* File:     local_sort.h
+ * Purpose:  Header file for local_sort.c, which implements the local
+ *           sorting and merging used by the odd-even sort programs:
+ *           an LSD radix sort for ints and SIMD bitonic merges.
+ */
+#ifndef _LOCAL_SORT_H_
+#define _LOCAL_SORT_H_
+
+void Radix_sort(int a[], int n, int tmp[]);
+void Radix_sort_omp(int a[], int n, int tmp[], int thread_count);
+void Local_sort(int a[], int n);
+
+void Merge_simd(const int a[], int na, const int b[], int nb, int c[]);
+void Merge_low_simd(const int a[], const int b[], int c[], int n);
+void Merge_high_simd(const int a[], const int b[], int c[], int n);
+
+int  Block_first(int rank, int n, int block_count);
+int  Merge_low(const int a[], int na, const int b[], int nb, int c[]);
+int  Merge_high(const int a[], int na, const int b[], int nb, int c[]);
+int  Co_rank(int k, const int a[], int m, const int b[], int n);
+void Merge_range(const int a[], int m, const int b[], int n, int c[],
+      int first, int last);
+
+#endif
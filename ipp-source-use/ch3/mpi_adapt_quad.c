@@ -0,0 +1,407 @@
+/* File:     mpi_adapt_quad.c
+ * Purpose:  Use MPI to estimate a definite integral to a given
+ *           accuracy with adaptive Gauss-Kronrod quadrature.  Process
+ *           0 keeps a pool of subintervals and hands them out to the
+ *           other processes.  Each of those refines its subinterval
+ *           for at most QUANTUM steps, and then sends back its partial
+ *           result and the subintervals it didn't finish, so the
+ *           subintervals that need the most work are spread over all
+ *           the processes.  For comparison, the program also finds the
+ *           number of trapezoids the trapezoidal rule (mpi_trap3.c)
+ *           needs for the same accuracy, and times both.
+ *
+ * Input:    The endpoints of the interval of integration and the
+ *           error tolerance
+ * Output:   Estimates of the integral from a to b of f(x), the number
+ *           of evaluations of f and the run times of the adaptive and
+ *           uniform methods.
+ *
+ * Compile:  mpicc -g -Wall -O2 -o mpi_adapt_quad mpi_adapt_quad.c -lm
+ * Run:      mpiexec -n <number of processes> ./mpi_adapt_quad
+ *
+ * Algorithm:
+ *    1.  Process 0 splits [a, b] into INIT_PER_PROC subintervals per
+ *        process and puts them in the pool.
+ *    2.  While the pool isn't empty or some process is busy, process 0
+ *        gives a subinterval to each idle process, and waits for a
+ *        result from any process.  It adds the partial integral to the
+ *        total and puts the returned subintervals in the pool.
+ *    3.  When all the processes are idle and the pool is empty,
+ *        process 0 tells the other processes to stop.
+ *    With one process, process 0 does all the work itself.
+ *
+ * Notes:
+ *    1.  f(x) is hardwired.  It's sqrt(|x|), which has an unbounded
+ *        derivative at 0:  the adaptive method only refines near 0,
+ *        while the trapezoidal rule needs a small h everywhere.
+ *    2.  A subinterval [l, r] is accepted when the difference between
+ *        its 15-point Kronrod and 7-point Gauss estimates is at most
+ *        tol*(r-l)/(b-a), so the total error estimate is at most tol.
+ *    3.  The trapezoidal rule's error with n trapezoids is estimated
+ *        by |T(2n) - T(n)|/3, doubling n until it's at most tol.
+ *
+ * IPP:   Section 3.5 (pp. 117 and ff.) for the trapezoidal rule
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+
+/* Subintervals per process in the initial pool */
+#define INIT_PER_PROC 4
+
+/* Steps a process takes on a subinterval before reporting back */
+#define QUANTUM 64
+
+/* Subintervals aren't bisected past this depth */
+#define MAX_DEPTH 60
+
+/* Largest number of trapezoids tried */
+#define MAX_N (1L << 30)
+
+/* Result message:  integral, error, evaluations, then the endpoints
+ * of at most QUANTUM+1 unfinished subintervals */
+#define RES_HDR 3
+#define RES_SIZE (RES_HDR + 2*(QUANTUM+1))
+
+#define WORK_TAG 1
+#define RES_TAG  2
+#define STOP_TAG 3
+
+/* Get the input values */
+void Get_input(int my_rank, double* a_p, double* b_p, double* tol_p);
+
+/* Refine a subinterval for at most QUANTUM steps */
+int Work(double l, double r, double tol_per_len, double min_len,
+      double res[]);
+
+/* Process 0's part of the adaptive quadrature */
+double Manager(double a, double b, double tol, int comm_sz, double* err_p,
+      double* evals_p);
+void Worker(double a, double b, double tol);
+
+double Kronrod(double l, double r, double* err_p);
+
+/* Calculate local integral  */
+double Trap(double left_endpt, double right_endpt, long trap_count,
+   double base_len);
+
+/* Function we're integrating */
+double f(double x);
+
+/* 15-point Gauss-Kronrod rule on [-1, 1]:  xgk[1], xgk[3], xgk[5]
+ * and xgk[7] = 0 are the nodes of the 7-point Gauss rule */
+const double xgk[8] = {
+   0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+   0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+   0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+   0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+const double wgk[8] = {
+   0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+   0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+   0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+   0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+const double wg[4] = {
+   0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+   0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+int main(void) {
+   int my_rank, comm_sz;
+   long n, local_n;
+   double a, b, tol, h, local_a, local_b;
+   double adapt_int = 0.0, err = 0.0, evals = 0.0;
+   double local_int, total_int = 0.0, prev_int;
+   double start, local_elapsed, adapt_elapsed, trap_elapsed = 0.0;
+
+   MPI_Init(NULL, NULL);
+   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+   MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+
+   Get_input(my_rank, &a, &b, &tol);
+
+   MPI_Barrier(MPI_COMM_WORLD);
+   start = MPI_Wtime();
+   if (my_rank == 0)
+      adapt_int = Manager(a, b, tol, comm_sz, &err, &evals);
+   else
+      Worker(a, b, tol);
+   local_elapsed = MPI_Wtime() - start;
+   MPI_Reduce(&local_elapsed, &adapt_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0,
+         MPI_COMM_WORLD);
+
+   if (my_rank == 0) {
+      printf("Adaptive:  our estimate of the integral from %f to %f\n",
+            a, b);
+      printf("   = %.14e, estimated error = %.2e\n", adapt_int, err);
+      printf("   %.0f evaluations of f, %e seconds\n", evals,
+            adapt_elapsed);
+   }
+
+   /* Double n until the trapezoidal rule reaches tol.  n is always a
+    * multiple of comm_sz */
+   prev_int = 0.0;
+   for (n = comm_sz; n <= MAX_N; n *= 2) {
+      h = (b-a)/n;
+      local_n = n/comm_sz;
+      local_a = a + my_rank*local_n*h;
+      local_b = local_a + local_n*h;
+
+      MPI_Barrier(MPI_COMM_WORLD);
+      start = MPI_Wtime();
+      local_int = Trap(local_a, local_b, local_n, h);
+      MPI_Allreduce(&local_int, &total_int, 1, MPI_DOUBLE, MPI_SUM,
+            MPI_COMM_WORLD);
+      local_elapsed = MPI_Wtime() - start;
+      MPI_Reduce(&local_elapsed, &trap_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0,
+            MPI_COMM_WORLD);
+
+      if (n > comm_sz && fabs(total_int - prev_int)/3.0 <= tol) break;
+      prev_int = total_int;
+   }
+
+   if (my_rank == 0) {
+      if (n > MAX_N) {
+         printf("Trapezoidal rule:  tol not reached with n = %ld\n", MAX_N);
+      } else {
+         printf("Trapezoidal rule:  with n = %ld trapezoids\n", n);
+         printf("   = %.14e, estimated error = %.2e\n", total_int,
+               fabs(total_int - prev_int)/3.0);
+         printf("   %ld evaluations of f, %e seconds\n", n+1,
+               trap_elapsed);
+      }
+   }
+
+   MPI_Finalize();
+   return 0;
+} /*  main  */
+
+/*------------------------------------------------------------------
+ * Function:     Get_input
+ * Purpose:      Get the user input:  the left and right endpoints
+ *               and the error tolerance
+ * Input args:   my_rank:  process rank in MPI_COMM_WORLD
+ * Output args:  a_p:  pointer to left endpoint
+ *               b_p:  pointer to right endpoint
+ *               tol_p:  pointer to error tolerance
+ */
+void Get_input(int my_rank, double* a_p, double* b_p, double* tol_p) {
+   int ok = 1;
+
+   if (my_rank == 0) {
+      printf("Enter a, b, and tol\n");
+      if (scanf("%lf %lf %lf", a_p, b_p, tol_p) != 3 || !(*a_p < *b_p)
+            || *tol_p <= 0.0) {
+         fprintf(stderr, "Need a < b and tol > 0\n");
+         ok = 0;
+      }
+   }
+   MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+   if (!ok) {
+      MPI_Finalize();
+      exit(-1);
+   }
+   MPI_Bcast(a_p, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+   MPI_Bcast(b_p, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+   MPI_Bcast(tol_p, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+}  /* Get_input */
+
+/*------------------------------------------------------------------
+ * Function:     Manager
+ * Purpose:      Hand out subintervals from the pool and collect the
+ *               results until all of [a, b] is integrated
+ * Input args:   a, b, tol, comm_sz
+ * Output args:  err_p:  estimated error
+ *               evals_p:  number of evaluations of f
+ * Return val:   The estimate of the integral
+ */
+double Manager(double a, double b, double tol, int comm_sz, double* err_p,
+      double* evals_p) {
+   double* pool;      /* pool[2i], pool[2i+1] are the endpoints */
+   int pool_count, pool_max, idle_count, i, count, src;
+   int* idle;
+   double res[RES_SIZE], total = 0.0;
+   MPI_Status status;
+
+   pool_max = INIT_PER_PROC*comm_sz + RES_SIZE;
+   pool = malloc(2*pool_max*sizeof(double));
+   idle = malloc(comm_sz*sizeof(int));
+   pool_count = INIT_PER_PROC*comm_sz;
+   for (i = 0; i < pool_count; i++) {
+      pool[2*i] = a + i*(b-a)/pool_count;
+      pool[2*i+1] = (i == pool_count-1) ? b : a + (i+1)*(b-a)/pool_count;
+   }
+   idle_count = 0;
+   for (src = 1; src < comm_sz; src++)
+      idle[idle_count++] = src;
+   *err_p = *evals_p = 0.0;
+
+   while (pool_count > 0 || idle_count < comm_sz-1) {
+      if (comm_sz == 1) {
+         /* No workers:  do it myself */
+         pool_count--;
+         count = Work(pool[2*pool_count], pool[2*pool_count+1], tol/(b-a),
+               ldexp(b-a, -MAX_DEPTH), res);
+         src = -1;
+      } else {
+         while (pool_count > 0 && idle_count > 0) {
+            pool_count--;
+            MPI_Send(&pool[2*pool_count], 2, MPI_DOUBLE, idle[--idle_count],
+                  WORK_TAG, MPI_COMM_WORLD);
+         }
+         MPI_Recv(res, RES_SIZE, MPI_DOUBLE, MPI_ANY_SOURCE, RES_TAG,
+               MPI_COMM_WORLD, &status);
+         MPI_Get_count(&status, MPI_DOUBLE, &count);
+         count = (count - RES_HDR)/2;
+         src = status.MPI_SOURCE;
+      }
+
+      total += res[0];
+      *err_p += res[1];
+      *evals_p += res[2];
+      if (pool_count + count > pool_max) {
+         pool_max = 2*(pool_count + count);
+         pool = realloc(pool, 2*pool_max*sizeof(double));
+      }
+      for (i = 0; i < 2*count; i++)
+         pool[2*pool_count + i] = res[RES_HDR + i];
+      pool_count += count;
+      if (src > 0) idle[idle_count++] = src;
+   }
+
+   for (src = 1; src < comm_sz; src++)
+      MPI_Send(NULL, 0, MPI_DOUBLE, src, STOP_TAG, MPI_COMM_WORLD);
+
+   free(idle);
+   free(pool);
+   return total;
+}  /* Manager */
+
+/*------------------------------------------------------------------
+ * Function:     Worker
+ * Purpose:      Refine the subintervals process 0 sends until it
+ *               says stop
+ * Input args:   a, b, tol
+ */
+void Worker(double a, double b, double tol) {
+   double lr[2], res[RES_SIZE];
+   int count;
+   MPI_Status status;
+
+   while (1) {
+      MPI_Recv(lr, 2, MPI_DOUBLE, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+      if (status.MPI_TAG == STOP_TAG) break;
+      count = Work(lr[0], lr[1], tol/(b-a), ldexp(b-a, -MAX_DEPTH), res);
+      MPI_Send(res, RES_HDR + 2*count, MPI_DOUBLE, 0, RES_TAG,
+            MPI_COMM_WORLD);
+   }
+}  /* Worker */
+
+/*------------------------------------------------------------------
+ * Function:     Work
+ * Purpose:      Refine [l, r] for at most QUANTUM steps.  Each step
+ *               takes a subinterval off a stack, and either accepts
+ *               its estimate or pushes its two halves.
+ * Input args:   l, r, tol_per_len
+ *               min_len:  subintervals this short are always accepted
+ * Output arg:   res:  res[0] = integral over the accepted subintervals
+ *                     res[1] = their estimated error
+ *                     res[2] = number of evaluations of f
+ *                     res[RES_HDR], ...:  endpoints of the subintervals
+ *                        left on the stack
+ * Return val:   The number of subintervals left on the stack
+ */
+int Work(double l, double r, double tol_per_len, double min_len,
+      double res[]) {
+   double* stack = res + RES_HDR;
+   int top = 0, step;
+   double est, err, m;
+
+   res[0] = res[1] = res[2] = 0.0;
+   stack[0] = l;
+   stack[1] = r;
+   top = 1;
+   for (step = 0; step < QUANTUM && top > 0; step++) {
+      top--;
+      l = stack[2*top];
+      r = stack[2*top+1];
+      est = Kronrod(l, r, &err);
+      res[2] += 15;
+      if (err <= tol_per_len*(r - l) || r - l <= min_len) {
+         res[0] += est;
+         res[1] += err;
+      } else {
+         m = (l + r)/2.0;
+         stack[2*top] = l;
+         stack[2*top+1] = m;
+         stack[2*top+2] = m;
+         stack[2*top+3] = r;
+         top += 2;
+      }
+   }
+
+   return top;
+}  /* Work */
+
+/*------------------------------------------------------------------
+ * Function:     Kronrod
+ * Purpose:      Apply the 15-point Gauss-Kronrod rule to [l, r]
+ * Input args:   l, r
+ * Output arg:   err_p:  |Kronrod estimate - Gauss estimate|
+ * Return val:   Kronrod estimate of the integral from l to r
+ */
+double Kronrod(double l, double r, double* err_p) {
+   double c = (l + r)/2.0, h = (r - l)/2.0;
+   double fc = f(c), f1, f2;
+   double res_k = wgk[7]*fc, res_g = wg[3]*fc;
+   int j;
+
+   for (j = 0; j < 7; j++) {
+      f1 = f(c - h*xgk[j]);
+      f2 = f(c + h*xgk[j]);
+      res_k += wgk[j]*(f1 + f2);
+      if (j % 2 == 1) res_g += wg[j/2]*(f1 + f2);
+   }
+
+   *err_p = fabs((res_k - res_g)*h);
+   return res_k*h;
+}  /* Kronrod */
+
+/*------------------------------------------------------------------
+ * Function:     Trap
+ * Purpose:      Serial function for estimating a definite integral
+ *               using the trapezoidal rule
+ * Input args:   left_endpt
+ *               right_endpt
+ *               trap_count
+ *               base_len
+ * Return val:   Trapezoidal rule estimate of integral from
+ *               left_endpt to right_endpt using trap_count
+ *               trapezoids
+ */
+double Trap(
+      double left_endpt  /* in */,
+      double right_endpt /* in */,
+      long   trap_count  /* in */,
+      double base_len    /* in */) {
+   double estimate, x;
+   long i;
+
+   estimate = (f(left_endpt) + f(right_endpt))/2.0;
+   for (i = 1; i <= trap_count-1; i++) {
+      x = left_endpt + i*base_len;
+      estimate += f(x);
+   }
+   estimate = estimate*base_len;
+
+   return estimate;
+} /*  Trap  */
+
+
+/*------------------------------------------------------------------
+ * Function:    f
+ * Purpose:     Compute value of function to be integrated
+ * Input args:  x
+ */
+double f(double x) {
+   return sqrt(fabs(x));
+} /* f */
@@ -0,0 +1,373 @@
+/* File:     mpi_io.c
+ *
+ * Purpose:  Read and write matrices and vectors stored in files with
+ *           collective MPI-IO, so that no process ever needs storage
+ *           for the whole matrix and every process does its own I/O.
+ *           This replaces reading the input on process 0 and
+ *           scattering it, and gathering the output to process 0 and
+ *           printing it.
+ *
+ * Io_block_size:  Get the number of consecutive rows in each block of
+ *                 a distribution from its name
+ * Io_read_dims:   Get the dimensions of a matrix stored in a file
+ * Io_read_rows:   Read each process' rows of a matrix
+ * Io_write_rows:  Write each process' rows of a matrix
+ *
+ * Files:    A matrix with m rows and n columns is stored in row-major
+ *           order after a header containing m and n.  A vector is a
+ *           matrix with one column.
+ *           Binary files:  the header is two ints, and the entries
+ *              are doubles in the native format.
+ *           Text files:  every field is TEXT_WIDTH chars wide.  The
+ *              header is m and n followed by a newline, and each entry
+ *              is printed with "%24.16e" followed by a blank or, at
+ *              the end of a row, a newline.  So the files can be read
+ *              and written with an editor or with printf, and the
+ *              position of an entry can still be computed.
+ *
+ * Distributions:
+ *    The rows are split into blocks of blk consecutive rows, and the
+ *    blocks are assigned to the processes round-robin.  With
+ *    blk = m/comm_sz this is a block distribution, with blk = 1 it's
+ *    a cyclic distribution, and any other blk that divides m/comm_sz
+ *    gives a block-cyclic distribution.  Each process' file view is
+ *    an MPI_Type_vector of rows with stride comm_sz*blk rows, which is
+ *    cyclic_mpi_t from ../ch6/cyclic_derived.c with rows of blk rows
+ *    instead of ints, starting at the process' first block.  So each
+ *    process reads or writes all of its rows with a single collective
+ *    call, and they end up contiguous in its local array.
+ *
+ * Compile:  Add mpi_io.c to the compile command of the program
+ *
+ * Compile with driver:  mpicc -g -Wall -DUSE_DRIVER -o mpi_io mpi_io.c
+ * Run with driver:  mpiexec -n <p> ./mpi_io <file> [t] < <text input>
+ *    Reads m, n and an m x n matrix from stdin in the format read by
+ *    mpi_mat_vect_mult.c and writes it to <file>:  in binary, or with
+ *    t, as text.  p should evenly divide m.
+ *
+ * Notes:
+ * 1.  The functions return 1 if they succeed and 0 if they can't
+ *     open or read the file, or the file is too short.  They should be
+ *     called by all the processes in comm, and the caller should
+ *     check the return value with something like Check_for_error.
+ * 2.  m should be evenly divisible by comm_sz, and blk should evenly
+ *     divide local_m = m/comm_sz.
+ * 3.  Binary files aren't portable between systems with different
+ *     int or double formats.
+ *
+ * IPP:  Section 3.4.6 (pp. 109 and ff.) and Exercise 6.9 (p. 343)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mpi_io.h"
+
+#define TEXT_WIDTH 25                  // chars per field in a text file
+static const char TEXT_FMT[] = "%24.16e";
+static const char TEXT_HEADER_FMT[] = "%12d %11d\n";
+
+static MPI_Offset Header_size(int text);
+static MPI_Offset Row_size(int text, int n);
+static void Build_types(int text, int n, int local_m, int blk,
+      MPI_Comm comm, MPI_Datatype* row_mpi_t_p, MPI_Datatype* file_mpi_t_p,
+      MPI_Offset* disp_p);
+
+
+/*-------------------------------------------------------------------
+ * Function:  Io_block_size
+ * Purpose:   Get the number of consecutive rows in a block of a
+ *            distribution
+ * In args:   dist:     "block", "cyclic" or the number of rows in a
+ *                      block of a block-cyclic distribution
+ *            local_m:  number of rows on each process
+ * Ret val:   The number of rows in a block, or 0 if dist isn't valid
+ *            or the block size doesn't evenly divide local_m
+ */
+int Io_block_size(char dist[], int local_m) {
+   int blk;
+
+   if (strcmp(dist, "block") == 0)
+      blk = local_m;
+   else if (strcmp(dist, "cyclic") == 0)
+      blk = 1;
+   else
+      blk = strtol(dist, NULL, 10);
+
+   if (blk <= 0 || local_m % blk != 0) return 0;
+   return blk;
+}  /* Io_block_size */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Io_read_dims
+ * Purpose:   Get the dimensions of a matrix stored in a file
+ * In args:   fname:  name of the file
+ *            text:   nonzero for a text file, 0 for a binary file
+ *            comm:   communicator containing the calling processes
+ * Out args:  m_p:    number of rows
+ *            n_p:    number of columns
+ * Ret val:   1 if the file could be read and m and n are positive,
+ *            0 otherwise
+ * Note:      Process 0 reads the header and broadcasts it
+ */
+int Io_read_dims(char fname[], int text, int* m_p, int* n_p,
+      MPI_Comm comm) {
+   MPI_File fh;
+   int my_rank, opened, dims[2] = {0, 0};
+   char header[TEXT_WIDTH+1];
+
+   MPI_Comm_rank(comm, &my_rank);
+   opened = (MPI_File_open(comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL,
+            &fh) == MPI_SUCCESS);
+   if (my_rank == 0 && opened) {
+      if (text) {
+         memset(header, 0, TEXT_WIDTH+1);
+         MPI_File_read_at(fh, 0, header, TEXT_WIDTH, MPI_CHAR,
+               MPI_STATUS_IGNORE);
+         if (sscanf(header, "%d %d", &dims[0], &dims[1]) != 2)
+            dims[0] = dims[1] = 0;
+      } else {
+         MPI_File_read_at(fh, 0, dims, 2, MPI_INT, MPI_STATUS_IGNORE);
+      }
+   }
+   MPI_Bcast(dims, 2, MPI_INT, 0, comm);
+   if (opened) MPI_File_close(&fh);
+
+   *m_p = dims[0];
+   *n_p = dims[1];
+   return (dims[0] > 0 && dims[1] > 0);
+}  /* Io_read_dims */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Io_read_rows
+ * Purpose:   Read the calling process' rows of a matrix from a file
+ * In args:   fname:    name of the file
+ *            text:     nonzero for a text file, 0 for a binary file
+ *            m:        global number of rows
+ *            local_m:  local number of rows (m/comm_sz)
+ *            n:        number of columns
+ *            blk:      number of consecutive rows in a block
+ *            comm:     communicator containing the calling processes
+ * Out arg:   local_A:  the calling process' local_m rows
+ * Ret val:   1 if the rows were read, 0 otherwise
+ */
+int Io_read_rows(char fname[], int text, double local_A[], int m,
+      int local_m, int n, int blk, MPI_Comm comm) {
+   MPI_File fh;
+   MPI_Datatype row_mpi_t, file_mpi_t;
+   MPI_Offset disp, file_size;
+   MPI_Status status;
+   int comm_sz, count = 0, i;
+   char* buf = NULL;
+
+   MPI_Comm_size(comm, &comm_sz);
+   if (m != local_m*comm_sz || blk <= 0 || local_m % blk != 0) return 0;
+   if (MPI_File_open(comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh)
+         != MPI_SUCCESS) return 0;
+   /* Open MPI reports a short collective read through a file view as
+    * complete, so the count alone doesn't catch a truncated file */
+   MPI_File_get_size(fh, &file_size);
+   if (file_size < Header_size(text) + m*Row_size(text, n)) {
+      MPI_File_close(&fh);
+      return 0;
+   }
+
+   Build_types(text, n, local_m, blk, comm, &row_mpi_t, &file_mpi_t,
+         &disp);
+   MPI_File_set_view(fh, disp, text ? MPI_CHAR : MPI_DOUBLE, file_mpi_t,
+         "native", MPI_INFO_NULL);
+   if (text) {
+      /* One more byte, so that strtod stops at the end of the last
+       * field */
+      buf = malloc((size_t) local_m*n*TEXT_WIDTH + 1);
+      MPI_File_read_all(fh, buf, local_m, row_mpi_t, &status);
+      MPI_Get_count(&status, row_mpi_t, &count);
+      buf[(size_t) local_m*n*TEXT_WIDTH] = '\0';
+      /* Fields have fixed width, so strtod can start at each one.  On
+       * a short file the end of buf wasn't read, so don't parse it. */
+      if (count == local_m)
+         for (i = 0; i < local_m*n; i++)
+            local_A[i] = strtod(buf + (size_t) i*TEXT_WIDTH, NULL);
+      free(buf);
+   } else {
+      MPI_File_read_all(fh, local_A, local_m, row_mpi_t, &status);
+      MPI_Get_count(&status, row_mpi_t, &count);
+   }
+
+   MPI_Type_free(&row_mpi_t);
+   MPI_Type_free(&file_mpi_t);
+   MPI_File_close(&fh);
+   return (count == local_m);
+}  /* Io_read_rows */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Io_write_rows
+ * Purpose:   Write the calling process' rows of a matrix to a file.
+ *            If the file exists, it's replaced.
+ * In args:   fname:    name of the file
+ *            text:     nonzero for a text file, 0 for a binary file
+ *            local_A:  the calling process' local_m rows
+ *            m:        global number of rows
+ *            local_m:  local number of rows (m/comm_sz)
+ *            n:        number of columns
+ *            blk:      number of consecutive rows in a block
+ *            comm:     communicator containing the calling processes
+ * Ret val:   1 if the rows were written, 0 otherwise
+ */
+int Io_write_rows(char fname[], int text, double local_A[], int m,
+      int local_m, int n, int blk, MPI_Comm comm) {
+   MPI_File fh;
+   MPI_Datatype row_mpi_t, file_mpi_t;
+   MPI_Offset disp;
+   int my_rank, comm_sz, i, dims[2] = {m, n};
+   char header[TEXT_WIDTH+1];
+   char* buf = NULL;
+   char* field;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   if (m != local_m*comm_sz || blk <= 0 || local_m % blk != 0) return 0;
+   if (MPI_File_open(comm, fname, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+            MPI_INFO_NULL, &fh) != MPI_SUCCESS) return 0;
+   MPI_File_set_size(fh, 0);
+
+   if (my_rank == 0) {
+      if (text) {
+         sprintf(header, TEXT_HEADER_FMT, m, n);
+         MPI_File_write_at(fh, 0, header, TEXT_WIDTH, MPI_CHAR,
+               MPI_STATUS_IGNORE);
+      } else {
+         MPI_File_write_at(fh, 0, dims, 2, MPI_INT, MPI_STATUS_IGNORE);
+      }
+   }
+
+   Build_types(text, n, local_m, blk, comm, &row_mpi_t, &file_mpi_t,
+         &disp);
+   MPI_File_set_view(fh, disp, text ? MPI_CHAR : MPI_DOUBLE, file_mpi_t,
+         "native", MPI_INFO_NULL);
+   if (text) {
+      /* One extra char for the '\0' after the last field */
+      buf = malloc((size_t) local_m*n*TEXT_WIDTH + 1);
+      for (i = 0; i < local_m*n; i++) {
+         field = buf + (size_t) i*TEXT_WIDTH;
+         sprintf(field, TEXT_FMT, local_A[i]);
+         field[TEXT_WIDTH-1] = (i % n == n-1) ? '\n' : ' ';
+      }
+      MPI_File_write_all(fh, buf, local_m, row_mpi_t, MPI_STATUS_IGNORE);
+      free(buf);
+   } else {
+      MPI_File_write_all(fh, local_A, local_m, row_mpi_t,
+            MPI_STATUS_IGNORE);
+   }
+
+   MPI_Type_free(&row_mpi_t);
+   MPI_Type_free(&file_mpi_t);
+   MPI_File_close(&fh);
+   return 1;
+}  /* Io_write_rows */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Header_size
+ * Purpose:   Return the number of bytes in the header of a file
+ */
+static MPI_Offset Header_size(int text) {
+   return text ? TEXT_WIDTH : 2*sizeof(int);
+}  /* Header_size */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Row_size
+ * Purpose:   Return the number of bytes in a row of a file
+ */
+static MPI_Offset Row_size(int text, int n) {
+   return (MPI_Offset) n*(text ? TEXT_WIDTH : (int) sizeof(double));
+}  /* Row_size */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Build_types
+ * Purpose:   Build the datatypes for a row and for the calling
+ *            process' view of the file, and find the displacement
+ *            of its first row
+ * In args:   text, n, local_m, blk, comm
+ * Out args:  row_mpi_t_p:   n doubles, or n fields of TEXT_WIDTH chars
+ *            file_mpi_t_p:  local_m/blk blocks of blk rows with a
+ *                           stride of comm_sz*blk rows
+ *            disp_p:        offset in bytes of the calling process'
+ *                           first row
+ */
+static void Build_types(int text, int n, int local_m, int blk,
+      MPI_Comm comm, MPI_Datatype* row_mpi_t_p, MPI_Datatype* file_mpi_t_p,
+      MPI_Offset* disp_p) {
+   int my_rank, comm_sz;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+
+   if (text)
+      MPI_Type_contiguous(n*TEXT_WIDTH, MPI_CHAR, row_mpi_t_p);
+   else
+      MPI_Type_contiguous(n, MPI_DOUBLE, row_mpi_t_p);
+   MPI_Type_commit(row_mpi_t_p);
+
+   MPI_Type_vector(local_m/blk, blk, comm_sz*blk, *row_mpi_t_p,
+         file_mpi_t_p);
+   MPI_Type_commit(file_mpi_t_p);
+
+   *disp_p = Header_size(text) + (MPI_Offset) my_rank*blk*Row_size(text, n);
+}  /* Build_types */
+
+
+#ifdef USE_DRIVER
+int main(int argc, char* argv[]) {
+   int my_rank, comm_sz, m = 0, n = 0, local_m, i, ok = 1;
+   int text = (argc == 3 && argv[2][0] == 't');
+   double *A = NULL, *local_A;
+   MPI_Comm comm;
+
+   MPI_Init(&argc, &argv);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+
+   if (my_rank == 0) {
+      if (argc < 2 || argc > 3) {
+         fprintf(stderr, "usage: mpiexec -n <p> %s <file> [t] < <text input>\n",
+               argv[0]);
+      } else {
+         scanf("%d %d", &m, &n);
+      }
+   }
+   MPI_Bcast(&m, 1, MPI_INT, 0, comm);
+   MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+   if (m <= 0 || n <= 0 || m % comm_sz != 0) {
+      if (my_rank == 0 && argc >= 2 && argc <= 3)
+         fprintf(stderr, "m and n must be positive and p must divide m\n");
+      MPI_Finalize();
+      return 0;
+   }
+   local_m = m/comm_sz;
+
+   local_A = malloc(local_m*n*sizeof(double));
+   if (my_rank == 0) {
+      A = malloc(m*n*sizeof(double));
+      for (i = 0; i < m*n; i++)
+         scanf("%lf", &A[i]);
+   }
+   MPI_Scatter(A, local_m*n, MPI_DOUBLE, local_A, local_m*n, MPI_DOUBLE,
+         0, comm);
+   ok = Io_write_rows(argv[1], text, local_A, m, local_m, n, local_m,
+         comm);
+   if (my_rank == 0 && !ok)
+      fprintf(stderr, "Can't write %s\n", argv[1]);
+
+   free(local_A);
+   if (my_rank == 0) free(A);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+#endif
@@ -0,0 +1,19 @@
+/* File:     mpi_io.h
+ * Purpose:  Header file for mpi_io.c, which reads and writes matrices
+ *           and vectors stored in files with collective MPI-IO.  The
+ *           rows can have a block, cyclic or block-cyclic distribution.
+ */
+#ifndef _MPI_IO_H_
+#define _MPI_IO_H_
+
+#include <mpi.h>
+
+int Io_block_size(char dist[], int local_m);
+int Io_read_dims(char fname[], int text, int* m_p, int* n_p,
+      MPI_Comm comm);
+int Io_read_rows(char fname[], int text, double local_A[], int m,
+      int local_m, int n, int blk, MPI_Comm comm);
+int Io_write_rows(char fname[], int text, double local_A[], int m,
+      int local_m, int n, int blk, MPI_Comm comm);
+
+#endif
@@ -10,6 +10,9 @@
  * Output:   Elapsed time for n messages of size 1 double and elapsed
  *           time for 1 message of n doubles
  *
+ * Note:     mpi_p2p_bench.c measures latency, bandwidth and message rate
+ *           over a range of message sizes.
+ *
  * IPP:      Section 3.5 (pp. 116 and ff.)
  */
 #include <stdio.h>
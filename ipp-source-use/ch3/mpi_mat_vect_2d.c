@@ -0,0 +1,600 @@
+/* File:     mpi_mat_vect_2d.c
+ *
+ * Purpose:  Implement parallel matrix-vector multiplication using a
+ *           two-dimensional "checkerboard" distribution of the
+ *           matrix.  The processes form a q_r x q_c grid built with
+ *           MPI_Cart_create, and process (r, c) owns the block of A
+ *           with rows r*local_m, ..., (r+1)*local_m - 1 and columns
+ *           c*local_n, ..., (c+1)*local_n - 1.
+ *
+ *           x is distributed by blocks over the first row of the grid:
+ *           process (0, c) owns x_c.  Each multiplication broadcasts
+ *           x_c down grid column c, forms a partial product with the
+ *           local block, and reduces the partial products across grid
+ *           row r onto process (r, 0), which then owns y_r.  So each
+ *           process sends and receives O(n/q_c + m/q_r) doubles,
+ *           instead of the O(n) of the MPI_Allgather in the block-row
+ *           program mpi_mat_vect_mult.c.
+ *
+ *           In "g" mode the program generates A and x, and times both
+ *           the 2-D product and the block-row product of
+ *           mpi_mat_vect_time.c on the same data.  In "f" mode it reads
+ *           A and x from binary files and writes y to a binary file.
+ *           The file I/O uses MPI-IO:  every process reads its own
+ *           block of A through a subarray file view, so the matrix is
+ *           never funnelled through process 0.
+ *
+ * Compile:  mpicc -g -Wall -O2 -o mpi_mat_vect_2d mpi_mat_vect_2d.c
+ * Run:      mpiexec -n <p> ./mpi_mat_vect_2d g <m> <n>
+ *           mpiexec -n <p> ./mpi_mat_vect_2d f <m> <n> <A file> <x file>
+ *                 <y file>
+ *
+ * Input:    "g" mode:  none
+ *           "f" mode:  A file:  m*n doubles, stored by rows, no header
+ *                      x file:  n doubles
+ * Output:   "g" mode:  minimum elapsed time over NUM_RUNS runs for the
+ *                      block-row and the 2-D product, doubles moved per
+ *                      process, and a checksum of y for each
+ *           "f" mode:  y file:  m doubles, and the elapsed time
+ *
+ * Notes:
+ *    1. MPI_Dims_create chooses q_r and q_c.  q_r should evenly divide
+ *       m and q_c should evenly divide n.  In "g" mode p should also
+ *       evenly divide m and n (for the block-row comparison).
+ *    2. Entries of A and x are a deterministic function of their
+ *       global indices, so the two distributions see the same matrix
+ *       and the checksums should agree.
+ *    3. Define DEBUG to print y on process 0.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#define NUM_RUNS 5
+
+typedef struct {
+   int      p;          /* Total number of processes      */
+   MPI_Comm comm;       /* Communicator for entire grid   */
+   MPI_Comm row_comm;   /* Communicator for my grid row   */
+   MPI_Comm col_comm;   /* Communicator for my grid col   */
+   int      q_r;        /* Number of rows in the grid     */
+   int      q_c;        /* Number of cols in the grid     */
+   int      my_row;     /* My row number                  */
+   int      my_col;     /* My column number               */
+   int      my_rank;    /* My rank in the grid comm       */
+} grid_info_t;
+
+void Usage(char* prog_name);
+void Check_for_error(int local_ok, char fname[], char message[],
+      MPI_Comm comm);
+void Get_args(int argc, char* argv[], char* g_f_p, int* m_p, int* n_p,
+      char A_file[], char x_file[], char y_file[], int my_rank,
+      MPI_Comm comm);
+void Setup_grid(grid_info_t* grid, MPI_Comm comm);
+void Free_grid(grid_info_t* grid);
+double Entry(long i, long j, long n);
+void Generate_block(double local_A[], int local_m, int local_n,
+      int first_row, int first_col, int n);
+void Generate_vector(double local_x[], int local_n, int first);
+void Read_block(char fname[], double local_A[], int m, int n,
+      int local_m, int local_n, grid_info_t* grid);
+void Read_vector_block(char fname[], double local_x[], int local_n,
+      grid_info_t* grid);
+void Write_vector_block(char fname[], double local_y[], int local_m,
+      grid_info_t* grid);
+void Mat_vect_mult_2d(double local_A[], double local_x[],
+      double local_y[], double temp_y[], int local_m, int local_n,
+      grid_info_t* grid);
+void Mat_vect_mult_1d(double local_A[], double local_x[],
+      double local_y[], double x[], int local_m, int n, int local_n,
+      MPI_Comm comm);
+double Time_2d(double local_A[], double local_x[], double local_y[],
+      int local_m, int local_n, grid_info_t* grid);
+double Time_1d(int m, int n, grid_info_t* grid, double* checksum_p);
+void Print_vector_2d(char title[], double local_y[], int m, int local_m,
+      grid_info_t* grid);
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   double* local_A;
+   double* local_x;
+   double* local_y;
+   int m, n, local_m, local_n, local_ok = 1;
+   char g_f;
+   char A_file[256], x_file[256], y_file[256];
+   double elapsed_2d, elapsed_1d, checksum_2d, checksum_1d;
+   double my_sum;
+   grid_info_t grid;
+   int i;
+
+   MPI_Init(&argc, &argv);
+   Setup_grid(&grid, MPI_COMM_WORLD);
+   Get_args(argc, argv, &g_f, &m, &n, A_file, x_file, y_file,
+         grid.my_rank, grid.comm);
+
+   if (m % grid.q_r != 0 || n % grid.q_c != 0) local_ok = 0;
+   if (g_f == 'g' && (m % grid.p != 0 || n % grid.p != 0)) local_ok = 0;
+   Check_for_error(local_ok, "main",
+         "m and n must be evenly divisible by the grid dimensions",
+         grid.comm);
+   local_m = m/grid.q_r;
+   local_n = n/grid.q_c;
+
+   local_A = malloc((size_t) local_m*local_n*sizeof(double));
+   local_x = malloc(local_n*sizeof(double));
+   local_y = malloc(local_m*sizeof(double));
+   if (local_A == NULL || local_x == NULL || local_y == NULL) local_ok = 0;
+   Check_for_error(local_ok, "main", "Can't allocate local arrays",
+         grid.comm);
+
+   if (g_f == 'g') {
+      Generate_block(local_A, local_m, local_n, grid.my_row*local_m,
+            grid.my_col*local_n, n);
+      if (grid.my_row == 0)
+         Generate_vector(local_x, local_n, grid.my_col*local_n);
+   } else {
+      Read_block(A_file, local_A, m, n, local_m, local_n, &grid);
+      Read_vector_block(x_file, local_x, local_n, &grid);
+   }
+
+   elapsed_2d = Time_2d(local_A, local_x, local_y, local_m, local_n,
+         &grid);
+
+#  ifdef DEBUG
+   Print_vector_2d("y", local_y, m, local_m, &grid);
+#  endif
+
+   if (g_f == 'f') {
+      Write_vector_block(y_file, local_y, local_m, &grid);
+      if (grid.my_rank == 0)
+         printf("q_r = %d, q_c = %d, elapsed time = %e\n",
+               grid.q_r, grid.q_c, elapsed_2d);
+   } else {
+      my_sum = 0.0;
+      if (grid.my_col == 0)
+         for (i = 0; i < local_m; i++)
+            my_sum += local_y[i];
+      MPI_Reduce(&my_sum, &checksum_2d, 1, MPI_DOUBLE, MPI_SUM, 0,
+            grid.comm);
+
+      /* Free the 2-D blocks before allocating the block rows */
+      free(local_A);
+      local_A = NULL;
+      elapsed_1d = Time_1d(m, n, &grid, &checksum_1d);
+
+      if (grid.my_rank == 0) {
+         printf("p = %d, m = %d, n = %d\n", grid.p, m, n);
+         printf("Block-row:    elapsed time = %e, ", elapsed_1d);
+         printf("doubles moved per process = %d, checksum = %.10e\n",
+               n - n/grid.p, checksum_1d);
+         printf("2-D (%dx%d):   elapsed time = %e, ", grid.q_r, grid.q_c,
+               elapsed_2d);
+         printf("doubles moved per process = %d, checksum = %.10e\n",
+               (grid.q_r > 1 ? local_n : 0) + (grid.q_c > 1 ? local_m : 0),
+               checksum_2d);
+      }
+   }
+
+   free(local_A);
+   free(local_x);
+   free(local_y);
+   Free_grid(&grid);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print command line to start program
+ * In arg:    prog_name:  name of executable
+ * Note:      Purely local, run only by process 0
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage:  mpiexec -n <p> %s g <m> <n>\n", prog_name);
+   fprintf(stderr, "        mpiexec -n <p> %s f <m> <n> ", prog_name);
+   fprintf(stderr, "<A file> <x file> <y file>\n");
+   fprintf(stderr, "   - g: generate A and x, compare block-row and 2-D\n");
+   fprintf(stderr, "   - f: read binary A and x, write binary y\n");
+   fflush(stderr);
+}  /* Usage */
+
+
+/*-------------------------------------------------------------------*/
+void Check_for_error(
+      int       local_ok   /* in */,
+      char      fname[]    /* in */,
+      char      message[]  /* in */,
+      MPI_Comm  comm       /* in */) {
+   int ok;
+
+   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (ok == 0) {
+      int my_rank;
+      MPI_Comm_rank(comm, &my_rank);
+      if (my_rank == 0) {
+         fprintf(stderr, "Proc %d > In %s, %s\n", my_rank, fname,
+               message);
+         fflush(stderr);
+      }
+      MPI_Finalize();
+      exit(-1);
+   }
+}  /* Check_for_error */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check command line arguments
+ * In args:     argc, argv, my_rank, comm
+ * Out args:    g_f_p, m_p, n_p, A_file, x_file, y_file
+ */
+void Get_args(int argc, char* argv[], char* g_f_p, int* m_p, int* n_p,
+      char A_file[], char x_file[], char y_file[], int my_rank,
+      MPI_Comm comm) {
+   int local_ok = 1;
+
+   *g_f_p = (argc > 1) ? argv[1][0] : 'x';
+   if ((*g_f_p == 'g' && argc != 4) || (*g_f_p == 'f' && argc != 7) ||
+         (*g_f_p != 'g' && *g_f_p != 'f')) {
+      if (my_rank == 0) Usage(argv[0]);
+      local_ok = 0;
+   } else {
+      *m_p = strtol(argv[2], NULL, 10);
+      *n_p = strtol(argv[3], NULL, 10);
+      if (*m_p <= 0 || *n_p <= 0) local_ok = 0;
+      if (*g_f_p == 'f') {
+         strncpy(A_file, argv[4], 255);  A_file[255] = '\0';
+         strncpy(x_file, argv[5], 255);  x_file[255] = '\0';
+         strncpy(y_file, argv[6], 255);  y_file[255] = '\0';
+      }
+   }
+   Check_for_error(local_ok, "Get_args", "bad command line", comm);
+}  /* Get_args */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Setup_grid
+ * Purpose:    Create a two-dimensional cartesian communicator, and
+ *             row and column communicators for it
+ * In arg:     comm:  the processes that will form the grid
+ * Out arg:    grid
+ */
+void Setup_grid(grid_info_t* grid, MPI_Comm comm) {
+   int dims[2] = {0, 0};
+   int periods[2] = {0, 0};
+   int coords[2];
+   int free_coords[2];
+
+   MPI_Comm_size(comm, &grid->p);
+   MPI_Dims_create(grid->p, 2, dims);
+   grid->q_r = dims[0];
+   grid->q_c = dims[1];
+
+   MPI_Cart_create(comm, 2, dims, periods, 1, &grid->comm);
+   MPI_Comm_rank(grid->comm, &grid->my_rank);
+   MPI_Cart_coords(grid->comm, grid->my_rank, 2, coords);
+   grid->my_row = coords[0];
+   grid->my_col = coords[1];
+
+   /* Processes in the same grid row:  vary the column coordinate */
+   free_coords[0] = 0;
+   free_coords[1] = 1;
+   MPI_Cart_sub(grid->comm, free_coords, &grid->row_comm);
+
+   /* Processes in the same grid column:  vary the row coordinate */
+   free_coords[0] = 1;
+   free_coords[1] = 0;
+   MPI_Cart_sub(grid->comm, free_coords, &grid->col_comm);
+}  /* Setup_grid */
+
+
+/*-------------------------------------------------------------------*/
+void Free_grid(grid_info_t* grid) {
+   MPI_Comm_free(&grid->row_comm);
+   MPI_Comm_free(&grid->col_comm);
+   MPI_Comm_free(&grid->comm);
+}  /* Free_grid */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Entry
+ * Purpose:   Return a pseudo-random double in [0, 1) that only depends
+ *            on the global position (i, j) of an entry.  Use i = -1
+ *            for the entries of x.
+ */
+double Entry(long i, long j, long n) {
+   unsigned long h = (unsigned long) ((i+1)*(n+1) + j + 1);
+
+   h *= 0x9E3779B97F4A7C15UL;
+   h ^= h >> 31;
+   h *= 0xBF58476D1CE4E5B9UL;
+   h ^= h >> 29;
+   return (h >> 11)*(1.0/9007199254740992.0);
+}  /* Entry */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Generate_block
+ * Purpose:   Generate the local_m x local_n block of A whose upper
+ *            left corner is A[first_row][first_col]
+ */
+void Generate_block(double local_A[], int local_m, int local_n,
+      int first_row, int first_col, int n) {
+   int i, j;
+
+   for (i = 0; i < local_m; i++)
+      for (j = 0; j < local_n; j++)
+         local_A[(size_t) i*local_n + j] =
+            Entry(first_row + i, first_col + j, n);
+}  /* Generate_block */
+
+
+/*-------------------------------------------------------------------*/
+void Generate_vector(double local_x[], int local_n, int first) {
+   int j;
+
+   for (j = 0; j < local_n; j++)
+      local_x[j] = Entry(-1, first + j, 0);
+}  /* Generate_vector */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Read_block
+ * Purpose:   Each process reads its block of A from a binary file
+ *            with a collective read through a subarray file view
+ * In args:   fname, m, n, local_m, local_n, grid
+ * Out arg:   local_A
+ * Errors:    if the file can't be opened, all processes quit
+ */
+void Read_block(char fname[], double local_A[], int m, int n,
+      int local_m, int local_n, grid_info_t* grid) {
+   MPI_File fh;
+   MPI_Datatype block_t;
+   int sizes[2], subsizes[2], starts[2];
+   int err;
+
+   err = MPI_File_open(grid->comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL,
+         &fh);
+   Check_for_error(err == MPI_SUCCESS, "Read_block",
+         "Can't open matrix file", grid->comm);
+
+   sizes[0] = m;                         sizes[1] = n;
+   subsizes[0] = local_m;                subsizes[1] = local_n;
+   starts[0] = grid->my_row*local_m;     starts[1] = grid->my_col*local_n;
+   MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+         MPI_DOUBLE, &block_t);
+   MPI_Type_commit(&block_t);
+
+   MPI_File_set_view(fh, 0, MPI_DOUBLE, block_t, "native", MPI_INFO_NULL);
+   MPI_File_read_all(fh, local_A, local_m*local_n, MPI_DOUBLE,
+         MPI_STATUS_IGNORE);
+
+   MPI_Type_free(&block_t);
+   MPI_File_close(&fh);
+}  /* Read_block */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Read_vector_block
+ * Purpose:   The processes in the first row of the grid read their
+ *            blocks of x from a binary file
+ * Note:      All processes call the collective open and close, but
+ *            only the processes in grid row 0 read anything
+ */
+void Read_vector_block(char fname[], double local_x[], int local_n,
+      grid_info_t* grid) {
+   MPI_File fh;
+   MPI_Offset offset;
+   int count = (grid->my_row == 0) ? local_n : 0;
+   int err;
+
+   err = MPI_File_open(grid->comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL,
+         &fh);
+   Check_for_error(err == MPI_SUCCESS, "Read_vector_block",
+         "Can't open vector file", grid->comm);
+
+   offset = (MPI_Offset) grid->my_col*local_n*sizeof(double);
+   MPI_File_read_at_all(fh, offset, local_x, count, MPI_DOUBLE,
+         MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+}  /* Read_vector_block */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Write_vector_block
+ * Purpose:   The processes in the first column of the grid write their
+ *            blocks of y to a binary file
+ */
+void Write_vector_block(char fname[], double local_y[], int local_m,
+      grid_info_t* grid) {
+   MPI_File fh;
+   MPI_Offset offset;
+   int count = (grid->my_col == 0) ? local_m : 0;
+   int err;
+
+   err = MPI_File_open(grid->comm, fname, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+         MPI_INFO_NULL, &fh);
+   Check_for_error(err == MPI_SUCCESS, "Write_vector_block",
+         "Can't open output file", grid->comm);
+   /* MPI_MODE_CREATE doesn't truncate an existing file */
+   MPI_File_set_size(fh, 0);
+
+   offset = (MPI_Offset) grid->my_row*local_m*sizeof(double);
+   MPI_File_write_at_all(fh, offset, local_y, count, MPI_DOUBLE,
+         MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+}  /* Write_vector_block */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Mat_vect_mult_2d
+ * Purpose:   Multiply a matrix with a checkerboard distribution by a
+ *            vector
+ * In args:   local_A:   my block of A
+ *            local_n:   number of columns in my block
+ *            local_m:   number of rows in my block
+ *            grid
+ * In/out:    local_x:   on input x_c on the processes in grid row 0,
+ *                       on output x_c on every process in column c
+ * Out arg:   local_y:   y_r on the processes in grid column 0
+ * Scratch:   temp_y:    local_m doubles
+ */
+void Mat_vect_mult_2d(
+      double        local_A[]  /* in     */,
+      double        local_x[]  /* in/out */,
+      double        local_y[]  /* out    */,
+      double        temp_y[]   /* scratch */,
+      int           local_m    /* in     */,
+      int           local_n    /* in     */,
+      grid_info_t*  grid       /* in     */) {
+   int local_i, j;
+   double sum;
+
+   /* Process (0, c) has rank 0 in column c's communicator */
+   MPI_Bcast(local_x, local_n, MPI_DOUBLE, 0, grid->col_comm);
+
+   for (local_i = 0; local_i < local_m; local_i++) {
+      sum = 0.0;
+      for (j = 0; j < local_n; j++)
+         sum += local_A[(size_t) local_i*local_n + j]*local_x[j];
+      temp_y[local_i] = sum;
+   }
+
+   /* Process (r, 0) has rank 0 in row r's communicator */
+   MPI_Reduce(temp_y, local_y, local_m, MPI_DOUBLE, MPI_SUM, 0,
+         grid->row_comm);
+}  /* Mat_vect_mult_2d */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Mat_vect_mult_1d
+ * Purpose:   The block-row product from mpi_mat_vect_time.c.  Here x
+ *            is storage for the gathered vector, so the allocation
+ *            isn't timed.
+ */
+void Mat_vect_mult_1d(
+      double    local_A[]  /* in  */,
+      double    local_x[]  /* in  */,
+      double    local_y[]  /* out */,
+      double    x[]        /* scratch */,
+      int       local_m    /* in  */,
+      int       n          /* in  */,
+      int       local_n    /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   int local_i, j;
+
+   MPI_Allgather(local_x, local_n, MPI_DOUBLE,
+         x, local_n, MPI_DOUBLE, comm);
+
+   for (local_i = 0; local_i < local_m; local_i++) {
+      local_y[local_i] = 0.0;
+      for (j = 0; j < n; j++)
+         local_y[local_i] += local_A[(size_t) local_i*n+j]*x[j];
+   }
+}  /* Mat_vect_mult_1d */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Time_2d
+ * Purpose:   Run the 2-D product NUM_RUNS times and return the
+ *            minimum over the runs of the maximum time over the
+ *            processes
+ * Note:      The broadcast overwrites local_x on processes that
+ *            aren't in grid row 0, so repeated runs are consistent
+ */
+double Time_2d(double local_A[], double local_x[], double local_y[],
+      int local_m, int local_n, grid_info_t* grid) {
+   double* temp_y = malloc(local_m*sizeof(double));
+   double start, loc_elapsed, elapsed, min_elapsed = 0.0;
+   int run;
+
+   for (run = 0; run < NUM_RUNS; run++) {
+      MPI_Barrier(grid->comm);
+      start = MPI_Wtime();
+      Mat_vect_mult_2d(local_A, local_x, local_y, temp_y, local_m,
+            local_n, grid);
+      loc_elapsed = MPI_Wtime() - start;
+      MPI_Allreduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX,
+            grid->comm);
+      if (run == 0 || elapsed < min_elapsed) min_elapsed = elapsed;
+   }
+
+   free(temp_y);
+   return min_elapsed;
+}  /* Time_2d */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Time_1d
+ * Purpose:   Generate the same A and x with a block-row distribution
+ *            and time the block-row product
+ * Out arg:   checksum_p:  sum of the entries of y (on process 0)
+ * Ret val:   minimum over NUM_RUNS runs of the maximum time over the
+ *            processes
+ */
+double Time_1d(int m, int n, grid_info_t* grid, double* checksum_p) {
+   int local_m = m/grid->p, local_n = n/grid->p;
+   int local_ok = 1, run, i;
+   double *local_A, *local_x, *local_y, *x;
+   double start, loc_elapsed, elapsed, min_elapsed = 0.0, my_sum = 0.0;
+
+   local_A = malloc((size_t) local_m*n*sizeof(double));
+   local_x = malloc(local_n*sizeof(double));
+   local_y = malloc(local_m*sizeof(double));
+   x = malloc(n*sizeof(double));
+   if (local_A == NULL || local_x == NULL || local_y == NULL || x == NULL)
+      local_ok = 0;
+   Check_for_error(local_ok, "Time_1d", "Can't allocate local arrays",
+         grid->comm);
+
+   Generate_block(local_A, local_m, n, grid->my_rank*local_m, 0, n);
+   Generate_vector(local_x, local_n, grid->my_rank*local_n);
+
+   for (run = 0; run < NUM_RUNS; run++) {
+      MPI_Barrier(grid->comm);
+      start = MPI_Wtime();
+      Mat_vect_mult_1d(local_A, local_x, local_y, x, local_m, n, local_n,
+            grid->comm);
+      loc_elapsed = MPI_Wtime() - start;
+      MPI_Allreduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX,
+            grid->comm);
+      if (run == 0 || elapsed < min_elapsed) min_elapsed = elapsed;
+   }
+
+   for (i = 0; i < local_m; i++)
+      my_sum += local_y[i];
+   MPI_Reduce(&my_sum, checksum_p, 1, MPI_DOUBLE, MPI_SUM, 0, grid->comm);
+
+   free(local_A);
+   free(local_x);
+   free(local_y);
+   free(x);
+   return min_elapsed;
+}  /* Time_1d */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Print_vector_2d
+ * Purpose:   Gather y from the first column of the grid onto process
+ *            0 and print it
+ * Note:      Only for debugging:  it funnels y through process 0
+ */
+void Print_vector_2d(char title[], double local_y[], int m, int local_m,
+      grid_info_t* grid) {
+   double* y = NULL;
+   int i;
+
+   if (grid->my_col != 0) return;
+   if (grid->my_row == 0) y = malloc(m*sizeof(double));
+   MPI_Gather(local_y, local_m, MPI_DOUBLE, y, local_m, MPI_DOUBLE, 0,
+         grid->col_comm);
+   if (grid->my_row == 0) {
+      printf("\nThe vector %s\n", title);
+      for (i = 0; i < m; i++)
+         printf("%f ", y[i]);
+      printf("\n");
+      free(y);
+   }
+}  /* Print_vector_2d */
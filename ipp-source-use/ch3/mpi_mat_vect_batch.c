@@ -0,0 +1,357 @@
+/* File:     mpi_mat_vect_batch.c
+ *
+ * Purpose:  Implement a parallel "batched" matrix-vector product
+ *           Y = AX, where A is m x n and X is an n x k matrix whose
+ *           columns are k different vectors x.  A is distributed by
+ *           block rows, and X and Y are distributed by block rows
+ *           (so each process has a block of every vector in the
+ *           batch).  A is streamed from memory once for the whole
+ *           batch, and all k vectors are gathered with a single
+ *           MPI_Allgather.  The program generates a random A and X
+ *           and prints the run-time.
+ *
+ * Compile:  mpicc -g -Wall -O3 -fopenmp-simd -o mpi_mat_vect_batch
+ *              mpi_mat_vect_batch.c
+ * Run:      mpiexec -n <number of processes> ./mpi_mat_vect_batch
+ *
+ * Input:    Dimensions of the matrix (m = number of rows, n
+ *              = number of columns) and the number of vectors k
+ * Output:   Elapsed time for the multiplication (maximum over the
+ *           processes), the part of it spent in the Allgather,
+ *           GFLOP/s, and the arithmetic intensity of the batched
+ *           product compared to k separate matrix-vector products
+ *
+ * Notes:
+ *    1. Number of processes should evenly divide both m and n
+ *    2. X and Y are stored by rows:  X[j][c] = X[j*k + c], so the
+ *       innermost loop over the batch index c is unit stride and
+ *       is vectorized with a simd directive.
+ *    3. The columns of A are processed in blocks so that the rows
+ *       of X used by a block fit in X_CACHE_BYTES bytes (default
+ *       128 KB, override with -DX_CACHE_BYTES=<bytes>).
+ *    4. Define DEBUG for verbose output, including the product Y
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#ifndef X_CACHE_BYTES
+#define X_CACHE_BYTES (128*1024)
+#endif
+
+void Check_for_error(int local_ok, char fname[], char message[],
+      MPI_Comm comm);
+void Get_dims(int* m_p, int* local_m_p, int* n_p, int* local_n_p,
+      int* k_p, int my_rank, int comm_sz, MPI_Comm comm);
+void Allocate_arrays(double** local_A_pp, double** local_X_pp,
+      double** local_Y_pp, int local_m, int n, int local_n, int k,
+      MPI_Comm comm);
+void Generate_matrix(double local_A[], int local_m, int n);
+void Print_matrix(char title[], double local_A[], int m, int local_m,
+      int n, int my_rank, MPI_Comm comm);
+int  Col_block(int k);
+void Mat_mult_rows(double* restrict local_A, double* restrict X,
+      double* restrict local_Y, int local_m, int n, int k);
+void Mat_vect_batch(double local_A[], double local_X[],
+      double local_Y[], int local_m, int n, int local_n, int k,
+      double* comm_time_p, MPI_Comm comm);
+void Print_stats(double elapsed, double comm_time, int m, int n, int k);
+
+/*-------------------------------------------------------------------*/
+int main(void) {
+   double* local_A;
+   double* local_X;
+   double* local_Y;
+   int m, local_m, n, local_n, k;
+   int my_rank, comm_sz;
+   MPI_Comm comm;
+   double start, finish, loc_elapsed, elapsed;
+   double loc_comm_time, comm_time;
+
+   MPI_Init(NULL, NULL);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+
+   Get_dims(&m, &local_m, &n, &local_n, &k, my_rank, comm_sz, comm);
+   Allocate_arrays(&local_A, &local_X, &local_Y, local_m, n, local_n, k,
+         comm);
+   srandom(my_rank);
+   Generate_matrix(local_A, local_m, n);
+   Generate_matrix(local_X, local_n, k);
+#  ifdef DEBUG
+   Print_matrix("A", local_A, m, local_m, n, my_rank, comm);
+   Print_matrix("X", local_X, n, local_n, k, my_rank, comm);
+#  endif
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   Mat_vect_batch(local_A, local_X, local_Y, local_m, n, local_n, k,
+         &loc_comm_time, comm);
+   finish = MPI_Wtime();
+   loc_elapsed = finish-start;
+   MPI_Reduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+   MPI_Reduce(&loc_comm_time, &comm_time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+#  ifdef DEBUG
+   Print_matrix("Y", local_Y, m, local_m, k, my_rank, comm);
+#  endif
+
+   if (my_rank == 0)
+      Print_stats(elapsed, comm_time, m, n, k);
+
+   free(local_A);
+   free(local_X);
+   free(local_Y);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+
+/*-------------------------------------------------------------------*/
+void Check_for_error(
+      int       local_ok   /* in */,
+      char      fname[]    /* in */,
+      char      message[]  /* in */,
+      MPI_Comm  comm       /* in */) {
+   int ok;
+
+   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (ok == 0) {
+      int my_rank;
+      MPI_Comm_rank(comm, &my_rank);
+      if (my_rank == 0) {
+         fprintf(stderr, "Proc %d > In %s, %s\n", my_rank, fname,
+               message);
+         fflush(stderr);
+      }
+      MPI_Finalize();
+      exit(-1);
+   }
+}  /* Check_for_error */
+
+
+/*-------------------------------------------------------------------*/
+void Get_dims(
+      int*      m_p        /* out */,
+      int*      local_m_p  /* out */,
+      int*      n_p        /* out */,
+      int*      local_n_p  /* out */,
+      int*      k_p        /* out */,
+      int       my_rank    /* in  */,
+      int       comm_sz    /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   int local_ok = 1;
+
+   if (my_rank == 0) {
+      printf("Enter the number of rows\n");
+      scanf("%d", m_p);
+      printf("Enter the number of columns\n");
+      scanf("%d", n_p);
+      printf("Enter the number of vectors\n");
+      scanf("%d", k_p);
+   }
+   MPI_Bcast(m_p, 1, MPI_INT, 0, comm);
+   MPI_Bcast(n_p, 1, MPI_INT, 0, comm);
+   MPI_Bcast(k_p, 1, MPI_INT, 0, comm);
+   if (*m_p <= 0 || *n_p <= 0 || *k_p <= 0 || *m_p % comm_sz != 0
+         || *n_p % comm_sz != 0) local_ok = 0;
+   Check_for_error(local_ok, "Get_dims",
+      "m, n, k must be positive and m, n evenly divisible by comm_sz",
+      comm);
+
+   *local_m_p = *m_p/comm_sz;
+   *local_n_p = *n_p/comm_sz;
+}  /* Get_dims */
+
+/*-------------------------------------------------------------------*/
+void Allocate_arrays(
+      double**  local_A_pp  /* out */,
+      double**  local_X_pp  /* out */,
+      double**  local_Y_pp  /* out */,
+      int       local_m     /* in  */,
+      int       n           /* in  */,
+      int       local_n     /* in  */,
+      int       k           /* in  */,
+      MPI_Comm  comm        /* in  */) {
+
+   int local_ok = 1;
+
+   *local_A_pp = malloc((size_t) local_m*n*sizeof(double));
+   *local_X_pp = malloc((size_t) local_n*k*sizeof(double));
+   *local_Y_pp = malloc((size_t) local_m*k*sizeof(double));
+
+   if (*local_A_pp == NULL || *local_X_pp == NULL ||
+         *local_Y_pp == NULL) local_ok = 0;
+   Check_for_error(local_ok, "Allocate_arrays",
+         "Can't allocate local arrays", comm);
+}  /* Allocate_arrays */
+
+/*-------------------------------------------------------------------*/
+void Generate_matrix(
+      double local_A[]  /* out */,
+      int    local_m    /* in  */,
+      int    n          /* in  */) {
+   int i, j;
+
+   for (i = 0; i < local_m; i++)
+      for (j = 0; j < n; j++)
+         local_A[(size_t) i*n + j] = ((double) random())/((double) RAND_MAX);
+}  /* Generate_matrix */
+
+/*-------------------------------------------------------------------*/
+void Print_matrix(
+      char      title[]    /* in */,
+      double    local_A[]  /* in */,
+      int       m          /* in */,
+      int       local_m    /* in */,
+      int       n          /* in */,
+      int       my_rank    /* in */,
+      MPI_Comm  comm       /* in */) {
+   double* A = NULL;
+   int i, j, local_ok = 1;
+
+   if (my_rank == 0) {
+      A = malloc((size_t) m*n*sizeof(double));
+      if (A == NULL) local_ok = 0;
+      Check_for_error(local_ok, "Print_matrix",
+            "Can't allocate temporary matrix", comm);
+      MPI_Gather(local_A, local_m*n, MPI_DOUBLE,
+            A, local_m*n, MPI_DOUBLE, 0, comm);
+      printf("\nThe matrix %s\n", title);
+      for (i = 0; i < m; i++) {
+         for (j = 0; j < n; j++)
+            printf("%f ", A[(size_t) i*n+j]);
+         printf("\n");
+      }
+      printf("\n");
+      free(A);
+   } else {
+      Check_for_error(local_ok, "Print_matrix",
+            "Can't allocate temporary matrix", comm);
+      MPI_Gather(local_A, local_m*n, MPI_DOUBLE,
+            A, local_m*n, MPI_DOUBLE, 0, comm);
+   }
+}  /* Print_matrix */
+
+/*-------------------------------------------------------------------
+ * Function:  Col_block
+ * Purpose:   Find the number of columns of A (= rows of X) that
+ *            should be processed together so that the corresponding
+ *            rows of X fit in X_CACHE_BYTES
+ * In arg:    k
+ * Ret val:   number of columns in a block (at least 1)
+ */
+int Col_block(int k) {
+   int col_block = X_CACHE_BYTES/(k*sizeof(double));
+
+   return col_block > 0 ? col_block : 1;
+}  /* Col_block */
+
+/*-------------------------------------------------------------------
+ * Function:  Mat_mult_rows
+ * Purpose:   Multiply the local rows of A by the whole of X
+ * In args:   local_A, X, local_m, n, k
+ * Out arg:   local_Y
+ */
+void Mat_mult_rows(
+      double* restrict local_A  /* in  */,
+      double* restrict X        /* in  */,
+      double* restrict local_Y  /* out */,
+      int              local_m  /* in  */,
+      int              n        /* in  */,
+      int              k        /* in  */) {
+   int local_i, j, c, jb, j_last;
+   int col_block = Col_block(k);
+   double a;
+   double* y_row;
+   double* x_row;
+   double* a_row;
+
+   for (local_i = 0; local_i < local_m; local_i++)
+      for (c = 0; c < k; c++)
+         local_Y[(size_t) local_i*k+c] = 0.0;
+
+   for (jb = 0; jb < n; jb += col_block) {
+      j_last = (jb + col_block < n) ? jb + col_block : n;
+      for (local_i = 0; local_i < local_m; local_i++) {
+         a_row = local_A + (size_t) local_i*n;
+         y_row = local_Y + (size_t) local_i*k;
+         for (j = jb; j < j_last; j++) {
+            a = a_row[j];
+            x_row = X + (size_t) j*k;
+#           pragma omp simd
+            for (c = 0; c < k; c++)
+               y_row[c] += a*x_row[c];
+         }
+      }
+   }
+}  /* Mat_mult_rows */
+
+/*-------------------------------------------------------------------
+ * Function:  Mat_vect_batch
+ * Purpose:   Multiply a matrix A by k vectors stored as the columns
+ *            of X.  The matrix and X and Y are distributed by block
+ *            rows.
+ * In args:   local_A:  calling process' rows of matrix A
+ *            local_X:  calling process' rows of X
+ *            local_m:  calling process' number of rows
+ *            n:        global (and local) number of columns of A
+ *            local_n:  calling process' number of rows of X
+ *            k:        number of vectors
+ *            comm:     communicator containing all calling processes
+ * Out args:  local_Y:     calling process' rows of Y
+ *            comm_time_p: time spent in MPI_Allgather
+ * Errors:    if malloc of local storage on any process fails, all
+ *            processes quit.
+ */
+void Mat_vect_batch(
+      double    local_A[]    /* in  */,
+      double    local_X[]    /* in  */,
+      double    local_Y[]    /* out */,
+      int       local_m      /* in  */,
+      int       n            /* in  */,
+      int       local_n      /* in  */,
+      int       k            /* in  */,
+      double*   comm_time_p  /* out */,
+      MPI_Comm  comm         /* in  */) {
+   double* X;
+   int local_ok = 1;
+   double start;
+
+   X = malloc((size_t) n*k*sizeof(double));
+   if (X == NULL) local_ok = 0;
+   Check_for_error(local_ok, "Mat_vect_batch",
+         "Can't allocate temporary matrix", comm);
+
+   start = MPI_Wtime();
+   MPI_Allgather(local_X, local_n*k, MPI_DOUBLE,
+         X, local_n*k, MPI_DOUBLE, comm);
+   *comm_time_p = MPI_Wtime() - start;
+
+   Mat_mult_rows(local_A, X, local_Y, local_m, n, k);
+
+   free(X);
+}  /* Mat_vect_batch */
+
+/*-------------------------------------------------------------------
+ * Function:    Print_stats
+ * Purpose:     Print elapsed time, flop rate and arithmetic intensity
+ * In args:     elapsed, comm_time, m, n, k
+ * Notes:
+ * 1.  The batched product does 2mnk flops.  Its compulsory traffic
+ *     is one pass over A, X and Y:  8(mn + nk + mk) bytes.
+ * 2.  k separate matrix-vector products do the same number of flops
+ *     but read A k times:  8k(mn + n + m) bytes.
+ */
+void Print_stats(double elapsed, double comm_time, int m, int n, int k) {
+   double flops = 2.0*m*n*k;
+   double batch_bytes = 8.0*((double) m*n + (double) n*k + (double) m*k);
+   double single_bytes = 8.0*k*((double) m*n + n + m);
+
+   printf("m = %d, n = %d, k = %d\n", m, n, k);
+   printf("Elapsed time = %e (Allgather = %e)\n", elapsed, comm_time);
+   printf("GFLOP/s = %.3f\n", flops/elapsed/1.0e9);
+   printf("Arithmetic intensity = %.3f flops/byte ", flops/batch_bytes);
+   printf("(k single mat-vects = %.3f flops/byte)\n", flops/single_bytes);
+}  /* Print_stats */
@@ -6,7 +6,12 @@
  *           matrix is distributed by block rows.
  *
  * Compile:  mpicc -g -Wall -o mpi_mat_vect_mult mpi_mat_vect_mult.c
+ *              mpi_io.c
+ *           Needs mpi_io.h
  * Run:      mpiexec -n <number of processes> ./mpi_mat_vect_mult
+ *           mpiexec -n <number of processes> ./mpi_mat_vect_mult
+ *              <A file> <x file> <y file> [block | cyclic | <block size>]
+ *              [t]
  *
  * Input:    Dimensions of the matrix (m = number of rows, n
  *              = number of columns)
@@ -14,6 +19,14 @@
  *           n-dimensional vector x
  * Output:   Product vector y = Ax
  *
+ *           With file arguments, A and x are read from the files, and
+ *           y is written to a file, by all the processes with MPI-IO
+ *           (see mpi_io.c).  The rows of A and the components of y
+ *           are distributed with the given distribution (default
+ *           block).  x always has a block distribution, since
+ *           Mat_vect_mult gathers it with MPI_Allgather.  The files
+ *           are binary, or with t, text.
+ *
  * Errors:   If an error is detected (m or n negative, m or n not evenly
  *           divisible by the number of processes, malloc fails), the
  *           program prints a message and all processes quit.
@@ -21,17 +34,24 @@
  * Notes:     
  *    1. Number of processes should evenly divide both m and n
  *    2. Define DEBUG for verbose output
+ *    3. Reading on process 0 and scattering needs storage for all of
+ *       A on process 0, and process 0 does all the I/O.  With files,
+ *       each process only stores and reads its own rows.
  *
  * IPP:      Section 3.4.9 (pp. 113 and ff.)
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include "mpi_io.h"
 
 void Check_for_error(int local_ok, char fname[], char message[], 
       MPI_Comm comm);
 void Get_dims(int* m_p, int* local_m_p, int* n_p, int* local_n_p,
       int my_rank, int comm_sz, MPI_Comm comm);
+void Get_file_args(int argc, char* argv[], int* m_p, int* local_m_p,
+      int* n_p, int* local_n_p, int* blk_p, int* text_p, int comm_sz,
+      MPI_Comm comm);
 void Allocate_arrays(double** local_A_pp, double** local_x_pp, 
       double** local_y_pp, int local_m, int n, int local_n, 
       MPI_Comm comm);
@@ -48,33 +68,52 @@ void Mat_vect_mult(double local_A[], double local_x[],
       MPI_Comm comm);
 
 /*-------------------------------------------------------------------*/
-int main(void) {
+int main(int argc, char* argv[]) {
    double* local_A;
    double* local_x;
    double* local_y;
-   int m, local_m, n, local_n;
+   int m, local_m, n, local_n, blk, text;
    int my_rank, comm_sz;
    MPI_Comm comm;
 
-   MPI_Init(NULL, NULL);
+   MPI_Init(&argc, &argv);
    comm = MPI_COMM_WORLD;
    MPI_Comm_size(comm, &comm_sz);
    MPI_Comm_rank(comm, &my_rank);
 
-   Get_dims(&m, &local_m, &n, &local_n, my_rank, comm_sz, comm);
+   if (argc == 1)
+      Get_dims(&m, &local_m, &n, &local_n, my_rank, comm_sz, comm);
+   else
+      Get_file_args(argc, argv, &m, &local_m, &n, &local_n, &blk, &text,
+            comm_sz, comm);
    Allocate_arrays(&local_A, &local_x, &local_y, local_m, n, local_n, comm);
-   Read_matrix("A", local_A, m, local_m, n, my_rank, comm);
-#  ifdef DEBUG
-   Print_matrix("A", local_A, m, local_m, n, my_rank, comm);
-#  endif
-   Read_vector("x", local_x, n, local_n, my_rank, comm);
-#  ifdef DEBUG
-   Print_vector("x", local_x, n, local_n, my_rank, comm);
-#  endif
+   if (argc == 1) {
+      Read_matrix("A", local_A, m, local_m, n, my_rank, comm);
+#     ifdef DEBUG
+      Print_matrix("A", local_A, m, local_m, n, my_rank, comm);
+#     endif
+      Read_vector("x", local_x, n, local_n, my_rank, comm);
+#     ifdef DEBUG
+      Print_vector("x", local_x, n, local_n, my_rank, comm);
+#     endif
+   } else {
+      Check_for_error(
+            Io_read_rows(argv[1], text, local_A, m, local_m, n, blk, comm),
+            "main", "Can't read A", comm);
+      Check_for_error(
+            Io_read_rows(argv[2], text, local_x, n, local_n, 1, local_n,
+               comm),
+            "main", "Can't read x", comm);
+   }
 
    Mat_vect_mult(local_A, local_x, local_y, local_m, n, local_n, comm);
 
-   Print_vector("y", local_y, m, local_m, my_rank, comm);
+   if (argc == 1)
+      Print_vector("y", local_y, m, local_m, my_rank, comm);
+   else
+      Check_for_error(
+            Io_write_rows(argv[3], text, local_y, m, local_m, 1, blk, comm),
+            "main", "Can't write y", comm);
 
    free(local_A);
    free(local_x);
@@ -169,6 +208,68 @@ void Get_dims(
    *local_n_p = *n_p/comm_sz;
 }  /* Get_dims */
 
+/*-------------------------------------------------------------------
+ * Function:  Get_file_args
+ * Purpose:   Get the dimensions of the matrix and the vectors from
+ *            the A and x files, and the distribution and file format
+ *            from the command line
+ * In args:   argc, argv: the command line (argc > 1)
+ *            comm_sz:    number of processes in comm
+ *            comm:       communicator containing all processes calling
+ *                        Get_file_args
+ * Out args:  m_p:        global number of rows of A and components in y
+ *            local_m_p:  local number of rows of A and components of y
+ *            n_p:        global number of cols of A and components of x
+ *            local_n_p:  local number of components of x
+ *            blk_p:      number of consecutive rows of A in each block
+ *                        of the distribution
+ *            text_p:     1 if the files are text, 0 if binary
+ *
+ * Errors:    the A and x files must be readable, x must have n
+ *            components, m and n should be evenly divisible by
+ *            comm_sz, and the block size should evenly divide local_m
+ */
+void Get_file_args(
+      int       argc       /* in  */,
+      char*     argv[]     /* in  */,
+      int*      m_p        /* out */, 
+      int*      local_m_p  /* out */,
+      int*      n_p        /* out */,
+      int*      local_n_p  /* out */,
+      int*      blk_p      /* out */, 
+      int*      text_p     /* out */, 
+      int       comm_sz    /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   int local_ok = 1, x_n, x_cols;
+
+   Check_for_error(argc >= 4 && argc <= 6, "Get_file_args",
+         "usage: <A file> <x file> <y file> [block | cyclic | <block size>] [t]",
+         comm);
+   *text_p = (argv[argc-1][0] == 't' && argv[argc-1][1] == '\0');
+   Check_for_error(argc < 6 || *text_p, "Get_file_args",
+         "the last argument should be t", comm);
+   if (!Io_read_dims(argv[1], *text_p, m_p, n_p, comm)) local_ok = 0;
+   Check_for_error(local_ok, "Get_file_args",
+         "Can't read the dimensions of A", comm);
+   if (!Io_read_dims(argv[2], *text_p, &x_n, &x_cols, comm)
+         || x_n != *n_p || x_cols != 1) local_ok = 0;
+   Check_for_error(local_ok, "Get_file_args",
+         "x should be a vector with n components", comm);
+   if (*m_p % comm_sz != 0 || *n_p % comm_sz != 0) local_ok = 0;
+   Check_for_error(local_ok, "Get_file_args",
+      "m and n must be evenly divisible by comm_sz", comm);
+   *local_m_p = *m_p/comm_sz;
+   *local_n_p = *n_p/comm_sz;
+
+   if (argc - *text_p > 4)
+      *blk_p = Io_block_size(argv[4], *local_m_p);
+   else
+      *blk_p = *local_m_p;
+   if (*blk_p == 0) local_ok = 0;
+   Check_for_error(local_ok, "Get_file_args",
+         "the block size should evenly divide m/comm_sz", comm);
+}  /* Get_file_args */
+
 /*-------------------------------------------------------------------
  * Function:   Allocate_arrays
  * Purpose:    Allocate storage for local parts of A, x, and y
@@ -5,25 +5,54 @@
  *           matrix.  Vectors use block distributions and the
  *           matrix is distributed by block rows.  This version
  *           generates a random matrix A and a random vector x.
- *           It prints out the run-time.
+ *           It prints out the run-time.  With the argument 2d, the
+ *           matrix has a two-dimensional "checkerboard" distribution
+ *           instead (see mpi_mat_vect_2d.c), so that the scaling of
+ *           the two distributions can be compared.
  *
- * Compile:  mpicc -g -Wall -o mpi_mat_vect_time mpi_mat_vect_time.c
- * Run:      mpiexec -n <number of processes> ./mpi_mat_vect_time
+ * Compile:  mpicc -g -Wall -DUSE_MPI -o mpi_mat_vect_time
+ *              mpi_mat_vect_time.c prof.c
+ * Run:      mpiexec -n <number of processes> ./mpi_mat_vect_time [1d|2d]
  *
  * Input:    Dimensions of the matrix (m = number of rows, n
  *              = number of columns)
- * Output:   Elapsed time for execution of the multiplication
+ * Output:   On stderr, the minimum, median and maximum over the
+ *           processes of the time for REPS multiplications, after
+ *           one warm up multiplication, and the fastest
+ *           multiplication (see prof.h)
  *
  * Notes:     
  *    1. Number of processes should evenly divide both m and n
  *    2. Define DEBUG for verbose output, including the product
  *       vector y
+ *    3. The processes synchronize with MPI_Barrier before each
+ *       multiplication, but the barrier isn't timed
+ *    4. Both distributions time the region "mat_vect", so
+ *       benchmark.sh can run the program once with each and
+ *       scaling.awk prints their speedups side by side.  The block-row
+ *       product gathers all of x on every process, O(n) doubles, while
+ *       the 2-D product moves O(m/q_r + n/q_c) doubles per process.
+ *       DEBUG output is only printed for the block-row product.
  *
  * IPP:  Section 3.6.2 (pp. 122 and ff.)
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <mpi.h>
+#include "prof.h"
+
+#define REPS 10
+
+typedef struct {
+   MPI_Comm comm;       /* Communicator for entire grid   */
+   MPI_Comm row_comm;   /* Communicator for my grid row   */
+   MPI_Comm col_comm;   /* Communicator for my grid col   */
+   int      q_r;        /* Number of rows in the grid     */
+   int      q_c;        /* Number of cols in the grid     */
+   int      my_row;     /* My row number                  */
+   int      my_col;     /* My column number               */
+} grid_info_t;
 
 void Check_for_error(int local_ok, char fname[], char message[], 
       MPI_Comm comm);
@@ -45,23 +74,37 @@ void Print_vector(char title[], double local_vec[], int n,
 void Mat_vect_mult(double local_A[], double local_x[], 
       double local_y[], int local_m, int n, int local_n, 
       MPI_Comm comm);
+void Setup_grid(grid_info_t* grid, MPI_Comm comm);
+void Free_grid(grid_info_t* grid);
+void Mat_vect_mult_2d(double local_A[], double local_x[],
+      double local_y[], double temp_y[], int local_m, int local_n,
+      grid_info_t* grid);
+void Run_2d(int m, int n, int my_rank, MPI_Comm comm);
 
 /*-------------------------------------------------------------------*/
-int main(void) {
+int main(int argc, char* argv[]) {
    double* local_A;
    double* local_x;
    double* local_y;
    int m, local_m, n, local_n;
-   int my_rank, comm_sz;
+   int my_rank, comm_sz, rep;
    MPI_Comm comm;
-   double start, finish, loc_elapsed, elapsed;
 
-   MPI_Init(NULL, NULL);
+   MPI_Init(&argc, &argv);
    comm = MPI_COMM_WORLD;
    MPI_Comm_size(comm, &comm_sz);
    MPI_Comm_rank(comm, &my_rank);
 
+   Check_for_error(argc == 1 || (argc == 2 && (strcmp(argv[1], "1d") == 0
+         || strcmp(argv[1], "2d") == 0)), "main",
+         "usage: mpiexec -n <p> mpi_mat_vect_time [1d|2d]", comm);
    Get_dims(&m, &local_m, &n, &local_n, my_rank, comm_sz, comm);
+   if (argc == 2 && strcmp(argv[1], "2d") == 0) {
+      Run_2d(m, n, my_rank, comm);
+      PROF_REPORT();
+      MPI_Finalize();
+      return 0;
+   }
    Allocate_arrays(&local_A, &local_x, &local_y, local_m, n, local_n, comm);
 // Read_matrix("A", local_A, m, local_m, n, my_rank, comm);
    srandom(my_rank);
@@ -75,19 +118,20 @@ int main(void) {
    Print_vector("x", local_x, n, local_n, my_rank, comm);
 #  endif
 
-   MPI_Barrier(comm);
-   start = MPI_Wtime();
+   /* Warm up */
    Mat_vect_mult(local_A, local_x, local_y, local_m, n, local_n, comm);
-   finish = MPI_Wtime();
-   loc_elapsed = finish-start;
-   MPI_Reduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+   for (rep = 0; rep < REPS; rep++) {
+      MPI_Barrier(comm);
+      PROF_BEGIN("mat_vect");
+      Mat_vect_mult(local_A, local_x, local_y, local_m, n, local_n, comm);
+      PROF_END("mat_vect");
+   }
 
 #  ifdef DEBUG
    Print_vector("y", local_y, m, local_m, my_rank, comm);
 #  endif
 
-   if (my_rank == 0)
-      printf("Elapsed time = %e\n", elapsed);
+   PROF_REPORT();
 
    free(local_A);
    free(local_x);
@@ -349,3 +393,129 @@ void Mat_vect_mult(
    }
    free(x);
 }  /* Mat_vect_mult */
+
+/*-------------------------------------------------------------------
+ * Function:   Setup_grid
+ * Purpose:    Create a two-dimensional cartesian communicator, and
+ *             row and column communicators for it
+ */
+void Setup_grid(
+      grid_info_t*  grid  /* out */,
+      MPI_Comm      comm  /* in  */) {
+   int dims[2] = {0, 0};
+   int periods[2] = {0, 0};
+   int coords[2];
+   int free_coords[2];
+   int p, grid_rank;
+
+   MPI_Comm_size(comm, &p);
+   MPI_Dims_create(p, 2, dims);
+   grid->q_r = dims[0];
+   grid->q_c = dims[1];
+
+   MPI_Cart_create(comm, 2, dims, periods, 1, &grid->comm);
+   MPI_Comm_rank(grid->comm, &grid_rank);
+   MPI_Cart_coords(grid->comm, grid_rank, 2, coords);
+   grid->my_row = coords[0];
+   grid->my_col = coords[1];
+
+   /* Processes in the same grid row:  vary the column coordinate */
+   free_coords[0] = 0;
+   free_coords[1] = 1;
+   MPI_Cart_sub(grid->comm, free_coords, &grid->row_comm);
+
+   /* Processes in the same grid column:  vary the row coordinate */
+   free_coords[0] = 1;
+   free_coords[1] = 0;
+   MPI_Cart_sub(grid->comm, free_coords, &grid->col_comm);
+}  /* Setup_grid */
+
+/*-------------------------------------------------------------------*/
+void Free_grid(grid_info_t* grid  /* in/out */) {
+   MPI_Comm_free(&grid->row_comm);
+   MPI_Comm_free(&grid->col_comm);
+   MPI_Comm_free(&grid->comm);
+}  /* Free_grid */
+
+/*-------------------------------------------------------------------
+ * Function:  Mat_vect_mult_2d
+ * Purpose:   Multiply a matrix with a checkerboard distribution by a
+ *            vector:  broadcast x_c down grid column c, and reduce
+ *            the partial products across grid row r onto process
+ *            (r, 0)
+ * Note:      On input x_c is only needed on the processes in grid
+ *            row 0.  On output y_r is on the processes in column 0.
+ */
+void Mat_vect_mult_2d(
+      double        local_A[]  /* in      */,
+      double        local_x[]  /* in/out  */,
+      double        local_y[]  /* out     */,
+      double        temp_y[]   /* scratch */,
+      int           local_m    /* in      */,
+      int           local_n    /* in      */,
+      grid_info_t*  grid       /* in      */) {
+   int local_i, j;
+   double sum;
+
+   MPI_Bcast(local_x, local_n, MPI_DOUBLE, 0, grid->col_comm);
+
+   for (local_i = 0; local_i < local_m; local_i++) {
+      sum = 0.0;
+      for (j = 0; j < local_n; j++)
+         sum += local_A[(size_t) local_i*local_n + j]*local_x[j];
+      temp_y[local_i] = sum;
+   }
+
+   MPI_Reduce(temp_y, local_y, local_m, MPI_DOUBLE, MPI_SUM, 0,
+         grid->row_comm);
+}  /* Mat_vect_mult_2d */
+
+/*-------------------------------------------------------------------
+ * Function:  Run_2d
+ * Purpose:   Generate a random m x n matrix with a checkerboard
+ *            distribution and a random x, and time REPS products,
+ *            after one warm up product, in the region "mat_vect"
+ */
+void Run_2d(
+      int       m        /* in */,
+      int       n        /* in */,
+      int       my_rank  /* in */,
+      MPI_Comm  comm     /* in */) {
+   grid_info_t grid;
+   double *local_A, *local_x, *local_y, *temp_y;
+   int local_m, local_n, rep, local_ok = 1;
+
+   Setup_grid(&grid, comm);
+   local_m = m/grid.q_r;
+   local_n = n/grid.q_c;
+
+   local_A = malloc((size_t) local_m*local_n*sizeof(double));
+   local_x = malloc(local_n*sizeof(double));
+   local_y = malloc(local_m*sizeof(double));
+   temp_y = malloc(local_m*sizeof(double));
+   if (local_A == NULL || local_x == NULL || local_y == NULL ||
+         temp_y == NULL) local_ok = 0;
+   Check_for_error(local_ok, "Run_2d", "Can't allocate local arrays",
+         grid.comm);
+
+   srandom(my_rank);
+   Generate_matrix(local_A, local_m, local_n);
+   Generate_vector(local_x, local_n);
+
+   /* Warm up */
+   Mat_vect_mult_2d(local_A, local_x, local_y, temp_y, local_m, local_n,
+         &grid);
+   for (rep = 0; rep < REPS; rep++) {
+      MPI_Barrier(grid.comm);
+      PROF_BEGIN("mat_vect");
+      Mat_vect_mult_2d(local_A, local_x, local_y, temp_y, local_m,
+            local_n, &grid);
+      PROF_END("mat_vect");
+   }
+
+   free(local_A);
+   free(local_x);
+   free(local_y);
+   free(temp_y);
+   Free_grid(&grid);
+}  /* Run_2d */
@@ -6,8 +6,10 @@
  *    A:     elements of array (optional)
  * Output:
  *    A:     elements of A after sorting
+ *    On stderr, the time for the sort (see prof.h)
  *
- * Compile:  mpicc -g -Wall -o mpi_odd_even mpi_odd_even.c
+ * Compile:  mpicc -g -Wall -O3 -march=native -DUSE_MPI -I../ch4
+ *              -o mpi_odd_even mpi_odd_even.c local_sort.c prof.c
  * Run:
  *    mpiexec -n <p> mpi_odd_even <g|i> <global_n> 
  *       - p: the number of processes
@@ -19,32 +21,33 @@
  * 1.  global_n must be evenly divisible by p
  * 2.  Except for debug output, process 0 does all I/O
  * 3.  Optional -DDEBUG compile flag for verbose output
+ * 4.  The local sort is a radix sort, and the merge-splits use the
+ *     SIMD merges in local_sort.c.  The merges write to a scratch
+ *     array, which is then swapped with the local keys instead of
+ *     being copied back.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <mpi.h>
+#include "local_sort.h"
+#include "prof.h"
 
 const int RMAX = 100;
 
 /* Local functions */
 void Usage(char* program);
 void Print_list(int local_A[], int local_n, int rank);
-void Merge_low(int local_A[], int temp_B[], int temp_C[], 
-         int local_n);
-void Merge_high(int local_A[], int temp_B[], int temp_C[], 
-        int local_n);
 void Generate_list(int local_A[], int local_n, int my_rank);
-int  Compare(const void* a_p, const void* b_p);
 
 /* Functions involving communication */
 void Get_args(int argc, char* argv[], int* global_n_p, int* local_n_p, 
          char* gi_p, int my_rank, int p, MPI_Comm comm);
 void Sort(int local_A[], int local_n, int my_rank, 
          int p, MPI_Comm comm);
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
+void Odd_even_iter(int** keys_p, int temp_B[], int** temp_C_p,
          int local_n, int phase, int even_partner, int odd_partner,
-         int my_rank, int p, MPI_Comm comm);
+         int my_rank, MPI_Comm comm);
 void Print_local_lists(int local_A[], int local_n, 
          int my_rank, int p, MPI_Comm comm);
 void Print_global_list(int local_A[], int local_n, int my_rank,
@@ -83,7 +86,9 @@ int main(int argc, char* argv[]) {
    printf("Proc %d > Before Sort\n", my_rank);
    fflush(stdout);
 #  endif
+   PROF_BEGIN("sort");
    Sort(local_A, local_n, my_rank, p, comm);
+   PROF_END("sort");
 
 #  ifdef DEBUG
    Print_local_lists(local_A, local_n, my_rank, p, comm);
@@ -94,6 +99,7 @@ int main(int argc, char* argv[]) {
 
    free(local_A);
 
+   PROF_REPORT();
    MPI_Finalize();
 
    return 0;
@@ -237,24 +243,6 @@ void Print_global_list(int local_A[], int local_n, int my_rank, int p,
 
 }  /* Print_global_list */
 
-/*-------------------------------------------------------------------
- * Function:    Compare
- * Purpose:     Compare 2 ints, return -1, 0, or 1, respectively, when
- *              the first int is less than, equal, or greater than
- *              the second.  Used by qsort.
- */
-int Compare(const void* a_p, const void* b_p) {
-   int a = *((int*)a_p);
-   int b = *((int*)b_p);
-
-   if (a < b)
-      return -1;
-   else if (a == b)
-      return 0;
-   else /* a > b */
-      return 1;
-}  /* Compare */
-
 /*-------------------------------------------------------------------
  * Function:    Sort
  * Purpose:     Sort local list, use odd-even sort to sort
@@ -265,7 +253,7 @@ int Compare(const void* a_p, const void* b_p) {
 void Sort(int local_A[], int local_n, int my_rank, 
          int p, MPI_Comm comm) {
    int phase;
-   int *temp_B, *temp_C;
+   int *keys, *temp_B, *temp_C;
    int even_partner;  /* phase is even or left-looking */
    int odd_partner;   /* phase is odd or right-looking */
 
@@ -284,18 +272,25 @@ void Sort(int local_A[], int local_n, int my_rank,
       odd_partner = my_rank-1;  
    }
 
-   /* Sort local list using built-in quick sort */
-   qsort(local_A, local_n, sizeof(int), Compare);
+   /* Sort local list using radix sort */
+   Local_sort(local_A, local_n);
 
 #  ifdef DEBUG
    printf("Proc %d > before loop in sort\n", my_rank);
    fflush(stdout);
 #  endif
 
+   /* The merges write to temp_C, and then keys and temp_C are
+    * swapped, so keys may end up pointing to the malloc'ed block */
+   keys = local_A;
    for (phase = 0; phase < p; phase++)
-      Odd_even_iter(local_A, temp_B, temp_C, local_n, phase, 
-             even_partner, odd_partner, my_rank, p, comm);
+      Odd_even_iter(&keys, temp_B, &temp_C, local_n, phase, 
+             even_partner, odd_partner, my_rank, comm);
 
+   if (keys != local_A) {
+      memcpy(local_A, keys, local_n*sizeof(int));
+      temp_C = keys;
+   }
    free(temp_B);
    free(temp_C);
 }  /* Sort */
@@ -304,99 +299,40 @@ void Sort(int local_A[], int local_n, int my_rank,
 /*-------------------------------------------------------------------
  * Function:    Odd_even_iter
  * Purpose:     One iteration of Odd-even transposition sort
- * In args:     local_n, phase, my_rank, p, comm
- * In/out args: local_A
- * Scratch:     temp_B, temp_C
+ * In args:     local_n, phase, my_rank, comm
+ * In/out args: keys_p:  the sorted local keys.  After a merge-split,
+ *                 *keys_p and *temp_C_p are swapped.
+ * Scratch:     temp_B, *temp_C_p
  */
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
+void Odd_even_iter(int** keys_p, int temp_B[], int** temp_C_p,
         int local_n, int phase, int even_partner, int odd_partner,
-        int my_rank, int p, MPI_Comm comm) {
+        int my_rank, MPI_Comm comm) {
    MPI_Status status;
+   int partner, keep_low;
+   int* tmp;
 
    if (phase % 2 == 0) {
-      if (even_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, even_partner, 0, 
-            temp_B, local_n, MPI_INT, even_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_high(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_low(local_A, temp_B, temp_C, local_n);
-      }
+      partner = even_partner;
+      keep_low = (my_rank % 2 == 0);
    } else { /* odd phase */
-      if (odd_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, odd_partner, 0, 
-            temp_B, local_n, MPI_INT, odd_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_low(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_high(local_A, temp_B, temp_C, local_n);
-      }
+      partner = odd_partner;
+      keep_low = (my_rank % 2 != 0);
    }
+   if (partner < 0) return;
+
+   MPI_Sendrecv(*keys_p, local_n, MPI_INT, partner, 0, 
+      temp_B, local_n, MPI_INT, partner, 0, comm,
+      &status);
+   if (keep_low)
+      Merge_low_simd(*keys_p, temp_B, *temp_C_p, local_n);
+   else
+      Merge_high_simd(*keys_p, temp_B, *temp_C_p, local_n);
+   tmp = *keys_p;
+   *keys_p = *temp_C_p;
+   *temp_C_p = tmp;
 }  /* Odd_even_iter */
 
 
-/*-------------------------------------------------------------------
- * Function:    Merge_low
- * Purpose:     Merge the smallest local_n elements in my_keys
- *              and recv_keys into temp_keys.  Then copy temp_keys
- *              back into my_keys.
- * In args:     local_n, recv_keys
- * In/out args: my_keys
- * Scratch:     temp_keys
- */
-void Merge_low(
-      int  my_keys[],     /* in/out    */
-      int  recv_keys[],   /* in        */
-      int  temp_keys[],   /* scratch   */
-      int  local_n        /* = n/p, in */) {
-   int m_i, r_i, t_i;
-   
-   m_i = r_i = t_i = 0;
-   while (t_i < local_n) {
-      if (my_keys[m_i] <= recv_keys[r_i]) {
-         temp_keys[t_i] = my_keys[m_i];
-         t_i++; m_i++;
-      } else {
-         temp_keys[t_i] = recv_keys[r_i];
-         t_i++; r_i++;
-      }
-   }
-
-   memcpy(my_keys, temp_keys, local_n*sizeof(int));
-}  /* Merge_low */
-
-/*-------------------------------------------------------------------
- * Function:    Merge_high
- * Purpose:     Merge the largest local_n elements in local_A 
- *              and temp_B into temp_C.  Then copy temp_C
- *              back into local_A.
- * In args:     local_n, temp_B
- * In/out args: local_A
- * Scratch:     temp_C
- */
-void Merge_high(int local_A[], int temp_B[], int temp_C[], 
-        int local_n) {
-   int ai, bi, ci;
-   
-   ai = local_n-1;
-   bi = local_n-1;
-   ci = local_n-1;
-   while (ci >= 0) {
-      if (local_A[ai] >= temp_B[bi]) {
-         temp_C[ci] = local_A[ai];
-         ci--; ai--;
-      } else {
-         temp_C[ci] = temp_B[bi];
-         ci--; bi--;
-      }
-   }
-
-   memcpy(local_A, temp_C, local_n*sizeof(int));
-}  /* Merge_high */
-
-
 /*-------------------------------------------------------------------
  * Only called by process 0
  */
@@ -0,0 +1,609 @@
+/* File:     mpi_p2p_bench.c
+ * Purpose:  Measure the cost of point-to-point communication between
+ *           two processes.  This extends mpi_many_msgs.c, which
+ *           compares n messages of one double with one message of n
+ *           doubles, to a set of tests over message sizes from 8 bytes
+ *           up to max_bytes:
+ *
+ *           pingpong:  latency and bandwidth with blocking
+ *              (MPI_Send/MPI_Recv), nonblocking (MPI_Isend/MPI_Irecv)
+ *              and persistent (MPI_Send_init/MPI_Recv_init) requests
+ *           eager:     whether MPI_Send returns before the receive is
+ *              posted, i.e., whether the message is sent eagerly or
+ *              with a rendezvous, and the largest eager size
+ *           rate:      messages per second for many small messages,
+ *              sent one at a time, and aggregated into buffers the
+ *              size of the eager limit (at most AGG_MAX_BYTES)
+ *           datatype:  sending every STRIDE-th double of an array
+ *              with a derived datatype (MPI_Type_vector, as in
+ *              ../ch6/cyclic_derived.c), compared with packing the
+ *              doubles by hand or with MPI_Pack, and with sending
+ *              contiguous doubles
+ *
+ * Compile:  mpicc -g -Wall -O2 -o mpi_p2p_bench mpi_p2p_bench.c
+ * Run:      mpiexec -n 2 mpi_p2p_bench [all|pingpong|eager|rate|datatype]
+ *              [max_bytes] [reps]
+ *           Defaults:  all, 64 MB (67108864), 100
+ *
+ * Input:    none
+ * Output:   CSV, one line per test, variant and size:
+ *              test,variant,bytes,messages,reps,min_us,median_us,
+ *                 MB_per_s,msgs_per_s
+ *           bytes is the size of one message, and messages the number
+ *           of messages in one timed repetition.  MB_per_s and
+ *           msgs_per_s are computed from min_us.  For pingpong and
+ *           datatype, the times are half of a round trip.  For eager,
+ *           the time is the time MPI_Send takes while the receiver
+ *           isn't ready, and the last line gives the eager limit in the
+ *           bytes column.
+ *
+ * Notes:
+ * 1.  Sizes double from 8 bytes.  Messages larger than 1 MB are timed
+ *     fewer times:  reps*1MB/bytes, but at least MIN_REPS.  Every test
+ *     does WARMUP untimed repetitions first.
+ * 2.  The eager test is also run, without output, before the rate test,
+ *     to choose the size of the aggregation buffers.  If no size is
+ *     sent eagerly, DEFAULT_AGG_BYTES is used.
+ * 3.  Only process 0 prints.
+ *
+ * IPP:      Section 3.5 (pp. 116 and ff.), Section 3.6 (pp. 119 and
+ *           ff.) and Exercise 6.9 (p. 343)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+
+#define MIN_BYTES 8
+#define DEFAULT_MAX_BYTES (64L << 20)
+#define DEFAULT_REPS 100
+#define MIN_REPS 5
+#define WARMUP 2
+#define EAGER_MAX_BYTES (4L << 20)  /* Largest size tried by eager     */
+#define EAGER_DELAY 0.01            /* Seconds the receiver waits      */
+#define EAGER_REPS 3
+#define RATE_MAX_BYTES 4096         /* Largest size tried by rate      */
+#define RATE_MSGS 10000             /* Messages per rate repetition    */
+#define RATE_WINDOW 64              /* Outstanding nonblocking sends   */
+#define DEFAULT_AGG_BYTES 8192
+#define AGG_MAX_BYTES 65536
+#define DT_MAX_BYTES (16L << 20)    /* Largest size tried by datatype  */
+#define STRIDE 4
+
+int      my_rank;
+int      comm_sz;
+MPI_Comm comm;
+
+char*    buf;       /* For pingpong, eager and rate */
+char*    buf2;
+char*    agg;       /* RATE_WINDOW aggregation buffers */
+double*  strided;   /* STRIDE*DT_MAX_BYTES bytes, for datatype */
+double*  packed;
+
+void Get_args(int argc, char* argv[], char test[], long* max_bytes_p,
+      int* reps_p);
+int  Reps(long bytes, int reps);
+int  Compare(const void* a_p, const void* b_p);
+void Print_row(const char test[], const char variant[], long bytes,
+      int messages, int reps, double times[]);
+void Ping_pong(long max_bytes, int reps, double times[]);
+double Ping_pong_time(char mode, long bytes);
+long Eager(long max_bytes, int print, double times[]);
+void Rate(long max_bytes, int reps, long agg_bytes, double times[]);
+double Rate_individual(long bytes);
+double Rate_aggregated(long bytes, long agg_bytes);
+void Sleep(double seconds);
+void Datatype(long max_bytes, int reps, double times[]);
+double Datatype_time(char mode, long n, MPI_Datatype vec_mpi_t);
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   char    test[16];
+   long    max_bytes, buf_bytes, agg_bytes, dt_bytes, i;
+   int     reps, pack_bytes;
+   double* times;
+   int     all;
+
+   MPI_Init(&argc, &argv);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+
+   Get_args(argc, argv, test, &max_bytes, &reps);
+   all = (strcmp(test, "all") == 0);
+
+   /* Touch the buffers, so that page faults aren't timed.  The rate
+    * test uses RATE_WINDOW messages at a time. */
+   buf_bytes = (max_bytes > RATE_WINDOW*RATE_MAX_BYTES) ?
+      max_bytes : RATE_WINDOW*RATE_MAX_BYTES;
+   buf = malloc(buf_bytes);
+   buf2 = malloc(buf_bytes);
+   memset(buf, my_rank, buf_bytes);
+   memset(buf2, my_rank, buf_bytes);
+   times = malloc((reps + WARMUP)*sizeof(double));
+
+   if (my_rank == 0)
+      printf("test,variant,bytes,messages,reps,min_us,median_us,"
+            "MB_per_s,msgs_per_s\n");
+
+   if (all || strcmp(test, "pingpong") == 0)
+      Ping_pong(max_bytes, reps, times);
+   if (all || strcmp(test, "eager") == 0 || strcmp(test, "rate") == 0) {
+      agg_bytes = Eager(max_bytes, strcmp(test, "rate") != 0, times);
+      if (agg_bytes == 0) agg_bytes = DEFAULT_AGG_BYTES;
+      if (agg_bytes > AGG_MAX_BYTES) agg_bytes = AGG_MAX_BYTES;
+      if (strcmp(test, "eager") != 0) {
+         agg = malloc(RATE_WINDOW*agg_bytes);
+         memset(agg, my_rank, RATE_WINDOW*agg_bytes);
+         Rate(max_bytes, reps, agg_bytes, times);
+         free(agg);
+      }
+   }
+   if (all || strcmp(test, "datatype") == 0) {
+      dt_bytes = (max_bytes < DT_MAX_BYTES) ? max_bytes : DT_MAX_BYTES;
+      strided = malloc(STRIDE*dt_bytes);
+      /* packed holds n doubles for the manual test, and the packed
+       * vector for MPI_Pack, which may need more room */
+      MPI_Pack_size(dt_bytes/sizeof(double), MPI_DOUBLE, comm,
+            &pack_bytes);
+      if (pack_bytes < dt_bytes) pack_bytes = dt_bytes;
+      packed = malloc(pack_bytes);
+      for (i = 0; i < STRIDE*dt_bytes/(long) sizeof(double); i++)
+         strided[i] = i;
+      memset(packed, 0, pack_bytes);
+      Datatype(dt_bytes, reps, times);
+      free(packed);
+      free(strided);
+   }
+
+   free(times);
+   free(buf2);
+   free(buf);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get and broadcast the command line arguments
+ * Out args:  test, max_bytes_p, reps_p
+ */
+void Get_args(int argc, char* argv[], char test[], long* max_bytes_p,
+      int* reps_p) {
+   int ok = 1;
+
+   if (my_rank == 0) {
+      strcpy(test, "all");
+      *max_bytes_p = DEFAULT_MAX_BYTES;
+      *reps_p = DEFAULT_REPS;
+      if (argc > 4 || comm_sz != 2) ok = 0;
+      if (argc > 1) {
+         strncpy(test, argv[1], 15);
+         test[15] = '\0';
+      }
+      if (argc > 2) *max_bytes_p = strtol(argv[2], NULL, 10);
+      if (argc > 3) *reps_p = strtol(argv[3], NULL, 10);
+      if (strcmp(test, "all") != 0 && strcmp(test, "pingpong") != 0
+            && strcmp(test, "eager") != 0 && strcmp(test, "rate") != 0
+            && strcmp(test, "datatype") != 0)
+         ok = 0;
+      if (*max_bytes_p < MIN_BYTES || *reps_p < MIN_REPS) ok = 0;
+      if (!ok) {
+         fprintf(stderr, "usage:  mpiexec -n 2 %s "
+               "[all|pingpong|eager|rate|datatype] [max_bytes] [reps]\n",
+               argv[0]);
+         fprintf(stderr, "   max_bytes >= %d, reps >= %d\n", MIN_BYTES,
+               MIN_REPS);
+      }
+   }
+   MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+   if (!ok) {
+      MPI_Finalize();
+      exit(0);
+   }
+   MPI_Bcast(test, 16, MPI_CHAR, 0, comm);
+   MPI_Bcast(max_bytes_p, 1, MPI_LONG, 0, comm);
+   MPI_Bcast(reps_p, 1, MPI_INT, 0, comm);
+}  /* Get_args */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Reps
+ * Purpose:   Find the number of timed repetitions for a message size
+ */
+int Reps(long bytes, int reps) {
+   long r;
+
+   if (bytes <= (1L << 20)) return reps;
+   r = reps*(1L << 20)/bytes;
+   return (r < MIN_REPS) ? MIN_REPS : r;
+}  /* Reps */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Compare
+ * Purpose:   Compare two doubles for qsort
+ */
+int Compare(const void* a_p, const void* b_p) {
+   double a = *((double*) a_p);
+   double b = *((double*) b_p);
+
+   if (a < b) return -1;
+   if (a > b) return 1;
+   return 0;
+}  /* Compare */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Print_row
+ * Purpose:   Print a line of CSV on process 0
+ * In args:   test, variant, bytes, messages, reps
+ * In/out:    times:  the reps times in seconds.  Sorted on return.
+ */
+void Print_row(const char test[], const char variant[], long bytes,
+      int messages, int reps, double times[]) {
+   double min, median;
+
+   if (my_rank != 0) return;
+   qsort(times, reps, sizeof(double), Compare);
+   min = times[0];
+   median = (reps % 2) ? times[reps/2] : (times[reps/2-1] + times[reps/2])/2;
+   printf("%s,%s,%ld,%d,%d,%.3f,%.3f,%.2f,%.0f\n", test, variant, bytes,
+         messages, reps, 1.0e6*min, 1.0e6*median,
+         (double) bytes*messages/min/1.0e6, messages/min);
+   fflush(stdout);
+}  /* Print_row */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Ping_pong
+ * Purpose:   Time round trips with blocking, nonblocking and persistent
+ *            requests for all the message sizes
+ * Scratch:   times
+ */
+void Ping_pong(long max_bytes, int reps, double times[]) {
+   const char* modes = "bnp";
+   const char* names[] = {"blocking", "nonblocking", "persistent"};
+   long bytes;
+   int m, r, my_reps;
+
+   for (m = 0; m < 3; m++)
+      for (bytes = MIN_BYTES; bytes <= max_bytes; bytes *= 2) {
+         my_reps = Reps(bytes, reps);
+         for (r = -WARMUP; r < my_reps; r++)
+            times[r + WARMUP] = Ping_pong_time(modes[m], bytes);
+         Print_row("pingpong", names[m], bytes, 1, my_reps,
+               times + WARMUP);
+      }
+}  /* Ping_pong */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Ping_pong_time
+ * Purpose:   Send a message of bytes bytes from 0 to 1 and back
+ * In args:   mode:  'b' blocking, 'n' nonblocking, 'p' persistent
+ *            bytes
+ * Ret val:   Half the round trip time on process 0
+ * Note:      The persistent requests are created and freed outside the
+ *            timed part, as they would be in a loop that reuses them.
+ */
+double Ping_pong_time(char mode, long bytes) {
+   int other = 1 - my_rank;
+   MPI_Request reqs[2];
+   double start;
+
+   if (mode == 'p') {
+      MPI_Send_init(buf, bytes, MPI_CHAR, other, 0, comm, &reqs[0]);
+      MPI_Recv_init(buf2, bytes, MPI_CHAR, other, 0, comm, &reqs[1]);
+   }
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   if (mode == 'b') {
+      if (my_rank == 0) {
+         MPI_Send(buf, bytes, MPI_CHAR, other, 0, comm);
+         MPI_Recv(buf2, bytes, MPI_CHAR, other, 0, comm, MPI_STATUS_IGNORE);
+      } else {
+         MPI_Recv(buf2, bytes, MPI_CHAR, other, 0, comm, MPI_STATUS_IGNORE);
+         MPI_Send(buf, bytes, MPI_CHAR, other, 0, comm);
+      }
+   } else if (mode == 'n') {
+      if (my_rank == 0) {
+         MPI_Irecv(buf2, bytes, MPI_CHAR, other, 0, comm, &reqs[1]);
+         MPI_Isend(buf, bytes, MPI_CHAR, other, 0, comm, &reqs[0]);
+         MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+      } else {
+         MPI_Irecv(buf2, bytes, MPI_CHAR, other, 0, comm, &reqs[1]);
+         MPI_Wait(&reqs[1], MPI_STATUS_IGNORE);
+         MPI_Isend(buf, bytes, MPI_CHAR, other, 0, comm, &reqs[0]);
+         MPI_Wait(&reqs[0], MPI_STATUS_IGNORE);
+      }
+   } else {
+      if (my_rank == 0) {
+         MPI_Start(&reqs[1]);
+         MPI_Start(&reqs[0]);
+         MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+      } else {
+         MPI_Start(&reqs[1]);
+         MPI_Wait(&reqs[1], MPI_STATUS_IGNORE);
+         MPI_Start(&reqs[0]);
+         MPI_Wait(&reqs[0], MPI_STATUS_IGNORE);
+      }
+   }
+   start = (MPI_Wtime() - start)/2;
+   if (mode == 'p') {
+      MPI_Request_free(&reqs[0]);
+      MPI_Request_free(&reqs[1]);
+   }
+   return start;
+}  /* Ping_pong_time */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Eager
+ * Purpose:   Find out which message sizes are sent eagerly.  Process 1
+ *            sleeps EAGER_DELAY seconds before it posts the receive.  If
+ *            MPI_Send on process 0 returns in much less time than that,
+ *            the message was buffered (eager protocol); otherwise it
+ *            waited for the receive (rendezvous protocol).
+ * In args:   max_bytes
+ *            print:  whether to print the results
+ * Scratch:   times
+ * Ret val:   The largest size sent eagerly, or 0 if there is none.
+ *            The same on both processes.
+ */
+long Eager(long max_bytes, int print, double times[]) {
+   long bytes, limit = 0;
+   int r, eager, rendezvous_seen = 0;
+   double start;
+
+   if (max_bytes > EAGER_MAX_BYTES) max_bytes = EAGER_MAX_BYTES;
+   for (bytes = MIN_BYTES; bytes <= max_bytes; bytes *= 2) {
+      for (r = 0; r < EAGER_REPS; r++) {
+         MPI_Barrier(comm);
+         if (my_rank == 0) {
+            start = MPI_Wtime();
+            MPI_Send(buf, bytes, MPI_CHAR, 1, 0, comm);
+            times[r] = MPI_Wtime() - start;
+         } else {
+            Sleep(EAGER_DELAY);
+            MPI_Recv(buf2, bytes, MPI_CHAR, 0, 0, comm, MPI_STATUS_IGNORE);
+         }
+      }
+      if (my_rank == 0) {
+         qsort(times, EAGER_REPS, sizeof(double), Compare);
+         eager = (times[0] < EAGER_DELAY/2);
+      }
+      MPI_Bcast(&eager, 1, MPI_INT, 0, comm);
+      if (print)
+         Print_row("eager", eager ? "eager" : "rendezvous", bytes, 1,
+               EAGER_REPS, times);
+      if (!eager)
+         rendezvous_seen = 1;
+      else if (!rendezvous_seen)
+         limit = bytes;
+   }
+   if (print && my_rank == 0) {
+      printf("eager,limit,%ld,,,,,,\n", limit);
+      fflush(stdout);
+   }
+   return limit;
+}  /* Eager */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Rate
+ * Purpose:   Time RATE_MSGS messages of each size up to
+ *            RATE_MAX_BYTES, sent one at a time and aggregated
+ * Scratch:   times
+ */
+void Rate(long max_bytes, int reps, long agg_bytes, double times[]) {
+   long bytes;
+   int r;
+
+   if (max_bytes > RATE_MAX_BYTES) max_bytes = RATE_MAX_BYTES;
+   for (bytes = MIN_BYTES; bytes <= max_bytes; bytes *= 2) {
+      for (r = -WARMUP; r < reps; r++)
+         times[r + WARMUP] = Rate_individual(bytes);
+      Print_row("rate", "individual", bytes, RATE_MSGS, reps,
+            times + WARMUP);
+      if (bytes > agg_bytes) continue;
+      for (r = -WARMUP; r < reps; r++)
+         times[r + WARMUP] = Rate_aggregated(bytes, agg_bytes);
+      Print_row("rate", "aggregated", bytes, RATE_MSGS, reps,
+            times + WARMUP);
+   }
+}  /* Rate */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Rate_individual
+ * Purpose:   Send RATE_MSGS messages of bytes bytes from 0 to 1, with
+ *            up to RATE_WINDOW nonblocking sends and receives
+ *            outstanding.  Process 1 acknowledges the last message.
+ * Ret val:   The time on process 0, including the acknowledgement
+ */
+double Rate_individual(long bytes) {
+   MPI_Request reqs[RATE_WINDOW];
+   int i, w, count;
+   double start;
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   for (i = 0; i < RATE_MSGS; i += RATE_WINDOW) {
+      count = (RATE_MSGS - i < RATE_WINDOW) ? RATE_MSGS - i : RATE_WINDOW;
+      for (w = 0; w < count; w++)
+         if (my_rank == 0)
+            MPI_Isend(buf + w*bytes, bytes, MPI_CHAR, 1, 0, comm, &reqs[w]);
+         else
+            MPI_Irecv(buf2 + w*bytes, bytes, MPI_CHAR, 0, 0, comm,
+                  &reqs[w]);
+      MPI_Waitall(count, reqs, MPI_STATUSES_IGNORE);
+   }
+   if (my_rank == 0)
+      MPI_Recv(NULL, 0, MPI_CHAR, 1, 1, comm, MPI_STATUS_IGNORE);
+   else
+      MPI_Send(NULL, 0, MPI_CHAR, 0, 1, comm);
+   return MPI_Wtime() - start;
+}  /* Rate_individual */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Rate_aggregated
+ * Purpose:   Send RATE_MSGS messages of bytes bytes from 0 to 1 by
+ *            copying as many as fit into each of RATE_WINDOW buffers of
+ *            agg_bytes bytes, and sending the buffers with nonblocking
+ *            sends.  Process 1 receives RATE_WINDOW buffers at a time,
+ *            copies the messages out of them, and acknowledges the
+ *            last one.
+ * Ret val:   The time on process 0, including the copies and the
+ *            acknowledgement
+ * Note:      bytes <= agg_bytes.  The messages come from, and go to,
+ *            the same places as in Rate_individual.
+ */
+double Rate_aggregated(long bytes, long agg_bytes) {
+   MPI_Request reqs[RATE_WINDOW];
+   int per_buf = agg_bytes/bytes;
+   int buf_count = (RATE_MSGS + per_buf - 1)/per_buf;
+   int b, w, count, msg, k, in_buf;
+   double start;
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   for (b = 0; b < buf_count; b += RATE_WINDOW) {
+      count = (buf_count - b < RATE_WINDOW) ? buf_count - b : RATE_WINDOW;
+      for (w = 0; w < count; w++) {
+         msg = (b + w)*per_buf;
+         in_buf = (RATE_MSGS - msg < per_buf) ? RATE_MSGS - msg : per_buf;
+         if (my_rank == 0) {
+            for (k = 0; k < in_buf; k++)
+               memcpy(agg + w*agg_bytes + k*bytes,
+                     buf + ((msg + k) % RATE_WINDOW)*bytes, bytes);
+            MPI_Isend(agg + w*agg_bytes, in_buf*bytes, MPI_CHAR, 1, 0,
+                  comm, &reqs[w]);
+         } else {
+            MPI_Irecv(agg + w*agg_bytes, in_buf*bytes, MPI_CHAR, 0, 0,
+                  comm, &reqs[w]);
+         }
+      }
+      MPI_Waitall(count, reqs, MPI_STATUSES_IGNORE);
+      if (my_rank == 1)
+         for (w = 0; w < count; w++) {
+            msg = (b + w)*per_buf;
+            in_buf = (RATE_MSGS - msg < per_buf) ? RATE_MSGS - msg : per_buf;
+            for (k = 0; k < in_buf; k++)
+               memcpy(buf2 + ((msg + k) % RATE_WINDOW)*bytes,
+                     agg + w*agg_bytes + k*bytes, bytes);
+         }
+   }
+   if (my_rank == 0)
+      MPI_Recv(NULL, 0, MPI_CHAR, 1, 1, comm, MPI_STATUS_IGNORE);
+   else
+      MPI_Send(NULL, 0, MPI_CHAR, 0, 1, comm);
+   return MPI_Wtime() - start;
+}  /* Rate_aggregated */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Sleep
+ * Purpose:   Sleep for the given number of seconds, without using the
+ *            processor, so that the other process can run even if
+ *            both share a core
+ */
+void Sleep(double seconds) {
+   struct timespec t;
+
+   t.tv_sec = (time_t) seconds;
+   t.tv_nsec = (long) ((seconds - t.tv_sec)*1.0e9);
+   nanosleep(&t, NULL);
+}  /* Sleep */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Datatype
+ * Purpose:   Time round trips of n = bytes/8 doubles for each size,
+ *            with the doubles taken from and put into every STRIDE-th
+ *            element of an array
+ * Scratch:   times
+ */
+void Datatype(long max_bytes, int reps, double times[]) {
+   const char* modes = "cvmp";
+   const char* names[] = {"contiguous", "vector", "manual", "MPI_Pack"};
+   MPI_Datatype vec_mpi_t;
+   long bytes, n;
+   int m, r, my_reps;
+
+   for (bytes = MIN_BYTES; bytes <= max_bytes; bytes *= 2) {
+      n = bytes/sizeof(double);
+      my_reps = Reps(bytes, reps);
+      MPI_Type_vector(n, 1, STRIDE, MPI_DOUBLE, &vec_mpi_t);
+      MPI_Type_commit(&vec_mpi_t);
+      for (m = 0; m < 4; m++) {
+         for (r = -WARMUP; r < my_reps; r++)
+            times[r + WARMUP] = Datatype_time(modes[m], n, vec_mpi_t);
+         Print_row("datatype", names[m], bytes, 1, my_reps,
+               times + WARMUP);
+      }
+      MPI_Type_free(&vec_mpi_t);
+   }
+}  /* Datatype */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Datatype_time
+ * Purpose:   Send n doubles from 0 to 1 and back
+ * In args:   mode:  'c' contiguous doubles (no stride), 'v' the
+ *               vector type, 'm' strided doubles packed and unpacked
+ *               with a loop, 'p' packed and unpacked with MPI_Pack
+ *               and MPI_Unpack
+ *            n, vec_mpi_t
+ * Ret val:   Half the round trip time on process 0, including the
+ *            packing and unpacking
+ */
+double Datatype_time(char mode, long n, MPI_Datatype vec_mpi_t) {
+   int other = 1 - my_rank, pos, size, step;
+   long i;
+   double start;
+
+   MPI_Pack_size(1, vec_mpi_t, comm, &size);
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   for (step = 0; step < 2; step++) {
+      /* Process 0 sends in step 0, and process 1 in step 1 */
+      if (step == my_rank) {
+         if (mode == 'c') {
+            MPI_Send(strided, n, MPI_DOUBLE, other, 0, comm);
+         } else if (mode == 'v') {
+            MPI_Send(strided, 1, vec_mpi_t, other, 0, comm);
+         } else if (mode == 'm') {
+            for (i = 0; i < n; i++)
+               packed[i] = strided[i*STRIDE];
+            MPI_Send(packed, n, MPI_DOUBLE, other, 0, comm);
+         } else {
+            pos = 0;
+            MPI_Pack(strided, 1, vec_mpi_t, packed, size, &pos, comm);
+            MPI_Send(packed, pos, MPI_PACKED, other, 0, comm);
+         }
+      } else {
+         if (mode == 'c') {
+            MPI_Recv(strided, n, MPI_DOUBLE, other, 0, comm,
+                  MPI_STATUS_IGNORE);
+         } else if (mode == 'v') {
+            MPI_Recv(strided, 1, vec_mpi_t, other, 0, comm,
+                  MPI_STATUS_IGNORE);
+         } else if (mode == 'm') {
+            MPI_Recv(packed, n, MPI_DOUBLE, other, 0, comm,
+                  MPI_STATUS_IGNORE);
+            for (i = 0; i < n; i++)
+               strided[i*STRIDE] = packed[i];
+         } else {
+            MPI_Recv(packed, size, MPI_PACKED, other, 0, comm,
+                  MPI_STATUS_IGNORE);
+            pos = 0;
+            MPI_Unpack(packed, size, &pos, strided, 1, vec_mpi_t, comm);
+         }
+      }
+   }
+   return (MPI_Wtime() - start)/2;
+}  /* Datatype_time */
@@ -0,0 +1,607 @@
+/*
+ * File:     mpi_sample_sort.c
+ * Purpose:  Implement parallel sample sort of an array of
+ *           nonegative ints.  Unlike odd-even transposition sort
+ *           (mpi_odd_even.c), which sends all the local keys in each
+ *           of p phases, each key is sent at most once, in a single
+ *           MPI_Alltoallv.
+ * Input:
+ *    A:     elements of array (optional)
+ * Output:
+ *    A:     elements of A after sorting, if global_n <= MAX_PRINT;
+ *           otherwise, whether A is sorted
+ *    The time taken by the sort and the largest and smallest number
+ *    of keys a process ends up with
+ *
+ * Compile:  mpicc -g -Wall -O2 -o mpi_sample_sort mpi_sample_sort.c
+ * Run:
+ *    mpiexec -n <p> mpi_sample_sort <g|i> <global_n>
+ *       - p: the number of processes
+ *       - g: generate random, distributed list
+ *       - i: user will input list on process 0
+ *       - global_n: number of elements in global list
+ *
+ * Algorithm (sorting by regular sampling):
+ * 1.  Each process sorts its keys with qsort, and picks up to p
+ *     regularly spaced samples of them.
+ * 2.  The samples are gathered on all the processes with
+ *     MPI_Allgatherv and sorted, and p-1 regularly spaced splitters
+ *     are picked from them.
+ * 3.  Each process splits its sorted keys into p buckets with the
+ *     splitters, and the buckets are exchanged with one
+ *     MPI_Alltoallv:  process q gets bucket q from every process.
+ * 4.  Each process merges the p sorted runs it received with a k-way
+ *     merge.
+ *
+ * Notes:
+ * 1.  global_n needn't be evenly divisible by p, and after the sort
+ *     the processes generally have different numbers of keys.
+ * 2.  If several splitters are equal, the keys equal to them are
+ *     divided evenly among the buckets that share them, so lists with
+ *     many duplicates (e.g., RMAX small) are still split evenly.
+ * 3.  Except for debug output, process 0 does all I/O
+ * 4.  Optional -DDEBUG compile flag for verbose output
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+const int RMAX = 100;
+
+/* Lists longer than this aren't printed */
+const int MAX_PRINT = 100;
+
+/* Local functions */
+void Usage(char* program);
+void Print_list(int local_A[], int local_n, int rank);
+void Generate_list(int local_A[], int local_n, int my_rank);
+int  Compare(const void* a_p, const void* b_p);
+int  Lower_bound(int A[], int n, int val);
+int  Upper_bound(int A[], int n, int val);
+void Find_buckets(int local_A[], int local_n, int splitters[], int p,
+         int send_counts[]);
+void Merge_runs(int runs[], int counts[], int displs[], int p,
+         int result[]);
+
+/* Functions involving communication */
+void Get_args(int argc, char* argv[], int* global_n_p, int* local_n_p,
+         char* gi_p, int my_rank, int p, MPI_Comm comm);
+int* Sort(int local_A[], int* local_n_p, int p, MPI_Comm comm);
+void Get_splitters(int local_A[], int local_n, int splitters[], int p,
+         MPI_Comm comm);
+void Print_local_lists(int local_A[], int local_n,
+         int my_rank, int p, MPI_Comm comm);
+void Print_global_list(int local_A[], int local_n, int my_rank,
+         int p, MPI_Comm comm);
+void Check_sorted(int local_A[], int local_n, int my_rank, int p,
+         MPI_Comm comm);
+void Read_list(int local_A[], int local_n, int global_n, int my_rank,
+         int p, MPI_Comm comm);
+
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int my_rank, p;
+   char g_i;
+   int *local_A;
+   int global_n;
+   int local_n, min_n, max_n;
+   double start, loc_elapsed, elapsed;
+   MPI_Comm comm;
+
+   MPI_Init(&argc, &argv);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &p);
+   MPI_Comm_rank(comm, &my_rank);
+
+   Get_args(argc, argv, &global_n, &local_n, &g_i, my_rank, p, comm);
+   local_A = (int*) malloc(local_n*sizeof(int));
+   if (g_i == 'g') {
+      Generate_list(local_A, local_n, my_rank);
+      if (global_n <= MAX_PRINT)
+         Print_local_lists(local_A, local_n, my_rank, p, comm);
+   } else {
+      Read_list(local_A, local_n, global_n, my_rank, p, comm);
+#     ifdef DEBUG
+      Print_local_lists(local_A, local_n, my_rank, p, comm);
+#     endif
+   }
+
+#  ifdef DEBUG
+   printf("Proc %d > Before Sort\n", my_rank);
+   fflush(stdout);
+#  endif
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   local_A = Sort(local_A, &local_n, p, comm);
+   loc_elapsed = MPI_Wtime() - start;
+   MPI_Reduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+   MPI_Reduce(&local_n, &min_n, 1, MPI_INT, MPI_MIN, 0, comm);
+   MPI_Reduce(&local_n, &max_n, 1, MPI_INT, MPI_MAX, 0, comm);
+
+#  ifdef DEBUG
+   Print_local_lists(local_A, local_n, my_rank, p, comm);
+   fflush(stdout);
+#  endif
+
+   if (global_n <= MAX_PRINT)
+      Print_global_list(local_A, local_n, my_rank, p, comm);
+   else
+      Check_sorted(local_A, local_n, my_rank, p, comm);
+   if (my_rank == 0) {
+      printf("Elapsed time = %e seconds\n", elapsed);
+      printf("Keys per process:  min = %d, max = %d, mean = %.1f\n",
+            min_n, max_n, ((double) global_n)/p);
+   }
+
+   free(local_A);
+
+   MPI_Finalize();
+
+   return 0;
+}  /* main */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Generate_list
+ * Purpose:    Fill list with random ints
+ * Input Args: local_n, my_rank
+ * Output Arg: local_A
+ */
+void Generate_list(int local_A[], int local_n, int my_rank) {
+   int i;
+
+    srandom(my_rank+1);
+    for (i = 0; i < local_n; i++)
+       local_A[i] = random() % RMAX;
+
+}  /* Generate_list */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print command line to start program
+ * In arg:    program:  name of executable
+ * Note:      Purely local, run only by process 0;
+ */
+void Usage(char* program) {
+   fprintf(stderr, "usage:  mpirun -np <p> %s <g|i> <global_n>\n",
+       program);
+   fprintf(stderr, "   - p: the number of processes \n");
+   fprintf(stderr, "   - g: generate random, distributed list\n");
+   fprintf(stderr, "   - i: user will input list on process 0\n");
+   fprintf(stderr, "   - global_n: number of elements in global list\n");
+   fflush(stderr);
+}  /* Usage */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check command line arguments
+ * Input args:  argc, argv, my_rank, p, comm
+ * Output args: global_n_p, local_n_p, gi_p
+ * Note:        The first global_n % p processes get one more element
+ *              than the others.
+ */
+void Get_args(int argc, char* argv[], int* global_n_p, int* local_n_p,
+         char* gi_p, int my_rank, int p, MPI_Comm comm) {
+
+   if (my_rank == 0) {
+      if (argc != 3) {
+         Usage(argv[0]);
+         *global_n_p = -1;  /* Bad args, quit */
+      } else {
+         *gi_p = argv[1][0];
+         if (*gi_p != 'g' && *gi_p != 'i') {
+            Usage(argv[0]);
+            *global_n_p = -1;  /* Bad args, quit */
+         } else {
+            *global_n_p = atoi(argv[2]);
+            if (*global_n_p <= 0) Usage(argv[0]);
+         }
+      }
+   }  /* my_rank == 0 */
+
+   MPI_Bcast(gi_p, 1, MPI_CHAR, 0, comm);
+   MPI_Bcast(global_n_p, 1, MPI_INT, 0, comm);
+
+   if (*global_n_p <= 0) {
+      MPI_Finalize();
+      exit(-1);
+   }
+
+   *local_n_p = *global_n_p/p + (my_rank < *global_n_p % p);
+#  ifdef DEBUG
+   printf("Proc %d > gi = %c, global_n = %d, local_n = %d\n",
+      my_rank, *gi_p, *global_n_p, *local_n_p);
+   fflush(stdout);
+#  endif
+
+}  /* Get_args */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Read_list
+ * Purpose:    process 0 reads the list from stdin and scatters it
+ *             to the other processes.
+ * In args:    local_n, global_n, my_rank, p, comm
+ * Out arg:    local_A
+ */
+void Read_list(int local_A[], int local_n, int global_n, int my_rank,
+         int p, MPI_Comm comm) {
+   int i, q;
+   int *temp = NULL;
+   int *counts = NULL, *displs = NULL;
+
+   if (my_rank == 0) {
+      temp = (int*) malloc(global_n*sizeof(int));
+      counts = (int*) malloc(2*p*sizeof(int));
+      displs = counts + p;
+      printf("Enter the elements of the list\n");
+      for (i = 0; i < global_n; i++)
+         scanf("%d", &temp[i]);
+      for (q = 0; q < p; q++) {
+         counts[q] = global_n/p + (q < global_n % p);
+         displs[q] = (q == 0) ? 0 : displs[q-1] + counts[q-1];
+      }
+   }
+
+   MPI_Scatterv(temp, counts, displs, MPI_INT, local_A, local_n, MPI_INT,
+       0, comm);
+
+   if (my_rank == 0) {
+      free(temp);
+      free(counts);
+   }
+}  /* Read_list */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Print_global_list
+ * Purpose:    Gather the local lists, which may have different
+ *             lengths, onto process 0 and print them
+ * Input args: all
+ */
+void Print_global_list(int local_A[], int local_n, int my_rank, int p,
+      MPI_Comm comm) {
+   int* A = NULL;
+   int *counts = NULL, *displs = NULL;
+   int i, n = 0, q;
+
+   if (my_rank == 0) {
+      counts = (int*) malloc(2*p*sizeof(int));
+      displs = counts + p;
+   }
+   MPI_Gather(&local_n, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+   if (my_rank == 0) {
+      for (q = 0; q < p; q++) {
+         displs[q] = n;
+         n += counts[q];
+      }
+      A = (int*) malloc(n*sizeof(int));
+   }
+   MPI_Gatherv(local_A, local_n, MPI_INT, A, counts, displs, MPI_INT, 0,
+         comm);
+
+   if (my_rank == 0) {
+      printf("Global list:\n");
+      for (i = 0; i < n; i++)
+         printf("%d ", A[i]);
+      printf("\n\n");
+      free(A);
+      free(counts);
+   }
+}  /* Print_global_list */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Check_sorted
+ * Purpose:    Check that the distributed list is sorted:  each local
+ *             list is sorted, and the last key on each process is <=
+ *             the first key on the next process with any keys.
+ * Input args: all
+ * Note:       Process 0 prints the result
+ */
+void Check_sorted(int local_A[], int local_n, int my_rank, int p,
+      MPI_Comm comm) {
+   int i, q, ok = 1, all_ok;
+   int ends[3], *all_ends = NULL;  /* local_n, first, last */
+   int prev_last, have_prev = 0;
+
+   for (i = 1; i < local_n; i++)
+      if (local_A[i-1] > local_A[i]) ok = 0;
+   ends[0] = local_n;
+   ends[1] = (local_n > 0) ? local_A[0] : 0;
+   ends[2] = (local_n > 0) ? local_A[local_n-1] : 0;
+
+   if (my_rank == 0) all_ends = (int*) malloc(3*p*sizeof(int));
+   MPI_Gather(ends, 3, MPI_INT, all_ends, 3, MPI_INT, 0, comm);
+   MPI_Reduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, 0, comm);
+
+   if (my_rank == 0) {
+      prev_last = 0;
+      for (q = 0; q < p; q++) {
+         if (all_ends[3*q] == 0) continue;
+         if (have_prev && prev_last > all_ends[3*q+1]) all_ok = 0;
+         prev_last = all_ends[3*q+2];
+         have_prev = 1;
+      }
+      printf("The list is %s\n", all_ok ? "sorted" : "NOT sorted");
+      free(all_ends);
+   }
+}  /* Check_sorted */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Compare
+ * Purpose:     Compare 2 ints, return -1, 0, or 1, respectively, when
+ *              the first int is less than, equal, or greater than
+ *              the second.  Used by qsort.
+ */
+int Compare(const void* a_p, const void* b_p) {
+   int a = *((int*)a_p);
+   int b = *((int*)b_p);
+
+   if (a < b)
+      return -1;
+   else if (a == b)
+      return 0;
+   else /* a > b */
+      return 1;
+}  /* Compare */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Sort
+ * Purpose:     Sort the global list with sample sort
+ * Input args:  p, comm
+ * In/out args: local_A:  it's freed, and the sorted keys are
+ *                 returned in a new array
+ *              local_n_p:  number of keys in local_A on input, and
+ *                 in the returned array on output
+ * Ret val:     This process' block of the sorted list
+ */
+int* Sort(int local_A[], int* local_n_p, int p, MPI_Comm comm) {
+   int local_n = *local_n_p, new_n, q;
+   int *splitters, *counts, *new_A, *runs;
+   int *send_counts, *send_displs, *recv_counts, *recv_displs;
+
+   /* Sort local list using built-in quick sort */
+   qsort(local_A, local_n, sizeof(int), Compare);
+
+   splitters = (int*) malloc(p*sizeof(int));
+   Get_splitters(local_A, local_n, splitters, p, comm);
+
+   counts = (int*) malloc(4*p*sizeof(int));
+   send_counts = counts;
+   send_displs = counts + p;
+   recv_counts = counts + 2*p;
+   recv_displs = counts + 3*p;
+   Find_buckets(local_A, local_n, splitters, p, send_counts);
+   MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+
+   new_n = 0;
+   for (q = 0; q < p; q++) {
+      send_displs[q] = (q == 0) ? 0 : send_displs[q-1] + send_counts[q-1];
+      recv_displs[q] = new_n;
+      new_n += recv_counts[q];
+   }
+
+#  ifdef DEBUG
+   {
+      int my_rank;
+      MPI_Comm_rank(comm, &my_rank);
+      printf("Proc %d > receiving %d keys\n", my_rank, new_n);
+      fflush(stdout);
+   }
+#  endif
+
+   /* Add 1 so malloc never gets 0 */
+   runs = (int*) malloc((new_n+1)*sizeof(int));
+   MPI_Alltoallv(local_A, send_counts, send_displs, MPI_INT,
+         runs, recv_counts, recv_displs, MPI_INT, comm);
+   free(local_A);
+
+   new_A = (int*) malloc((new_n+1)*sizeof(int));
+   Merge_runs(runs, recv_counts, recv_displs, p, new_A);
+
+   free(runs);
+   free(counts);
+   free(splitters);
+   *local_n_p = new_n;
+   return new_A;
+}  /* Sort */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Get_splitters
+ * Purpose:     Choose p-1 splitters by regular sampling
+ * Input args:  local_A:  the sorted local keys
+ *              local_n, p, comm
+ * Output arg:  splitters:  splitters[0], ..., splitters[p-2]
+ */
+void Get_splitters(int local_A[], int local_n, int splitters[], int p,
+      MPI_Comm comm) {
+   int my_count = (local_n < p) ? local_n : p;
+   int *samples, *all_samples, *counts, *displs;
+   int i, q, total;
+
+   samples = (int*) malloc((p+1)*sizeof(int));
+   for (i = 0; i < my_count; i++)
+      samples[i] = local_A[(long) i*local_n/my_count];
+
+   counts = (int*) malloc(2*p*sizeof(int));
+   displs = counts + p;
+   MPI_Allgather(&my_count, 1, MPI_INT, counts, 1, MPI_INT, comm);
+   total = 0;
+   for (q = 0; q < p; q++) {
+      displs[q] = total;
+      total += counts[q];
+   }
+   all_samples = (int*) malloc((total+1)*sizeof(int));
+   MPI_Allgatherv(samples, my_count, MPI_INT, all_samples, counts,
+         displs, MPI_INT, comm);
+
+   qsort(all_samples, total, sizeof(int), Compare);
+   for (i = 1; i < p; i++)
+      splitters[i-1] = (total > 0) ? all_samples[(long) i*total/p] : 0;
+
+   free(all_samples);
+   free(counts);
+   free(samples);
+}  /* Get_splitters */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Find_buckets
+ * Purpose:     Split the sorted local keys into p buckets:  bucket q
+ *              gets the keys k with splitters[q-1] < k <= splitters[q].
+ *              When splitters[j] = ... = splitters[m] = v, the keys
+ *              equal to v are divided evenly among buckets j, ..., m.
+ * Input args:  local_A, local_n, splitters, p
+ * Output arg:  send_counts:  number of keys in each bucket
+ */
+void Find_buckets(int local_A[], int local_n, int splitters[], int p,
+      int send_counts[]) {
+   int j, m, q, lo, hi, prev_end = 0, end;
+
+   for (j = 0; j < p-1; j = m+1) {
+      /* splitters[j..m] are equal */
+      for (m = j; m+1 < p-1 && splitters[m+1] == splitters[j]; m++);
+      lo = Lower_bound(local_A, local_n, splitters[j]);
+      hi = Upper_bound(local_A, local_n, splitters[j]);
+      for (q = j; q <= m; q++) {
+         end = lo + (long) (hi - lo)*(q - j + 1)/(m - j + 1);
+         send_counts[q] = end - prev_end;
+         prev_end = end;
+      }
+   }
+   send_counts[p-1] = local_n - prev_end;
+}  /* Find_buckets */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Lower_bound
+ * Purpose:     Return the index of the first element of the sorted
+ *              array A that's >= val (n if there isn't one)
+ */
+int Lower_bound(int A[], int n, int val) {
+   int lo = 0, hi = n, mid;
+
+   while (lo < hi) {
+      mid = lo + (hi - lo)/2;
+      if (A[mid] < val)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}  /* Lower_bound */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Upper_bound
+ * Purpose:     Return the index of the first element of the sorted
+ *              array A that's > val (n if there isn't one)
+ */
+int Upper_bound(int A[], int n, int val) {
+   int lo = 0, hi = n, mid;
+
+   while (lo < hi) {
+      mid = lo + (hi - lo)/2;
+      if (A[mid] <= val)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}  /* Upper_bound */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Merge_runs
+ * Purpose:     Merge p sorted runs with a k-way merge.  The next key
+ *              of each nonempty run is kept in a binary min-heap.
+ * In args:     runs:  run q is runs[displs[q]], ...,
+ *                 runs[displs[q]+counts[q]-1]
+ *              counts, displs, p
+ * Out arg:     result
+ */
+void Merge_runs(int runs[], int counts[], int displs[], int p,
+      int result[]) {
+   int *heap, *pos, *end;  /* heap holds run numbers */
+   int heap_sz = 0, q, i, child, r, out = 0;
+
+   heap = (int*) malloc(3*p*sizeof(int));
+   pos = heap + p;
+   end = heap + 2*p;
+   for (q = 0; q < p; q++) {
+      pos[q] = displs[q];
+      end[q] = displs[q] + counts[q];
+      if (counts[q] > 0) {
+         /* Sift up */
+         for (i = heap_sz++; i > 0 && runs[pos[heap[(i-1)/2]]] > runs[pos[q]];
+               i = (i-1)/2)
+            heap[i] = heap[(i-1)/2];
+         heap[i] = q;
+      }
+   }
+
+   while (heap_sz > 0) {
+      r = heap[0];
+      result[out++] = runs[pos[r]++];
+      if (pos[r] == end[r]) r = heap[--heap_sz];
+
+      /* Sift r down from the root */
+      for (i = 0; (child = 2*i+1) < heap_sz; i = child) {
+         if (child+1 < heap_sz &&
+               runs[pos[heap[child+1]]] < runs[pos[heap[child]]])
+            child++;
+         if (runs[pos[heap[child]]] >= runs[pos[r]]) break;
+         heap[i] = heap[child];
+      }
+      if (heap_sz > 0) heap[i] = r;
+   }
+
+   free(heap);
+}  /* Merge_runs */
+
+
+/*-------------------------------------------------------------------
+ * Only called by process 0
+ */
+void Print_list(int local_A[], int local_n, int rank) {
+   int i;
+   printf("%d: ", rank);
+   for (i = 0; i < local_n; i++)
+      printf("%d ", local_A[i]);
+   printf("\n");
+}  /* Print_list */
+
+/*-------------------------------------------------------------------
+ * Function:   Print_local_lists
+ * Purpose:    Print each process' current list contents
+ * Input args: all
+ * Note:       The processes can have different numbers of elements
+ */
+void Print_local_lists(int local_A[], int local_n,
+         int my_rank, int p, MPI_Comm comm) {
+   int*       A;
+   int        q, count;
+   MPI_Status status;
+
+   if (my_rank == 0) {
+      Print_list(local_A, local_n, my_rank);
+      for (q = 1; q < p; q++) {
+         MPI_Probe(q, 0, comm, &status);
+         MPI_Get_count(&status, MPI_INT, &count);
+         A = (int*) malloc((count+1)*sizeof(int));
+         MPI_Recv(A, count, MPI_INT, q, 0, comm, &status);
+         Print_list(A, count, q);
+         free(A);
+      }
+   } else {
+      MPI_Send(local_A, local_n, MPI_INT, 0, 0, comm);
+   }
+}  /* Print_local_lists */
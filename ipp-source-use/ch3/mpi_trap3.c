@@ -6,10 +6,12 @@
  * Input:    The endpoints of the interval of integration and the number
  *           of trapezoids
  * Output:   Estimate of the integral from a to b of f(x)
- *           using the trapezoidal rule and n trapezoids.
+ *           using the trapezoidal rule and n trapezoids.  On
+ *           stderr, the time for the local integrals and the global
+ *           sum (see prof.h)
  *
- * Compile:  mpicc -g -Wall -o mpi_trap2 mpi_trap2.c
- * Run:      mpiexec -n <number of processes> ./mpi_trap2
+ * Compile:  mpicc -g -Wall -DUSE_MPI -o mpi_trap3 mpi_trap3.c prof.c
+ * Run:      mpiexec -n <number of processes> ./mpi_trap3
  *
  * Algorithm:
  *    1.  Each process calculates "its" interval of
@@ -20,7 +22,11 @@
  *    3b. Process 0 sums the calculations received from
  *        the individual processes and prints the result.
  *
- * Note:  f(x) is all hardwired.
+ * Notes:
+ * 1.  f(x) is all hardwired.
+ * 2.  mpi_trap_hier.c compares the flat MPI_Bcast and MPI_Reduce
+ *     used here with node-aware (two-level) collectives and with
+ *     an MPI_Ireduce that overlaps the computation.
  *
  * IPP:   Section 3.4.2 (pp. 104 and ff.)
  */
@@ -28,6 +34,7 @@
 
 /* We'll be using MPI routines, definitions, etc. */
 #include <mpi.h>
+#include "prof.h"
 
 /* Get the input values */
 void Get_input(int my_rank, int comm_sz, double* a_p, double* b_p,
@@ -64,11 +71,13 @@ int main(void) {
     * starts at: */
    local_a = a + my_rank*local_n*h;
    local_b = local_a + local_n*h;
+   PROF_BEGIN("trap");
    local_int = Trap(local_a, local_b, local_n, h);
 
    /* Add up the integrals calculated by each process */
    MPI_Reduce(&local_int, &total_int, 1, MPI_DOUBLE, MPI_SUM, 0,
          MPI_COMM_WORLD);
+   PROF_END("trap");
 
    /* Print the result */
    if (my_rank == 0) {
@@ -77,6 +86,8 @@ int main(void) {
           a, b, total_int);
    }
 
+   PROF_REPORT();
+
    /* Shut down MPI */
    MPI_Finalize();
 
@@ -21,7 +21,11 @@
  *    3b. Process 0 sums the calculations received from
  *        the individual processes and prints the result.
  *
- * Note:  f(x) is all hardwired.
+ * Notes:
+ * 1.  f(x) is all hardwired.
+ * 2.  mpi_trap_hier.c compares the flat MPI_Bcast and MPI_Reduce
+ *     used here with node-aware (two-level) collectives and with
+ *     an MPI_Ireduce that overlaps the computation.
  *
  * IPP:   Section 3.5 (pp. 117 and ff.)
  */
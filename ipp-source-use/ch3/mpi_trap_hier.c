@@ -0,0 +1,304 @@
+/* File:     mpi_trap_hier.c
+ * Purpose:  Compare three ways of distributing the input and computing
+ *           the global sum in the MPI trapezoidal rule:
+ *
+ *           flat:     MPI_Bcast and MPI_Reduce on MPI_COMM_WORLD, as in
+ *                     mpi_trap3.c and mpi_trap4.c
+ *           hier:     node-aware Hier_bcast and Hier_reduce_sum (see
+ *                     hier_coll.c):  shared memory among the processes
+ *                     on a node, MPI among one leader per node
+ *           ireduce:  split each process' interval into IREDUCE_CHUNKS
+ *                     pieces, and start an MPI_Ireduce of each piece's
+ *                     integral as soon as it's computed, so that the
+ *                     reductions overlap the computation of the
+ *                     remaining pieces.  While it computes a piece, a
+ *                     process calls MPI_Testall on the reductions it
+ *                     has started every POLL_TRAPS trapezoids:  most
+ *                     MPI implementations only make progress on a
+ *                     nonblocking collective inside MPI calls.
+ *
+ * Compile:  mpicc -g -Wall -O2 -o mpi_trap_hier mpi_trap_hier.c
+ *              hier_coll.c
+ * Run:      mpiexec -n <number of processes> ./mpi_trap_hier [n] [reps]
+ *           n:     number of trapezoids (default 500*2^20)
+ *           reps:  number of times each reduction is timed by itself
+ *                  (default 1000)
+ *
+ * Input:    none:  a = 0 and b = 3 are hardwired, as in lista-03
+ * Output:   For each method, the estimate of the integral from a to b
+ *           of f(x), and
+ *              elapsed:   time for the input, Trap and reduction,
+ *                         taken by the slowest process
+ *              exposed:   the largest time a process spent in the
+ *                         reduction after its last call to Trap
+ *              reduce:    mean time for a reduction of one double,
+ *                         by itself, over reps reductions.  For
+ *                         ireduce, MPI_Ireduce followed by MPI_Wait.
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by the number of processes.
+ * 2.  The three methods add the integrals in different orders, so
+ *     the estimates can differ in the last few digits.
+ * 3.  On a single node, hier does no inter-node communication.  With
+ *     more processes than cores, the node barrier in hier and the
+ *     busy-waiting in MPI can make any method slow:  compare methods
+ *     at the same process count.
+ *
+ * IPP:   Sections 3.4.2 (pp. 104 and ff.) and 3.6 (pp. 121 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "hier_coll.h"
+
+#define IREDUCE_CHUNKS 8
+/* Trapezoids between calls to MPI_Testall in ireduce */
+#define POLL_TRAPS (1 << 16)
+#define METHODS 3
+
+typedef enum { FLAT, HIER, IREDUCE } method_t;
+const char* method_names[METHODS] = {"flat", "hier", "ireduce"};
+
+void Get_input(int argc, char* argv[], int my_rank, method_t method,
+      hier_comm_t* hc, double* a_p, double* b_p, int* n_p);
+double Trap_sum(method_t method, hier_comm_t* hc, int my_rank,
+      int comm_sz, double a, double h, int n, double* exposed_p);
+double Reduce_time(method_t method, hier_comm_t* hc, int reps);
+double Trap_poll(double left_endpt, int trap_count, double base_len,
+      MPI_Request requests[], int request_count);
+double Trap(double left_endpt, double right_endpt, int trap_count,
+      double base_len);
+double f(double x);
+
+int main(int argc, char* argv[]) {
+   int my_rank, comm_sz, n, reps = 1000;
+   double a, b, h, total_int, start, finish, elapsed, exposed;
+   double max_elapsed, max_exposed, reduce;
+   method_t method;
+   hier_comm_t hc;
+
+   MPI_Init(&argc, &argv);
+   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+   MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+   if (argc > 2) reps = strtol(argv[2], NULL, 10);
+   Hier_init(MPI_COMM_WORLD, IREDUCE_CHUNKS, &hc);
+
+   for (method = FLAT; method <= IREDUCE; method++) {
+      MPI_Barrier(MPI_COMM_WORLD);
+      start = MPI_Wtime();
+      Get_input(argc, argv, my_rank, method, &hc, &a, &b, &n);
+      h = (b-a)/n;
+      total_int = Trap_sum(method, &hc, my_rank, comm_sz, a, h, n,
+            &exposed);
+      finish = MPI_Wtime();
+      elapsed = finish - start;
+      MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0,
+            MPI_COMM_WORLD);
+      MPI_Reduce(&exposed, &max_exposed, 1, MPI_DOUBLE, MPI_MAX, 0,
+            MPI_COMM_WORLD);
+      reduce = Reduce_time(method, &hc, reps);
+
+      if (my_rank == 0) {
+         if (method == FLAT) {
+            printf("n = %d, processes = %d, nodes = %d, reps = %d\n",
+                  n, comm_sz, hc.node_count, reps);
+            printf("%-8s %12s %12s %12s %22s\n", "method", "elapsed (s)",
+                  "exposed (s)", "reduce (s)", "integral");
+         }
+         printf("%-8s %12.6f %12.6e %12.6e %22.15e\n",
+               method_names[method], max_elapsed, max_exposed, reduce,
+               total_int);
+      }
+   }
+
+   Hier_free(&hc);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:     Get_input
+ * Purpose:      Process 0 sets a, b, and n (from the command line, if
+ *               it's there) and distributes them with method's
+ *               broadcast.
+ * In args:      argc, argv, my_rank, method
+ * In/out arg:   hc
+ * Out args:     a_p, b_p, n_p
+ */
+void Get_input(int argc, char* argv[], int my_rank, method_t method,
+      hier_comm_t* hc, double* a_p, double* b_p, int* n_p) {
+   double input[3];
+
+   if (my_rank == 0) {
+      input[0] = 0.0;
+      input[1] = 3.0;
+      input[2] = argc > 1 ? strtol(argv[1], NULL, 10) : 1024*1024*500;
+   }
+   if (method == HIER)
+      Hier_bcast(hc, input, 3);
+   else
+      MPI_Bcast(input, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+   *a_p = input[0];
+   *b_p = input[1];
+   *n_p = (int) input[2];
+}  /* Get_input */
+
+
+/*------------------------------------------------------------------
+ * Function:     Trap_sum
+ * Purpose:      Compute this process' part of the integral, and
+ *               add the parts with method's reduction
+ * In args:      method, my_rank, comm_sz, a, h, n
+ * In/out arg:   hc
+ * Out arg:      exposed_p:  time spent in the reduction after the
+ *                  last call to Trap
+ * Return val:   The integral on process 0
+ */
+double Trap_sum(method_t method, hier_comm_t* hc, int my_rank,
+      int comm_sz, double a, double h, int n, double* exposed_p) {
+   int local_n, chunk, first, count;
+   double local_a, local_int, total_int = 0.0, start, finish;
+   double chunk_int[IREDUCE_CHUNKS], chunk_total[IREDUCE_CHUNKS];
+   MPI_Request requests[IREDUCE_CHUNKS];
+
+   local_n = n/comm_sz;
+   local_a = a + my_rank*local_n*h;
+
+   if (method != IREDUCE) {
+      local_int = Trap(local_a, local_a + local_n*h, local_n, h);
+      start = MPI_Wtime();
+      if (method == HIER)
+         Hier_reduce_sum(hc, &local_int, &total_int, 1);
+      else
+         MPI_Reduce(&local_int, &total_int, 1, MPI_DOUBLE, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+      finish = MPI_Wtime();
+   } else {
+      for (chunk = 0; chunk < IREDUCE_CHUNKS; chunk++) {
+         first = (long) local_n*chunk/IREDUCE_CHUNKS;
+         count = (long) local_n*(chunk+1)/IREDUCE_CHUNKS - first;
+         chunk_int[chunk] = Trap_poll(local_a + first*h, count, h,
+               requests, chunk);
+         MPI_Ireduce(&chunk_int[chunk], &chunk_total[chunk], 1,
+               MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD, &requests[chunk]);
+      }
+      start = MPI_Wtime();
+      MPI_Waitall(IREDUCE_CHUNKS, requests, MPI_STATUSES_IGNORE);
+      finish = MPI_Wtime();
+      if (my_rank == 0)
+         for (chunk = 0; chunk < IREDUCE_CHUNKS; chunk++)
+            total_int += chunk_total[chunk];
+   }
+
+   *exposed_p = finish - start;
+   return total_int;
+}  /* Trap_sum */
+
+
+/*------------------------------------------------------------------
+ * Function:     Reduce_time
+ * Purpose:      Find the mean time for method's reduction of one
+ *               double, by itself
+ * In args:      method, reps
+ * In/out arg:   hc
+ * Return val:   Mean time on process 0
+ */
+double Reduce_time(method_t method, hier_comm_t* hc, int reps) {
+   int rep;
+   double x = 1.0, sum, start, finish;
+   MPI_Request request;
+
+   MPI_Barrier(MPI_COMM_WORLD);
+   start = MPI_Wtime();
+   for (rep = 0; rep < reps; rep++) {
+      if (method == HIER) {
+         Hier_reduce_sum(hc, &x, &sum, 1);
+      } else if (method == IREDUCE) {
+         MPI_Ireduce(&x, &sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD,
+               &request);
+         MPI_Wait(&request, MPI_STATUS_IGNORE);
+      } else {
+         MPI_Reduce(&x, &sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+      }
+   }
+   MPI_Barrier(MPI_COMM_WORLD);
+   finish = MPI_Wtime();
+
+   return reps > 0 ? (finish - start)/reps : 0.0;
+}  /* Reduce_time */
+
+
+/*------------------------------------------------------------------
+ * Function:     Trap_poll
+ * Purpose:      Estimate the integral over trap_count trapezoids
+ *               starting at left_endpt, POLL_TRAPS trapezoids at a
+ *               time, and call MPI_Testall on the requests between
+ *               the calls to Trap, so that they make progress
+ * In args:      left_endpt, trap_count, base_len, request_count
+ * In/out arg:   requests:  completed requests are set to
+ *                  MPI_REQUEST_NULL
+ * Return val:   Trapezoidal rule estimate of the integral, or 0 if
+ *               trap_count is 0
+ */
+double Trap_poll(
+      double       left_endpt     /* in     */,
+      int          trap_count     /* in     */,
+      double       base_len       /* in     */,
+      MPI_Request  requests[]     /* in/out */,
+      int          request_count  /* in     */) {
+   double estimate = 0.0;
+   int first, count, done = (request_count == 0);
+
+   for (first = 0; first < trap_count; first += POLL_TRAPS) {
+      count = (trap_count - first < POLL_TRAPS) ? trap_count - first
+         : POLL_TRAPS;
+      estimate += Trap(left_endpt + first*base_len,
+            left_endpt + (first + count)*base_len, count, base_len);
+      if (!done)
+         MPI_Testall(request_count, requests, &done, MPI_STATUSES_IGNORE);
+   }
+
+   return estimate;
+}  /* Trap_poll */
+
+
+/*------------------------------------------------------------------
+ * Function:     Trap
+ * Purpose:      Serial function for estimating a definite integral
+ *               using the trapezoidal rule
+ * Input args:   left_endpt
+ *               right_endpt
+ *               trap_count
+ *               base_len
+ * Return val:   Trapezoidal rule estimate of integral from
+ *               left_endpt to right_endpt using trap_count
+ *               trapezoids
+ */
+double Trap(
+      double left_endpt  /* in */,
+      double right_endpt /* in */,
+      int    trap_count  /* in */,
+      double base_len    /* in */) {
+   double estimate, x;
+   int i;
+
+   estimate = (f(left_endpt) + f(right_endpt))/2.0;
+   for (i = 1; i <= trap_count-1; i++) {
+      x = left_endpt + i*base_len;
+      estimate += f(x);
+   }
+   estimate = estimate*base_len;
+
+   return estimate;
+} /*  Trap  */
+
+
+/*------------------------------------------------------------------
+ * Function:    f
+ * Purpose:     Compute value of function to be integrated
+ * Input args:  x
+ */
+double f(double x) {
+   return x*x;
+}  /* f */
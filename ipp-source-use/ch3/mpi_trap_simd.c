@@ -0,0 +1,225 @@
+/* File:     mpi_trap_simd.c
+ * Purpose:  Use MPI to estimate definite integrals with the
+ *           trapezoidal rule, where each process sums its points with
+ *           kernels that are specialised on the integrand
+ *           (trap_simd.h), so the integrand is inlined and the sums
+ *           are vectorised.  Compare the number of points per second
+ *           with the Trap function from mpi_trap3.c, and also
+ *           integrate a batch of k integrands in one pass over the
+ *           points.
+ *
+ * Input:    The endpoints of the interval of integration, the number
+ *           of trapezoids and the number of integrands in the batch
+ * Output:   For each of mpi_trap3's Trap, the specialised kernel and
+ *           the batch kernel:  the estimates of the integrals from a
+ *           to b, the run time and the points evaluated per second.
+ *
+ * Compile:  mpicc -g -Wall -O3 -fopenmp-simd -o mpi_trap_simd
+ *              mpi_trap_simd.c
+ * Run:      mpiexec -n <number of processes> ./mpi_trap_simd
+ *
+ * Notes:
+ *    1.  The functions are hardwired.  f(x) = x^2, as in mpi_trap3.c,
+ *        and the c-th integrand of the batch is g(x, c) = x^2 + c*x.
+ *    2.  As in mpi_trap3.c, n should be evenly divisible by comm_sz.
+ *    3.  The times are the maximum over the processes, and include the
+ *        MPI_Reduce of the results.
+ *
+ * IPP:   Section 3.5 (pp. 117 and ff.) for mpi_trap3.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "trap_simd.h"
+
+/* Integrands for the kernels */
+#define F(x) ((x)*(x))
+#define G(x, p) ((x)*(x) + (p)*(x))
+
+TRAP_KERNEL(Sum_f, F)
+TRAP_BATCH_KERNEL(Sum_g, G)
+
+/* Get the input values */
+void Get_input(int my_rank, int comm_sz, double* a_p, double* b_p,
+      long* n_p, int* k_p);
+
+/* Calculate local integral  */
+double Trap(double left_endpt, double right_endpt, long trap_count,
+   double base_len);
+
+/* Print a result and its time */
+void Print_time(double local_elapsed, double points,
+      int my_rank);
+
+/* Function we're integrating */
+double f(double x);
+
+int main(void) {
+   int my_rank, comm_sz, k, c;
+   long n, local_n;
+   double a, b, h, local_a, local_b;
+   double local_int, total_int;
+   double start, local_elapsed;
+   double *p, *local_approx, *approx;
+
+   MPI_Init(NULL, NULL);
+   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+   MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+
+   Get_input(my_rank, comm_sz, &a, &b, &n, &k);
+
+   h = (b-a)/n;          /* h is the same for all processes */
+   local_n = n/comm_sz;  /* So is the number of trapezoids  */
+   local_a = a + my_rank*local_n*h;
+   local_b = local_a + local_n*h;
+
+   /* mpi_trap3 */
+   MPI_Barrier(MPI_COMM_WORLD);
+   start = MPI_Wtime();
+   local_int = Trap(local_a, local_b, local_n, h);
+   MPI_Reduce(&local_int, &total_int, 1, MPI_DOUBLE, MPI_SUM, 0,
+         MPI_COMM_WORLD);
+   local_elapsed = MPI_Wtime() - start;
+   if (my_rank == 0) printf("mpi_trap3 Trap:  %.14e\n", total_int);
+   Print_time(local_elapsed, n+1, my_rank);
+
+   /* Specialised kernel:  the local trapezoids are the points
+    * my_rank*local_n, ..., (my_rank+1)*local_n of the global grid */
+   MPI_Barrier(MPI_COMM_WORLD);
+   start = MPI_Wtime();
+   local_int = (F(local_a) + F(local_b))/2.0
+      + Sum_f(a, h, my_rank*local_n + 1, (my_rank+1)*local_n);
+   local_int = h*local_int;
+   MPI_Reduce(&local_int, &total_int, 1, MPI_DOUBLE, MPI_SUM, 0,
+         MPI_COMM_WORLD);
+   local_elapsed = MPI_Wtime() - start;
+   if (my_rank == 0) printf("Specialised kernel:  %.14e\n", total_int);
+   Print_time(local_elapsed, n+1, my_rank);
+
+   /* Batch kernel */
+   p = malloc(k*sizeof(double));
+   local_approx = malloc(k*sizeof(double));
+   approx = malloc(k*sizeof(double));
+   for (c = 0; c < k; c++)
+      p[c] = c;
+   MPI_Barrier(MPI_COMM_WORLD);
+   start = MPI_Wtime();
+   for (c = 0; c < k; c++)
+      local_approx[c] = (G(local_a, p[c]) + G(local_b, p[c]))/2.0;
+   Sum_g(a, h, my_rank*local_n + 1, (my_rank+1)*local_n, p, k,
+         local_approx);
+   for (c = 0; c < k; c++)
+      local_approx[c] *= h;
+   MPI_Reduce(local_approx, approx, k, MPI_DOUBLE, MPI_SUM, 0,
+         MPI_COMM_WORLD);
+   local_elapsed = MPI_Wtime() - start;
+   if (my_rank == 0) {
+      printf("Batch kernel, %d integrands:\n", k);
+      printf("   c = 0:  %.14e, exact = %.14e\n", approx[0],
+            (b*b*b - a*a*a)/3.0);
+      printf("   c = %d:  %.14e, exact = %.14e\n", k-1, approx[k-1],
+            (b*b*b - a*a*a)/3.0 + p[k-1]*(b*b - a*a)/2.0);
+   }
+   Print_time(local_elapsed, (double) (n+1)*k, my_rank);
+
+   free(approx);
+   free(local_approx);
+   free(p);
+   MPI_Finalize();
+   return 0;
+} /*  main  */
+
+/*------------------------------------------------------------------
+ * Function:     Get_input
+ * Purpose:      Get the user input:  the left and right endpoints,
+ *               the number of trapezoids and the number of integrands
+ *               in the batch
+ * Input args:   my_rank:  process rank in MPI_COMM_WORLD
+ *               comm_sz:  number of processes in MPI_COMM_WORLD
+ * Output args:  a_p:  pointer to left endpoint
+ *               b_p:  pointer to right endpoint
+ *               n_p:  pointer to number of trapezoids
+ *               k_p:  pointer to number of integrands
+ */
+void Get_input(int my_rank, int comm_sz, double* a_p, double* b_p,
+      long* n_p, int* k_p) {
+   int ok = 1;
+
+   if (my_rank == 0) {
+      printf("Enter a, b, n, and k\n");
+      if (scanf("%lf %lf %ld %d", a_p, b_p, n_p, k_p) != 4 || *n_p <= 0
+            || *n_p % comm_sz != 0 || *k_p <= 0) {
+         fprintf(stderr, "Need n > 0 divisible by comm_sz, and k > 0\n");
+         ok = 0;
+      }
+   }
+   MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+   if (!ok) {
+      MPI_Finalize();
+      exit(-1);
+   }
+   MPI_Bcast(a_p, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+   MPI_Bcast(b_p, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+   MPI_Bcast(n_p, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+   MPI_Bcast(k_p, 1, MPI_INT, 0, MPI_COMM_WORLD);
+}  /* Get_input */
+
+/*------------------------------------------------------------------
+ * Function:     Print_time
+ * Purpose:      Find the maximum of the processes' times, and print it
+ *               and the number of points per second
+ * Input args:   local_elapsed:  this process' time
+ *               points:  total number of points evaluated
+ *               my_rank
+ */
+void Print_time(double local_elapsed, double points,
+      int my_rank) {
+   double elapsed;
+
+   MPI_Reduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0,
+         MPI_COMM_WORLD);
+   if (my_rank == 0)
+      printf("   %e seconds, %.3e points/second\n", elapsed,
+            points/elapsed);
+}  /* Print_time */
+
+/*------------------------------------------------------------------
+ * Function:     Trap
+ * Purpose:      Serial function for estimating a definite integral
+ *               using the trapezoidal rule.  This is the version in
+ *               mpi_trap3.c.
+ * Input args:   left_endpt
+ *               right_endpt
+ *               trap_count
+ *               base_len
+ * Return val:   Trapezoidal rule estimate of integral from
+ *               left_endpt to right_endpt using trap_count
+ *               trapezoids
+ */
+double Trap(
+      double left_endpt  /* in */,
+      double right_endpt /* in */,
+      long   trap_count  /* in */,
+      double base_len    /* in */) {
+   double estimate, x;
+   long i;
+
+   estimate = (f(left_endpt) + f(right_endpt))/2.0;
+   for (i = 1; i <= trap_count-1; i++) {
+      x = left_endpt + i*base_len;
+      estimate += f(x);
+   }
+   estimate = estimate*base_len;
+
+   return estimate;
+} /*  Trap  */
+
+
+/*------------------------------------------------------------------
+ * Function:    f
+ * Purpose:     Compute value of function to be integrated
+ * Input args:  x
+ */
+double f(double x) {
+   return x*x;
+} /* f */
@@ -4,12 +4,21 @@
  *           distribution of the vectors.  This version also
  *           illustrates the use of MPI_Scatter and MPI_Gather.
  *
- * Compile:  mpicc -g -Wall -o mpi_vector_add mpi_vector_add.c
+ * Compile:  mpicc -g -Wall -o mpi_vector_add mpi_vector_add.c mpi_io.c
+ *           Needs mpi_io.h
  * Run:      mpiexec -n <comm_sz> ./vector_add
+ *           mpiexec -n <comm_sz> ./vector_add <x file> <y file> <z file>
+ *              [block | cyclic | <block size>] [t]
  *
  * Input:    The order of the vectors, n, and the vectors x and y
  * Output:   The sum vector z = x+y
  *
+ *           With file arguments, x and y are read from the files, and
+ *           z is written to a file, by all the processes with MPI-IO
+ *           (see mpi_io.c).  The vectors are distributed with the
+ *           given distribution (default block).  The files are binary,
+ *           or with t, text.
+ *
  * Notes:     
  * 1.  The order of the vectors, n, should be evenly divisible
  *     by comm_sz
@@ -19,17 +28,26 @@
  *     quit.  Errors detected are incorrect values of the vector
  *     order (negative or not evenly divisible by comm_sz), and
  *     malloc failures.
+ * 4.  Reading on process 0 and scattering needs storage for a whole
+ *     vector on process 0, and process 0 does all the I/O.  With
+ *     files, each process only stores and reads its own components.
+ *     n is read from the x file, and y is read with the same n:
+ *     the y file must store a vector of the same order, since its
+ *     header isn't checked.
  *
  * IPP:  Section 3.4.6 (pp. 109 and ff.)
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include "mpi_io.h"
 
 void Check_for_error(int local_ok, char fname[], char message[], 
       MPI_Comm comm);
 void Read_n(int* n_p, int* local_n_p, int my_rank, int comm_sz, 
       MPI_Comm comm);
+void Get_file_args(int argc, char* argv[], int* n_p, int* local_n_p,
+      int* blk_p, int* text_p, int comm_sz, MPI_Comm comm);
 void Allocate_vectors(double** local_x_pp, double** local_y_pp,
       double** local_z_pp, int local_n, MPI_Comm comm);
 void Read_vector(double local_a[], int local_n, int n, char vec_name[], 
@@ -41,30 +59,47 @@ void Parallel_vector_sum(double local_x[], double local_y[],
 
 
 /*-------------------------------------------------------------------*/
-int main(void) {
-   int n, local_n;
+int main(int argc, char* argv[]) {
+   int n, local_n, blk, text;
    int comm_sz, my_rank;
    double *local_x, *local_y, *local_z;
    MPI_Comm comm;
 
-   MPI_Init(NULL, NULL);
+   MPI_Init(&argc, &argv);
    comm = MPI_COMM_WORLD;
    MPI_Comm_size(comm, &comm_sz);
    MPI_Comm_rank(comm, &my_rank);
 
-   Read_n(&n, &local_n, my_rank, comm_sz, comm);
+   if (argc == 1)
+      Read_n(&n, &local_n, my_rank, comm_sz, comm);
+   else
+      Get_file_args(argc, argv, &n, &local_n, &blk, &text, comm_sz, comm);
 #  ifdef DEBUG
    printf("Proc %d > n = %d, local_n = %d\n", my_rank, n, local_n);
 #  endif
    Allocate_vectors(&local_x, &local_y, &local_z, local_n, comm);
    
-   Read_vector(local_x, local_n, n, "x", my_rank, comm);
-   Print_vector(local_x, local_n, n, "x is", my_rank, comm);
-   Read_vector(local_y, local_n, n, "y", my_rank, comm);
-   Print_vector(local_y, local_n, n, "y is", my_rank, comm);
+   if (argc == 1) {
+      Read_vector(local_x, local_n, n, "x", my_rank, comm);
+      Print_vector(local_x, local_n, n, "x is", my_rank, comm);
+      Read_vector(local_y, local_n, n, "y", my_rank, comm);
+      Print_vector(local_y, local_n, n, "y is", my_rank, comm);
+   } else {
+      Check_for_error(
+            Io_read_rows(argv[1], text, local_x, n, local_n, 1, blk, comm),
+            "main", "Can't read x", comm);
+      Check_for_error(
+            Io_read_rows(argv[2], text, local_y, n, local_n, 1, blk, comm),
+            "main", "Can't read y", comm);
+   }
    
    Parallel_vector_sum(local_x, local_y, local_z, local_n);
-   Print_vector(local_z, local_n, n, "The sum is", my_rank, comm);
+   if (argc == 1)
+      Print_vector(local_z, local_n, n, "The sum is", my_rank, comm);
+   else
+      Check_for_error(
+            Io_write_rows(argv[3], text, local_z, n, local_n, 1, blk, comm),
+            "main", "Can't write z", comm);
 
    free(local_x);
    free(local_y);
@@ -140,13 +175,67 @@ void Read_n(
       scanf("%d", n_p);
    }
    MPI_Bcast(n_p, 1, MPI_INT, 0, comm);
-   if (*n_p =< 0 || *n_p % comm_sz != 0) local_ok = 0;
+   if (*n_p <= 0 || *n_p % comm_sz != 0) local_ok = 0;
    Check_for_error(local_ok, fname,
          "n should be > 0 and evenly divisible by comm_sz", comm);
    *local_n_p = *n_p/comm_sz;
 }  /* Read_n */
 
 
+/*-------------------------------------------------------------------
+ * Function:  Get_file_args
+ * Purpose:   Get the order of the vectors from the x file, and the
+ *            distribution and file format from the command line
+ * In args:   argc, argv:  the command line (argc > 1)
+ *            comm_sz:     number of processes in communicator
+ *            comm:        communicator containing all the processes
+ *                         calling Get_file_args
+ * Out args:  n_p:         global value of n
+ *            local_n_p:   local value of n = n/comm_sz
+ *            blk_p:       number of consecutive components in each
+ *                         block of the distribution
+ *            text_p:      1 if the files are text, 0 if binary
+ *
+ * Errors:    the x file must be readable and store a vector, n
+ *            should be evenly divisible by comm_sz, and the block
+ *            size should evenly divide local_n
+ */
+void Get_file_args(
+      int       argc       /* in  */,
+      char*     argv[]     /* in  */,
+      int*      n_p        /* out */, 
+      int*      local_n_p  /* out */, 
+      int*      blk_p      /* out */, 
+      int*      text_p     /* out */, 
+      int       comm_sz    /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   int local_ok = 1, cols;
+   char* fname = "Get_file_args";
+
+   Check_for_error(argc >= 4 && argc <= 6, fname,
+         "usage: <x file> <y file> <z file> [block | cyclic | <block size>] [t]",
+         comm);
+   *text_p = (argv[argc-1][0] == 't' && argv[argc-1][1] == '\0');
+   Check_for_error(argc < 6 || *text_p, fname,
+         "the last argument should be t", comm);
+   if (!Io_read_dims(argv[1], *text_p, n_p, &cols, comm) || cols != 1)
+      local_ok = 0;
+   Check_for_error(local_ok, fname, "Can't read the order of x", comm);
+   if (*n_p % comm_sz != 0) local_ok = 0;
+   Check_for_error(local_ok, fname,
+         "n should be evenly divisible by comm_sz", comm);
+   *local_n_p = *n_p/comm_sz;
+
+   if (argc - *text_p > 4)
+      *blk_p = Io_block_size(argv[4], *local_n_p);
+   else
+      *blk_p = *local_n_p;
+   if (*blk_p == 0) local_ok = 0;
+   Check_for_error(local_ok, fname,
+         "the block size should evenly divide n/comm_sz", comm);
+}  /* Get_file_args */
+
+
 /*-------------------------------------------------------------------
  * Function:  Allocate_vectors
  * Purpose:   Allocate storage for x, y, and z
@@ -0,0 +1,685 @@
+/* File:     mpi_wait_prof.c
+ *
+ * Purpose:  Find out how much of each process' run time is spent
+ *           computing and how much waiting in MPI calls, without
+ *           changing the program.  The functions here have the names
+ *           of MPI functions:  each one reads the clock, calls the
+ *           real function through the profiling interface (PMPI_...),
+ *           and records the time, the bytes and the partner.  At
+ *           MPI_Finalize process 0 prints
+ *
+ *              - each process' elapsed time, MPI time and compute time
+ *                (elapsed - MPI), and the load imbalance of the
+ *                compute times
+ *              - for each MPI function, the calls, bytes and the
+ *                minimum, mean and maximum over the processes of the
+ *                time spent in it
+ *              - a timeline:  a row for each process, each column a
+ *                slice of the run, marked with the MPI function the
+ *                process spent most of the slice in, or '.' if it
+ *                spent most of the slice computing
+ *              - with at most 16 processes, the bytes sent by each
+ *                process to each other process
+ *
+ *           and writes every call as a line of a CSV file.
+ *
+ * Compile:  As a library that's loaded into an unchanged program:
+ *              mpicc -g -Wall -O2 -shared -fPIC -o libmpi_wait_prof.so
+ *                 mpi_wait_prof.c
+ *           or linked with the program:
+ *              mpicc -g -Wall -DUSE_MPI -o mpi_mat_vect_time
+ *                 mpi_mat_vect_time.c prof.c mpi_wait_prof.c
+ * Run:      Open MPI:
+ *              mpiexec -n <p> -x LD_PRELOAD=./libmpi_wait_prof.so <program>
+ *           MPICH:
+ *              mpiexec -n <p> -genv LD_PRELOAD ./libmpi_wait_prof.so <program>
+ *
+ * Environment:
+ *    MPI_WAIT_FILE      file for the summary (default stderr)
+ *    MPI_WAIT_TIMELINE  CSV file for the calls (default
+ *                       mpi_wait_timeline.csv;  empty for none)
+ *    MPI_WAIT_EVENTS    maximum number of calls each process records
+ *                       for the timeline (default 100000)
+ *
+ * Output:   The timeline CSV has the columns
+ *              rank,call,start,end,partner,bytes
+ *           with times in seconds from the end of MPI_Init, and the
+ *           partner's rank in MPI_COMM_WORLD:  the destination of a
+ *           send (of the send part of a Sendrecv), the source of a
+ *           receive, the root of a rooted collective, or -1.
+ *
+ * Notes:
+ * 1.  The functions wrapped are the ones the programs in ch3 and
+ *     lista-04 use:  Send, Bsend, Isend, Recv, Irecv, Sendrecv,
+ *     Sendrecv_replace, Iprobe, Wait, Waitall, Barrier, Bcast,
+ *     Reduce, Allreduce, Gather, Scatter, Allgather and Alltoallv.
+ *     Time in other MPI functions counts as computation.
+ * 2.  MPI_Init ends with a barrier, so that the processes' clocks
+ *     start at about the same time.
+ * 3.  Bytes are those this process sends or receives in the call,
+ *     from the counts and the sizes of the datatypes.  A receive
+ *     counts the bytes actually received.  For Isend and Irecv the
+ *     bytes are recorded at the Isend or Irecv, and the wait in
+ *     MPI_Wait or MPI_Waitall.
+ * 4.  Calls after the MPI_Init_thread of a multithreaded program
+ *     aren't recorded safely from more than one thread.
+ *
+ * IPP:  Section 3.6 (pp. 121 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#define DEFAULT_MAX_EVENTS 100000
+#define TIMELINE_COLS 64
+#define MAX_MATRIX_PROCS 16
+
+typedef enum {
+   W_SEND, W_BSEND, W_ISEND, W_RECV, W_IRECV, W_SENDRECV,
+   W_SENDRECV_REPLACE, W_IPROBE, W_WAIT, W_WAITALL, W_BARRIER, W_BCAST,
+   W_REDUCE, W_ALLREDUCE, W_GATHER, W_SCATTER, W_ALLGATHER, W_ALLTOALLV,
+   CALL_COUNT
+} call_t;
+
+const char* call_names[CALL_COUNT] = {
+   "MPI_Send", "MPI_Bsend", "MPI_Isend", "MPI_Recv", "MPI_Irecv",
+   "MPI_Sendrecv", "MPI_Sendrecv_replace", "MPI_Iprobe", "MPI_Wait",
+   "MPI_Waitall", "MPI_Barrier", "MPI_Bcast", "MPI_Reduce",
+   "MPI_Allreduce", "MPI_Gather", "MPI_Scatter", "MPI_Allgather",
+   "MPI_Alltoallv"};
+
+/* Marks for the timeline */
+const char call_marks[CALL_COUNT] = {
+   'S', 'B', 's', 'R', 'r', 'X', 'x', 'P', 'W', 'w', '|', 'b', '+', '*',
+   'g', 'c', 'a', 'v'};
+
+typedef struct {
+   double     start, end;
+   int        call, partner;
+   long long  bytes;
+}  event_t;
+
+/* Per process statistics gathered onto process 0:  elapsed, MPI time,
+ * events dropped, then calls, time and bytes for each function */
+#define STAT_HEAD 3
+#define STAT_LEN (STAT_HEAD + 3*CALL_COUNT)
+
+static int my_rank, comm_sz;
+static double t0;
+static long calls[CALL_COUNT];
+static double times[CALL_COUNT];
+static long long bytes[CALL_COUNT];
+static long long* sent_bytes;      /* Bytes sent to each process */
+static event_t* events;
+static int event_count, max_events, events_dropped;
+static MPI_Group world_group;
+
+static void Start_up(void);
+static void Record(call_t call, double start, int partner,
+      long long count);
+static int World_rank(MPI_Comm comm, int rank);
+static long long Type_bytes(MPI_Datatype type, int count);
+static void Report(void);
+static void Print_summary(FILE* fp, double stats[], long long matrix[],
+      event_t all_events[], int event_counts[], int displs[]);
+static void Print_timeline(FILE* fp, double span,
+      event_t all_events[], int event_counts[], int displs[]);
+static void Write_timeline(const char* fname, event_t all_events[],
+      int event_counts[], int displs[]);
+
+
+/*---------------------------------------------------------------------
+ * Functions:  MPI_Init, MPI_Init_thread
+ * Purpose:    Start MPI and the recording
+ */
+int MPI_Init(int* argc_p, char*** argv_p) {
+   int rv = PMPI_Init(argc_p, argv_p);
+
+   Start_up();
+   return rv;
+}  /* MPI_Init */
+
+int MPI_Init_thread(int* argc_p, char*** argv_p, int required,
+      int* provided_p) {
+   int rv = PMPI_Init_thread(argc_p, argv_p, required, provided_p);
+
+   Start_up();
+   return rv;
+}  /* MPI_Init_thread */
+
+
+/*---------------------------------------------------------------------
+ * Function:  MPI_Finalize
+ * Purpose:   Print the summary and write the timeline, then shut down
+ *            MPI
+ */
+int MPI_Finalize(void) {
+   Report();
+   free(sent_bytes);
+   free(events);
+   PMPI_Group_free(&world_group);
+   return PMPI_Finalize();
+}  /* MPI_Finalize */
+
+
+/*---------------------------------------------------------------------
+ * Point-to-point functions
+ */
+int MPI_Send(const void* buf, int count, MPI_Datatype type, int dest,
+      int tag, MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Send(buf, count, type, dest, tag, comm);
+
+   Record(W_SEND, start, World_rank(comm, dest), Type_bytes(type, count));
+   return rv;
+}  /* MPI_Send */
+
+int MPI_Bsend(const void* buf, int count, MPI_Datatype type, int dest,
+      int tag, MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Bsend(buf, count, type, dest, tag, comm);
+
+   Record(W_BSEND, start, World_rank(comm, dest), Type_bytes(type, count));
+   return rv;
+}  /* MPI_Bsend */
+
+int MPI_Isend(const void* buf, int count, MPI_Datatype type, int dest,
+      int tag, MPI_Comm comm, MPI_Request* request_p) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Isend(buf, count, type, dest, tag, comm, request_p);
+
+   Record(W_ISEND, start, World_rank(comm, dest), Type_bytes(type, count));
+   return rv;
+}  /* MPI_Isend */
+
+int MPI_Recv(void* buf, int count, MPI_Datatype type, int source,
+      int tag, MPI_Comm comm, MPI_Status* status_p) {
+   double start = PMPI_Wtime();
+   MPI_Status status;
+   int rv = PMPI_Recv(buf, count, type, source, tag, comm, &status);
+   int received;
+
+   PMPI_Get_count(&status, type, &received);
+   Record(W_RECV, start, World_rank(comm, status.MPI_SOURCE),
+         Type_bytes(type, received));
+   if (status_p != MPI_STATUS_IGNORE) *status_p = status;
+   return rv;
+}  /* MPI_Recv */
+
+int MPI_Irecv(void* buf, int count, MPI_Datatype type, int source,
+      int tag, MPI_Comm comm, MPI_Request* request_p) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Irecv(buf, count, type, source, tag, comm, request_p);
+
+   Record(W_IRECV, start, World_rank(comm, source), Type_bytes(type, count));
+   return rv;
+}  /* MPI_Irecv */
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      int dest, int sendtag, void* recvbuf, int recvcount,
+      MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm,
+      MPI_Status* status_p) {
+   double start = PMPI_Wtime();
+   MPI_Status status;
+   int rv = PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag,
+         recvbuf, recvcount, recvtype, source, recvtag, comm, &status);
+   int received;
+
+   PMPI_Get_count(&status, recvtype, &received);
+   Record(W_SENDRECV, start, World_rank(comm, dest),
+         Type_bytes(sendtype, sendcount));
+   bytes[W_SENDRECV] += Type_bytes(recvtype, received);
+   if (status_p != MPI_STATUS_IGNORE) *status_p = status;
+   return rv;
+}  /* MPI_Sendrecv */
+
+int MPI_Sendrecv_replace(void* buf, int count, MPI_Datatype type,
+      int dest, int sendtag, int source, int recvtag, MPI_Comm comm,
+      MPI_Status* status_p) {
+   double start = PMPI_Wtime();
+   MPI_Status status;
+   int rv = PMPI_Sendrecv_replace(buf, count, type, dest, sendtag, source,
+         recvtag, comm, &status);
+
+   Record(W_SENDRECV_REPLACE, start, World_rank(comm, dest),
+         Type_bytes(type, count));
+   bytes[W_SENDRECV_REPLACE] += Type_bytes(type, count);
+   if (status_p != MPI_STATUS_IGNORE) *status_p = status;
+   return rv;
+}  /* MPI_Sendrecv_replace */
+
+int MPI_Iprobe(int source, int tag, MPI_Comm comm, int* flag_p,
+      MPI_Status* status_p) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Iprobe(source, tag, comm, flag_p, status_p);
+
+   Record(W_IPROBE, start, World_rank(comm, source), 0);
+   return rv;
+}  /* MPI_Iprobe */
+
+int MPI_Wait(MPI_Request* request_p, MPI_Status* status_p) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Wait(request_p, status_p);
+
+   Record(W_WAIT, start, -1, 0);
+   return rv;
+}  /* MPI_Wait */
+
+int MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[]) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Waitall(count, requests, statuses);
+
+   Record(W_WAITALL, start, -1, 0);
+   return rv;
+}  /* MPI_Waitall */
+
+
+/*---------------------------------------------------------------------
+ * Collective functions
+ */
+int MPI_Barrier(MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Barrier(comm);
+
+   Record(W_BARRIER, start, -1, 0);
+   return rv;
+}  /* MPI_Barrier */
+
+int MPI_Bcast(void* buf, int count, MPI_Datatype type, int root,
+      MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Bcast(buf, count, type, root, comm);
+
+   Record(W_BCAST, start, World_rank(comm, root), Type_bytes(type, count));
+   return rv;
+}  /* MPI_Bcast */
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Reduce(sendbuf, recvbuf, count, type, op, root, comm);
+
+   Record(W_REDUCE, start, World_rank(comm, root), Type_bytes(type, count));
+   return rv;
+}  /* MPI_Reduce */
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Allreduce(sendbuf, recvbuf, count, type, op, comm);
+
+   Record(W_ALLREDUCE, start, -1, Type_bytes(type, count));
+   return rv;
+}  /* MPI_Allreduce */
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+      MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+         recvtype, root, comm);
+
+   Record(W_GATHER, start, World_rank(comm, root),
+         Type_bytes(sendtype, sendcount));
+   return rv;
+}  /* MPI_Gather */
+
+int MPI_Scatter(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+      MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+         recvtype, root, comm);
+
+   Record(W_SCATTER, start, World_rank(comm, root),
+         Type_bytes(recvtype, recvcount));
+   return rv;
+}  /* MPI_Scatter */
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf,
+         recvcount, recvtype, comm);
+
+   Record(W_ALLGATHER, start, -1, Type_bytes(sendtype, sendcount));
+   return rv;
+}  /* MPI_Allgather */
+
+int MPI_Alltoallv(const void* sendbuf, const int sendcounts[],
+      const int sdispls[], MPI_Datatype sendtype, void* recvbuf,
+      const int recvcounts[], const int rdispls[], MPI_Datatype recvtype,
+      MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+         recvcounts, rdispls, recvtype, comm);
+   int q, p;
+   long long sent = 0;
+
+   PMPI_Comm_size(comm, &p);
+   for (q = 0; q < p; q++)
+      sent += Type_bytes(sendtype, sendcounts[q]);
+   Record(W_ALLTOALLV, start, -1, sent);
+   return rv;
+}  /* MPI_Alltoallv */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Start_up
+ * Purpose:   Allocate the storage for the recording, and synchronize
+ *            the processes' start times
+ */
+static void Start_up(void) {
+   char* max_s = getenv("MPI_WAIT_EVENTS");
+
+   PMPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+   PMPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+   PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+   sent_bytes = calloc(comm_sz, sizeof(long long));
+   max_events = max_s != NULL ? strtol(max_s, NULL, 10) : DEFAULT_MAX_EVENTS;
+   if (max_events < 0) max_events = 0;
+   events = malloc((max_events > 0 ? max_events : 1)*sizeof(event_t));
+   event_count = events_dropped = 0;
+
+   PMPI_Barrier(MPI_COMM_WORLD);
+   t0 = PMPI_Wtime();
+}  /* Start_up */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Record
+ * Purpose:   Add a call that started at start and ends now to the
+ *            statistics and the timeline
+ * In args:   call, start, partner (rank in MPI_COMM_WORLD or < 0),
+ *            count:  bytes sent or received
+ */
+static void Record(call_t call, double start, int partner,
+      long long count) {
+   double end = PMPI_Wtime();
+   event_t* e;
+
+   calls[call]++;
+   times[call] += end - start;
+   bytes[call] += count;
+   if (partner >= 0 && partner < comm_sz && (call == W_SEND ||
+         call == W_BSEND || call == W_ISEND || call == W_SENDRECV ||
+         call == W_SENDRECV_REPLACE))
+      sent_bytes[partner] += count;
+
+   if (event_count < max_events) {
+      e = &events[event_count++];
+      e->start = start - t0;
+      e->end = end - t0;
+      e->call = call;
+      e->partner = partner;
+      e->bytes = count;
+   } else {
+      events_dropped++;
+   }
+}  /* Record */
+
+
+/*---------------------------------------------------------------------
+ * Function:  World_rank
+ * Purpose:   Translate rank in comm to a rank in MPI_COMM_WORLD
+ * Return:    The rank, or -1 for MPI_ANY_SOURCE, MPI_PROC_NULL, etc.
+ */
+static int World_rank(MPI_Comm comm, int rank) {
+   MPI_Group group;
+   int world;
+
+   if (rank < 0) return -1;
+   if (comm == MPI_COMM_WORLD) return rank;
+   PMPI_Comm_group(comm, &group);
+   PMPI_Group_translate_ranks(group, 1, &rank, world_group, &world);
+   PMPI_Group_free(&group);
+   return world == MPI_UNDEFINED ? -1 : world;
+}  /* World_rank */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Type_bytes
+ * Purpose:   Return the number of bytes in count elements of type
+ */
+static long long Type_bytes(MPI_Datatype type, int count) {
+   int size;
+
+   if (count <= 0 || count == MPI_UNDEFINED) return 0;
+   PMPI_Type_size(type, &size);
+   return (long long) size*count;
+}  /* Type_bytes */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Report
+ * Purpose:   Gather the statistics and events onto process 0, which
+ *            prints the summary and writes the timeline
+ * Note:      Collective on MPI_COMM_WORLD
+ */
+static void Report(void) {
+   double my_stats[STAT_LEN], *stats = NULL, mpi_time = 0.0;
+   long long* matrix = NULL;
+   event_t* all_events = NULL;
+   int *event_counts = NULL, *displs = NULL, my_bytes, total = 0, q, c;
+   char *fname, *tl_name;
+   FILE* fp = stderr;
+
+   my_stats[0] = PMPI_Wtime() - t0;
+   for (c = 0; c < CALL_COUNT; c++) {
+      mpi_time += times[c];
+      my_stats[STAT_HEAD + 3*c] = calls[c];
+      my_stats[STAT_HEAD + 3*c + 1] = times[c];
+      my_stats[STAT_HEAD + 3*c + 2] = bytes[c];
+   }
+   my_stats[1] = mpi_time;
+   my_stats[2] = events_dropped;
+
+   if (my_rank == 0) {
+      stats = malloc(comm_sz*STAT_LEN*sizeof(double));
+      matrix = malloc(comm_sz*comm_sz*sizeof(long long));
+      event_counts = malloc(comm_sz*sizeof(int));
+      displs = malloc(comm_sz*sizeof(int));
+   }
+   PMPI_Gather(my_stats, STAT_LEN, MPI_DOUBLE, stats, STAT_LEN, MPI_DOUBLE,
+         0, MPI_COMM_WORLD);
+   PMPI_Gather(sent_bytes, comm_sz, MPI_LONG_LONG, matrix, comm_sz,
+         MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+
+   my_bytes = event_count*sizeof(event_t);
+   PMPI_Gather(&my_bytes, 1, MPI_INT, event_counts, 1, MPI_INT, 0,
+         MPI_COMM_WORLD);
+   if (my_rank == 0) {
+      for (q = 0; q < comm_sz; q++) {
+         displs[q] = total;
+         total += event_counts[q];
+      }
+      all_events = malloc(total > 0 ? total : 1);
+   }
+   PMPI_Gatherv(events, my_bytes, MPI_BYTE, all_events, event_counts,
+         displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+   if (my_rank == 0) {
+      for (q = 0; q < comm_sz; q++) {
+         event_counts[q] /= sizeof(event_t);
+         displs[q] /= sizeof(event_t);
+      }
+      fname = getenv("MPI_WAIT_FILE");
+      if (fname != NULL && fname[0] != '\0') {
+         fp = fopen(fname, "w");
+         if (fp == NULL) {
+            fprintf(stderr, "mpi_wait_prof:  can't open %s\n", fname);
+            fp = stderr;
+         }
+      }
+      Print_summary(fp, stats, matrix, all_events, event_counts, displs);
+      if (fp != stderr) fclose(fp);
+
+      tl_name = getenv("MPI_WAIT_TIMELINE");
+      if (tl_name == NULL) tl_name = "mpi_wait_timeline.csv";
+      if (tl_name[0] != '\0')
+         Write_timeline(tl_name, all_events, event_counts, displs);
+
+      free(stats);
+      free(matrix);
+      free(event_counts);
+      free(displs);
+      free(all_events);
+   }
+}  /* Report */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Print_summary
+ * Purpose:   Print the per process times, the per function statistics,
+ *            the timeline and the bytes sent between processes
+ */
+static void Print_summary(FILE* fp, double stats[], long long matrix[],
+      event_t all_events[], int event_counts[], int displs[]) {
+   double *st, elapsed, mpi, comp, max_elapsed = 0.0;
+   double comp_sum = 0.0, comp_max = 0.0, comp_mean;
+   double t, t_min, t_max, t_sum, n_calls, n_bytes;
+   int q, c, r, max_rank, dropped = 0;
+
+   fprintf(fp, "MPI wait time profile:  %d process(es)\n\n", comm_sz);
+   fprintf(fp, "%5s %12s %12s %12s %7s\n", "rank", "elapsed (s)",
+         "MPI (s)", "compute (s)", "MPI %");
+   for (q = 0; q < comm_sz; q++) {
+      st = &stats[q*STAT_LEN];
+      elapsed = st[0];
+      mpi = st[1];
+      comp = elapsed - mpi;
+      dropped += st[2];
+      fprintf(fp, "%5d %12.6f %12.6f %12.6f %6.1f%%\n", q, elapsed, mpi,
+            comp, elapsed > 0 ? 100.0*mpi/elapsed : 0.0);
+      if (elapsed > max_elapsed) max_elapsed = elapsed;
+      comp_sum += comp;
+      if (comp > comp_max) comp_max = comp;
+   }
+   comp_mean = comp_sum/comm_sz;
+   fprintf(fp, "Load imbalance of compute time:  max/mean = %.3f, "
+         "(max - mean)/max = %.1f%%\n\n", comp_mean > 0 ?
+         comp_max/comp_mean : 1.0, comp_max > 0 ?
+         100.0*(comp_max - comp_mean)/comp_max : 0.0);
+
+   fprintf(fp, "%-21s %9s %14s %12s %12s %12s %5s\n", "function", "calls",
+         "bytes", "min (s)", "mean (s)", "max (s)", "rank");
+   for (c = 0; c < CALL_COUNT; c++) {
+      n_calls = n_bytes = t_sum = 0.0;
+      t_min = t_max = stats[STAT_HEAD + 3*c + 1];
+      max_rank = 0;
+      for (q = 0; q < comm_sz; q++) {
+         st = &stats[q*STAT_LEN + STAT_HEAD + 3*c];
+         n_calls += st[0];
+         t = st[1];
+         n_bytes += st[2];
+         t_sum += t;
+         if (t < t_min) t_min = t;
+         if (t > t_max) {
+            t_max = t;
+            max_rank = q;
+         }
+      }
+      if (n_calls == 0) continue;
+      fprintf(fp, "%-21s %9.0f %14.0f %12.6f %12.6f %12.6f %5d\n",
+            call_names[c], n_calls, n_bytes, t_min, t_sum/comm_sz, t_max,
+            max_rank);
+   }
+   fprintf(fp, "(min, mean, max:  time in the function over the processes;"
+         "  rank:  the process with the max)\n\n");
+
+   Print_timeline(fp, max_elapsed, all_events, event_counts, displs);
+   if (dropped > 0)
+      fprintf(fp, "%d calls weren't recorded in the timeline:  "
+            "increase MPI_WAIT_EVENTS\n", dropped);
+
+   if (comm_sz <= MAX_MATRIX_PROCS) {
+      fprintf(fp, "\nBytes sent point-to-point (row = sender, column = "
+            "receiver)\n%5s", "");
+      for (r = 0; r < comm_sz; r++)
+         fprintf(fp, " %10d", r);
+      fprintf(fp, "\n");
+      for (q = 0; q < comm_sz; q++) {
+         fprintf(fp, "%5d", q);
+         for (r = 0; r < comm_sz; r++)
+            fprintf(fp, " %10lld", matrix[q*comm_sz + r]);
+         fprintf(fp, "\n");
+      }
+   }
+}  /* Print_summary */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Print_timeline
+ * Purpose:   Print a row for each process, in which each column is
+ *            span/TIMELINE_COLS seconds, marked with the function the
+ *            process spent most of the column in, or '.' if it spent
+ *            less than half of it in MPI functions
+ */
+static void Print_timeline(FILE* fp, double span,
+      event_t all_events[], int event_counts[], int displs[]) {
+   double width = span/TIMELINE_COLS, in_call[TIMELINE_COLS][CALL_COUNT];
+   double lo, hi, total, most;
+   char row[TIMELINE_COLS + 1];
+   int q, i, col, c, best;
+   event_t* e;
+
+   if (width <= 0) return;
+   fprintf(fp, "Timeline:  %d columns of %.3e s\n", TIMELINE_COLS, width);
+   for (q = 0; q < comm_sz; q++) {
+      memset(in_call, 0, sizeof(in_call));
+      for (i = 0; i < event_counts[q]; i++) {
+         e = &all_events[displs[q] + i];
+         for (col = e->start/width; col < TIMELINE_COLS && col*width < e->end;
+               col++) {
+            lo = e->start > col*width ? e->start : col*width;
+            hi = e->end < (col + 1)*width ? e->end : (col + 1)*width;
+            if (hi > lo) in_call[col][e->call] += hi - lo;
+         }
+      }
+      for (col = 0; col < TIMELINE_COLS; col++) {
+         total = most = 0.0;
+         best = 0;
+         for (c = 0; c < CALL_COUNT; c++) {
+            total += in_call[col][c];
+            if (in_call[col][c] > most) {
+               most = in_call[col][c];
+               best = c;
+            }
+         }
+         row[col] = total >= width/2 ? call_marks[best] : '.';
+      }
+      row[TIMELINE_COLS] = '\0';
+      fprintf(fp, "%5d |%s|\n", q, row);
+   }
+   fprintf(fp, "  . = computing");
+   for (c = 0; c < CALL_COUNT; c++)
+      fprintf(fp, "%s%c = %s", c % 6 == 5 ? "\n  " : ", ", call_marks[c],
+            call_names[c] + 4);
+   fprintf(fp, "\n");
+}  /* Print_timeline */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Write_timeline
+ * Purpose:   Write every recorded call to a CSV file
+ */
+static void Write_timeline(const char* fname, event_t all_events[],
+      int event_counts[], int displs[]) {
+   FILE* fp = fopen(fname, "w");
+   event_t* e;
+   int q, i;
+
+   if (fp == NULL) {
+      fprintf(stderr, "mpi_wait_prof:  can't open %s\n", fname);
+      return;
+   }
+   fprintf(fp, "rank,call,start,end,partner,bytes\n");
+   for (q = 0; q < comm_sz; q++)
+      for (i = 0; i < event_counts[q]; i++) {
+         e = &all_events[displs[q] + i];
+         fprintf(fp, "%d,%s,%.9f,%.9f,%d,%lld\n", q, call_names[e->call],
+               e->start, e->end, e->partner, e->bytes);
+      }
+   fclose(fp);
+}  /* Write_timeline */
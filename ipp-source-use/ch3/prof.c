@@ -0,0 +1,681 @@
+/* File:     prof.c
+ *
+ * Purpose:  Timing and profiling of named regions, to replace the
+ *           GET_TIME, omp_get_wtime and MPI_Wtime + MPI_Reduce(MPI_MAX)
+ *           code scattered through the programs.  See prof.h for the
+ *           macros a program uses.
+ *
+ *           Prof_begin(name) and Prof_end(name) open and close a
+ *           region.  A region opened inside another is a different
+ *           region from one with the same name opened elsewhere:  its
+ *           path is "outer/inner".  Each thread has its own table of
+ *           regions, with the number of calls, the total, minimum and
+ *           maximum time of a call, and, with -DPROF_PERF, hardware
+ *           counts.  So the threads don't share anything while they
+ *           time regions.
+ *
+ *           Prof_report collects the tables of all the threads (and,
+ *           with -DUSE_MPI, of all the processes in MPI_COMM_WORLD),
+ *           and for each path prints the number of threads that
+ *           entered it (samples), the total calls, and the minimum,
+ *           median and maximum over the samples of the time spent in
+ *           the region.  The maximum is what MPI_Reduce(MPI_MAX) of
+ *           the elapsed time gave.
+ *
+ * Compile:  See prof.h
+ *
+ * Notes:
+ * 1.  The clock is clock_gettime(CLOCK_MONOTONIC), which, unlike
+ *     gettimeofday, doesn't jump when the system time is set.  With
+ *     -DPROF_TSC it's the time stamp counter, which is cheaper to
+ *     read:  its rate is measured against CLOCK_MONOTONIC the first
+ *     time it's used.  This assumes an invariant TSC that's
+ *     synchronized across cores, as on current x86 processors.
+ * 2.  The counters are opened for each thread the first time it
+ *     enters a region, and count only user mode.  If perf_event_open
+ *     fails (e.g., because /proc/sys/kernel/perf_event_paranoid
+ *     forbids it), a warning is printed and the counters are
+ *     reported as -1.  Without -DPROF_PERF the text report has no
+ *     counter columns;  the CSV and JSON reports always have them, so
+ *     their format doesn't depend on the compile flags, and report
+ *     -1.
+ * 3.  A thread's table isn't freed when the thread terminates, so at
+ *     most PROF_MAX_THREADS threads can ever time regions.  Programs
+ *     that start new threads in a loop should time regions in the
+ *     main thread.
+ * 4.  A thread starts with no regions open:  a region that a thread
+ *     opens in an OpenMP parallel region or a Pthreads thread
+ *     function is at the top level, even if the thread that started
+ *     it has a region open.
+ * 5.  The reports aren't thread-safe:  call Prof_report and
+ *     Prof_reset when no other thread is in a region.
+ *
+ * IPP:  Sections 2.6.2 (pp. 66 and ff.) and 3.6.1 (pp. 121 and ff.)
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#if defined(PROF_TSC) && !(defined(__x86_64__) || defined(__i386__))
+#  undef PROF_TSC
+#endif
+#ifdef PROF_TSC
+#include <x86intrin.h>
+#endif
+#ifdef PROF_PERF
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "prof.h"
+
+typedef unsigned long long ticks_t;
+
+typedef struct {
+   char       path[PROF_PATH_LEN];
+   int        name;         /* Offset of the last name in path */
+   int        parent;       /* Index of enclosing region, or -1  */
+   long       calls;
+   ticks_t    total, min, max;
+   long long  counts[PROF_COUNTERS];
+}  prof_region_t;
+
+typedef struct {
+   int            region_count;
+   prof_region_t  regions[PROF_MAX_REGIONS];
+   int            depth;
+   int            stack[PROF_MAX_DEPTH];
+   ticks_t        start[PROF_MAX_DEPTH];
+   long long      start_counts[PROF_MAX_DEPTH][PROF_COUNTERS];
+   int            perf_fd;      /* Leader of the counter group, or -1 */
+}  prof_thread_t;
+
+/* One region in one thread, as it's sent to process 0 */
+typedef struct {
+   char       path[PROF_PATH_LEN];
+   long       calls;
+   double     total, min, max;
+   long long  counts[PROF_COUNTERS];
+   int        has_counts;
+}  prof_sample_t;
+
+static prof_thread_t* threads[PROF_MAX_THREADS];
+static int thread_count = 0;
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread prof_thread_t* my_thread = NULL;
+
+static double secs_per_tick = 1.0e-9;
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+
+static void Error(const char* format, const char* name);
+static ticks_t Ticks(void);
+static ticks_t Monotonic_ns(void);
+static void Init_clock(void);
+static prof_thread_t* Get_thread(void);
+static int Find_region(prof_thread_t* t, int parent, const char* name);
+static void Read_counts(prof_thread_t* t, long long counts[]);
+static int Local_samples(prof_sample_t** samples_p);
+static int Gather_samples(prof_sample_t** samples_p, int* my_rank_p,
+      int* comm_sz_p);
+static void Print_report(FILE* fp, prof_format_t format,
+      prof_sample_t samples[], int count, int comm_sz);
+static int Compare_doubles(const void* a, const void* b);
+static void Print_json_string(FILE* fp, const char* s);
+#ifdef PROF_PERF
+static int Perf_open(void);
+#endif
+
+
+/*---------------------------------------------------------------------
+ * Function:  Prof_time
+ * Purpose:   Return the time in seconds since some point in the past,
+ *            on the clock used for the regions
+ */
+double Prof_time(void) {
+   pthread_once(&clock_once, Init_clock);
+   return Ticks()*secs_per_tick;
+}  /* Prof_time */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Prof_begin
+ * Purpose:   Open region name inside the region the calling thread
+ *            has open, if any
+ * In arg:    name
+ */
+void Prof_begin(const char* name) {
+   prof_thread_t* t = Get_thread();
+   int parent;
+
+   if (t->depth == PROF_MAX_DEPTH)
+      Error("Prof_begin:  regions nested too deeply at \"%s\"", name);
+   parent = t->depth > 0 ? t->stack[t->depth-1] : -1;
+   t->stack[t->depth] = Find_region(t, parent, name);
+   Read_counts(t, t->start_counts[t->depth]);
+   t->start[t->depth] = Ticks();
+   t->depth++;
+}  /* Prof_begin */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Prof_end
+ * Purpose:   Close region name, which must be the last region the
+ *            calling thread opened
+ * In arg:    name
+ */
+void Prof_end(const char* name) {
+   ticks_t finish = Ticks(), elapsed;
+   long long counts[PROF_COUNTERS];
+   prof_thread_t* t = Get_thread();
+   prof_region_t* r;
+   int i;
+
+   if (t->depth == 0)
+      Error("Prof_end:  region \"%s\" isn't open", name);
+   r = &t->regions[t->stack[t->depth-1]];
+   if (strcmp(r->path + r->name, name) != 0)
+      Error("Prof_end:  region \"%s\" isn't the last one opened", name);
+   t->depth--;
+   Read_counts(t, counts);
+
+   elapsed = finish - t->start[t->depth];
+   if (r->calls == 0 || elapsed < r->min) r->min = elapsed;
+   if (elapsed > r->max) r->max = elapsed;
+   r->total += elapsed;
+   r->calls++;
+   for (i = 0; i < PROF_COUNTERS; i++)
+      r->counts[i] += counts[i] - t->start_counts[t->depth][i];
+}  /* Prof_end */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Prof_report
+ * Purpose:   Print statistics for each region.  With -DUSE_MPI and MPI
+ *            initialized, this is collective on MPI_COMM_WORLD and
+ *            process 0 prints the statistics over all the processes.
+ * In args:   fp (only used on process 0), format
+ */
+void Prof_report(FILE* fp, prof_format_t format) {
+   prof_sample_t* samples;
+   int count, my_rank, comm_sz;
+
+   count = Gather_samples(&samples, &my_rank, &comm_sz);
+   if (my_rank == 0)
+      Print_report(fp, format, samples, count, comm_sz);
+   free(samples);
+}  /* Prof_report */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Prof_report_env
+ * Purpose:   Prof_report with the format in the environment variable
+ *            PROF_FORMAT (text, csv or json) to the file in PROF_FILE
+ *            (default stderr)
+ */
+void Prof_report_env(void) {
+   char* format_s = getenv("PROF_FORMAT");
+   char* file_s = getenv("PROF_FILE");
+   prof_format_t format = PROF_TEXT;
+   FILE* fp = stderr;
+   int my_rank = 0;
+#  ifdef USE_MPI
+   int initialized, finalized;
+
+   MPI_Initialized(&initialized);
+   MPI_Finalized(&finalized);
+   if (initialized && !finalized)
+      MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+#  endif
+
+   if (format_s != NULL && strcmp(format_s, "csv") == 0)
+      format = PROF_CSV;
+   else if (format_s != NULL && strcmp(format_s, "json") == 0)
+      format = PROF_JSON;
+   if (my_rank == 0 && file_s != NULL && file_s[0] != '\0') {
+      fp = fopen(file_s, "w");
+      if (fp == NULL) {
+         fprintf(stderr, "Can't open %s, using stderr\n", file_s);
+         fp = stderr;
+      }
+   }
+
+   Prof_report(fp, format);
+   if (fp != stderr) fclose(fp);
+}  /* Prof_report_env */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Prof_reset
+ * Purpose:   Discard the times and counts of all the regions
+ */
+void Prof_reset(void) {
+   int i;
+
+   pthread_mutex_lock(&threads_mutex);
+   for (i = 0; i < thread_count; i++) {
+      threads[i]->region_count = 0;
+      threads[i]->depth = 0;
+   }
+   pthread_mutex_unlock(&threads_mutex);
+}  /* Prof_reset */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Error
+ * Purpose:   Print a message about a misused region and quit
+ */
+static void Error(const char* format, const char* name) {
+   fprintf(stderr, format, name);
+   fprintf(stderr, "\n");
+#  ifdef USE_MPI
+   MPI_Abort(MPI_COMM_WORLD, -1);
+#  endif
+   exit(-1);
+}  /* Error */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Ticks
+ * Purpose:   Read the clock
+ */
+static ticks_t Ticks(void) {
+#  ifdef PROF_TSC
+   return __rdtsc();
+#  else
+   return Monotonic_ns();
+#  endif
+}  /* Ticks */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Monotonic_ns
+ * Purpose:   Read CLOCK_MONOTONIC in nanoseconds
+ */
+static ticks_t Monotonic_ns(void) {
+   struct timespec t;
+
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (ticks_t) t.tv_sec*1000000000ULL + t.tv_nsec;
+}  /* Monotonic_ns */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Init_clock
+ * Purpose:   Find the seconds per tick of the clock.  For the TSC,
+ *            count ticks over 20 ms of CLOCK_MONOTONIC.
+ */
+static void Init_clock(void) {
+#  ifdef PROF_TSC
+   ticks_t ns0, ns1, tsc0, tsc1;
+
+   ns0 = Monotonic_ns();
+   tsc0 = __rdtsc();
+   do
+      ns1 = Monotonic_ns();
+   while (ns1 - ns0 < 20000000ULL);
+   tsc1 = __rdtsc();
+   secs_per_tick = 1.0e-9*(ns1 - ns0)/(tsc1 - tsc0);
+#  else
+   secs_per_tick = 1.0e-9;
+#  endif
+}  /* Init_clock */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Get_thread
+ * Purpose:   Return the calling thread's table, creating it the first
+ *            time
+ */
+static prof_thread_t* Get_thread(void) {
+   prof_thread_t* t;
+
+   if (my_thread != NULL) return my_thread;
+
+   pthread_once(&clock_once, Init_clock);
+   t = calloc(1, sizeof(prof_thread_t));
+#  ifdef PROF_PERF
+   t->perf_fd = Perf_open();
+#  else
+   t->perf_fd = -1;
+#  endif
+
+   pthread_mutex_lock(&threads_mutex);
+   if (thread_count == PROF_MAX_THREADS) {
+      pthread_mutex_unlock(&threads_mutex);
+      Error("Prof_begin:  more than PROF_MAX_THREADS threads%s", "");
+   }
+   threads[thread_count++] = t;
+   pthread_mutex_unlock(&threads_mutex);
+
+   my_thread = t;
+   return t;
+}  /* Get_thread */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Find_region
+ * Purpose:   Return the index of region name inside region parent,
+ *            adding it to the table if it isn't there
+ */
+static int Find_region(prof_thread_t* t, int parent, const char* name) {
+   int i, len = 0;
+   prof_region_t* r;
+
+   for (i = 0; i < t->region_count; i++) {
+      r = &t->regions[i];
+      if (r->parent == parent && strcmp(r->path + r->name, name) == 0)
+         return i;
+   }
+
+   if (t->region_count == PROF_MAX_REGIONS)
+      Error("Prof_begin:  too many regions at \"%s\"", name);
+   r = &t->regions[t->region_count];
+   memset(r, 0, sizeof(prof_region_t));
+   r->parent = parent;
+   if (parent >= 0) {
+      len = strlen(t->regions[parent].path);
+      if (len + 1 < PROF_PATH_LEN) {
+         memcpy(r->path, t->regions[parent].path, len);
+         r->path[len++] = '/';
+      }
+      r->name = len;
+   }
+   if (r->name >= PROF_PATH_LEN - 1)
+      Error("Prof_begin:  path too long at \"%s\"", name);
+   snprintf(r->path + r->name, PROF_PATH_LEN - r->name, "%s", name);
+
+   return t->region_count++;
+}  /* Find_region */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Read_counts
+ * Purpose:   Read the thread's hardware counters, or zeroes if there
+ *            aren't any
+ */
+static void Read_counts(prof_thread_t* t, long long counts[]) {
+   int i;
+#  ifdef PROF_PERF
+   struct { unsigned long long nr, values[PROF_COUNTERS]; } buf;
+
+   if (t->perf_fd >= 0 && read(t->perf_fd, &buf, sizeof(buf))
+         == sizeof(buf)) {
+      for (i = 0; i < PROF_COUNTERS; i++)
+         counts[i] = buf.values[i];
+      return;
+   }
+#  else
+   (void) t;
+#  endif
+   for (i = 0; i < PROF_COUNTERS; i++)
+      counts[i] = 0;
+}  /* Read_counts */
+
+
+#ifdef PROF_PERF
+/*---------------------------------------------------------------------
+ * Function:  Perf_open
+ * Purpose:   Open a group of counters of the calling thread in user
+ *            mode:  cycles, instructions and cache misses
+ * Return:    The file descriptor of the group leader, or -1
+ */
+static int Perf_open(void) {
+   static int warned = 0;
+   unsigned long long configs[PROF_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+   int fds[PROF_COUNTERS], i, j;
+   struct perf_event_attr attr;
+
+   for (i = 0; i < PROF_COUNTERS; i++) {
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = (i == 0);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1,
+            i == 0 ? -1 : fds[0], 0);
+      if (fds[i] < 0) {
+         for (j = 0; j < i; j++)
+            close(fds[j]);
+         if (!warned) {
+            warned = 1;
+            fprintf(stderr, "prof:  perf_event_open failed, no hardware counts\n");
+         }
+         return -1;
+      }
+   }
+   ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+   ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+   return fds[0];
+}  /* Perf_open */
+#endif
+
+
+/*---------------------------------------------------------------------
+ * Function:  Local_samples
+ * Purpose:   Copy the regions of all the threads in this process into
+ *            an array of samples
+ * Out arg:   samples_p
+ * Return:    Number of samples
+ */
+static int Local_samples(prof_sample_t** samples_p) {
+   int count = 0, i, j, k;
+   prof_region_t* r;
+   prof_sample_t* s;
+
+   pthread_mutex_lock(&threads_mutex);
+   for (i = 0; i < thread_count; i++)
+      count += threads[i]->region_count;
+   *samples_p = s = malloc((count > 0 ? count : 1)*sizeof(prof_sample_t));
+   for (i = 0; i < thread_count; i++)
+      for (j = 0; j < threads[i]->region_count; j++, s++) {
+         r = &threads[i]->regions[j];
+         memcpy(s->path, r->path, PROF_PATH_LEN);
+         s->calls = r->calls;
+         s->total = r->total*secs_per_tick;
+         s->min = r->min*secs_per_tick;
+         s->max = r->max*secs_per_tick;
+         for (k = 0; k < PROF_COUNTERS; k++)
+            s->counts[k] = r->counts[k];
+         s->has_counts = threads[i]->perf_fd >= 0;
+      }
+   pthread_mutex_unlock(&threads_mutex);
+
+   return count;
+}  /* Local_samples */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Gather_samples
+ * Purpose:   Collect the samples of all the processes on process 0
+ * Out args:  samples_p:  on process 0 all the samples, ordered by
+ *               rank;  on the others the local samples
+ *            my_rank_p, comm_sz_p:  0 and 1 without MPI
+ * Return:    Number of samples in *samples_p
+ */
+static int Gather_samples(prof_sample_t** samples_p, int* my_rank_p,
+      int* comm_sz_p) {
+   int count = Local_samples(samples_p);
+#  ifdef USE_MPI
+   int initialized, finalized, q, total = 0;
+   int *counts = NULL, *displs = NULL;
+   prof_sample_t* all = NULL;
+
+   *my_rank_p = 0;
+   *comm_sz_p = 1;
+   MPI_Initialized(&initialized);
+   MPI_Finalized(&finalized);
+   if (!initialized || finalized) return count;
+
+   MPI_Comm_rank(MPI_COMM_WORLD, my_rank_p);
+   MPI_Comm_size(MPI_COMM_WORLD, comm_sz_p);
+   if (*my_rank_p == 0) {
+      counts = malloc(*comm_sz_p*sizeof(int));
+      displs = malloc(*comm_sz_p*sizeof(int));
+   }
+   count *= sizeof(prof_sample_t);
+   MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+   if (*my_rank_p == 0) {
+      for (q = 0; q < *comm_sz_p; q++) {
+         displs[q] = total;
+         total += counts[q];
+      }
+      all = malloc(total > 0 ? total : 1);
+   }
+   MPI_Gatherv(*samples_p, count, MPI_BYTE, all, counts, displs, MPI_BYTE,
+         0, MPI_COMM_WORLD);
+   if (*my_rank_p == 0) {
+      free(*samples_p);
+      *samples_p = all;
+      free(counts);
+      free(displs);
+      return total/sizeof(prof_sample_t);
+   }
+   return count/sizeof(prof_sample_t);
+#  else
+   *my_rank_p = 0;
+   *comm_sz_p = 1;
+   return count;
+#  endif
+}  /* Gather_samples */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Print_report
+ * Purpose:   Print the statistics of each path, in the order in which
+ *            the paths first appear in samples
+ * In args:   fp, format, samples, count, comm_sz
+ */
+static void Print_report(FILE* fp, prof_format_t format,
+      prof_sample_t samples[], int count, int comm_sz) {
+   int i, j, k, n, first = 1, has_counts;
+   char* done = calloc(count > 0 ? count : 1, 1);
+   double* totals = malloc((count > 0 ? count : 1)*sizeof(double));
+   double min_call, max_call;
+   long calls;
+   long long counts[PROF_COUNTERS];
+   const char* clock_name;
+
+#  ifdef PROF_TSC
+   clock_name = "tsc";
+#  else
+   clock_name = "monotonic";
+#  endif
+   if (format == PROF_TEXT) {
+      fprintf(fp, "Regions:  %d process(es), clock = %s\n", comm_sz,
+            clock_name);
+      fprintf(fp, "%-32s %7s %9s %12s %12s %12s %12s", "region",
+            "samples", "calls", "min (s)", "median (s)", "max (s)",
+            "min call (s)");
+#     ifdef PROF_PERF
+      fprintf(fp, " %14s %14s %12s", "cycles", "instructions",
+            "cache misses");
+#     endif
+      fprintf(fp, "\n");
+   } else if (format == PROF_CSV) {
+      fprintf(fp, "region,samples,calls,min_s,median_s,max_s,min_call_s,"
+            "max_call_s,cycles,instructions,cache_misses\n");
+   } else {
+      fprintf(fp, "{\"processes\": %d, \"clock\": \"%s\", \"regions\": [",
+            comm_sz, clock_name);
+   }
+
+   for (i = 0; i < count; i++) {
+      if (done[i]) continue;
+      n = 0;
+      calls = 0;
+      min_call = samples[i].min;
+      max_call = samples[i].max;
+      has_counts = 0;
+      for (k = 0; k < PROF_COUNTERS; k++)
+         counts[k] = 0;
+      for (j = i; j < count; j++) {
+         if (done[j] || strcmp(samples[j].path, samples[i].path) != 0)
+            continue;
+         done[j] = 1;
+         totals[n++] = samples[j].total;
+         calls += samples[j].calls;
+         if (samples[j].min < min_call) min_call = samples[j].min;
+         if (samples[j].max > max_call) max_call = samples[j].max;
+         if (samples[j].has_counts) {
+            has_counts = 1;
+            for (k = 0; k < PROF_COUNTERS; k++)
+               counts[k] += samples[j].counts[k];
+         }
+      }
+      if (!has_counts)
+         for (k = 0; k < PROF_COUNTERS; k++)
+            counts[k] = -1;
+      qsort(totals, n, sizeof(double), Compare_doubles);
+
+      if (format == PROF_TEXT) {
+         fprintf(fp, "%-32s %7d %9ld %12.6e %12.6e %12.6e %12.6e",
+               samples[i].path, n, calls, totals[0], totals[n/2],
+               totals[n-1], min_call);
+#        ifdef PROF_PERF
+         fprintf(fp, " %14lld %14lld %12lld", counts[0], counts[1],
+               counts[2]);
+#        endif
+         fprintf(fp, "\n");
+      } else if (format == PROF_CSV) {
+         fprintf(fp, "%s,%d,%ld,%.9e,%.9e,%.9e,%.9e,%.9e,%lld,%lld,%lld\n",
+               samples[i].path, n, calls, totals[0], totals[n/2],
+               totals[n-1], min_call, max_call, counts[0], counts[1],
+               counts[2]);
+      } else {
+         fprintf(fp, "%s\n  {\"region\": ", first ? "" : ",");
+         Print_json_string(fp, samples[i].path);
+         fprintf(fp, ", \"samples\": %d, \"calls\": %ld, \"min_s\": %.9e, "
+               "\"median_s\": %.9e, \"max_s\": %.9e, \"min_call_s\": %.9e, "
+               "\"max_call_s\": %.9e, \"cycles\": %lld, "
+               "\"instructions\": %lld, \"cache_misses\": %lld}",
+               n, calls, totals[0], totals[n/2], totals[n-1], min_call,
+               max_call, counts[0], counts[1], counts[2]);
+      }
+      first = 0;
+   }
+   if (format == PROF_JSON) fprintf(fp, "\n]}\n");
+   fflush(fp);
+
+   free(done);
+   free(totals);
+}  /* Print_report */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_doubles
+ * Purpose:   Comparison function for qsort
+ */
+static int Compare_doubles(const void* a, const void* b) {
+   double x = *(const double*) a, y = *(const double*) b;
+
+   return (x > y) - (x < y);
+}  /* Compare_doubles */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Print_json_string
+ * Purpose:   Print s as a JSON string
+ */
+static void Print_json_string(FILE* fp, const char* s) {
+   fputc('"', fp);
+   for (; *s != '\0'; s++) {
+      if (*s == '"' || *s == '\\')
+         fprintf(fp, "\\%c", *s);
+      else if ((unsigned char) *s < 0x20)
+         fprintf(fp, "\\u%04x", *s);
+      else
+         fputc(*s, fp);
+   }
+   fputc('"', fp);
+}  /* Print_json_string */
@@ -0,0 +1,78 @@
+/* File:     prof.h
+ * Purpose:  Header file for prof.c, which implements named, nested
+ *           timing regions with a monotonic clock, accumulated per
+ *           thread and per process, optional hardware counters, and
+ *           reports in text, CSV or JSON.
+ *
+ * Usage:
+ *    #include "prof.h"
+ *    . . .
+ *    PROF_BEGIN("solve");
+ *       PROF_REPEAT("mat_vect", 2, 10)     2 warm up runs, 10 timed
+ *          Mat_vect_mult(...);
+ *    PROF_END("solve");
+ *    . . .
+ *    PROF_REPORT();                        before MPI_Finalize
+ *
+ * Compile:  add prof.c to the compile command (from other
+ *           directories, -I../ch3 ../ch3/prof.c), and
+ *              -DUSE_MPI   in MPI programs:  the report is collective
+ *                          on MPI_COMM_WORLD, and gives statistics
+ *                          over all the processes' threads
+ *              -DPROF_TSC  time with the x86 time stamp counter,
+ *                          calibrated against clock_gettime
+ *              -DPROF_PERF count cycles, instructions and cache misses
+ *                          with Linux perf_event_open
+ *              -DPROF_OFF  compile the macros out:  PROF_REPEAT runs
+ *                          its statement warmup + reps times, and the
+ *                          others do nothing, so prof.c isn't needed
+ *
+ * Environment:
+ *    PROF_FORMAT  text (default), csv or json
+ *    PROF_FILE    file for the report (default stderr)
+ */
+#ifndef _PROF_H_
+#define _PROF_H_
+
+#include <stdio.h>
+
+/* Longest path of a region, e.g., "solve/mat_vect" */
+#define PROF_PATH_LEN 128
+/* Deepest nesting of regions in a thread */
+#define PROF_MAX_DEPTH 32
+/* Distinct regions in a thread */
+#define PROF_MAX_REGIONS 128
+/* Threads that can open regions */
+#define PROF_MAX_THREADS 256
+/* Hardware counters:  cycles, instructions, cache misses */
+#define PROF_COUNTERS 3
+
+typedef enum { PROF_TEXT, PROF_CSV, PROF_JSON } prof_format_t;
+
+double Prof_time(void);
+void   Prof_begin(const char* name);
+void   Prof_end(const char* name);
+void   Prof_report(FILE* fp, prof_format_t format);
+void   Prof_report_env(void);
+void   Prof_reset(void);
+
+#ifndef PROF_OFF
+#  define PROF_BEGIN(name)  Prof_begin(name)
+#  define PROF_END(name)    Prof_end(name)
+#  define PROF_REPORT()     Prof_report_env()
+/* Run the following statement warmup + reps times, and time the last
+ * reps runs in region name:  each timed run is one call */
+#  define PROF_REPEAT(name, warmup, reps) \
+   for (int _prof_i = -(warmup); _prof_i < (reps); _prof_i++) \
+      for (int _prof_once = (_prof_i >= 0 ? Prof_begin(name) : (void) 0, 1); \
+            _prof_once; \
+            _prof_once = (_prof_i >= 0 ? Prof_end(name) : (void) 0, 0))
+#else
+#  define PROF_BEGIN(name)
+#  define PROF_END(name)
+#  define PROF_REPORT()
+#  define PROF_REPEAT(name, warmup, reps) \
+   for (int _prof_i = -(warmup); _prof_i < (reps); _prof_i++)
+#endif
+
+#endif
@@ -4,9 +4,10 @@
  *
  * Input:   a, b, n
  * Output:  Estimate of integral from a to b of f(x)
- *          using n trapezoids.
+ *          using n trapezoids.  On stderr, the time for Trap
+ *          (see prof.h)
  *
- * Compile: gcc -g -Wall -o trap trap.c
+ * Compile: gcc -g -Wall -o trap trap.c prof.c -lpthread
  * Usage:   ./trap
  *
  * Note:    The function f(x) is hardwired.
@@ -15,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include "prof.h"
 
 double f(double x);    /* Function we're integrating */
 double Trap(double a, double b, int n, double h);
@@ -31,12 +33,15 @@ int main(void) {
    scanf("%d", &n);
 
    h = (b-a)/n;
+   PROF_BEGIN("trap");
    integral = Trap(a, b, n, h);
+   PROF_END("trap");
    
    printf("With n = %d trapezoids, our estimate\n", n);
    printf("of the integral from %f to %f = %.15f\n",
       a, b, integral);
 
+   PROF_REPORT();
    return 0;
 }  /* main */
 
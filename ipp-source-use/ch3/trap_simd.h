@@ -0,0 +1,106 @@
+/* File:     trap_simd.h
+ *
+ * Purpose:  Define macros that generate trapezoidal rule kernels
+ *           specialised on the integrand, so that the integrand is
+ *           inlined and the loop over the points is vectorised.
+ *
+ * TRAP_KERNEL(name, F) defines
+ *
+ *    double name(double a, double h, long first, long last)
+ *
+ * which returns F(a + first*h) + ... + F(a + (last-1)*h).  F is a
+ * function-like macro or a static inline function of one double.
+ *
+ * TRAP_BATCH_KERNEL(name, F) defines
+ *
+ *    void name(double a, double h, long first, long last,
+ *          const double p[], int k, double sums[])
+ *
+ * which adds F(a + first*h, p[c]) + ... + F(a + (last-1)*h, p[c]) to
+ * sums[c] for c = 0, 1, ..., k-1:  it integrates k parameter sets in
+ * one pass over the points.
+ *
+ * Example:
+ *    #define F(x) ((x)*(x))
+ *    TRAP_KERNEL(Sum_f, F)
+ *    . . .
+ *    approx = (F(a) + F(b))/2.0 + Sum_f(a, h, 1, n);
+ *    approx = h*approx;
+ *
+ * Notes:
+ * 1.  Compile with -fopenmp or -fopenmp-simd, so that the simd
+ *     directives are honored.  Without them, the compiler won't
+ *     reorder the additions, and the sums aren't vectorised.
+ * 2.  The sums are kept in TRAP_ACC partial accumulators, so that
+ *     consecutive additions don't wait for each other.
+ * 3.  The vector loops compute x as x_i + j*h, where j is an int and
+ *     x_i = a + i*h is computed once per iteration of the outer loop:
+ *     converting a long to a double can't be vectorised on most x86
+ *     processors, while converting an int can.
+ * 4.  The batch kernel works on TRAP_BLOCK points at a time:  it
+ *     computes their x values once, and then applies each parameter
+ *     set to them while they're in L1 cache.
+ */
+#ifndef _TRAP_SIMD_H_
+#define _TRAP_SIMD_H_
+
+/* Number of partial accumulators */
+#define TRAP_ACC 16
+
+/* Points per block in the batch kernel */
+#define TRAP_BLOCK 1024
+
+#define TRAP_KERNEL(name, F) \
+static inline double name(double a, double h, long first, long last) { \
+   double acc[TRAP_ACC] = {0.0}; \
+   double sum = 0.0, x_i; \
+   long i; \
+   int j; \
+   \
+   for (i = first; i + TRAP_ACC <= last; i += TRAP_ACC) { \
+      x_i = a + i*h; \
+      _Pragma("omp simd") \
+      for (j = 0; j < TRAP_ACC; j++) \
+         acc[j] += F(x_i + j*h); \
+   } \
+   for (; i < last; i++) \
+      sum += F(a + i*h); \
+   for (j = 0; j < TRAP_ACC; j++) \
+      sum += acc[j]; \
+   return sum; \
+}
+
+#define TRAP_BATCH_KERNEL(name, F) \
+static inline void name(double a, double h, long first, long last, \
+      const double p[], int k, double sums[]) { \
+   double x[TRAP_BLOCK]; \
+   double acc[TRAP_ACC]; \
+   double pc, sum, x_blk; \
+   long blk, i; \
+   int c, j, count; \
+   \
+   for (blk = first; blk < last; blk += TRAP_BLOCK) { \
+      count = (last - blk < TRAP_BLOCK) ? last - blk : TRAP_BLOCK; \
+      x_blk = a + blk*h; \
+      _Pragma("omp simd") \
+      for (j = 0; j < count; j++) \
+         x[j] = x_blk + j*h; \
+      for (c = 0; c < k; c++) { \
+         pc = p[c]; \
+         sum = 0.0; \
+         for (j = 0; j < TRAP_ACC; j++) acc[j] = 0.0; \
+         for (i = 0; i + TRAP_ACC <= count; i += TRAP_ACC) { \
+            _Pragma("omp simd") \
+            for (j = 0; j < TRAP_ACC; j++) \
+               acc[j] += F(x[i+j], pc); \
+         } \
+         for (; i < count; i++) \
+            sum += F(x[i], pc); \
+         for (j = 0; j < TRAP_ACC; j++) \
+            sum += acc[j]; \
+         sums[c] += sum; \
+      } \
+   } \
+}
+
+#endif
@@ -0,0 +1,350 @@
+/* File:     vec_bench.c
+ *
+ * Purpose:  Measure the memory bandwidth of the kernels in
+ *           vec_kernels.c, and compare a chain of kernels done one
+ *           after another with the same chain fused into one
+ *           expression.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -fopenmp -o vec_bench
+ *              vec_bench.c vec_kernels.c -lm -lpthread
+ *           or, for the mpi back end,
+ *           mpicc -g -Wall -O3 -march=native -fopenmp -DUSE_MPI
+ *              -o vec_bench vec_bench.c vec_kernels.c -lm -lpthread
+ * Run:      ./vec_bench <n> <reps> [serial | omp | pth] [thread count]
+ *           (default serial)
+ *           mpiexec -n <p> ./vec_bench <n> <reps> mpi
+ *
+ * Input:    none
+ * Output:   For each test, the minimum time over reps runs and the
+ *           bandwidth it implies, the speedup of the fused chain, and
+ *           the largest relative difference between the results of
+ *           the fused and unfused chains.
+ *
+ * Tests:
+ *    add:      z = x + y.  3n doubles are moved.  If n >= VEC_NT_MIN,
+ *              z is written with streaming stores.
+ *    unfused:  the update in a step of conjugate gradients,
+ *                 x = x + alpha*p, r = r - alpha*q, rr = r.r,
+ *                 p = r + beta*p,
+ *              as four expressions:  3n + 3n + n + 3n = 10n doubles.
+ *    fused:    the same four operations in one expression:  x, p, r
+ *              and q are read once and x, r and p are written once,
+ *              so 7n doubles.
+ *
+ * Notes:
+ * 1.  The bandwidth is the number of bytes the test must move divided
+ *     by the time.  Stores that aren't streaming also read the cache
+ *     line first, so the hardware moves more than this.
+ * 2.  n should be large enough that the vectors don't fit in cache,
+ *     e.g., 2^24 or more.
+ * 3.  Compile with -DVEC_NT_MIN=<n+1> to see the add without
+ *     streaming stores.
+ * 4.  With the mpi back end, n is the order of the global vectors,
+ *     which are block distributed (Vec_block_first), and each
+ *     expression runs with Expr_run_mpi.  The processes start each
+ *     test together (MPI_Barrier), and a test's time is the time of
+ *     the slowest process.  The bandwidth is the total over all the
+ *     processes.
+ *
+ * IPP:  Section 3.4.6 (pp. 109 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "timer.h"
+#include "vec_kernels.h"
+
+#define ALPHA 1.0e-3
+#define BETA 0.5
+
+typedef enum { SERIAL, OMP, PTH, MPI } backend_t;
+
+void Usage(char prog_name[]);
+void Run(vec_expr_t* e, long n, backend_t backend, int thread_count);
+void Init_vectors(double x[], double p[], double r[], double q[], long n,
+      long first);
+void Sync(backend_t backend);
+double Slowest(double elapsed, backend_t backend);
+void Cg_unfused(double x[], double p[], double r[], double q[],
+      double* rr_p, long n, backend_t backend, int thread_count);
+void Cg_fused(double x[], double p[], double r[], double q[],
+      double* rr_p, long n, backend_t backend, int thread_count);
+double Max_rel_diff(double a[], double b[], long n);
+
+int main(int argc, char* argv[]) {
+   long n, local_n, first = 0;
+   int reps, rep, thread_count = 1, streaming = 0, my_rank = 0;
+   backend_t backend = SERIAL;
+   double *x, *p, *r, *q, *x1, *p1, *r1, *z;
+   double rr, rr1, start, finish, elapsed;
+   double add_time, unfused_time, fused_time;
+   double diff;
+   vec_expr_t e;
+
+#  ifdef USE_MPI
+   MPI_Init(&argc, &argv);
+   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+#  endif
+   if (argc < 3 || argc > 5) Usage(argv[0]);
+   n = strtol(argv[1], NULL, 10);
+   reps = strtol(argv[2], NULL, 10);
+   if (argc >= 4) {
+      if (strcmp(argv[3], "omp") == 0)
+         backend = OMP;
+      else if (strcmp(argv[3], "pth") == 0)
+         backend = PTH;
+#     ifdef USE_MPI
+      else if (strcmp(argv[3], "mpi") == 0)
+         backend = MPI;
+#     endif
+      else if (strcmp(argv[3], "serial") != 0)
+         Usage(argv[0]);
+   }
+   if (argc == 5) thread_count = strtol(argv[4], NULL, 10);
+   if (n <= 0 || reps <= 0 || thread_count <= 0) Usage(argv[0]);
+
+   local_n = n;
+#  ifdef USE_MPI
+   if (backend == MPI) {
+      MPI_Comm_size(MPI_COMM_WORLD, &thread_count);
+      first = Vec_block_first(n, my_rank, thread_count);
+      local_n = Vec_block_first(n, my_rank+1, thread_count) - first;
+   }
+#  endif
+
+   x = malloc(local_n*sizeof(double));
+   p = malloc(local_n*sizeof(double));
+   r = malloc(local_n*sizeof(double));
+   q = malloc(local_n*sizeof(double));
+   x1 = malloc(local_n*sizeof(double));
+   p1 = malloc(local_n*sizeof(double));
+   r1 = malloc(local_n*sizeof(double));
+   z = malloc(local_n*sizeof(double));
+
+   /* Check that the fused chain gives the same results */
+   Init_vectors(x, p, r, q, local_n, first);
+   memcpy(x1, x, local_n*sizeof(double));
+   memcpy(p1, p, local_n*sizeof(double));
+   memcpy(r1, r, local_n*sizeof(double));
+   Cg_unfused(x, p, r, q, &rr, local_n, backend, thread_count);
+   Cg_fused(x1, p1, r1, q, &rr1, local_n, backend, thread_count);
+   diff = Max_rel_diff(x, x1, local_n);
+   if (Max_rel_diff(p, p1, local_n) > diff)
+      diff = Max_rel_diff(p, p1, local_n);
+   if (Max_rel_diff(r, r1, local_n) > diff)
+      diff = Max_rel_diff(r, r1, local_n);
+   if (fabs(rr - rr1)/fabs(rr) > diff) diff = fabs(rr - rr1)/fabs(rr);
+#  ifdef USE_MPI
+   if (backend == MPI)
+      MPI_Allreduce(MPI_IN_PLACE, &diff, 1, MPI_DOUBLE, MPI_MAX,
+            MPI_COMM_WORLD);
+#  endif
+
+   add_time = unfused_time = fused_time = 1.0e30;
+   for (rep = 0; rep < reps; rep++) {
+      Expr_init(&e);
+      Expr_add(&e, x, q, z);
+      Sync(backend);
+      GET_TIME(start);
+      Run(&e, local_n, backend, thread_count);
+      GET_TIME(finish);
+      elapsed = Slowest(finish - start, backend);
+      if (elapsed < add_time) add_time = elapsed;
+      streaming = e.ops[0].stream;
+
+      Sync(backend);
+      GET_TIME(start);
+      Cg_unfused(x, p, r, q, &rr, local_n, backend, thread_count);
+      GET_TIME(finish);
+      elapsed = Slowest(finish - start, backend);
+      if (elapsed < unfused_time) unfused_time = elapsed;
+
+      Sync(backend);
+      GET_TIME(start);
+      Cg_fused(x, p, r, q, &rr, local_n, backend, thread_count);
+      GET_TIME(finish);
+      elapsed = Slowest(finish - start, backend);
+      if (elapsed < fused_time) fused_time = elapsed;
+   }
+
+   if (my_rank == 0) {
+      printf("n = %ld, reps = %d, back end = %s, %s = %d\n", n, reps,
+            backend == OMP ? "omp" : backend == PTH ? "pth" :
+            backend == MPI ? "mpi" : "serial",
+            backend == MPI ? "processes" : "threads", thread_count);
+      printf("%-34s %12s %10s\n", "test", "min time (s)", "GB/s");
+      printf("%-34s %12.6f %10.2f\n", streaming ?
+            "add (streaming stores)" : "add (ordinary stores)", add_time,
+            3.0*n*sizeof(double)/add_time/1.0e9);
+      printf("%-34s %12.6f %10.2f\n", "CG update, unfused (4 passes)",
+            unfused_time, 10.0*n*sizeof(double)/unfused_time/1.0e9);
+      printf("%-34s %12.6f %10.2f\n", "CG update, fused (1 pass)",
+            fused_time, 7.0*n*sizeof(double)/fused_time/1.0e9);
+      printf("Fused speedup = %.2f\n", unfused_time/fused_time);
+      printf("Max relative difference, fused vs unfused = %.2e\n", diff);
+   }
+
+   free(x); free(p); free(r); free(q);
+   free(x1); free(p1); free(r1); free(z);
+#  ifdef USE_MPI
+   MPI_Finalize();
+#  endif
+   return 0;
+}  /* main */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message explaining the command line and quit
+ * Note:      With MPI, every process should call Usage
+ */
+void Usage(char prog_name[]) {
+#  ifdef USE_MPI
+   int my_rank;
+
+   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+   if (my_rank == 0) {
+      fprintf(stderr, "usage: %s <n> <reps> [serial | omp | pth] [thread count]\n",
+            prog_name);
+      fprintf(stderr, "   or:  mpiexec -n <p> %s <n> <reps> mpi\n",
+            prog_name);
+   }
+   MPI_Finalize();
+#  else
+   fprintf(stderr, "usage: %s <n> <reps> [serial | omp | pth] [thread count]\n",
+         prog_name);
+#  endif
+   exit(0);
+}  /* Usage */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Run
+ * Purpose:   Evaluate an expression with the chosen back end
+ */
+void Run(vec_expr_t* e, long n, backend_t backend, int thread_count) {
+#  ifdef USE_MPI
+   if (backend == MPI) {
+      Expr_run_mpi(e, n, MPI_COMM_WORLD);
+      return;
+   }
+#  endif
+   if (backend == OMP)
+      Expr_run_omp(e, n, thread_count);
+   else if (backend == PTH)
+      Expr_run_pth(e, n, thread_count);
+   else
+      Expr_run(e, n);
+}  /* Run */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Sync
+ * Purpose:   With the mpi back end, start a test on all the processes
+ *            at the same time
+ */
+void Sync(backend_t backend) {
+#  ifdef USE_MPI
+   if (backend == MPI) MPI_Barrier(MPI_COMM_WORLD);
+#  else
+   (void) backend;
+#  endif
+}  /* Sync */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Slowest
+ * Purpose:   Return the elapsed time of a test:  with the mpi back end,
+ *            the largest over the processes
+ */
+double Slowest(double elapsed, backend_t backend) {
+   double max = elapsed;
+
+#  ifdef USE_MPI
+   if (backend == MPI)
+      MPI_Allreduce(&elapsed, &max, 1, MPI_DOUBLE, MPI_MAX,
+            MPI_COMM_WORLD);
+#  else
+   (void) backend;
+#  endif
+   return max;
+}  /* Slowest */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Init_vectors
+ * Purpose:   Give the vectors values that aren't all the same.  x[0] is
+ *            element first of the global vector.
+ */
+void Init_vectors(double x[], double p[], double r[], double q[],
+      long n, long first) {
+   long i;
+
+   for (i = 0; i < n; i++) {
+      x[i] = 0.0;
+      p[i] = 1.0 + ((first + i) % 7);
+      r[i] = p[i];
+      q[i] = 2.0 - ((first + i) % 5);
+   }
+}  /* Init_vectors */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Cg_unfused
+ * Purpose:   x = x + alpha*p, r = r - alpha*q, rr = r.r,
+ *            p = r + beta*p, one operation at a time
+ */
+void Cg_unfused(double x[], double p[], double r[], double q[],
+      double* rr_p, long n, backend_t backend, int thread_count) {
+   vec_expr_t e;
+
+   Expr_init(&e);
+   Expr_axpy(&e, ALPHA, p, x);
+   Run(&e, n, backend, thread_count);
+
+   Expr_init(&e);
+   Expr_axpy(&e, -ALPHA, q, r);
+   Run(&e, n, backend, thread_count);
+
+   Expr_init(&e);
+   Expr_dot(&e, r, r, rr_p);
+   Run(&e, n, backend, thread_count);
+
+   Expr_init(&e);
+   Expr_axpby(&e, 1.0, r, BETA, p);
+   Run(&e, n, backend, thread_count);
+}  /* Cg_unfused */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Cg_fused
+ * Purpose:   The same operations as Cg_unfused, in one expression
+ */
+void Cg_fused(double x[], double p[], double r[], double q[],
+      double* rr_p, long n, backend_t backend, int thread_count) {
+   vec_expr_t e;
+
+   Expr_init(&e);
+   Expr_axpy(&e, ALPHA, p, x);
+   Expr_axpy(&e, -ALPHA, q, r);
+   Expr_dot(&e, r, r, rr_p);
+   Expr_axpby(&e, 1.0, r, BETA, p);
+   Run(&e, n, backend, thread_count);
+}  /* Cg_fused */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Max_rel_diff
+ * Purpose:   Return max |a[i] - b[i]|/max(|a[i]|, 1)
+ */
+double Max_rel_diff(double a[], double b[], long n) {
+   long i;
+   double diff, max = 0.0;
+
+   for (i = 0; i < n; i++) {
+      diff = fabs(a[i] - b[i])/fmax(fabs(a[i]), 1.0);
+      if (diff > max) max = diff;
+   }
+   return max;
+}  /* Max_rel_diff */
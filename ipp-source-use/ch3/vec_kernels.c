@@ -0,0 +1,515 @@
+/* File:     vec_kernels.c
+ *
+ * Purpose:  Vector (BLAS-1) kernels that can be chained into
+ *           expressions, so that a sequence of operations on long
+ *           vectors makes one pass over memory instead of one pass per
+ *           operation.
+ *
+ * Expressions:
+ *    An expression is a list of up to VEC_MAX_OPS operations:
+ *
+ *       Expr_add:    z = x + y
+ *       Expr_scale:  z = a*x
+ *       Expr_axpy:   z = a*x + z
+ *       Expr_axpby:  z = a*x + b*z
+ *       Expr_dot:    *result_p = x . y
+ *
+ *    The vectors are split into strips of VEC_STRIP elements, and
+ *    every operation is applied to a strip before the next strip is
+ *    started.  So each vector is loaded from memory once, and a vector
+ *    written by one operation is still in L1 cache when a later one
+ *    reads it.  Each operation on a strip is a simple loop that the
+ *    compiler vectorises.
+ *
+ *    Example:  one step of conjugate gradients with given alpha and
+ *    beta,
+ *
+ *       vec_expr_t e;
+ *       double rr;
+ *       Expr_init(&e);
+ *       Expr_axpy(&e, alpha, p, x);      // x = x + alpha*p
+ *       Expr_axpy(&e, -alpha, q, r);     // r = r - alpha*q
+ *       Expr_dot(&e, r, r, &rr);         // rr = r . r
+ *       Expr_axpby(&e, 1.0, r, beta, p); // p = r + beta*p
+ *       Expr_run_omp(&e, n, thread_count);
+ *
+ *    reads x, p, r and q once and writes x, r and p once:  7n doubles
+ *    against 10n if the four operations are done one after another.
+ *
+ * Back ends:
+ *    Expr_run:      serial
+ *    Expr_run_omp:  OpenMP threads (serial if compiled without OpenMP)
+ *    Expr_run_pth:  Pthreads
+ *    Expr_run_mpi:  MPI processes (compile with -DUSE_MPI).  The
+ *                   vectors are each process' local vectors.
+ *    The threaded back ends give thread t the elements
+ *    Vec_block_first(n, t, p), ..., Vec_block_first(n, t+1, p) - 1,
+ *    and an MPI program can use the same function for its local
+ *    vectors.  The threaded back ends add the partial dot products in
+ *    thread order, so the results don't depend on the scheduling.
+ *    Expr_run_mpi adds them with MPI_Allreduce, and the order of those
+ *    additions is up to the MPI implementation.  vec_bench.c times
+ *    all four back ends.
+ *
+ * Single kernels:
+ *    Vec_add, Vec_scale, Vec_axpy, Vec_dot, Vec_norm and
+ *    Vec_axpby_dot (y = a*x + b*y followed by y . w) run one-operation
+ *    (or two-operation) expressions with Expr_run.
+ *
+ * Compile:  Add vec_kernels.c and -O3 -fopenmp (or -fopenmp-simd) to
+ *           the compile command of the program, and -lpthread for
+ *           Expr_run_pth.  Add -DUSE_MPI with mpicc for Expr_run_mpi.
+ *
+ * Notes:
+ * 1.  The simd directives tell the compiler it may reorder the
+ *     additions in the dot products.  Without -fopenmp or
+ *     -fopenmp-simd they're ignored and the dot products aren't
+ *     vectorised.
+ * 2.  When the vectors have at least VEC_NT_MIN elements, the output
+ *     of an add or a scale that no later operation in the expression
+ *     reads or writes is written with SSE2 non-temporal stores.  These
+ *     go straight to memory:  the cache lines aren't read first, and
+ *     the vectors that will be read again aren't evicted.  An axpy or
+ *     axpby reads its output, so it uses ordinary stores.
+ * 3.  Vectors may be the same or overlap exactly (e.g. z = a*z), but
+ *     shouldn't partially overlap.
+ * 4.  The sums in the dot products are done in a different order for
+ *     different strip boundaries and numbers of threads, so the
+ *     results can differ in the last few bits.
+ *
+ * IPP:  Section 3.4.6 (pp. 109 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "vec_kernels.h"
+
+typedef struct {
+   vec_expr_t*  e;
+   long         n;
+   int          rank;
+   int          thread_count;
+   double*      partials;
+}  vec_thread_arg_t;
+
+static void Add_op(vec_expr_t* e, vec_op_code_t code, double a, double b,
+      const double x[], const double y[], double z[], double* result_p);
+static void Mark_streaming(vec_expr_t* e, long n);
+static void Run_range(vec_expr_t* e, long first, long last,
+      double partials[]);
+static void Store_results(vec_expr_t* e, double sums[]);
+static void* Pth_run(void* arg);
+
+
+/*---------------------------------------------------------------------
+ * Function:  Vec_block_first
+ * Purpose:   Find the first element of block b when n elements are
+ *            split into p blocks whose sizes differ by at most 1
+ */
+long Vec_block_first(long n, int b, int p) {
+   return (long) ((__int128) n*b/p);
+}  /* Vec_block_first */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Expr_init
+ * Purpose:   Make e an empty expression
+ */
+void Expr_init(vec_expr_t* e) {
+   e->op_count = 0;
+   e->dot_count = 0;
+}  /* Expr_init */
+
+
+/*---------------------------------------------------------------------
+ * Functions:  Expr_add, Expr_scale, Expr_axpy, Expr_axpby, Expr_dot
+ * Purpose:    Append an operation to an expression
+ */
+void Expr_add(vec_expr_t* e, const double x[], const double y[],
+      double z[]) {
+   Add_op(e, VEC_ADD, 0.0, 0.0, x, y, z, NULL);
+}  /* Expr_add */
+
+void Expr_scale(vec_expr_t* e, double a, const double x[], double z[]) {
+   Add_op(e, VEC_SCALE, a, 0.0, x, NULL, z, NULL);
+}  /* Expr_scale */
+
+void Expr_axpy(vec_expr_t* e, double a, const double x[], double z[]) {
+   Add_op(e, VEC_AXPY, a, 1.0, x, NULL, z, NULL);
+}  /* Expr_axpy */
+
+void Expr_axpby(vec_expr_t* e, double a, const double x[], double b,
+      double z[]) {
+   Add_op(e, VEC_AXPBY, a, b, x, NULL, z, NULL);
+}  /* Expr_axpby */
+
+void Expr_dot(vec_expr_t* e, const double x[], const double y[],
+      double* result_p) {
+   Add_op(e, VEC_DOT, 0.0, 0.0, x, y, NULL, result_p);
+   e->dot_count++;
+}  /* Expr_dot */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Expr_run
+ * Purpose:   Evaluate an expression on elements 0, 1, ..., n-1
+ */
+void Expr_run(vec_expr_t* e, long n) {
+   double sums[VEC_MAX_OPS];
+
+   Mark_streaming(e, n);
+   Run_range(e, 0, n, sums);
+   Store_results(e, sums);
+}  /* Expr_run */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Expr_run_omp
+ * Purpose:   Evaluate an expression on elements 0, 1, ..., n-1 with
+ *            thread_count OpenMP threads
+ */
+void Expr_run_omp(vec_expr_t* e, long n, int thread_count) {
+#  ifdef _OPENMP
+   double sums[VEC_MAX_OPS];
+   double* partials = malloc(thread_count*VEC_MAX_OPS*sizeof(double));
+   int t, d;
+
+   Mark_streaming(e, n);
+#  pragma omp parallel num_threads(thread_count)
+   {
+      int my_rank = omp_get_thread_num();
+
+      Run_range(e, Vec_block_first(n, my_rank, thread_count),
+            Vec_block_first(n, my_rank+1, thread_count),
+            partials + my_rank*VEC_MAX_OPS);
+   }
+   for (d = 0; d < e->dot_count; d++) {
+      sums[d] = 0.0;
+      for (t = 0; t < thread_count; t++)
+         sums[d] += partials[t*VEC_MAX_OPS + d];
+   }
+   Store_results(e, sums);
+   free(partials);
+#  else
+   Expr_run(e, n);
+#  endif
+}  /* Expr_run_omp */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Expr_run_pth
+ * Purpose:   Evaluate an expression on elements 0, 1, ..., n-1 with
+ *            thread_count Pthreads
+ * Note:      The threads are started and joined by each call
+ */
+void Expr_run_pth(vec_expr_t* e, long n, int thread_count) {
+   double sums[VEC_MAX_OPS];
+   double* partials = malloc(thread_count*VEC_MAX_OPS*sizeof(double));
+   pthread_t* thread_handles = malloc(thread_count*sizeof(pthread_t));
+   vec_thread_arg_t* args = malloc(thread_count*sizeof(vec_thread_arg_t));
+   int t, d;
+
+   Mark_streaming(e, n);
+   for (t = 0; t < thread_count; t++) {
+      args[t].e = e;
+      args[t].n = n;
+      args[t].rank = t;
+      args[t].thread_count = thread_count;
+      args[t].partials = partials + t*VEC_MAX_OPS;
+      pthread_create(&thread_handles[t], NULL, Pth_run, &args[t]);
+   }
+   for (t = 0; t < thread_count; t++)
+      pthread_join(thread_handles[t], NULL);
+
+   for (d = 0; d < e->dot_count; d++) {
+      sums[d] = 0.0;
+      for (t = 0; t < thread_count; t++)
+         sums[d] += partials[t*VEC_MAX_OPS + d];
+   }
+   Store_results(e, sums);
+
+   free(args);
+   free(thread_handles);
+   free(partials);
+}  /* Expr_run_pth */
+
+
+#ifdef USE_MPI
+/*---------------------------------------------------------------------
+ * Function:  Expr_run_mpi
+ * Purpose:   Evaluate an expression on each process' local vectors,
+ *            which have local_n elements, and add the dot products
+ *            over all the processes in comm
+ * Note:      All the processes in comm should call Expr_run_mpi with
+ *            the same operations.  The sums are done by MPI_Allreduce,
+ *            so they aren't necessarily in rank order, but every
+ *            process gets the same results.
+ */
+void Expr_run_mpi(vec_expr_t* e, long local_n, MPI_Comm comm) {
+   double partials[VEC_MAX_OPS], sums[VEC_MAX_OPS];
+
+   Mark_streaming(e, local_n);
+   Run_range(e, 0, local_n, partials);
+   if (e->dot_count > 0)
+      MPI_Allreduce(partials, sums, e->dot_count, MPI_DOUBLE, MPI_SUM,
+            comm);
+   Store_results(e, sums);
+}  /* Expr_run_mpi */
+#endif
+
+
+/*---------------------------------------------------------------------
+ * Functions:  Vec_add, Vec_scale, Vec_axpy, Vec_dot, Vec_norm,
+ *             Vec_axpby_dot
+ * Purpose:    Single kernels:  z = x + y, z = a*x, y = a*x + y,
+ *             x . y, sqrt(x . x), and y = a*x + b*y followed by y . w
+ */
+void Vec_add(const double x[], const double y[], double z[], long n) {
+   vec_expr_t e;
+
+   Expr_init(&e);
+   Expr_add(&e, x, y, z);
+   Expr_run(&e, n);
+}  /* Vec_add */
+
+void Vec_scale(double a, const double x[], double z[], long n) {
+   vec_expr_t e;
+
+   Expr_init(&e);
+   Expr_scale(&e, a, x, z);
+   Expr_run(&e, n);
+}  /* Vec_scale */
+
+void Vec_axpy(double a, const double x[], double y[], long n) {
+   vec_expr_t e;
+
+   Expr_init(&e);
+   Expr_axpy(&e, a, x, y);
+   Expr_run(&e, n);
+}  /* Vec_axpy */
+
+double Vec_dot(const double x[], const double y[], long n) {
+   vec_expr_t e;
+   double dot;
+
+   Expr_init(&e);
+   Expr_dot(&e, x, y, &dot);
+   Expr_run(&e, n);
+   return dot;
+}  /* Vec_dot */
+
+double Vec_norm(const double x[], long n) {
+   return sqrt(Vec_dot(x, x, n));
+}  /* Vec_norm */
+
+double Vec_axpby_dot(double a, const double x[], double b, double y[],
+      const double w[], long n) {
+   vec_expr_t e;
+   double dot;
+
+   Expr_init(&e);
+   Expr_axpby(&e, a, x, b, y);
+   Expr_dot(&e, y, w, &dot);
+   Expr_run(&e, n);
+   return dot;
+}  /* Vec_axpby_dot */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Add_op
+ * Purpose:   Append an operation to an expression
+ * Errors:    If the expression already has VEC_MAX_OPS operations,
+ *            the program terminates
+ */
+static void Add_op(vec_expr_t* e, vec_op_code_t code, double a, double b,
+      const double x[], const double y[], double z[], double* result_p) {
+   vec_op_t* op;
+
+   if (e->op_count == VEC_MAX_OPS) {
+      fprintf(stderr, "An expression can have at most %d operations\n",
+            VEC_MAX_OPS);
+      exit(-1);
+   }
+   op = &e->ops[e->op_count++];
+   op->code = code;
+   op->a = a;
+   op->b = b;
+   op->x = x;
+   op->y = y;
+   op->z = z;
+   op->result_p = result_p;
+   op->stream = 0;
+}  /* Add_op */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Mark_streaming
+ * Purpose:   Decide which outputs are written with non-temporal
+ *            stores:  the outputs of adds and scales on at least
+ *            VEC_NT_MIN elements that no later operation uses
+ */
+static void Mark_streaming(vec_expr_t* e, long n) {
+   int k, j;
+   vec_op_t *op, *later;
+
+   for (k = 0; k < e->op_count; k++) {
+      op = &e->ops[k];
+      op->stream = (n >= VEC_NT_MIN &&
+            (op->code == VEC_ADD || op->code == VEC_SCALE));
+      for (j = k+1; j < e->op_count && op->stream; j++) {
+         later = &e->ops[j];
+         if (later->x == op->z || later->y == op->z || later->z == op->z)
+            op->stream = 0;
+      }
+   }
+}  /* Mark_streaming */
+
+
+/*---------------------------------------------------------------------
+ * Functions:  Add_strip, Scale_strip
+ * Purpose:    z = x + y and z = a*x on len elements, with
+ *             non-temporal stores if stream is nonzero
+ */
+static inline void Add_strip(const double x[], const double y[],
+      double z[], long len, int stream) {
+   long i = 0, j;
+
+#  ifdef __SSE2__
+   if (stream) {
+      /* _mm_stream_pd needs a 16-byte aligned address */
+      if (((uintptr_t) z & 15) != 0 && len > 0) {
+         z[0] = x[0] + y[0];
+         i = 1;
+      }
+      for (; i + 2 <= len; i += 2)
+         _mm_stream_pd(z + i,
+               _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+   }
+#  endif
+#  pragma omp simd
+   for (j = i; j < len; j++)
+      z[j] = x[j] + y[j];
+}  /* Add_strip */
+
+static inline void Scale_strip(double a, const double x[], double z[],
+      long len, int stream) {
+   long i = 0, j;
+
+#  ifdef __SSE2__
+   if (stream) {
+      __m128d av = _mm_set1_pd(a);
+
+      if (((uintptr_t) z & 15) != 0 && len > 0) {
+         z[0] = a*x[0];
+         i = 1;
+      }
+      for (; i + 2 <= len; i += 2)
+         _mm_stream_pd(z + i, _mm_mul_pd(av, _mm_loadu_pd(x + i)));
+   }
+#  endif
+#  pragma omp simd
+   for (j = i; j < len; j++)
+      z[j] = a*x[j];
+}  /* Scale_strip */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Run_range
+ * Purpose:   Evaluate an expression on elements first, ..., last-1,
+ *            one strip at a time
+ * Out arg:   partials:  the dot products over these elements, in the
+ *                       order they were added to the expression
+ */
+static void Run_range(vec_expr_t* e, long first, long last,
+      double partials[]) {
+   long s, len, i;
+   int k, d;
+   double sum, a, b;
+   const double *x, *y;
+   double* z;
+   vec_op_t* op;
+
+   for (d = 0; d < e->dot_count; d++)
+      partials[d] = 0.0;
+
+   for (s = first; s < last; s += VEC_STRIP) {
+      len = (last - s < VEC_STRIP) ? last - s : VEC_STRIP;
+      d = 0;
+      for (k = 0; k < e->op_count; k++) {
+         op = &e->ops[k];
+         a = op->a;
+         b = op->b;
+         x = op->x + s;
+         y = (op->y != NULL) ? op->y + s : NULL;
+         z = (op->z != NULL) ? op->z + s : NULL;
+         switch (op->code) {
+            case VEC_ADD:
+               Add_strip(x, y, z, len, op->stream);
+               break;
+            case VEC_SCALE:
+               Scale_strip(a, x, z, len, op->stream);
+               break;
+            case VEC_AXPY:
+#              pragma omp simd
+               for (i = 0; i < len; i++)
+                  z[i] += a*x[i];
+               break;
+            case VEC_AXPBY:
+#              pragma omp simd
+               for (i = 0; i < len; i++)
+                  z[i] = a*x[i] + b*z[i];
+               break;
+            case VEC_DOT:
+               sum = 0.0;
+#              pragma omp simd reduction(+: sum)
+               for (i = 0; i < len; i++)
+                  sum += x[i]*y[i];
+               partials[d++] += sum;
+               break;
+         }
+      }
+   }
+
+#  ifdef __SSE2__
+   /* Make the streaming stores visible before other threads or
+    * processes look at the outputs */
+   _mm_sfence();
+#  endif
+}  /* Run_range */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Store_results
+ * Purpose:   Copy the dot products to the variables given to Expr_dot
+ */
+static void Store_results(vec_expr_t* e, double sums[]) {
+   int k, d = 0;
+
+   for (k = 0; k < e->op_count; k++)
+      if (e->ops[k].code == VEC_DOT)
+         *(e->ops[k].result_p) = sums[d++];
+}  /* Store_results */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Pth_run
+ * Purpose:   Thread function for Expr_run_pth:  evaluate the
+ *            expression on the thread's block
+ */
+static void* Pth_run(void* arg) {
+   vec_thread_arg_t* my_arg = arg;
+
+   Run_range(my_arg->e,
+         Vec_block_first(my_arg->n, my_arg->rank, my_arg->thread_count),
+         Vec_block_first(my_arg->n, my_arg->rank+1, my_arg->thread_count),
+         my_arg->partials);
+   return NULL;
+}  /* Pth_run */
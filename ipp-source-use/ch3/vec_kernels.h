@@ -0,0 +1,88 @@
+/* File:     vec_kernels.h
+ * Purpose:  Header file for vec_kernels.c, which implements vector
+ *           (BLAS-1) kernels, and expressions that chain several of
+ *           them so that they're done in one pass over memory, with
+ *           serial, OpenMP, Pthreads and MPI back ends.
+ */
+#ifndef _VEC_KERNELS_H_
+#define _VEC_KERNELS_H_
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+/* Maximum number of operations in an expression */
+#define VEC_MAX_OPS 16
+
+/* Elements per strip:  an expression applies all of its operations
+ * to one strip before going on to the next, so 8 KB of each vector
+ * is still in L1 cache when the next operation reads it */
+#define VEC_STRIP 1024
+
+/* Outputs of at least this many elements are written with
+ * non-temporal (streaming) stores, when nothing else in the
+ * expression reads them.  Should be bigger than the last level
+ * cache. */
+#ifndef VEC_NT_MIN
+#define VEC_NT_MIN (1L << 21)
+#endif
+
+typedef enum {
+   VEC_ADD,      /* z = x + y             */
+   VEC_SCALE,    /* z = a*x               */
+   VEC_AXPY,     /* z = a*x + z           */
+   VEC_AXPBY,    /* z = a*x + b*z         */
+   VEC_DOT       /* *result_p = x . y     */
+} vec_op_code_t;
+
+typedef struct {
+   vec_op_code_t  code;
+   double         a, b;
+   const double*  x;
+   const double*  y;
+   double*        z;
+   double*        result_p;
+   int            stream;       /* 1 if z is written with streaming stores */
+}  vec_op_t;
+
+typedef struct {
+   vec_op_t  ops[VEC_MAX_OPS];
+   int       op_count;
+   int       dot_count;
+}  vec_expr_t;
+
+/* Block distribution shared by all the back ends:  block b of n
+ * elements split into p blocks starts at Vec_block_first(n, b, p) */
+long Vec_block_first(long n, int b, int p);
+
+/* Building expressions.  The operations are done in the order they
+ * are added, element by element, so an operation can use the output
+ * of an earlier one. */
+void Expr_init(vec_expr_t* e);
+void Expr_add(vec_expr_t* e, const double x[], const double y[],
+      double z[]);
+void Expr_scale(vec_expr_t* e, double a, const double x[], double z[]);
+void Expr_axpy(vec_expr_t* e, double a, const double x[], double z[]);
+void Expr_axpby(vec_expr_t* e, double a, const double x[], double b,
+      double z[]);
+void Expr_dot(vec_expr_t* e, const double x[], const double y[],
+      double* result_p);
+
+/* Running expressions on elements 0, 1, ..., n-1 */
+void Expr_run(vec_expr_t* e, long n);
+void Expr_run_omp(vec_expr_t* e, long n, int thread_count);
+void Expr_run_pth(vec_expr_t* e, long n, int thread_count);
+#ifdef USE_MPI
+void Expr_run_mpi(vec_expr_t* e, long local_n, MPI_Comm comm);
+#endif
+
+/* Single kernels */
+void   Vec_add(const double x[], const double y[], double z[], long n);
+void   Vec_scale(double a, const double x[], double z[], long n);
+void   Vec_axpy(double a, const double x[], double y[], long n);
+double Vec_dot(const double x[], const double y[], long n);
+double Vec_norm(const double x[], long n);
+double Vec_axpby_dot(double a, const double x[], double b, double y[],
+      const double w[], long n);
+
+#endif
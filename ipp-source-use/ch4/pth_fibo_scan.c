@@ -0,0 +1,213 @@
+/* File:
+ *     pth_fibo_scan.c
+ *
+ * Purpose:
+ *     Compute n Fibonacci numbers with Pthreads, using a scan of 2x2
+ *     matrices to break the dependence of each number on the two
+ *     before it.
+ *
+ * Input:
+ *     none
+ * Output:
+ *     The last Fibonacci number, the run times of the parallel and
+ *     the serial loops, and whether their results agree.  With p, a
+ *     list of all the Fibonacci numbers.
+ *
+ * Compile:  gcc -g -Wall -O2 -o pth_fibo_scan pth_fibo_scan.c -lpthread
+ *           timer.h and scan.h must be available
+ * Usage:
+ *     pth_fibo_scan <thread_count> <n> [p]
+ *
+ * Algorithm:
+ *     With v[i] = (fibo[i], fibo[i-1]) and M = |1 1|, v[i] = M*v[i-1].
+ *                                              |1 0|
+ *     Each thread finds the matrix of its block of indices, M^(block
+ *     size), and stores it in blocks[my_rank].  After a barrier, it
+ *     multiplies the matrices of the lower ranked blocks (scan.h) to
+ *     get the pair of numbers just before its block, and runs the
+ *     serial loop over its block.  See ../ch5/omp_fibo_scan.c.
+ *
+ * Notes:
+ *     1.  The arithmetic is unsigned and mod 2^64.
+ *     2.  The barrier is a condition variable barrier, as in
+ *         pth_cond_bar.c.
+ *
+ * IPP:    Section 4.8 (pp. 176 and ff.) and Section 5.5.2 (pp. 227
+ *         and ff.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "timer.h"
+#include "scan.h"
+
+/* Global variables */
+int     thread_count;
+long    n;
+unsigned long long* fibo;
+mat2_t* blocks;
+
+/* Barrier */
+int barrier_thread_count = 0;
+int barrier_cycle = 0;
+pthread_mutex_t barrier_mutex;
+pthread_cond_t ok_to_proceed;
+
+void Usage(char* prog_name);
+void Fibo_serial(unsigned long long check[]);
+void Barrier(void);
+void *Fibo_scan(void* rank);  /* Thread function */
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long       thread, i;
+   pthread_t* thread_handles;
+   unsigned long long* check;
+   double     start, finish, par_time, ser_time;
+
+   if (argc != 3 && argc != 4) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   n = strtol(argv[2], NULL, 10);
+   if (thread_count <= 0 || n <= 0) Usage(argv[0]);
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   blocks = malloc(thread_count*sizeof(mat2_t));
+   fibo = malloc(n*sizeof(unsigned long long));
+   check = malloc(n*sizeof(unsigned long long));
+   pthread_mutex_init(&barrier_mutex, NULL);
+   pthread_cond_init(&ok_to_proceed, NULL);
+
+   GET_TIME(start);
+   fibo[0] = 1;
+   if (n > 1) fibo[1] = 1;
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         Fibo_scan, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+   par_time = finish - start;
+
+   GET_TIME(start);
+   Fibo_serial(check);
+   GET_TIME(finish);
+   ser_time = finish - start;
+
+   if (argc == 4 && argv[3][0] == 'p') {
+      printf("The first n Fibonacci numbers (mod 2^64):\n");
+      for (i = 0; i < n; i++)
+         printf("%ld\t%llu\n", i, fibo[i]);
+   }
+   printf("fibo[%ld] = %llu (mod 2^64)\n", n-1, fibo[n-1]);
+   for (i = 0; i < n; i++)
+      if (fibo[i] != check[i]) break;
+   if (i < n)
+      printf("The parallel and serial results differ at %ld\n", i);
+   else
+      printf("The parallel and serial results agree\n");
+   printf("Parallel:  %e seconds\n", par_time);
+   printf("Serial:    %e seconds\n", ser_time);
+
+   pthread_mutex_destroy(&barrier_mutex);
+   pthread_cond_destroy(&ok_to_proceed);
+   free(check);
+   free(fibo);
+   free(blocks);
+   free(thread_handles);
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print command line for function and terminate
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <n> [p]\n", prog_name);
+   fprintf(stderr, "   n:  number of Fibonacci numbers\n");
+   fprintf(stderr, "   p:  print all the numbers\n");
+   exit(0);
+}  /* Usage */
+
+
+/*------------------------------------------------------------------
+ * Function:  Fibo_serial
+ * Purpose:   Compute the Fibonacci numbers with a serial loop
+ * Out arg:   check
+ * Global:    n
+ */
+void Fibo_serial(unsigned long long check[]) {
+   long i;
+
+   check[0] = 1;
+   if (n > 1) check[1] = 1;
+   for (i = 2; i < n; i++)
+      check[i] = check[i-1] + check[i-2];
+}  /* Fibo_serial */
+
+
+/*------------------------------------------------------------------
+ * Function:    Barrier
+ * Purpose:     Wait until all thread_count threads have called Barrier
+ * Globals:     barrier_thread_count, barrier_cycle, barrier_mutex,
+ *              ok_to_proceed
+ * Note:        A thread waits until barrier_cycle changes, so a
+ *              spurious wakeup doesn't let it through early.
+ */
+void Barrier(void) {
+   int my_cycle;
+
+   pthread_mutex_lock(&barrier_mutex);
+   my_cycle = barrier_cycle;
+   barrier_thread_count++;
+   if (barrier_thread_count == thread_count) {
+      barrier_thread_count = 0;
+      barrier_cycle++;
+      pthread_cond_broadcast(&ok_to_proceed);
+   } else {
+      while (barrier_cycle == my_cycle)
+         pthread_cond_wait(&ok_to_proceed, &barrier_mutex);
+   }
+   pthread_mutex_unlock(&barrier_mutex);
+}  /* Barrier */
+
+
+/*------------------------------------------------------------------
+ * Function:       Fibo_scan
+ * Purpose:        Thread function:  compute the Fibonacci numbers in
+ *                 my block of the indices 2, ..., n-1
+ * In arg:         rank
+ * Global vars:    n, thread_count (in), blocks (in/out), fibo (out)
+ * Return val:     Ignored
+ */
+void *Fibo_scan(void* rank) {
+   long my_rank = (long) rank;
+   const mat2_t M = {1, 1, 1, 0};
+   long my_first, my_last, i;
+   unsigned long long prev, prev2, next;
+   mat2_t carry;
+
+   if (n <= 2) return NULL;
+   my_first = 2 + Scan_first(n-2, my_rank, thread_count);
+   my_last = 2 + Scan_first(n-2, my_rank+1, thread_count);
+
+   blocks[my_rank] = Mat2_pow(M, my_last - my_first);
+   Barrier();
+
+   /* carry maps (fibo[1], fibo[0]) to (fibo[my_first-1],
+    * fibo[my_first-2]) */
+   carry = Mat2_reduce(blocks, 0, my_rank, MAT2_IDENTITY);
+   prev = carry.a + carry.b;
+   prev2 = carry.c + carry.d;
+   for (i = my_first; i < my_last; i++) {
+      next = prev + prev2;
+      fibo[i] = next;
+      prev2 = prev;
+      prev = next;
+   }
+
+   return NULL;
+}  /* Fibo_scan */
@@ -0,0 +1,262 @@
+/* File:
+ *     pth_mat_vect_batch.c
+ *
+ * Purpose:
+ *     Computes a parallel "batched" matrix-vector product Y = AX,
+ *     where A is m x n and X is an n x k matrix whose columns are
+ *     k different vectors x.  A is streamed from memory once for
+ *     the whole batch instead of once per vector:  each element
+ *     A[i][j] is loaded once and used for all k columns of X.  The
+ *     matrix A is distributed by block rows.
+ *
+ * Input:
+ *     none
+ *
+ * Output:
+ *     Elapsed time for the computation, GFLOP/s, and the arithmetic
+ *     intensity (flops per byte of compulsory memory traffic) of the
+ *     batched product compared to k separate matrix-vector products
+ *
+ * Compile:
+ *    gcc -g -Wall -O3 -fopenmp-simd -o pth_mat_vect_batch
+ *          pth_mat_vect_batch.c -lpthread
+ * Usage:
+ *     pth_mat_vect_batch <thread_count> <m> <n> <k>
+ *
+ * Notes:
+ *     1.  Storage for A, X, Y is dynamically allocated.
+ *     2.  Number of threads (thread_count) should evenly divide
+ *         m.  The program doesn't check for this.
+ *     3.  We use 1-dimensional arrays for A, X and Y.  A is stored
+ *         by rows, A[i][j] = A[i*n + j].  X and Y are also stored by
+ *         rows, so that the k entries X[j][0], ..., X[j][k-1] that
+ *         are multiplied by A[i][j] are contiguous:  X[j][c] =
+ *         X[j*k + c] and Y[i][c] = Y[i*k + c].  The innermost loop
+ *         runs over c and is vectorized (SIMD across the batch).
+ *     4.  The columns of A are processed in blocks of col_block
+ *         columns, where col_block*k doubles of X fit in
+ *         X_CACHE_BYTES bytes (default 128 KB, override with
+ *         -DX_CACHE_BYTES=<bytes>).  So the block of X stays in
+ *         cache while every row of A is streamed past it.
+ *     5.  Compile with -DDEBUG for information on generated data
+ *         and product.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "timer.h"
+
+#ifndef X_CACHE_BYTES
+#define X_CACHE_BYTES (128*1024)
+#endif
+
+/* Global variables */
+int     thread_count;
+int     m, n, k;
+double* A;
+double* X;
+double* Y;
+
+/* Serial functions */
+void Usage(char* prog_name);
+void Gen_matrix(double A[], int m, int n);
+void Print_matrix(char* title, double A[], int m, int n);
+int  Col_block(int k);
+void Mat_mult_rows(double* restrict A, double* restrict X,
+      double* restrict Y, int first_row, int last_row, int n, int k);
+void Print_stats(double elapsed, int m, int n, int k);
+
+/* Parallel function */
+void *Pth_mat_vect_batch(void* rank);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long       thread;
+   pthread_t* thread_handles;
+   double     start, finish;
+
+   if (argc != 5) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   m = strtol(argv[2], NULL, 10);
+   n = strtol(argv[3], NULL, 10);
+   k = strtol(argv[4], NULL, 10);
+   if (thread_count <= 0 || m <= 0 || n <= 0 || k <= 0) Usage(argv[0]);
+
+#  ifdef DEBUG
+   printf("thread_count =  %d, m = %d, n = %d, k = %d\n",
+         thread_count, m, n, k);
+#  endif
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   A = malloc((size_t) m*n*sizeof(double));
+   X = malloc((size_t) n*k*sizeof(double));
+   Y = malloc((size_t) m*k*sizeof(double));
+
+   Gen_matrix(A, m, n);
+   Gen_matrix(X, n, k);
+#  ifdef DEBUG
+   Print_matrix("We generated A", A, m, n);
+   Print_matrix("We generated X", X, n, k);
+#  endif
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         Pth_mat_vect_batch, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+
+#  ifdef DEBUG
+   Print_matrix("The product is", Y, m, k);
+#  endif
+   Print_stats(finish - start, m, n, k);
+
+   free(A);
+   free(X);
+   free(Y);
+   free(thread_handles);
+
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   print a message showing what the command line should
+ *            be, and terminate
+ * In arg :   prog_name
+ */
+void Usage (char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <m> <n> <k>\n", prog_name);
+   fprintf(stderr, "   k = number of vectors in the batch\n");
+   exit(0);
+}  /* Usage */
+
+/*------------------------------------------------------------------
+ * Function: Gen_matrix
+ * Purpose:  Use the random number generator random to generate
+ *    the entries in an m x n matrix
+ * In args:  m, n
+ * Out arg:  A
+ */
+void Gen_matrix(double A[], int m, int n) {
+   int i, j;
+   for (i = 0; i < m; i++)
+      for (j = 0; j < n; j++)
+         A[(size_t) i*n+j] = random()/((double) RAND_MAX);
+}  /* Gen_matrix */
+
+/*------------------------------------------------------------------
+ * Function:  Col_block
+ * Purpose:   Find the number of columns of A (= rows of X) that
+ *            should be processed together so that the corresponding
+ *            rows of X fit in X_CACHE_BYTES
+ * In arg:    k
+ * Ret val:   number of columns in a block (at least 1)
+ */
+int Col_block(int k) {
+   int col_block = X_CACHE_BYTES/(k*sizeof(double));
+
+   return col_block > 0 ? col_block : 1;
+}  /* Col_block */
+
+/*------------------------------------------------------------------
+ * Function:  Mat_mult_rows
+ * Purpose:   Compute rows first_row, ..., last_row-1 of Y = AX
+ * In args:   A, X, first_row, last_row, n, k
+ * Out arg:   Y
+ */
+void Mat_mult_rows(double* restrict A, double* restrict X,
+      double* restrict Y, int first_row, int last_row, int n, int k) {
+   int i, j, c, jb, j_last;
+   int col_block = Col_block(k);
+   double a;
+   double* y_row;
+   double* x_row;
+   double* a_row;
+
+   for (i = first_row; i < last_row; i++)
+      for (c = 0; c < k; c++)
+         Y[(size_t) i*k+c] = 0.0;
+
+   for (jb = 0; jb < n; jb += col_block) {
+      j_last = (jb + col_block < n) ? jb + col_block : n;
+      for (i = first_row; i < last_row; i++) {
+         a_row = A + (size_t) i*n;
+         y_row = Y + (size_t) i*k;
+         for (j = jb; j < j_last; j++) {
+            a = a_row[j];
+            x_row = X + (size_t) j*k;
+#           pragma omp simd
+            for (c = 0; c < k; c++)
+               y_row[c] += a*x_row[c];
+         }
+      }
+   }
+}  /* Mat_mult_rows */
+
+/*------------------------------------------------------------------
+ * Function:       Pth_mat_vect_batch
+ * Purpose:        Multiply an mxn matrix by an nxk matrix
+ * In arg:         rank
+ * Global in vars: A, X, m, n, k, thread_count
+ * Global out var: Y
+ */
+void *Pth_mat_vect_batch(void* rank) {
+   long my_rank = (long) rank;
+   int local_m = m/thread_count;
+   int my_first_row = my_rank*local_m;
+   int my_last_row = my_first_row + local_m;
+
+#  ifdef DEBUG
+   printf("Thread %ld > rows %d to %d\n",
+         my_rank, my_first_row, my_last_row-1);
+#  endif
+
+   Mat_mult_rows(A, X, Y, my_first_row, my_last_row, n, k);
+
+   return NULL;
+}  /* Pth_mat_vect_batch */
+
+/*------------------------------------------------------------------
+ * Function:    Print_stats
+ * Purpose:     Print elapsed time, flop rate and arithmetic intensity
+ * In args:     elapsed, m, n, k
+ * Notes:
+ * 1.  The batched product does 2mnk flops.  Its compulsory traffic
+ *     is one pass over A, X and Y:  8(mn + nk + mk) bytes.
+ * 2.  k separate matrix-vector products do the same number of flops
+ *     but read A k times:  8k(mn + n + m) bytes.
+ */
+void Print_stats(double elapsed, int m, int n, int k) {
+   double flops = 2.0*m*n*k;
+   double batch_bytes = 8.0*((double) m*n + (double) n*k + (double) m*k);
+   double single_bytes = 8.0*k*((double) m*n + n + m);
+
+   printf("m = %d, n = %d, k = %d\n", m, n, k);
+   printf("Elapsed time = %e seconds\n", elapsed);
+   printf("GFLOP/s = %.3f\n", flops/elapsed/1.0e9);
+   printf("Arithmetic intensity = %.3f flops/byte ", flops/batch_bytes);
+   printf("(k single mat-vects = %.3f flops/byte)\n", flops/single_bytes);
+   printf("Effective bandwidth = %.3f GB/s\n", batch_bytes/elapsed/1.0e9);
+}  /* Print_stats */
+
+
+/*------------------------------------------------------------------
+ * Function:    Print_matrix
+ * Purpose:     Print the matrix
+ * In args:     title, A, m, n
+ */
+void Print_matrix( char* title, double A[], int m, int n) {
+   int   i, j;
+
+   printf("%s\n", title);
+   for (i = 0; i < m; i++) {
+      for (j = 0; j < n; j++)
+         printf("%6.3f ", A[(size_t) i*n + j]);
+      printf("\n");
+   }
+}  /* Print_matrix */
@@ -0,0 +1,350 @@
+/* File:
+ *     pth_odd_even.c
+ *
+ * Purpose:
+ *     Use block odd-even transposition sort or a parallel merge sort
+ *     to sort a list of ints with Pthreads.
+ *
+ * Input:
+ *     list (optional)
+ *
+ * Output:
+ *     Elapsed time for the sort
+ *
+ * Compile:  gcc -g -Wall -O2 -I../ch3 -I. -o pth_odd_even pth_odd_even.c
+ *              ../ch3/local_sort.c -lpthread
+ *           timer.h must be available
+ * Usage:
+ *     pth_odd_even <thread_count> <n> <g|i> [b|m]
+ *        n:   number of elements in list
+ *       'g':  generate list using a random number generator
+ *       'i':  user input list
+ *       'b':  block odd-even transposition sort (default)
+ *       'm':  parallel merge sort
+ *
+ * Notes:
+ *     1.  Each thread sorts a block of ceil(n/thread_count) keys with
+ *         Local_sort (see Block_first in ../ch3/local_sort.c).
+ *     2.  Block odd-even sort:  in each of thread_count phases
+ *         neighbouring threads do a merge-split of their blocks.  A
+ *         thread writes its new block to a second buffer, and
+ *         publishes a pointer to it for the next phase, instead of
+ *         copying it back.  A merge-split of blocks that are already
+ *         in order does nothing.
+ *     3.  Merge sort:  the sorted blocks are merged in pairs of runs.
+ *         Every thread works on every round of merges:  it finds the
+ *         part of the merged run that goes into its own block with a
+ *         binary search, and merges just that part.
+ *     4.  The phases and the rounds of merges are separated by a
+ *         condition variable barrier, as in pth_cond_bar.c.
+ *     5.  Compile with -DDEBUG to print the list before and after
+ *         sorting.  See also ../ch5/omp_odd_even3.c, which compares
+ *         the run times of these sorts with bubble sort and the
+ *         odd-even transposition sorts of single keys.
+ *
+ * IPP:    Section 3.7.2 (pp. 128 and ff.), Section 4.8.3 (pp. 179 and
+ *         ff.), and Section 5.6.2 (pp. 235 and ff.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timer.h"
+#include "local_sort.h"
+
+#ifdef DEBUG
+const int RMAX = 100;
+#else
+const int RMAX = 10000000;
+#endif
+
+/* Global variables */
+int     thread_count;
+int     n;
+int*    a;
+int*    tmp;
+int**   blocks;   /* For block odd-even sort */
+char    sort;
+
+/* Barrier */
+int barrier_thread_count = 0;
+int barrier_cycle = 0;
+pthread_mutex_t barrier_mutex;
+pthread_cond_t ok_to_proceed;
+
+/* Serial functions */
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], char* g_i_p);
+void Generate_list(int a[], int n);
+void Print_list(int a[], int n, char* title);
+void Read_list(int a[], int n);
+
+/* Parallel functions */
+void Barrier(void);
+void *Pth_sort(void* rank);
+void Block_odd_even(long my_rank);
+void Merge_sort(long my_rank);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long       thread;
+   pthread_t* thread_handles;
+   double     start, finish;
+   char       g_i;
+
+   Get_args(argc, argv, &g_i);
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   a = malloc(n*sizeof(int));
+   tmp = malloc(n*sizeof(int));
+   blocks = malloc(2*thread_count*sizeof(int*));
+   pthread_mutex_init(&barrier_mutex, NULL);
+   pthread_cond_init(&ok_to_proceed, NULL);
+
+   if (g_i == 'g') {
+      Generate_list(a, n);
+#     ifdef DEBUG
+      Print_list(a, n, "Before sort");
+#     endif
+   } else {
+      Read_list(a, n);
+   }
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         Pth_sort, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+
+#  ifdef DEBUG
+   Print_list(a, n, "After sort");
+#  endif
+   printf("Elapsed time = %e seconds\n", finish - start);
+
+   pthread_mutex_destroy(&barrier_mutex);
+   pthread_cond_destroy(&ok_to_proceed);
+   free(blocks);
+   free(tmp);
+   free(a);
+   free(thread_handles);
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print command line for function and terminate
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <n> <g|i> [b|m]\n",
+         prog_name);
+   fprintf(stderr, "   n:   number of elements in list\n");
+   fprintf(stderr, "  'g':  generate list using a random number generator\n");
+   fprintf(stderr, "  'i':  user input list\n");
+   fprintf(stderr, "  'b':  block odd-even transposition sort (default)\n");
+   fprintf(stderr, "  'm':  parallel merge sort\n");
+   exit(0);
+}  /* Usage */
+
+
+/*------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get and check command line arguments
+ * In args:   argc, argv
+ * Out arg:   g_i_p
+ * Globals:   thread_count, n, sort
+ */
+void Get_args(int argc, char* argv[], char* g_i_p) {
+   if (argc != 4 && argc != 5) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   n = strtol(argv[2], NULL, 10);
+   *g_i_p = argv[3][0];
+   sort = (argc == 5) ? argv[4][0] : 'b';
+
+   if (thread_count <= 0 || n <= 0 || (*g_i_p != 'g' && *g_i_p != 'i')
+         || (sort != 'b' && sort != 'm'))
+      Usage(argv[0]);
+}  /* Get_args */
+
+
+/*------------------------------------------------------------------
+ * Function:  Generate_list
+ * Purpose:   Use random number generator to generate list elements
+ * In args:   n
+ * Out args:  a
+ */
+void Generate_list(int a[], int n) {
+   int i;
+
+   srandom(1);
+   for (i = 0; i < n; i++)
+      a[i] = random() % RMAX;
+}  /* Generate_list */
+
+
+/*------------------------------------------------------------------
+ * Function:  Print_list
+ * Purpose:   Print the elements in the list
+ * In args:   a, n
+ */
+void Print_list(int a[], int n, char* title) {
+   int i;
+
+   printf("%s:\n", title);
+   for (i = 0; i < n; i++)
+      printf("%d ", a[i]);
+   printf("\n\n");
+}  /* Print_list */
+
+
+/*------------------------------------------------------------------
+ * Function:  Read_list
+ * Purpose:   Read elements of list from stdin
+ * In args:   n
+ * Out args:  a
+ */
+void Read_list(int a[], int n) {
+   int i;
+
+   printf("Please enter the elements of the list\n");
+   for (i = 0; i < n; i++)
+      scanf("%d", &a[i]);
+}  /* Read_list */
+
+
+/*------------------------------------------------------------------
+ * Function:    Barrier
+ * Purpose:     Wait until all thread_count threads have called Barrier
+ * Globals:     barrier_thread_count, barrier_cycle, barrier_mutex,
+ *              ok_to_proceed
+ * Note:        A thread waits until barrier_cycle changes, so a
+ *              spurious wakeup doesn't let it through early.
+ */
+void Barrier(void) {
+   int my_cycle;
+
+   pthread_mutex_lock(&barrier_mutex);
+   my_cycle = barrier_cycle;
+   barrier_thread_count++;
+   if (barrier_thread_count == thread_count) {
+      barrier_thread_count = 0;
+      barrier_cycle++;
+      pthread_cond_broadcast(&ok_to_proceed);
+   } else {
+      while (barrier_cycle == my_cycle)
+         pthread_cond_wait(&ok_to_proceed, &barrier_mutex);
+   }
+   pthread_mutex_unlock(&barrier_mutex);
+}  /* Barrier */
+
+
+/*------------------------------------------------------------------
+ * Function:       Pth_sort
+ * Purpose:        Thread function:  sort my block, and then run the
+ *                 phases of the sort
+ * In arg:         rank
+ * Global vars:    a, n, sort
+ * Return val:     Ignored
+ */
+void *Pth_sort(void* rank) {
+   long my_rank = (long) rank;
+   int my_first = Block_first(my_rank, n, thread_count);
+   int my_last = Block_first(my_rank + 1, n, thread_count);
+
+   Local_sort(a + my_first, my_last - my_first);
+   if (sort == 'b')
+      Block_odd_even(my_rank);
+   else
+      Merge_sort(my_rank);
+
+   return NULL;
+}  /* Pth_sort */
+
+
+/*------------------------------------------------------------------
+ * Function:       Block_odd_even
+ * Purpose:        Run the phases of block odd-even transposition sort
+ * In arg:         my_rank
+ * Global vars:    a, n, tmp, thread_count
+ * Scratch:        blocks:  blocks[(phase % 2)*thread_count + t] is
+ *                 the current block of thread t at the start of
+ *                 phase:  it's in a or in tmp
+ */
+void Block_odd_even(long my_rank) {
+   int my_first = Block_first(my_rank, n, thread_count);
+   int my_n = Block_first(my_rank + 1, n, thread_count) - my_first;
+   int phase, cur, partner, partner_n, changed;
+   int *mine, *out;
+
+   blocks[my_rank] = a + my_first;
+   Barrier();
+
+   for (phase = 0; phase < thread_count; phase++) {
+      cur = phase % 2;
+      mine = blocks[cur*thread_count + my_rank];
+      out = (mine == a + my_first) ? tmp + my_first : a + my_first;
+      partner = (phase % 2 == my_rank % 2) ? my_rank + 1 : my_rank - 1;
+      changed = 0;
+      if (partner >= 0 && partner < thread_count) {
+         partner_n = Block_first(partner + 1, n, thread_count)
+            - Block_first(partner, n, thread_count);
+         if (partner > my_rank)
+            changed = Merge_low(mine, my_n,
+                  blocks[cur*thread_count + partner], partner_n, out);
+         else
+            changed = Merge_high(blocks[cur*thread_count + partner],
+                  partner_n, mine, my_n, out);
+      }
+      /* The other slot isn't read until after the barrier */
+      blocks[(1 - cur)*thread_count + my_rank] = changed ? out : mine;
+      Barrier();
+   }
+
+   mine = blocks[(thread_count % 2)*thread_count + my_rank];
+   if (mine != a + my_first)
+      memcpy(a + my_first, mine, my_n*sizeof(int));
+}  /* Block_odd_even */
+
+
+/*------------------------------------------------------------------
+ * Function:       Merge_sort
+ * Purpose:        Merge the sorted blocks in pairs of runs, until
+ *                 there's one run
+ * In arg:         my_rank
+ * Global vars:    a, n, tmp, thread_count
+ */
+void Merge_sort(long my_rank) {
+   int my_first = Block_first(my_rank, n, thread_count);
+   int my_last = Block_first(my_rank + 1, n, thread_count);
+   int *src = a, *dst = tmp, *t;
+   int width, lo_blk, mid_blk, hi_blk, lo, mid, hi;
+
+   Barrier();
+
+   /* Runs of width blocks are merged into runs of 2*width blocks */
+   for (width = 1; width < thread_count; width *= 2) {
+      lo_blk = my_rank/(2*width)*(2*width);
+      mid_blk = (lo_blk + width < thread_count) ?
+         lo_blk + width : thread_count;
+      hi_blk = (lo_blk + 2*width < thread_count) ?
+         lo_blk + 2*width : thread_count;
+      lo = Block_first(lo_blk, n, thread_count);
+      mid = Block_first(mid_blk, n, thread_count);
+      hi = Block_first(hi_blk, n, thread_count);
+
+      /* The merged run takes the places of the two runs, so my part
+       * of it goes into my own block */
+      Merge_range(src + lo, mid - lo, src + mid, hi - mid, dst + lo,
+            my_first - lo, my_last - lo);
+      t = src; src = dst; dst = t;
+      Barrier();
+   }
+
+   if (src != a)
+      memcpy(a + my_first, src + my_first,
+            (my_last - my_first)*sizeof(int));
+}  /* Merge_sort */
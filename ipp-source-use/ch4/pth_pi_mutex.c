@@ -5,8 +5,8 @@
  *
  *           This version uses a mutex to protect the critical section
  *
- * Compile:  gcc -g -Wall -o pth_pi_mutex pth_pi_mutex.c -lm -lpthread
- *           timer.h needs to be available 
+ * Compile:  gcc -g -Wall -I../ch3 -o pth_pi_mutex pth_pi_mutex.c
+ *              ../ch3/prof.c -lm -lpthread
  * Run:      ./pth_pi_mutex <number of threads> <n>
  *           n is the number of terms of the Maclaurin series to use
  *           n should be evenly divisible by the number of threads
@@ -14,8 +14,9 @@
  * Input:    none            
  * Output:   The estimate of pi using multiple threads, one thread, and the 
  *           value computed by the math library arctan function
- *           Also elapsed times for the multithreaded and singlethreaded
- *           computations.
+ *           On stderr, the times of the multithreaded and singlethreaded
+ *           computations, and of each thread's sum and critical
+ *           section (see ../ch3/prof.h)
  *
  * Notes:
  *    1.  The radius of convergence for the series is only 1.  So the 
@@ -28,7 +29,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <pthread.h>
-#include "timer.h"
+#include "prof.h"
 
 const int MAX_THREADS = 1024;
 
@@ -47,7 +48,6 @@ double Serial_pi(long long n);
 int main(int argc, char* argv[]) {
    long       thread;  /* Use long in case of a 64-bit system */
    pthread_t* thread_handles;
-   double start, finish, elapsed;
 
    /* Get number of threads from command line */
    Get_args(argc, argv);
@@ -56,27 +56,24 @@ int main(int argc, char* argv[]) {
    pthread_mutex_init(&mutex, NULL);
    sum = 0.0;
 
-   GET_TIME(start);
+   PROF_BEGIN("multithreaded");
    for (thread = 0; thread < thread_count; thread++)  
       pthread_create(&thread_handles[thread], NULL,
           Thread_sum, (void*)thread);  
 
    for (thread = 0; thread < thread_count; thread++) 
       pthread_join(thread_handles[thread], NULL); 
-   GET_TIME(finish);
-   elapsed = finish - start;
+   PROF_END("multithreaded");
 
    sum = 4.0*sum;
    printf("With n = %lld terms,\n", n);
    printf("   Our estimate of pi = %.15f\n", sum);
-   printf("The elapsed time is %e seconds\n", elapsed);
-   GET_TIME(start);
+   PROF_BEGIN("singlethreaded");
    sum = Serial_pi(n);
-   GET_TIME(finish);
-   elapsed = finish - start;
+   PROF_END("singlethreaded");
    printf("   Single thread est  = %.15f\n", sum);
-   printf("The elapsed time is %e seconds\n", elapsed);
    printf("                   pi = %.15f\n", 4.0*atan(1.0));
+   PROF_REPORT();
    
    pthread_mutex_destroy(&mutex);
    free(thread_handles);
@@ -98,12 +95,16 @@ void* Thread_sum(void* rank) {
    else
       factor = -1.0;
 
+   PROF_BEGIN("thread_sum");
    for (i = my_first_i; i < my_last_i; i++, factor = -factor) {
       my_sum += factor/(2*i+1);
    }
+   PROF_END("thread_sum");
+   PROF_BEGIN("critical");
    pthread_mutex_lock(&mutex);
    sum += my_sum;
    pthread_mutex_unlock(&mutex);
+   PROF_END("critical");
 
    return NULL;
 }  /* Thread_sum */
@@ -0,0 +1,310 @@
+/* File:
+ *    pth_tokenize_bulk.c
+ *
+ * Purpose:
+ *    Use threads to tokenize a text file.  Unlike pth_tokenize_r.c,
+ *    the threads don't take turns reading lines:  the file is mapped
+ *    into memory, and each thread tokenizes a chunk of it.
+ *
+ * Input:
+ *    A text file
+ * Output:
+ *    The number of bytes, tokens and lines, and the time and
+ *    bandwidth of tokenizing and of merging the threads' lists.
+ *    With 'p', also each line's number and its tokens.  With 'f k',
+ *    the k most frequent tokens, their counts, and the times of
+ *    counting and of combining the counts.
+ *
+ * Compile:
+ *    gcc -g -Wall -O2 -o pth_tokenize_bulk pth_tokenize_bulk.c tokens.c
+ *       word_freq.c -lpthread
+ *    timer.h must be available
+ * Usage:
+ *    pth_tokenize_bulk <thread_count> <file> [p | f <k>]
+ *
+ * Algorithm:
+ *    The file is split into thread_count chunks that start at the
+ *    beginnings of lines (see tokens.c).  Each thread stores the
+ *    offsets and lengths of the tokens in its chunk in its own list.
+ *    Then the lists are concatenated in order of rank, which gives the
+ *    tokens in the order of the file:  each thread copies its own list
+ *    to its place in the merged list.
+ *
+ *    Word frequencies (see word_freq.c):  each thread counts the tokens
+ *    in its own list with thread_count hash maps, one for each
+ *    partition of the hash values.  Then thread q adds up partition q
+ *    of all the threads' maps, and finds the k most frequent tokens in
+ *    it.  Last, the main thread finds the k most frequent of these.
+ *
+ * Notes:
+ *    1.  The text isn't copied, and it isn't changed.  There's no
+ *        limit on the length of a line.
+ *    2.  The tokens are separated by white space (TOKEN_DELIMS in
+ *        tokens.h), as with strtok_r.
+ *
+ * IPP:  Section 4.11  (pp. 197 and ff.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tokens.h"
+#include "word_freq.h"
+#include "timer.h"
+
+int thread_count;
+char* text;
+long size;
+token_list_t* lists;
+token_list_t all;
+int k;
+word_map_t* maps;      /* maps[t*thread_count + q]:  thread t, part q */
+word_map_t* totals;    /* totals[q]:  partition q of all the threads  */
+word_entry_t* tops;    /* tops[q*k], ..., tops[q*k + k-1]:  top k in
+                          totals[q]                                   */
+
+void Usage(char* prog_name);
+void Print_tokens(token_list_t* all);
+void Word_freq(void);
+void *Tokenize(void* rank);  /* Thread function */
+void *Merge(void* rank);     /* Thread function */
+void *Count(void* rank);     /* Thread function */
+void *Reduce(void* rank);    /* Thread function */
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long        thread;
+   pthread_t* thread_handles;
+   double start, finish, tok_time, merge_time;
+
+   if (argc < 3 || argc > 5)
+      Usage(argv[0]);
+   thread_count = atoi(argv[1]);
+   if (thread_count <= 0) Usage(argv[0]);
+   if (argc == 5 && argv[3][0] == 'f') {
+      k = atoi(argv[4]);
+      if (k <= 0) Usage(argv[0]);
+   } else if (argc == 5 || (argc == 4 && argv[3][0] != 'p')) {
+      Usage(argv[0]);
+   }
+   text = Map_text(argv[2], &size);
+   if (text == NULL) {
+      fprintf(stderr, "Can't open %s\n", argv[2]);
+      exit(1);
+   }
+
+   thread_handles = (pthread_t*) malloc (thread_count*sizeof(pthread_t));
+   lists = malloc(thread_count*sizeof(token_list_t));
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], (pthread_attr_t*) NULL,
+          Tokenize, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++) {
+      pthread_join(thread_handles[thread], NULL);
+   }
+   GET_TIME(finish);
+   tok_time = finish - start;
+
+   GET_TIME(start);
+   Merge_alloc(lists, thread_count, &all);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], (pthread_attr_t*) NULL,
+          Merge, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++) {
+      pthread_join(thread_handles[thread], NULL);
+   }
+   GET_TIME(finish);
+   merge_time = finish - start;
+
+   if (argc == 4 && argv[3][0] == 'p')
+      Print_tokens(&all);
+   printf("%ld bytes, %ld tokens, %ld lines\n", size, all.count,
+         all.line_count);
+   printf("Tokenize:  %e seconds, %.3f GB/s\n", tok_time,
+         size/tok_time/1.0e9);
+   printf("Merge:     %e seconds\n", merge_time);
+   if (k > 0) Word_freq();
+
+   for (thread = 0; thread < thread_count; thread++)
+      Token_list_free(&lists[thread]);
+   Token_list_free(&all);
+   Unmap_text(text, size);
+   free(lists);
+   free(thread_handles);
+   return 0;
+}  /* main */
+
+
+/*--------------------------------------------------------------------
+ * Function:    Usage
+ * Purpose:     Print command line for function and terminate
+ * In arg:      prog_name
+ */
+void Usage(char* prog_name) {
+
+   fprintf(stderr, "usage: %s <number of threads> <file> [p | f <k>]\n",
+         prog_name);
+   fprintf(stderr, "   p:  print the tokens of each line\n");
+   fprintf(stderr, "   f:  print the k most frequent tokens\n");
+   exit(0);
+}  /* Usage */
+
+
+/*--------------------------------------------------------------------
+ * Function:    Print_tokens
+ * Purpose:     Print the tokens of each line
+ * In arg:      all
+ * Global var:  text
+ */
+void Print_tokens(token_list_t* all) {
+   long line, t, last;
+
+   for (line = 0; line < all->line_count; line++) {
+      last = (line + 1 < all->line_count) ?
+         all->line_first[line+1] : all->count;
+      for (t = all->line_first[line]; t < last; t++)
+         printf("Line %ld > string %ld = %.*s\n", line + 1,
+               t - all->line_first[line] + 1, all->spans[t].length,
+               text + all->spans[t].offset);
+   }
+}  /* Print_tokens */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Tokenize
+ * Purpose:     Tokenize my chunk of the text
+ * In arg:      rank
+ * Global vars: thread_count, text, size (in), lists (out)
+ * Return val:  Ignored
+ */
+void *Tokenize(void* rank) {
+   long my_rank = (long) rank;
+   long my_first = Chunk_first(text, size, my_rank, thread_count);
+   long my_last = Chunk_first(text, size, my_rank + 1, thread_count);
+
+   /* Guess about 1 token per 8 bytes */
+   Token_list_init(&lists[my_rank], (my_last - my_first)/8);
+   Tokenize_chunk(text, my_first, my_last, &lists[my_rank]);
+
+   return NULL;
+}  /* Tokenize */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Merge
+ * Purpose:     Copy my list into its place in the merged list
+ * In arg:      rank
+ * Global vars: lists (in), all (out)
+ * Return val:  Ignored
+ */
+void *Merge(void* rank) {
+   long my_rank = (long) rank;
+
+   Merge_copy(lists, my_rank, &all);
+
+   return NULL;
+}  /* Merge */
+
+
+/*--------------------------------------------------------------------
+ * Function:    Word_freq
+ * Purpose:     Count the tokens in the threads' lists and print the k
+ *              most frequent
+ * Global vars: thread_count, text, lists, k (in)
+ *              maps, totals, tops (scratch)
+ */
+void Word_freq(void) {
+   long thread;
+   pthread_t* thread_handles;
+   word_entry_t* top;
+   int i, found;
+   double start, finish, count_time, reduce_time;
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   maps = malloc(thread_count*thread_count*sizeof(word_map_t));
+   totals = malloc(thread_count*sizeof(word_map_t));
+   /* Empty slots have count 0, so Top_k ignores them */
+   tops = calloc(thread_count*k, sizeof(word_entry_t));
+   top = malloc(k*sizeof(word_entry_t));
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], (pthread_attr_t*) NULL,
+          Count, (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+   count_time = finish - start;
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], (pthread_attr_t*) NULL,
+          Reduce, (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   found = Top_k(tops, (long) thread_count*k, k, top);
+   GET_TIME(finish);
+   reduce_time = finish - start;
+
+   for (i = 0; i < found; i++)
+      printf("%8ld  %.*s\n", top[i].count, top[i].length,
+            text + top[i].offset);
+   printf("Count:     %e seconds\n", count_time);
+   printf("Reduce:    %e seconds\n", reduce_time);
+
+   for (i = 0; i < thread_count*thread_count; i++)
+      Word_map_free(&maps[i]);
+   for (i = 0; i < thread_count; i++)
+      Word_map_free(&totals[i]);
+   free(top);
+   free(tops);
+   free(totals);
+   free(maps);
+   free(thread_handles);
+}  /* Word_freq */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Count
+ * Purpose:     Count the tokens in my list, with one map for each
+ *              partition
+ * In arg:      rank
+ * Global vars: thread_count, text, lists (in), maps (out)
+ * Return val:  Ignored
+ */
+void *Count(void* rank) {
+   long my_rank = (long) rank;
+   word_map_t* my_maps = &maps[my_rank*thread_count];
+   int q;
+
+   /* Guess about 1 distinct token per 16 tokens */
+   for (q = 0; q < thread_count; q++)
+      Word_map_init(&my_maps[q], lists[my_rank].count/16/thread_count);
+   Count_tokens(text, &lists[my_rank], my_maps, thread_count);
+
+   return NULL;
+}  /* Count */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Reduce
+ * Purpose:     Add up my partition of all the threads' maps, and find
+ *              the k most frequent tokens in it
+ * In arg:      rank
+ * Global vars: thread_count, text, maps, k (in), totals, tops (out)
+ * Return val:  Ignored
+ */
+void *Reduce(void* rank) {
+   long my_rank = (long) rank;
+
+   Merge_partition(text, maps, thread_count, my_rank, thread_count,
+         &totals[my_rank]);
+   Top_k(totals[my_rank].entries, totals[my_rank].capacity, k,
+         &tops[my_rank*k]);
+
+   return NULL;
+}  /* Reduce */
@@ -0,0 +1,211 @@
+/* File:     scan.h
+ *
+ * Purpose:  Define macros that generate prefix scan (prefix sum)
+ *           kernels specialised on the element type and the operator,
+ *           so that the operator is inlined.
+ *
+ * SCAN_KERNELS(name, T, OP) defines
+ *
+ *    T    name_reduce(const T x[], long first, long last, T identity)
+ *    T    name_range(const T x[], T y[], long first, long last,
+ *               T carry, int inclusive)
+ *    void name_scan(const T x[], T y[], long n, T identity,
+ *               int inclusive)
+ *    void name_scan_omp(const T x[], T y[], long n, T identity,
+ *               int inclusive, int thread_count)
+ *
+ * OP(a, b) is an associative operator, a function-like macro or a
+ * static inline function that returns a T.  It needn't be commutative:
+ * the left operand always comes from lower indices.  identity is its
+ * identity element:  0 for +, the identity matrix for a product.
+ *
+ *    name_reduce returns identity OP x[first] OP ... OP x[last-1].
+ *    name_range scans x[first], ..., x[last-1] into y[first], ...,
+ *       y[last-1], starting from carry:  for an inclusive scan,
+ *       y[i] = carry OP x[first] OP ... OP x[i], and for an exclusive
+ *       scan, y[i] = carry OP x[first] OP ... OP x[i-1].  It returns
+ *       carry OP x[first] OP ... OP x[last-1].  y can be x.
+ *    name_scan scans x[0], ..., x[n-1] serially.
+ *    name_scan_omp scans x[0], ..., x[n-1] with thread_count OpenMP
+ *       threads.  Without OpenMP, it calls name_scan.
+ *
+ * Example:
+ *    #define SUM(a, b) ((a) + (b))
+ *    SCAN_KERNELS(Sum_long, long, SUM)
+ *    . . .
+ *    Sum_long_scan_omp(counts, offsets, n, 0, 0, thread_count);
+ *
+ * Algorithm:
+ *    The parallel scan is the two-pass blocked scan.  The elements are
+ *    split into one block per thread (Scan_first).  In the first pass,
+ *    each thread reduces its block to a single value, its total.  After
+ *    a barrier, each thread reduces the totals of the lower ranked
+ *    blocks to get its carry, and, in the second pass, scans its block
+ *    starting from the carry.  So there are about 2n applications of
+ *    OP, against n for the serial scan, and one barrier.
+ *
+ *    The kernels can also be called inside a parallel region, or from
+ *    Pthreads:  each thread calls name_reduce on its block and stores
+ *    the result in totals[my_rank], waits at a barrier, and calls
+ *    name_range with carry = name_reduce(totals, 0, my_rank, identity).
+ *
+ * Linear recurrences:
+ *    A second order recurrence x[i] = a*x[i-1] + b*x[i-2] is a product
+ *    of 2x2 matrices:
+ *
+ *       | x[i]   |   | a  b |   | x[i-1] |
+ *       | x[i-1] | = | 1  0 | * | x[i-2] |
+ *
+ *    so it can be computed with a scan using Mat2_after, which is
+ *    associative.  The matrices here are unsigned 64-bit ints, so the
+ *    arithmetic is mod 2^64.  Mat2_scan_omp, etc. are defined below.
+ *
+ * Notes:
+ * 1.  The parallel scan only pays if OP is expensive compared to a
+ *     load and a store, or there are enough threads to make up for the
+ *     doubled work.  For cheap operators on long arrays it's limited by
+ *     memory bandwidth, like the serial scan.
+ * 2.  Floating point + isn't associative, so the parallel scan of a
+ *     float array can differ from the serial scan in the last bits.
+ */
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+#include <stdlib.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+/*---------------------------------------------------------------------
+ * Function:  Scan_first
+ * Purpose:   Find the first index of block b when n elements are split
+ *            into block_count blocks whose sizes differ by at most 1.
+ *            Block b is Scan_first(n, b, ...), ...,
+ *            Scan_first(n, b+1, ...) - 1.
+ */
+static inline long Scan_first(long n, int b, int block_count) {
+   return (long) ((__int128) n*b/block_count);
+}  /* Scan_first */
+
+#define SCAN_KERNELS(name, T, OP) \
+static inline T name##_reduce(const T x[], long first, long last, \
+      T identity) { \
+   T sum = identity; \
+   long i; \
+   \
+   for (i = first; i < last; i++) \
+      sum = OP(sum, x[i]); \
+   return sum; \
+} \
+\
+static inline T name##_range(const T x[], T y[], long first, long last, \
+      T carry, int inclusive) { \
+   T x_i; \
+   long i; \
+   \
+   if (inclusive) \
+      for (i = first; i < last; i++) { \
+         carry = OP(carry, x[i]); \
+         y[i] = carry; \
+      } \
+   else \
+      for (i = first; i < last; i++) { \
+         x_i = x[i]; \
+         y[i] = carry; \
+         carry = OP(carry, x_i); \
+      } \
+   return carry; \
+} \
+\
+static inline void name##_scan(const T x[], T y[], long n, T identity, \
+      int inclusive) { \
+   name##_range(x, y, 0, n, identity, inclusive); \
+} \
+SCAN_OMP_KERNEL(name, T)
+
+#ifdef _OPENMP
+#define SCAN_OMP_KERNEL(name, T) \
+static inline void name##_scan_omp(const T x[], T y[], long n, \
+      T identity, int inclusive, int thread_count) { \
+   T* totals; \
+   \
+   if (thread_count <= 1) { \
+      name##_scan(x, y, n, identity, inclusive); \
+      return; \
+   } \
+   totals = malloc(thread_count*sizeof(T)); \
+   _Pragma("omp parallel num_threads(thread_count)") \
+   { \
+      int my_rank = omp_get_thread_num(); \
+      long my_first = Scan_first(n, my_rank, thread_count); \
+      long my_last = Scan_first(n, my_rank + 1, thread_count); \
+      \
+      totals[my_rank] = name##_reduce(x, my_first, my_last, identity); \
+      _Pragma("omp barrier") \
+      name##_range(x, y, my_first, my_last, \
+            name##_reduce(totals, 0, my_rank, identity), inclusive); \
+   } \
+   free(totals); \
+}
+#else
+#define SCAN_OMP_KERNEL(name, T) \
+static inline void name##_scan_omp(const T x[], T y[], long n, \
+      T identity, int inclusive, int thread_count) { \
+   (void) thread_count; \
+   name##_scan(x, y, n, identity, inclusive); \
+}
+#endif
+
+/* | a  b |
+ * | c  d |, with arithmetic mod 2^64 */
+typedef struct {
+   unsigned long long a, b, c, d;
+}  mat2_t;
+
+static const mat2_t MAT2_IDENTITY = {1, 0, 0, 1};
+
+/*---------------------------------------------------------------------
+ * Function:  Mat2_mult
+ * Purpose:   Return the product x*y
+ */
+static inline mat2_t Mat2_mult(mat2_t x, mat2_t y) {
+   mat2_t z;
+
+   z.a = x.a*y.a + x.b*y.c;
+   z.b = x.a*y.b + x.b*y.d;
+   z.c = x.c*y.a + x.d*y.c;
+   z.d = x.c*y.b + x.d*y.d;
+   return z;
+}  /* Mat2_mult */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Mat2_after
+ * Purpose:   Return the matrix that applies p and then x, i.e., x*p.
+ *            A scan with this operator of the step matrices of a
+ *            recurrence gives the matrices that map the initial values
+ *            to each later pair of values.
+ */
+static inline mat2_t Mat2_after(mat2_t p, mat2_t x) {
+   return Mat2_mult(x, p);
+}  /* Mat2_after */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Mat2_pow
+ * Purpose:   Return x^e, e >= 0, by repeated squaring
+ */
+static inline mat2_t Mat2_pow(mat2_t x, long e) {
+   mat2_t p = MAT2_IDENTITY;
+
+   while (e > 0) {
+      if (e & 1) p = Mat2_mult(p, x);
+      x = Mat2_mult(x, x);
+      e >>= 1;
+   }
+   return p;
+}  /* Mat2_pow */
+
+SCAN_KERNELS(Mat2, mat2_t, Mat2_after)
+
+#endif
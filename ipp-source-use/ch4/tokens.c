@@ -0,0 +1,390 @@
+/* File:     tokens.c
+ *
+ * Purpose:  Split text into tokens, in parallel, without copying the
+ *           text or writing to it.
+ *
+ * Map_text:           mmap a text file read-only
+ * Unmap_text:         munmap it
+ * Chunk_first:        Find the first byte of a chunk of the text.  The
+ *                     chunks have about the same number of bytes, and
+ *                     each starts at the beginning of a line.
+ * Token_list_init:    Allocate a list of tokens
+ * Token_list_free:    Free it
+ * Tokenize_chunk:     Add the tokens and the lines of a chunk to a list
+ * Merge_token_lists:  Concatenate the lists of the chunks into one list
+ * Merge_alloc:        Allocate the list for Merge_copy
+ * Merge_copy:         Copy one chunk's list into the concatenated list
+ *
+ * Notes:
+ * 1.  A token is a maximal run of characters that aren't in
+ *     TOKEN_DELIMS, as with strtok_r(..., " \t\n", ...).  It's stored
+ *     as its offset in the text and its length, so the text isn't
+ *     copied, and it isn't changed by inserting '\0's.
+ * 2.  Since the chunks start at the beginning of lines, no token or
+ *     line is split between two chunks.  So the chunks can be
+ *     tokenized independently, e.g. one per thread, and concatenating
+ *     their lists in chunk order gives the tokens and lines in the
+ *     order of the text.
+ * 3.  With SSE2, Tokenize_chunk finds the delimiters in 64 bytes at a
+ *     time:  it makes a 64-bit mask with a 1 for each delimiter, and
+ *     gets the starts and ends of the tokens from the mask with shifts
+ *     and ands.  Then only the starts, ends and newlines are visited,
+ *     instead of every character, and without branches that depend on
+ *     the text.
+ * 4.  Merge_token_lists copies the lists one after the other.  A
+ *     parallel program can call Merge_alloc once, and then Merge_copy
+ *     for each list in parallel.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+#include "tokens.h"
+
+static void Add_token(token_list_t* list, long offset, long length);
+static void Add_line(token_list_t* list);
+#ifdef __SSE2__
+static void Reserve(token_list_t* list, long capacity,
+      long line_capacity);
+#endif
+
+/*---------------------------------------------------------------------
+ * Function:  Map_text
+ * Purpose:   Map the file fname into memory read-only
+ * In arg:    fname
+ * Out arg:   size_p:  the number of bytes in the file
+ * Ret val:   The text, or NULL if the file can't be opened or mapped.
+ *            An empty file is mapped to a pointer to "".
+ */
+char* Map_text(char fname[], long* size_p) {
+   static char empty[1] = "";
+   struct stat st;
+   char* text;
+   int fd;
+
+   fd = open(fname, O_RDONLY);
+   if (fd < 0 || fstat(fd, &st) != 0) {
+      if (fd >= 0) close(fd);
+      return NULL;
+   }
+   *size_p = st.st_size;
+   if (st.st_size == 0) {
+      close(fd);
+      return empty;
+   }
+   text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (text == MAP_FAILED) return NULL;
+   madvise(text, st.st_size, MADV_SEQUENTIAL);
+
+   return text;
+}  /* Map_text */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Unmap_text
+ * Purpose:   Unmap text returned by Map_text
+ * In args:   text, size
+ */
+void Unmap_text(char* text, long size) {
+   if (size > 0) munmap(text, size);
+}  /* Unmap_text */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Chunk_first
+ * Purpose:   Find the first byte of chunk of the text when it's split
+ *            into chunk_count chunks.  Chunk c is text[Chunk_first(c)],
+ *            ..., text[Chunk_first(c+1)-1].
+ * In args:   text, size, chunk, chunk_count
+ * Ret val:   The first byte after the first newline at or after byte
+ *            chunk*size/chunk_count - 1, or size if there's none.
+ *            Some chunks may be empty.
+ */
+long Chunk_first(const char* text, long size, int chunk, int chunk_count) {
+   long first;
+   const char* nl;
+
+   if (chunk <= 0) return 0;
+   if (chunk >= chunk_count) return size;
+   first = (long) ((double) chunk*size/chunk_count);
+   if (first == 0) return 0;
+   nl = memchr(text + first - 1, '\n', size - first + 1);
+
+   return (nl == NULL) ? size : nl - text + 1;
+}  /* Chunk_first */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Token_list_init
+ * Purpose:   Allocate an empty token list
+ * In arg:    capacity:  initial number of tokens the list can hold.
+ *               It grows as needed.
+ * Out arg:   list
+ */
+void Token_list_init(token_list_t* list, long capacity) {
+   if (capacity < 16) capacity = 16;
+   list->spans = malloc(capacity*sizeof(token_span_t));
+   list->count = 0;
+   list->capacity = capacity;
+   list->line_capacity = capacity/8 + 16;
+   list->line_first = malloc(list->line_capacity*sizeof(long));
+   list->line_count = 0;
+}  /* Token_list_init */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Token_list_free
+ * Purpose:   Free the storage of a token list
+ * In/out:    list
+ */
+void Token_list_free(token_list_t* list) {
+   free(list->spans);
+   free(list->line_first);
+   memset(list, 0, sizeof(token_list_t));
+}  /* Token_list_free */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Add_token
+ * Purpose:   Append a token to a list
+ * In args:   offset, length
+ * In/out:    list
+ */
+static void Add_token(token_list_t* list, long offset, long length) {
+   if (list->count == list->capacity) {
+      list->capacity *= 2;
+      list->spans = realloc(list->spans,
+            list->capacity*sizeof(token_span_t));
+   }
+   list->spans[list->count].offset = offset;
+   list->spans[list->count].length = length;
+   list->count++;
+}  /* Add_token */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Add_line
+ * Purpose:   Start a new line in a list:  its first token will be the
+ *            next token added
+ * In/out:    list
+ */
+static void Add_line(token_list_t* list) {
+   if (list->line_count == list->line_capacity) {
+      list->line_capacity *= 2;
+      list->line_first = realloc(list->line_first,
+            list->line_capacity*sizeof(long));
+   }
+   list->line_first[list->line_count++] = list->count;
+}  /* Add_line */
+
+
+#ifdef __SSE2__
+/*---------------------------------------------------------------------
+ * Function:  Reserve
+ * Purpose:   Make room in a list for at least capacity tokens and
+ *            line_capacity lines
+ * In args:   capacity, line_capacity
+ * In/out:    list
+ */
+static void Reserve(token_list_t* list, long capacity,
+      long line_capacity) {
+   if (capacity > list->capacity) {
+      while (list->capacity < capacity) list->capacity *= 2;
+      list->spans = realloc(list->spans,
+            list->capacity*sizeof(token_span_t));
+   }
+   if (line_capacity > list->line_capacity) {
+      while (list->line_capacity < line_capacity) list->line_capacity *= 2;
+      list->line_first = realloc(list->line_first,
+            list->line_capacity*sizeof(long));
+   }
+}  /* Reserve */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Masks_64
+ * Purpose:   Find the delimiters and the newlines in 64 bytes
+ * In arg:    p
+ * Out args:  delims_p:  bit i is 1 iff p[i] is in TOKEN_DELIMS
+ *            nls_p:     bit i is 1 iff p[i] is '\n'
+ */
+static inline void Masks_64(const char* p, unsigned long long* delims_p,
+      unsigned long long* nls_p) {
+   const __m128i space = _mm_set1_epi8(' ');
+   const __m128i tab = _mm_set1_epi8('\t');
+   const __m128i cr = _mm_set1_epi8('\r');
+   const __m128i nl = _mm_set1_epi8('\n');
+   unsigned long long delims = 0, nls = 0;
+   __m128i v, is_nl, is_delim;
+   int k;
+
+   for (k = 0; k < 4; k++) {
+      v = _mm_loadu_si128((const __m128i*) (p + 16*k));
+      is_nl = _mm_cmpeq_epi8(v, nl);
+      is_delim = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), is_nl));
+      delims |= (unsigned long long)
+         (unsigned) _mm_movemask_epi8(is_delim) << (16*k);
+      nls |= (unsigned long long)
+         (unsigned) _mm_movemask_epi8(is_nl) << (16*k);
+   }
+   *delims_p = delims;
+   *nls_p = nls;
+}  /* Masks_64 */
+#endif
+
+
+/*---------------------------------------------------------------------
+ * Function:  Tokenize_chunk
+ * Purpose:   Add the tokens and lines of text[first], ...,
+ *            text[last-1] to list.  first should be the start of a
+ *            line, and last the start of a line or the end of the
+ *            text.
+ * In args:   text, first, last
+ * In/out:    list
+ */
+void Tokenize_chunk(const char* text, long first, long last,
+      token_list_t* list) {
+   long pos = first;
+   long start = -1;   /* Start of the current token, or -1 */
+   int prev_delim = 1;
+   int is_delim;
+   char c;
+#  ifdef __SSE2__
+   unsigned long long delims, nls, before, starts, ends;
+   long started, ended;  /* Tokens started and ended so far */
+   token_span_t* spans;
+   int i;
+#  endif
+
+   if (first >= last) return;
+   Add_line(list);
+
+#  ifdef __SSE2__
+   /* The starts of the tokens are stored as they're found, and the
+    * lengths are filled in when the ends are found.  The starts and
+    * ends alternate, so started is ended or ended + 1. */
+   started = ended = list->count;
+   for (; pos + 64 <= last; pos += 64) {
+      Masks_64(text + pos, &delims, &nls);
+      /* Bit i of before is 1 iff byte pos+i-1 is a delimiter */
+      before = (delims << 1) | prev_delim;
+      starts = ~delims & before;
+      ends = delims & ~before;
+      /* A newline at the end of the chunk doesn't start a line */
+      if (pos + 64 == last) nls &= ~(1ULL << 63);
+
+      /* At most 32 tokens start and 64 lines start in 64 bytes */
+      Reserve(list, started + 32, list->line_count + 64);
+      spans = list->spans;
+      while (starts != 0) {
+         spans[started++].offset = pos + __builtin_ctzll(starts);
+         starts &= starts - 1;
+      }
+      /* The line after a newline starts with the first token that
+       * ends after the newline */
+      while (nls != 0) {
+         i = __builtin_ctzll(nls);
+         list->line_first[list->line_count++] = ended
+            + __builtin_popcountll(ends & (~0ULL >> (63 - i)));
+         nls &= nls - 1;
+      }
+      while (ends != 0) {
+         spans[ended].length = pos + __builtin_ctzll(ends)
+            - spans[ended].offset;
+         ended++;
+         ends &= ends - 1;
+      }
+      prev_delim = delims >> 63;
+   }
+   list->count = ended;
+   if (started > ended) start = list->spans[ended].offset;
+#  endif
+
+   for (; pos < last; pos++) {
+      c = text[pos];
+      is_delim = (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+      if (is_delim && !prev_delim)
+         Add_token(list, start, pos - start);
+      else if (!is_delim && prev_delim)
+         start = pos;
+      if (c == '\n' && pos + 1 < last)
+         Add_line(list);
+      prev_delim = is_delim;
+   }
+   if (!prev_delim)
+      Add_token(list, start, last - start);
+}  /* Tokenize_chunk */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_alloc
+ * Purpose:   Allocate a list for the concatenation of lists[0], ...,
+ *            lists[list_count-1]
+ * In args:   lists, list_count
+ * Out arg:   all:  its count and line_count are set, but its tokens
+ *               and lines aren't
+ */
+void Merge_alloc(token_list_t lists[], int list_count,
+      token_list_t* all) {
+   int l;
+
+   all->count = all->line_count = 0;
+   for (l = 0; l < list_count; l++) {
+      all->count += lists[l].count;
+      all->line_count += lists[l].line_count;
+   }
+   all->capacity = (all->count > 0) ? all->count : 1;
+   all->line_capacity = (all->line_count > 0) ? all->line_count : 1;
+   all->spans = malloc(all->capacity*sizeof(token_span_t));
+   all->line_first = malloc(all->line_capacity*sizeof(long));
+}  /* Merge_alloc */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_copy
+ * Purpose:   Copy lists[l] into its place in the list allocated by
+ *            Merge_alloc.  The calls for different l can run in
+ *            parallel.
+ * In args:   lists, l
+ * In/out:    all
+ */
+void Merge_copy(token_list_t lists[], int l, token_list_t* all) {
+   long count = 0, line_count = 0, j;
+   int k;
+
+   for (k = 0; k < l; k++) {
+      count += lists[k].count;
+      line_count += lists[k].line_count;
+   }
+   memcpy(all->spans + count, lists[l].spans,
+         lists[l].count*sizeof(token_span_t));
+   for (j = 0; j < lists[l].line_count; j++)
+      all->line_first[line_count + j] = count + lists[l].line_first[j];
+}  /* Merge_copy */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_token_lists
+ * Purpose:   Concatenate lists[0], ..., lists[list_count-1] into one
+ *            list, in order.  If the lists are of consecutive chunks,
+ *            all has the tokens and lines of the text in order.
+ * In args:   lists, list_count
+ * Out arg:   all
+ */
+void Merge_token_lists(token_list_t lists[], int list_count,
+      token_list_t* all) {
+   int l;
+
+   Merge_alloc(lists, list_count, all);
+   for (l = 0; l < list_count; l++)
+      Merge_copy(lists, l, all);
+}  /* Merge_token_lists */
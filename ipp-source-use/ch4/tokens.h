@@ -0,0 +1,42 @@
+/* File:     tokens.h
+ * Purpose:  Header file for tokens.c, which splits a memory-mapped
+ *           text file into tokens without copying or changing it.
+ */
+#ifndef _TOKENS_H_
+#define _TOKENS_H_
+
+/* Characters that separate tokens.  '\n' also ends a line. */
+#define TOKEN_DELIMS " \t\r\n"
+
+/* A token is text[offset], ..., text[offset+length-1] */
+typedef struct {
+   long  offset;
+   int   length;
+}  token_span_t;
+
+typedef struct {
+   token_span_t* spans;
+   long          count;        /* Number of tokens                    */
+   long          capacity;
+   long*         line_first;   /* Line j's tokens are spans[line_first
+                                  [j]], ..., spans[line_first[j+1]-1]
+                                  (or spans[count-1] for the last
+                                  line)                               */
+   long          line_count;
+   long          line_capacity;
+}  token_list_t;
+
+char* Map_text(char fname[], long* size_p);
+void  Unmap_text(char* text, long size);
+long  Chunk_first(const char* text, long size, int chunk, int chunk_count);
+void  Token_list_init(token_list_t* list, long capacity);
+void  Token_list_free(token_list_t* list);
+void  Tokenize_chunk(const char* text, long first, long last,
+         token_list_t* list);
+void  Merge_token_lists(token_list_t lists[], int list_count,
+         token_list_t* all);
+void  Merge_alloc(token_list_t lists[], int list_count,
+         token_list_t* all);
+void  Merge_copy(token_list_t lists[], int l, token_list_t* all);
+
+#endif
@@ -0,0 +1,320 @@
+/* File:     word_freq.c
+ *
+ * Purpose:  Count how often each token occurs, using threads, and find
+ *           the k most frequent tokens.
+ *
+ * Hash_token:       Hash the characters of a token
+ * Word_partition:   Find the partition of a token from its hash
+ * Word_map_init:    Allocate an empty hash map
+ * Word_map_free:    Free it
+ * Word_map_add:     Add to the count of a token in a map
+ * Count_tokens:     Count the tokens in a list from tokens.c, with one
+ *                   map for each partition
+ * Merge_partition:  Add up the counts of one partition from all the
+ *                   threads' maps
+ * Top_k:            Find the k entries with the largest counts
+ *
+ * Usage:    Thread t calls Count_tokens with its token list and its
+ *           own maps, maps[t*P], ..., maps[t*P + P-1], where P is the
+ *           number of partitions.  Then thread q calls Merge_partition
+ *           for partition q, and Top_k on the result.  Last, one thread
+ *           calls Top_k on the P lists of the threads' top k tokens.
+ *
+ * Notes:
+ * 1.  The maps store the offset and length of a token in the text, not
+ *     a copy of it (see tokens.h).
+ * 2.  Every token goes to the same partition in every thread's maps,
+ *     so the threads can merge different partitions at the same time
+ *     without locks.  The partition is taken from the high bits of the
+ *     hash, and the slot in a map from the low bits.
+ * 3.  Hash_token is a multiply-and-fold hash in the style of wyhash:
+ *     it reads 8 bytes at a time and mixes them into the hash with a
+ *     64x64 -> 128 bit multiply.
+ * 4.  A token's entry keeps the offset of its first occurrence in the
+ *     text, and Top_k breaks ties in the counts by this offset.  So the
+ *     results don't depend on the number of threads.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "word_freq.h"
+
+#define P0 0xa0761d6478bd642fULL
+#define P1 0xe7037ed1a0b428dbULL
+#define P2 0x8ebc6af09c88c6e3ULL
+#define P3 0x589965cc75374cc3ULL
+
+static int Less(const word_entry_t* a, const word_entry_t* b);
+static void Sift_down(word_entry_t heap[], int n, int i);
+static int Compare_desc(const void* a_p, const void* b_p);
+
+/*---------------------------------------------------------------------
+ * Function:  Mix
+ * Purpose:   Multiply a and b, and fold the 128-bit product to 64 bits
+ */
+static inline unsigned long long Mix(unsigned long long a,
+      unsigned long long b) {
+   unsigned __int128 r = (unsigned __int128) a*b;
+
+   return (unsigned long long) r ^ (unsigned long long) (r >> 64);
+}  /* Mix */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Hash_token
+ * Purpose:   Hash the characters p[0], ..., p[length-1]
+ * In args:   p, length
+ * Ret val:   The hash
+ * Note:      Doesn't read past p[length-1], so it can be used at the
+ *            end of a memory-mapped file.
+ */
+unsigned long long Hash_token(const char* p, int length) {
+   unsigned long long h = P0 ^ ((unsigned long long) length*P1);
+   unsigned long long w;
+   int n = length;
+
+   for (; n >= 8; p += 8, n -= 8) {
+      memcpy(&w, p, 8);
+      h = Mix(w ^ P1, h ^ P2);
+   }
+   w = 0;
+   memcpy(&w, p, n);
+   h = Mix(w ^ P3, h ^ P1);
+
+   return Mix(h, P0 ^ length);
+}  /* Hash_token */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Word_partition
+ * Purpose:   Find the partition of a token with the given hash
+ * In args:   hash, partition_count
+ * Ret val:   0 <= partition < partition_count
+ */
+int Word_partition(unsigned long long hash, int partition_count) {
+   return (hash >> 32)*partition_count >> 32;
+}  /* Word_partition */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Word_map_init
+ * Purpose:   Allocate an empty map
+ * In arg:    capacity:  rounded up to a power of 2.  The map grows
+ *               when it's half full.
+ * Out arg:   map
+ */
+void Word_map_init(word_map_t* map, long capacity) {
+   long c = 16;
+
+   while (c < capacity) c *= 2;
+   map->entries = calloc(c, sizeof(word_entry_t));
+   map->capacity = c;
+   map->count = 0;
+}  /* Word_map_init */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Word_map_free
+ * Purpose:   Free the storage of a map
+ * In/out:    map
+ */
+void Word_map_free(word_map_t* map) {
+   free(map->entries);
+   memset(map, 0, sizeof(word_map_t));
+}  /* Word_map_free */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Grow
+ * Purpose:   Double the capacity of a map
+ * In/out:    map
+ */
+static void Grow(word_map_t* map) {
+   word_entry_t* old = map->entries;
+   long old_capacity = map->capacity;
+   long mask, i, j;
+
+   map->capacity *= 2;
+   map->entries = calloc(map->capacity, sizeof(word_entry_t));
+   mask = map->capacity - 1;
+   for (i = 0; i < old_capacity; i++)
+      if (old[i].count > 0) {
+         j = old[i].hash & mask;
+         while (map->entries[j].count > 0)
+            j = (j + 1) & mask;
+         map->entries[j] = old[i];
+      }
+   free(old);
+}  /* Grow */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Word_map_add
+ * Purpose:   Add count to the count of the token text[offset], ...,
+ *            text[offset+length-1], inserting it if it isn't in the
+ *            map
+ * In args:   text, hash, offset, length, count
+ * In/out:    map
+ */
+void Word_map_add(word_map_t* map, const char* text,
+      unsigned long long hash, long offset, int length, long count) {
+   long mask, j;
+   word_entry_t* e;
+
+   if (2*(map->count + 1) > map->capacity) Grow(map);
+   mask = map->capacity - 1;
+   j = hash & mask;
+   for (;;) {
+      e = &map->entries[j];
+      if (e->count == 0) {
+         e->hash = hash;
+         e->offset = offset;
+         e->length = length;
+         e->count = count;
+         map->count++;
+         return;
+      }
+      if (e->hash == hash && e->length == length
+            && memcmp(text + e->offset, text + offset, length) == 0) {
+         e->count += count;
+         if (offset < e->offset) e->offset = offset;
+         return;
+      }
+      j = (j + 1) & mask;
+   }
+}  /* Word_map_add */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Count_tokens
+ * Purpose:   Add the tokens in list to the maps
+ * In args:   text, list, partition_count
+ * In/out:    maps:  maps[q] has the tokens in partition q
+ */
+void Count_tokens(const char* text, token_list_t* list,
+      word_map_t maps[], int partition_count) {
+   token_span_t* s;
+   unsigned long long h;
+   long t;
+
+   for (t = 0; t < list->count; t++) {
+      s = &list->spans[t];
+      h = Hash_token(text + s->offset, s->length);
+      Word_map_add(&maps[Word_partition(h, partition_count)], text, h,
+            s->offset, s->length, 1);
+   }
+}  /* Count_tokens */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_partition
+ * Purpose:   Add up the counts in partition part of all the threads'
+ *            maps
+ * In args:   text
+ *            maps:  maps[t*partition_count + part] is thread t's map
+ *               for partition part
+ *            map_count:  the number of threads' maps
+ *            part, partition_count
+ * Out arg:   result:  initialized by this function
+ */
+void Merge_partition(const char* text, word_map_t maps[], int map_count,
+      int part, int partition_count, word_map_t* result) {
+   word_map_t* m;
+   word_entry_t* e;
+   long total = 0, i;
+   int t;
+
+   for (t = 0; t < map_count; t++)
+      total += maps[t*partition_count + part].count;
+   Word_map_init(result, 2*total);
+   for (t = 0; t < map_count; t++) {
+      m = &maps[t*partition_count + part];
+      for (i = 0; i < m->capacity; i++) {
+         e = &m->entries[i];
+         if (e->count > 0)
+            Word_map_add(result, text, e->hash, e->offset, e->length,
+                  e->count);
+      }
+   }
+}  /* Merge_partition */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Less
+ * Purpose:   Decide whether entry a ranks below entry b:  it has a
+ *            smaller count, or the same count and a later first
+ *            occurrence
+ */
+static int Less(const word_entry_t* a, const word_entry_t* b) {
+   if (a->count != b->count) return a->count < b->count;
+   return a->offset > b->offset;
+}  /* Less */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Sift_down
+ * Purpose:   Restore the min-heap property of heap[0..n-1] below i
+ */
+static void Sift_down(word_entry_t heap[], int n, int i) {
+   word_entry_t tmp;
+   int c;
+
+   while ((c = 2*i + 1) < n) {
+      if (c + 1 < n && Less(&heap[c+1], &heap[c])) c++;
+      if (!Less(&heap[c], &heap[i])) break;
+      tmp = heap[i]; heap[i] = heap[c]; heap[c] = tmp;
+      i = c;
+   }
+}  /* Sift_down */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_desc
+ * Purpose:   qsort comparison that puts the highest ranked entries
+ *            first
+ */
+static int Compare_desc(const void* a_p, const void* b_p) {
+   const word_entry_t* a = a_p;
+   const word_entry_t* b = b_p;
+
+   if (Less(a, b)) return 1;
+   if (Less(b, a)) return -1;
+   return 0;
+}  /* Compare_desc */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Top_k
+ * Purpose:   Find the k highest ranked entries among entries[0], ...,
+ *            entries[n-1], ignoring empty slots.  The entries can be a
+ *            map's entries (n = capacity), or the concatenated results
+ *            of earlier calls.
+ * In args:   entries, n, k
+ * Out arg:   top:  the entries found, highest ranked first
+ * Ret val:   The number of entries found:  min(k, number of entries
+ *            with count > 0)
+ * Note:      Uses a min-heap of the best k entries so far, so it takes
+ *            O(n log k) time.
+ */
+int Top_k(word_entry_t entries[], long n, int k, word_entry_t top[]) {
+   long i;
+   int size = 0, j;
+
+   if (k <= 0) return 0;
+   for (i = 0; i < n; i++) {
+      if (entries[i].count == 0) continue;
+      if (size < k) {
+         top[size++] = entries[i];
+         if (size == k) {
+            for (j = k/2 - 1; j >= 0; j--)
+               Sift_down(top, k, j);
+         }
+      } else if (Less(&top[0], &entries[i])) {
+         top[0] = entries[i];
+         Sift_down(top, k, 0);
+      }
+   }
+   qsort(top, size, sizeof(word_entry_t), Compare_desc);
+
+   return size;
+}  /* Top_k */
@@ -0,0 +1,40 @@
+/* File:     word_freq.h
+ * Purpose:  Header file for word_freq.c, which counts the tokens found
+ *           by tokens.c with hash maps that are split into partitions,
+ *           so that the threads' counts can be combined in parallel.
+ */
+#ifndef _WORD_FREQ_H_
+#define _WORD_FREQ_H_
+
+#include "tokens.h"
+
+/* A distinct token:  text[offset], ..., text[offset+length-1] is its
+ * first occurrence, and count is the number of occurrences.  An empty
+ * slot in a map has count 0. */
+typedef struct {
+   unsigned long long hash;
+   long               offset;
+   int                length;
+   long               count;
+}  word_entry_t;
+
+/* Open addressing hash map with linear probing */
+typedef struct {
+   word_entry_t* entries;
+   long          capacity;   /* A power of 2 */
+   long          count;      /* Number of distinct tokens */
+}  word_map_t;
+
+unsigned long long Hash_token(const char* p, int length);
+int  Word_partition(unsigned long long hash, int partition_count);
+void Word_map_init(word_map_t* map, long capacity);
+void Word_map_free(word_map_t* map);
+void Word_map_add(word_map_t* map, const char* text,
+        unsigned long long hash, long offset, int length, long count);
+void Count_tokens(const char* text, token_list_t* list,
+        word_map_t maps[], int partition_count);
+void Merge_partition(const char* text, word_map_t maps[], int map_count,
+        int part, int partition_count, word_map_t* result);
+int  Top_k(word_entry_t entries[], long n, int k, word_entry_t top[]);
+
+#endif
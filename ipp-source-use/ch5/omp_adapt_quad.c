@@ -0,0 +1,222 @@
+/* File:    omp_adapt_quad.c
+ * Purpose: Estimate a definite integral to a given accuracy using
+ *          adaptive Gauss-Kronrod quadrature.  Subintervals whose
+ *          error estimate is too large are bisected, and the two
+ *          halves are integrated by separate OpenMP tasks.  For
+ *          comparison, the program also finds the number of
+ *          trapezoids the trapezoidal rule (omp_trap3.c) needs for the
+ *          same accuracy, and times both.
+ *
+ * Input:   a, b, tol
+ * Output:  Estimates of the integral from a to b of f(x), the number
+ *          of evaluations of f and the run times of the adaptive and
+ *          uniform methods.
+ *
+ * Compile: gcc -g -Wall -O2 -fopenmp -o omp_adapt_quad omp_adapt_quad.c -lm
+ * Usage:   ./omp_adapt_quad <number of threads>
+ *
+ * Notes:
+ *   1.  The function f(x) is hardwired.  It's sqrt(|x|), which has an
+ *       unbounded derivative at 0:  the adaptive method only refines
+ *       near 0, while the trapezoidal rule needs a small h everywhere.
+ *   2.  Each subinterval is integrated with the 15-point Kronrod rule.
+ *       The difference between it and the embedded 7-point Gauss rule
+ *       is the error estimate.  A subinterval [l, r] is accepted when
+ *       its error estimate is at most tol*(r-l)/(b-a), so the total
+ *       error estimate is at most tol.
+ *   3.  Tasks aren't created below depth TASK_DEPTH:  below that, a
+ *       subinterval is refined by the thread that owns it.
+ *   4.  The trapezoidal rule's error with n trapezoids is estimated by
+ *       |T(2n) - T(n)|/3, doubling n until it's at most tol.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+/* Deepest level at which tasks are created */
+#define TASK_DEPTH 16
+
+/* Subintervals aren't bisected past this depth */
+#define MAX_DEPTH 60
+
+/* Largest number of trapezoids tried */
+#define MAX_N (1L << 30)
+
+void Usage(char* prog_name);
+double f(double x);    /* Function we're integrating */
+double Kronrod(double l, double r, double* err_p);
+double Adapt(double l, double r, double tol_per_len, int depth,
+      long* evals_p, double* err_p);
+double Trap(double a, double b, long n, int thread_count);
+
+/* 15-point Gauss-Kronrod rule on [-1, 1]:  xgk[1], xgk[3], xgk[5]
+ * and xgk[7] = 0 are the nodes of the 7-point Gauss rule */
+const double xgk[8] = {
+   0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+   0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+   0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+   0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+const double wgk[8] = {
+   0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+   0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+   0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+   0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+const double wg[4] = {
+   0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+   0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+int main(int argc, char* argv[]) {
+   double  adapt_result, trap_result = 0.0, prev;
+   double  a, b, tol, err;
+   long    evals = 0, n;
+   int     thread_count;
+   double  start, adapt_time, trap_time = 0.0;
+
+   if (argc != 2) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   printf("Enter a, b, and tol\n");
+   if (scanf("%lf %lf %lf", &a, &b, &tol) != 3 || !(a < b) || tol <= 0.0)
+      Usage(argv[0]);
+
+   start = omp_get_wtime();
+#  pragma omp parallel num_threads(thread_count)
+#  pragma omp single
+   adapt_result = Adapt(a, b, tol/(b-a), 0, &evals, &err);
+   adapt_time = omp_get_wtime() - start;
+
+   printf("Adaptive:  our estimate of the integral from %f to %f\n", a, b);
+   printf("   = %.14e, estimated error = %.2e\n", adapt_result, err);
+   printf("   %ld evaluations of f, %e seconds\n", evals, adapt_time);
+
+   /* Double n until the trapezoidal rule reaches tol */
+   prev = Trap(a, b, 1, thread_count);
+   for (n = 2; n <= MAX_N; n *= 2) {
+      start = omp_get_wtime();
+      trap_result = Trap(a, b, n, thread_count);
+      trap_time = omp_get_wtime() - start;
+      if (fabs(trap_result - prev)/3.0 <= tol) break;
+      prev = trap_result;
+   }
+
+   if (n > MAX_N) {
+      printf("Trapezoidal rule:  tol not reached with n = %ld\n", MAX_N);
+   } else {
+      printf("Trapezoidal rule:  with n = %ld trapezoids\n", n);
+      printf("   = %.14e, estimated error = %.2e\n", trap_result,
+            fabs(trap_result - prev)/3.0);
+      printf("   %ld evaluations of f, %e seconds\n", n+1, trap_time);
+   }
+   return 0;
+}  /* main */
+
+/*--------------------------------------------------------------------
+ * Function:    Usage
+ * Purpose:     Print command line for function and terminate
+ * In arg:      prog_name
+ */
+void Usage(char* prog_name) {
+
+   fprintf(stderr, "usage: %s <number of threads>\n", prog_name);
+   fprintf(stderr, "   then enter a, b, and tol, with a < b and tol > 0\n");
+   exit(0);
+}  /* Usage */
+
+/*------------------------------------------------------------------
+ * Function:    f
+ * Purpose:     Compute value of function to be integrated
+ * Input arg:   x
+ * Return val:  f(x)
+ */
+double f(double x) {
+   double return_val;
+
+   return_val = sqrt(fabs(x));
+   return return_val;
+}  /* f */
+
+/*------------------------------------------------------------------
+ * Function:    Kronrod
+ * Purpose:     Apply the 15-point Gauss-Kronrod rule to [l, r]
+ * Input args:  l, r
+ * Output arg:  err_p:  |Kronrod estimate - Gauss estimate|
+ * Return val:  Kronrod estimate of the integral from l to r
+ */
+double Kronrod(double l, double r, double* err_p) {
+   double c = (l + r)/2.0, h = (r - l)/2.0;
+   double fc = f(c), f1, f2;
+   double res_k = wgk[7]*fc, res_g = wg[3]*fc;
+   int j;
+
+   for (j = 0; j < 7; j++) {
+      f1 = f(c - h*xgk[j]);
+      f2 = f(c + h*xgk[j]);
+      res_k += wgk[j]*(f1 + f2);
+      if (j % 2 == 1) res_g += wg[j/2]*(f1 + f2);
+   }
+
+   *err_p = fabs((res_k - res_g)*h);
+   return res_k*h;
+}  /* Kronrod */
+
+/*------------------------------------------------------------------
+ * Function:    Adapt
+ * Purpose:     Estimate the integral from l to r with error at most
+ *              tol_per_len*(r-l), bisecting [l, r] if necessary
+ * Input args:  l, r, tol_per_len
+ *              depth:  number of bisections that produced [l, r]
+ * In/out arg:  evals_p:  number of evaluations of f
+ * Output arg:  err_p:  the estimated error
+ * Return val:  the estimate of the integral
+ * Note:        The two halves are integrated by separate tasks
+ *              until depth TASK_DEPTH.
+ */
+double Adapt(double l, double r, double tol_per_len, int depth,
+      long* evals_p, double* err_p) {
+   double m, est, err, left, right, left_err, right_err;
+   long left_evals = 0, right_evals = 0;
+
+   est = Kronrod(l, r, &err);
+   *evals_p += 15;
+   if (err <= tol_per_len*(r - l) || depth >= MAX_DEPTH) {
+      *err_p = err;
+      return est;
+   }
+
+   m = (l + r)/2.0;
+#  pragma omp task shared(left, left_evals, left_err) \
+      if(depth < TASK_DEPTH)
+   left = Adapt(l, m, tol_per_len, depth+1, &left_evals, &left_err);
+   right = Adapt(m, r, tol_per_len, depth+1, &right_evals, &right_err);
+#  pragma omp taskwait
+
+   *evals_p += left_evals + right_evals;
+   *err_p = left_err + right_err;
+   return left + right;
+}  /* Adapt */
+
+/*------------------------------------------------------------------
+ * Function:    Trap
+ * Purpose:     Use trapezoidal rule to estimate definite integral
+ * Input args:
+ *    a: left endpoint
+ *    b: right endpoint
+ *    n: number of trapezoids
+ * Return val:
+ *    approx:  estimate of integral from a to b of f(x)
+ */
+double Trap(double a, double b, long n, int thread_count) {
+   double  h, approx;
+   long  i;
+
+   h = (b-a)/n;
+   approx = (f(a) + f(b))/2.0;
+#  pragma omp parallel for num_threads(thread_count) \
+      reduction(+: approx)
+   for (i = 1; i <= n-1; i++)
+     approx += f(a + i*h);
+   approx = h*approx;
+
+   return approx;
+}  /* Trap */
@@ -13,6 +13,7 @@
  *
  * Note:     If your output seems to be OK, try increasing the number of
  *           threads and/or n.
+ *           See omp_fibo_scan.c for a version that's correct.
  *
  * IPP:      Section 5.5.2 (pp. 227 and ff.)
  */
@@ -0,0 +1,166 @@
+/* File:     omp_fibo_scan.c
+ *
+ * Purpose:  Compute n Fibonacci numbers correctly with OpenMP.  The
+ *           loop in omp_fibo.c can't be parallelized as it stands,
+ *           since each iteration uses the results of the two before
+ *           it.  Here the recurrence is written as a product of 2x2
+ *           matrices, which is computed with a parallel scan.
+ *
+ * Compile:  gcc -g -Wall -O2 -fopenmp -I../ch4 -o omp_fibo_scan
+ *              omp_fibo_scan.c
+ * Run:      ./omp_fibo_scan <number of threads> <number of Fibonacci
+ *              numbers> [p]
+ *
+ * Input:    none
+ * Output:   The last Fibonacci number, the run times of the parallel
+ *           and the serial loops, and whether their results agree.
+ *           With p, a list of all the Fibonacci numbers.
+ *
+ * Algorithm:
+ *    With v[i] = (fibo[i], fibo[i-1]) and M = |1 1|
+ *                                             |1 0|,
+ *    v[i] = M*v[i-1], so v[i] = M^(i-1)*v[1].  The indices 2, ..., n-1
+ *    are split into one block per thread.
+ *    1.  Each thread finds the matrix of its block, M^(block size).
+ *    2.  After a barrier, each thread multiplies the matrices of the
+ *        lower ranked blocks (an exclusive scan with Mat2_after in
+ *        ../ch4/scan.h) to get the matrix that maps v[1] to the pair
+ *        just before its block.
+ *    3.  Each thread runs the ordinary loop over its block, starting
+ *        from this pair.
+ *    For a recurrence whose coefficients change with i, step 1 is a
+ *    Mat2_reduce of the block's step matrices instead of a power.
+ *
+ * Notes:
+ * 1.  The arithmetic is unsigned and mod 2^64, so the numbers
+ *     "overflow" without undefined behavior, and the parallel and
+ *     serial results should agree exactly for all n.
+ * 2.  Only step 3 takes time proportional to n, and it has no
+ *     dependences between the threads.
+ *
+ * IPP:      Section 5.5.2 (pp. 227 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "scan.h"
+
+void Usage(char prog_name[]);
+void Fibo_scan(unsigned long long fibo[], long n, int thread_count);
+void Fibo_serial(unsigned long long fibo[], long n);
+
+int main(int argc, char* argv[]) {
+   int thread_count;
+   long n, i;
+   unsigned long long *fibo, *check;
+   double start, par_time, ser_time;
+
+   if (argc != 3 && argc != 4) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   n = strtol(argv[2], NULL, 10);
+   if (thread_count <= 0 || n <= 0) Usage(argv[0]);
+
+   fibo = malloc(n*sizeof(unsigned long long));
+   check = malloc(n*sizeof(unsigned long long));
+
+   start = omp_get_wtime();
+   Fibo_scan(fibo, n, thread_count);
+   par_time = omp_get_wtime() - start;
+
+   start = omp_get_wtime();
+   Fibo_serial(check, n);
+   ser_time = omp_get_wtime() - start;
+
+   if (argc == 4 && argv[3][0] == 'p') {
+      printf("The first n Fibonacci numbers (mod 2^64):\n");
+      for (i = 0; i < n; i++)
+         printf("%ld\t%llu\n", i, fibo[i]);
+   }
+   printf("fibo[%ld] = %llu (mod 2^64)\n", n-1, fibo[n-1]);
+   for (i = 0; i < n; i++)
+      if (fibo[i] != check[i]) break;
+   if (i < n)
+      printf("The parallel and serial results differ at %ld\n", i);
+   else
+      printf("The parallel and serial results agree\n");
+   printf("Parallel:  %e seconds\n", par_time);
+   printf("Serial:    %e seconds\n", ser_time);
+
+   free(check);
+   free(fibo);
+   return 0;
+}  /* main */
+
+void Usage(char prog_name[]) {
+   fprintf(stderr, "usage:  %s <thread count> <number of Fibonacci numbers> [p]\n",
+         prog_name);
+   fprintf(stderr, "   p:  print all the numbers\n");
+   exit(0);
+}  /* Usage */
+
+
+/*--------------------------------------------------------------------
+ * Function:  Fibo_scan
+ * Purpose:   Compute fibo[0], ..., fibo[n-1] with thread_count threads
+ * In args:   n, thread_count
+ * Out arg:   fibo
+ */
+void Fibo_scan(unsigned long long fibo[], long n, int thread_count) {
+   mat2_t* blocks = malloc(thread_count*sizeof(mat2_t));
+
+   fibo[0] = 1;
+   if (n > 1) fibo[1] = 1;
+   if (n <= 2) {
+      free(blocks);
+      return;
+   }
+
+#  pragma omp parallel num_threads(thread_count) default(none) \
+      shared(fibo, n, thread_count, blocks, MAT2_IDENTITY)
+   {
+      const mat2_t M = {1, 1, 1, 0};
+      int my_rank = omp_get_thread_num();
+      long my_first = 2 + Scan_first(n-2, my_rank, thread_count);
+      long my_last = 2 + Scan_first(n-2, my_rank+1, thread_count);
+      unsigned long long prev, prev2, next;
+      mat2_t carry;
+      long i;
+
+      /* Step 1 */
+      blocks[my_rank] = Mat2_pow(M, my_last - my_first);
+#     pragma omp barrier
+
+      /* Step 2:  carry maps (fibo[1], fibo[0]) to (fibo[my_first-1],
+       * fibo[my_first-2]) */
+      carry = Mat2_reduce(blocks, 0, my_rank, MAT2_IDENTITY);
+      prev = carry.a + carry.b;
+      prev2 = carry.c + carry.d;
+
+      /* Step 3 */
+      for (i = my_first; i < my_last; i++) {
+         next = prev + prev2;
+         fibo[i] = next;
+         prev2 = prev;
+         prev = next;
+      }
+   }
+
+   free(blocks);
+}  /* Fibo_scan */
+
+
+/*--------------------------------------------------------------------
+ * Function:  Fibo_serial
+ * Purpose:   Compute fibo[0], ..., fibo[n-1] with the loop in
+ *            omp_fibo.c
+ * In arg:    n
+ * Out arg:   fibo
+ */
+void Fibo_serial(unsigned long long fibo[], long n) {
+   long i;
+
+   fibo[0] = 1;
+   if (n > 1) fibo[1] = 1;
+   for (i = 2; i < n; i++)
+      fibo[i] = fibo[i-1] + fibo[i-2];
+}  /* Fibo_serial */
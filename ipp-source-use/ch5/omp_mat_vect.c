@@ -14,10 +14,11 @@
  *
  * Output:
  *     y: the product vector
- *     Elapsed time for the computation
+ *     On stderr, the time for the computation (see ../ch3/prof.h)
  *
  * Compile:  
- *    gcc -g -Wall -o omp_mat_vect omp_mat_vect.c -lpthread
+ *    gcc -g -Wall -fopenmp -I../ch3 -o omp_mat_vect omp_mat_vect.c
+ *       ../ch3/prof.c -lpthread
  * Usage:
  *    omp_mat_vect <thread_count> <m> <n>
  *
@@ -31,8 +32,8 @@
  *         globally shared.
  *     5.  DEBUG compile flag will prompt for input of A, x, and
  *         print y
- *     6.  Uses the OpenMP library function omp_get_wtime() to
- *         return the time elapsed since some point in the past
+ *     6.  The multiplication is timed as region mat_vect, which
+ *         the program runs REPS times after one warm up run
  *
  * IPP:    Section 5.9 (pp. 253 and ff.)
  */
@@ -40,6 +41,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <omp.h>
+#include "prof.h"
+
+#define REPS 10
 
 /* Serial functions */
 void Get_args(int argc, char* argv[], int* thread_count_p, 
@@ -82,7 +86,9 @@ int main(int argc, char* argv[]) {
 /*    Print_vector("We generated", x, n); */
  # endif
 
-   Omp_mat_vect(A, x, y, m, n, thread_count);
+   PROF_REPEAT("mat_vect", 1, REPS)
+      Omp_mat_vect(A, x, y, m, n, thread_count);
+   PROF_REPORT();
 
 #  ifdef DEBUG
       Print_vector("The product is", y, m);
@@ -192,9 +198,7 @@ void Read_vector(char* prompt, double x[], int n) {
 void Omp_mat_vect(double A[], double x[], double y[],
       int m, int n, int thread_count) {
    int i, j;
-   double start, finish, elapsed;
 
-   start = omp_get_wtime();
 #  pragma omp parallel for num_threads(thread_count)  \
       default(none) private(i, j)  shared(A, x, y, m, n)
    for (i = 0; i < m; i++) {
@@ -202,10 +206,6 @@ void Omp_mat_vect(double A[], double x[], double y[],
       for (j = 0; j < n; j++)
          y[i] += A[i*n+j]*x[j];
    }
-   finish = omp_get_wtime();
-   elapsed = finish - start;
-   printf("Elapsed time = %e seconds\n", elapsed);
-
 }  /* Omp_mat_vect */
 
 
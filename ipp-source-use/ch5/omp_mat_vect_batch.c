@@ -0,0 +1,239 @@
+/* File:
+ *     omp_mat_vect_batch.c
+ *
+ * Purpose:
+ *     Computes a parallel "batched" matrix-vector product Y = AX,
+ *     where A is m x n and X is an n x k matrix whose columns are
+ *     k different vectors x.  A is streamed from memory once for
+ *     the whole batch instead of once per vector.  Rows of A and Y
+ *     are divided among the threads with a parallel for directive.
+ *
+ * Compile:
+ *    gcc -g -Wall -O3 -fopenmp -o omp_mat_vect_batch omp_mat_vect_batch.c
+ * Run:
+ *    ./omp_mat_vect_batch <thread_count> <m> <n> <k>
+ *
+ * Input:
+ *     None
+ *
+ * Output:
+ *     Elapsed time for the computation, GFLOP/s, and the arithmetic
+ *     intensity of the batched product compared to k separate
+ *     matrix-vector products
+ *
+ * Notes:
+ *     1.  Storage for A, X, Y is dynamically allocated.
+ *     2.  A, X and Y are stored by rows:  A[i][j] = A[i*n + j],
+ *         X[j][c] = X[j*k + c], Y[i][c] = Y[i*k + c].  So the
+ *         innermost loop over the batch index c is unit stride
+ *         and is vectorized with a simd directive.
+ *     3.  The columns of A are processed in blocks so that the
+ *         rows of X used by a block fit in X_CACHE_BYTES bytes
+ *         (default 128 KB, override with -DX_CACHE_BYTES=<bytes>).
+ *     4.  DEBUG compile flag prints A, X and Y.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#ifndef X_CACHE_BYTES
+#define X_CACHE_BYTES (128*1024)
+#endif
+
+/* Serial functions */
+void Get_args(int argc, char* argv[], int* thread_count_p,
+      int* m_p, int* n_p, int* k_p);
+void Usage(char* prog_name);
+void Gen_matrix(double A[], int m, int n);
+void Print_matrix(char* title, double A[], int m, int n);
+int  Col_block(int k);
+void Print_stats(double elapsed, int m, int n, int k);
+
+/* Parallel function */
+void Omp_mat_vect_batch(double* restrict A, double* restrict X,
+      double* restrict Y, int m, int n, int k, int thread_count);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int     thread_count;
+   int     m, n, k;
+   double* A;
+   double* X;
+   double* Y;
+   double  start, finish;
+
+   Get_args(argc, argv, &thread_count, &m, &n, &k);
+
+   A = malloc((size_t) m*n*sizeof(double));
+   X = malloc((size_t) n*k*sizeof(double));
+   Y = malloc((size_t) m*k*sizeof(double));
+
+   Gen_matrix(A, m, n);
+   Gen_matrix(X, n, k);
+#  ifdef DEBUG
+   Print_matrix("We generated A", A, m, n);
+   Print_matrix("We generated X", X, n, k);
+#  endif
+
+   start = omp_get_wtime();
+   Omp_mat_vect_batch(A, X, Y, m, n, k, thread_count);
+   finish = omp_get_wtime();
+
+#  ifdef DEBUG
+   Print_matrix("The product is", Y, m, k);
+#  endif
+   Print_stats(finish - start, m, n, k);
+
+   free(A);
+   free(X);
+   free(Y);
+
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get command line args
+ * In args:   argc, argv
+ * Out args:  thread_count_p, m_p, n_p, k_p
+ */
+void Get_args(int argc, char* argv[], int* thread_count_p,
+      int* m_p, int* n_p, int* k_p)  {
+
+   if (argc != 5) Usage(argv[0]);
+   *thread_count_p = strtol(argv[1], NULL, 10);
+   *m_p = strtol(argv[2], NULL, 10);
+   *n_p = strtol(argv[3], NULL, 10);
+   *k_p = strtol(argv[4], NULL, 10);
+   if (*thread_count_p <= 0 || *m_p <= 0 || *n_p <= 0 || *k_p <= 0)
+      Usage(argv[0]);
+
+}  /* Get_args */
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   print a message showing what the command line should
+ *            be, and terminate
+ * In arg :   prog_name
+ */
+void Usage (char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <m> <n> <k>\n", prog_name);
+   fprintf(stderr, "   k = number of vectors in the batch\n");
+   exit(0);
+}  /* Usage */
+
+/*------------------------------------------------------------------
+ * Function: Gen_matrix
+ * Purpose:  Use the random number generator random to generate
+ *    the entries in an m x n matrix
+ * In args:  m, n
+ * Out arg:  A
+ */
+void Gen_matrix(double A[], int m, int n) {
+   int i, j;
+   for (i = 0; i < m; i++)
+      for (j = 0; j < n; j++)
+         A[(size_t) i*n+j] = random()/((double) RAND_MAX);
+}  /* Gen_matrix */
+
+/*------------------------------------------------------------------
+ * Function:  Col_block
+ * Purpose:   Find the number of columns of A (= rows of X) that
+ *            should be processed together so that the corresponding
+ *            rows of X fit in X_CACHE_BYTES
+ * In arg:    k
+ * Ret val:   number of columns in a block (at least 1)
+ */
+int Col_block(int k) {
+   int col_block = X_CACHE_BYTES/(k*sizeof(double));
+
+   return col_block > 0 ? col_block : 1;
+}  /* Col_block */
+
+/*------------------------------------------------------------------
+ * Function:  Omp_mat_vect_batch
+ * Purpose:   Multiply an mxn matrix by an nxk matrix
+ * In args:   A, X, m, n, k, thread_count
+ * Out arg:   Y
+ * Note:      Each thread keeps its own block of rows for every
+ *            column block (schedule(static) gives the same rows to
+ *            the same thread each time), so Y stays in the thread's
+ *            cache between column blocks.
+ */
+void Omp_mat_vect_batch(double* restrict A, double* restrict X,
+      double* restrict Y, int m, int n, int k, int thread_count) {
+   int i, j, c, jb, j_last;
+   int col_block = Col_block(k);
+   double a;
+   double* y_row;
+   double* x_row;
+   double* a_row;
+
+#  pragma omp parallel num_threads(thread_count) default(none) \
+      private(i, j, c, jb, j_last, a, y_row, x_row, a_row) \
+      shared(A, X, Y, m, n, k, col_block)
+   {
+#     pragma omp for schedule(static)
+      for (i = 0; i < m; i++)
+         for (c = 0; c < k; c++)
+            Y[(size_t) i*k+c] = 0.0;
+
+      for (jb = 0; jb < n; jb += col_block) {
+         j_last = (jb + col_block < n) ? jb + col_block : n;
+#        pragma omp for schedule(static) nowait
+         for (i = 0; i < m; i++) {
+            a_row = A + (size_t) i*n;
+            y_row = Y + (size_t) i*k;
+            for (j = jb; j < j_last; j++) {
+               a = a_row[j];
+               x_row = X + (size_t) j*k;
+#              pragma omp simd
+               for (c = 0; c < k; c++)
+                  y_row[c] += a*x_row[c];
+            }
+         }
+      }
+   }
+}  /* Omp_mat_vect_batch */
+
+/*------------------------------------------------------------------
+ * Function:    Print_stats
+ * Purpose:     Print elapsed time, flop rate and arithmetic intensity
+ * In args:     elapsed, m, n, k
+ * Notes:
+ * 1.  The batched product does 2mnk flops.  Its compulsory traffic
+ *     is one pass over A, X and Y:  8(mn + nk + mk) bytes.
+ * 2.  k separate matrix-vector products do the same number of flops
+ *     but read A k times:  8k(mn + n + m) bytes.
+ */
+void Print_stats(double elapsed, int m, int n, int k) {
+   double flops = 2.0*m*n*k;
+   double batch_bytes = 8.0*((double) m*n + (double) n*k + (double) m*k);
+   double single_bytes = 8.0*k*((double) m*n + n + m);
+
+   printf("m = %d, n = %d, k = %d\n", m, n, k);
+   printf("Elapsed time = %e seconds\n", elapsed);
+   printf("GFLOP/s = %.3f\n", flops/elapsed/1.0e9);
+   printf("Arithmetic intensity = %.3f flops/byte ", flops/batch_bytes);
+   printf("(k single mat-vects = %.3f flops/byte)\n", flops/single_bytes);
+   printf("Effective bandwidth = %.3f GB/s\n", batch_bytes/elapsed/1.0e9);
+}  /* Print_stats */
+
+
+/*------------------------------------------------------------------
+ * Function:    Print_matrix
+ * Purpose:     Print the matrix
+ * In args:     title, A, m, n
+ */
+void Print_matrix( char* title, double A[], int m, int n) {
+   int   i, j;
+
+   printf("%s\n", title);
+   for (i = 0; i < m; i++) {
+      for (j = 0; j < n; j++)
+         printf("%4.1f ", A[(size_t) i*n + j]);
+      printf("\n");
+   }
+}  /* Print_matrix */
@@ -0,0 +1,441 @@
+/* File:    omp_odd_even3.c
+ *
+ * Purpose: Use block odd-even transposition sort or a parallel merge
+ *          sort to sort a list of ints.  Optionally compare their run
+ *          times with bubble sort, serial odd-even transposition sort
+ *          and omp_odd_even2.c.
+ *
+ * Compile: gcc -g -Wall -O2 -fopenmp -I../ch3 -I../ch4 -o omp_odd_even3
+ *             omp_odd_even3.c ../ch3/local_sort.c
+ * Usage:   ./omp_odd_even3 <thread count> <n> <g|i> [b|m|a]
+ *             n:   number of elements in list
+ *            'g':  generate list using a random number generator
+ *            'i':  user input list
+ *            'b':  block odd-even transposition sort (default)
+ *            'm':  parallel merge sort
+ *            'a':  run all the sorts on copies of the list
+ *
+ * Input:   list (optional)
+ * Output:  elapsed time for sort.  With 'a', the elapsed time of each
+ *          sort, and whether its result agrees with the merge sort.
+ *
+ * Note:
+ * 1.  DEBUG flag prints the contents of the list
+ * 2.  In the block sort each thread sorts a block of
+ *     ceil(n/thread_count) keys with Local_sort (see Block_first in
+ *     ../ch3/local_sort.c).  Then there are thread_count phases:  in
+ *     each phase neighbouring threads do a merge-split of their
+ *     blocks, the lower ranked thread keeping the smaller keys.  So
+ *     there are thread_count phases over blocks instead of n phases
+ *     over single keys, and each phase reads its keys sequentially.
+ * 3.  A merge-split writes the thread's new block to a second buffer.
+ *     Instead of copying it back, the threads publish a pointer to
+ *     their current block for the next phase.  A merge-split whose
+ *     blocks are already in order does nothing.
+ * 4.  In the merge sort each thread sorts its block, and then the runs
+ *     are merged in pairs.  All the threads work on each merge:  a
+ *     thread finds the part of the merged run that goes into its own
+ *     block with a binary search, and merges just that part.
+ * 5.  Like omp_odd_even2.c, both sorts fork the threads once, and the
+ *     phases are separated by barriers.
+ * 6.  Bubble sort and serial odd-even sort take O(n^2) time, so with
+ *     'a' they're skipped if n > SLOW_MAX.  To compare across n, run
+ *     e.g.
+ *        for n in 1000 10000 100000 1000000; do
+ *           ./omp_odd_even3 4 $n g a; done
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "local_sort.h"
+
+#ifdef DEBUG
+const int RMAX = 100;
+#else
+const int RMAX = 10000000;
+#endif
+
+/* Largest n for the O(n^2) sorts with 'a' */
+const int SLOW_MAX = 100000;
+
+int thread_count;
+
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], int* n_p, char* g_i_p,
+      char* sort_p);
+void Generate_list(int a[], int n);
+void Print_list(int a[], int n, char* title);
+void Read_list(int a[], int n);
+void Block_odd_even(int a[], int n);
+void Merge_sort(int a[], int n);
+void Bubble_sort(int a[], int n);
+void Odd_even_sort(int a[], int n);
+void Odd_even(int a[], int n);
+void Run_all(int a[], int n);
+
+/*-----------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int  n;
+   char g_i, sort;
+   int* a;
+   double start, finish;
+
+   Get_args(argc, argv, &n, &g_i, &sort);
+   a = malloc(n*sizeof(int));
+   if (g_i == 'g') {
+      Generate_list(a, n);
+#     ifdef DEBUG
+      Print_list(a, n, "Before sort");
+#     endif
+   } else {
+      Read_list(a, n);
+   }
+
+   if (sort == 'a') {
+      Run_all(a, n);
+      free(a);
+      return 0;
+   }
+
+   start = omp_get_wtime();
+   if (sort == 'b')
+      Block_odd_even(a, n);
+   else
+      Merge_sort(a, n);
+   finish = omp_get_wtime();
+
+#  ifdef DEBUG
+   Print_list(a, n, "After sort");
+#  endif
+
+   printf("Elapsed time = %e seconds\n", finish - start);
+
+   free(a);
+   return 0;
+}  /* main */
+
+
+/*-----------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Summary of how to run program
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage:   %s <thread count> <n> <g|i> [b|m|a]\n",
+         prog_name);
+   fprintf(stderr, "   n:   number of elements in list\n");
+   fprintf(stderr, "  'g':  generate list using a random number generator\n");
+   fprintf(stderr, "  'i':  user input list\n");
+   fprintf(stderr, "  'b':  block odd-even transposition sort (default)\n");
+   fprintf(stderr, "  'm':  parallel merge sort\n");
+   fprintf(stderr, "  'a':  run all the sorts on copies of the list\n");
+}  /* Usage */
+
+
+/*-----------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get and check command line arguments
+ * In args:   argc, argv
+ * Out args:  n_p, g_i_p, sort_p
+ */
+void Get_args(int argc, char* argv[], int* n_p, char* g_i_p,
+      char* sort_p) {
+   if (argc != 4 && argc != 5) {
+      Usage(argv[0]);
+      exit(0);
+   }
+   thread_count = strtol(argv[1], NULL, 10);
+   *n_p = strtol(argv[2], NULL, 10);
+   *g_i_p = argv[3][0];
+   *sort_p = (argc == 5) ? argv[4][0] : 'b';
+
+   if (thread_count <= 0 || *n_p <= 0
+         || (*g_i_p != 'g' && *g_i_p != 'i')
+         || (*sort_p != 'b' && *sort_p != 'm' && *sort_p != 'a')) {
+      Usage(argv[0]);
+      exit(0);
+   }
+}  /* Get_args */
+
+
+/*-----------------------------------------------------------------
+ * Function:  Generate_list
+ * Purpose:   Use random number generator to generate list elements
+ * In args:   n
+ * Out args:  a
+ */
+void Generate_list(int a[], int n) {
+   int i;
+
+   srandom(1);
+   for (i = 0; i < n; i++)
+      a[i] = random() % RMAX;
+}  /* Generate_list */
+
+
+/*-----------------------------------------------------------------
+ * Function:  Print_list
+ * Purpose:   Print the elements in the list
+ * In args:   a, n
+ */
+void Print_list(int a[], int n, char* title) {
+   int i;
+
+   printf("%s:\n", title);
+   for (i = 0; i < n; i++)
+      printf("%d ", a[i]);
+   printf("\n\n");
+}  /* Print_list */
+
+
+/*-----------------------------------------------------------------
+ * Function:  Read_list
+ * Purpose:   Read elements of list from stdin
+ * In args:   n
+ * Out args:  a
+ */
+void Read_list(int a[], int n) {
+   int i;
+
+   printf("Please enter the elements of the list\n");
+   for (i = 0; i < n; i++)
+      scanf("%d", &a[i]);
+}  /* Read_list */
+
+
+/*-----------------------------------------------------------------
+ * Function:     Block_odd_even
+ * Purpose:      Sort list using block odd-even transposition sort
+ * In args:      n
+ * In/out args:  a
+ * Global:       thread_count
+ */
+void Block_odd_even(int a[], int n) {
+   int* tmp = malloc(n*sizeof(int));
+   /* blocks[(phase % 2)*thread_count + t] is the current block of
+    * thread t at the start of phase:  it's in a or in tmp */
+   int** blocks = malloc(2*thread_count*sizeof(int*));
+
+#  pragma omp parallel num_threads(thread_count) \
+      default(none) shared(a, n, tmp, blocks, thread_count)
+   {
+      int my_rank = omp_get_thread_num();
+      int my_first = Block_first(my_rank, n, thread_count);
+      int my_n = Block_first(my_rank + 1, n, thread_count) - my_first;
+      int phase, cur, partner, partner_n, changed;
+      int *mine, *out;
+
+      Local_sort(a + my_first, my_n);
+      blocks[my_rank] = a + my_first;
+#     pragma omp barrier
+
+      for (phase = 0; phase < thread_count; phase++) {
+         cur = phase % 2;
+         mine = blocks[cur*thread_count + my_rank];
+         out = (mine == a + my_first) ? tmp + my_first : a + my_first;
+         partner = (phase % 2 == my_rank % 2) ? my_rank + 1 : my_rank - 1;
+         changed = 0;
+         if (partner >= 0 && partner < thread_count) {
+            partner_n = Block_first(partner + 1, n, thread_count)
+               - Block_first(partner, n, thread_count);
+            if (partner > my_rank)
+               changed = Merge_low(mine, my_n,
+                     blocks[cur*thread_count + partner], partner_n, out);
+            else
+               changed = Merge_high(blocks[cur*thread_count + partner],
+                     partner_n, mine, my_n, out);
+         }
+         /* The other slot isn't read until after the barrier */
+         blocks[(1 - cur)*thread_count + my_rank] = changed ? out : mine;
+#        pragma omp barrier
+      }
+
+      mine = blocks[(thread_count % 2)*thread_count + my_rank];
+      if (mine != a + my_first)
+         memcpy(a + my_first, mine, my_n*sizeof(int));
+   }
+
+   free(blocks);
+   free(tmp);
+}  /* Block_odd_even */
+
+
+/*-----------------------------------------------------------------
+ * Function:     Merge_sort
+ * Purpose:      Sort list using a merge sort in which each thread
+ *               sorts a block, and then all the threads merge the
+ *               sorted runs in pairs
+ * In args:      n
+ * In/out args:  a
+ * Global:       thread_count
+ */
+void Merge_sort(int a[], int n) {
+   int* tmp = malloc(n*sizeof(int));
+
+#  pragma omp parallel num_threads(thread_count) \
+      default(none) shared(a, n, tmp, thread_count)
+   {
+      int my_rank = omp_get_thread_num();
+      int my_first = Block_first(my_rank, n, thread_count);
+      int my_last = Block_first(my_rank + 1, n, thread_count);
+      int *src = a, *dst = tmp, *t;
+      int width, lo_blk, mid_blk, hi_blk, lo, mid, hi;
+
+      Local_sort(a + my_first, my_last - my_first);
+#     pragma omp barrier
+
+      /* Runs of width blocks are merged into runs of 2*width blocks */
+      for (width = 1; width < thread_count; width *= 2) {
+         lo_blk = my_rank/(2*width)*(2*width);
+         mid_blk = (lo_blk + width < thread_count) ?
+            lo_blk + width : thread_count;
+         hi_blk = (lo_blk + 2*width < thread_count) ?
+            lo_blk + 2*width : thread_count;
+         lo = Block_first(lo_blk, n, thread_count);
+         mid = Block_first(mid_blk, n, thread_count);
+         hi = Block_first(hi_blk, n, thread_count);
+
+         /* The merged run takes the places of the two runs, so this
+          * thread's part of it goes into its own block */
+         Merge_range(src + lo, mid - lo, src + mid, hi - mid, dst + lo,
+               my_first - lo, my_last - lo);
+         t = src; src = dst; dst = t;
+#        pragma omp barrier
+      }
+
+      if (src != a)
+         memcpy(a + my_first, src + my_first,
+               (my_last - my_first)*sizeof(int));
+   }
+
+   free(tmp);
+}  /* Merge_sort */
+
+
+/*-----------------------------------------------------------------
+ * Function:     Bubble_sort
+ * Purpose:      Sort list using bubble sort.  This is the version
+ *               in bubble.c.
+ * In args:      n
+ * In/out args:  a
+ */
+void Bubble_sort(
+      int  a[]  /* in/out */,
+      int  n    /* in     */) {
+   int list_length, i, temp;
+
+   for (list_length = n; list_length >= 2; list_length--)
+      for (i = 0; i < list_length-1; i++)
+         if (a[i] > a[i+1]) {
+            temp = a[i];
+            a[i] = a[i+1];
+            a[i+1] = temp;
+         }
+
+}  /* Bubble_sort */
+
+
+/*-----------------------------------------------------------------
+ * Function:     Odd_even_sort
+ * Purpose:      Sort list using serial odd-even transposition sort.
+ *               This is the version in odd_even.c.
+ * In args:      n
+ * In/out args:  a
+ */
+void Odd_even_sort(
+      int  a[]  /* in/out */,
+      int  n    /* in     */) {
+   int phase, i, temp;
+
+   for (phase = 0; phase < n; phase++)
+      if (phase % 2 == 0) { /* Even phase */
+         for (i = 1; i < n; i += 2)
+            if (a[i-1] > a[i]) {
+               temp = a[i];
+               a[i] = a[i-1];
+               a[i-1] = temp;
+            }
+      } else { /* Odd phase */
+         for (i = 1; i < n-1; i += 2)
+            if (a[i] > a[i+1]) {
+               temp = a[i];
+               a[i] = a[i+1];
+               a[i+1] = temp;
+            }
+      }
+}  /* Odd_even_sort */
+
+
+/*-----------------------------------------------------------------
+ * Function:     Odd_even
+ * Purpose:      Sort list using odd-even transposition sort.  This
+ *               is the version in omp_odd_even2.c.
+ * In args:      n
+ * In/out args:  a
+ */
+void Odd_even(int a[], int n) {
+   int phase, i, tmp;
+
+#  pragma omp parallel num_threads(thread_count) \
+      default(none) shared(a, n) private(i, tmp, phase)
+   for (phase = 0; phase < n; phase++) {
+      if (phase % 2 == 0)
+#        pragma omp for
+         for (i = 1; i < n; i += 2) {
+            if (a[i-1] > a[i]) {
+               tmp = a[i-1];
+               a[i-1] = a[i];
+               a[i] = tmp;
+            }
+         }
+      else
+#        pragma omp for
+         for (i = 1; i < n-1; i += 2) {
+            if (a[i] > a[i+1]) {
+               tmp = a[i+1];
+               a[i+1] = a[i];
+               a[i] = tmp;
+            }
+         }
+   }
+}  /* Odd_even */
+
+
+/*-----------------------------------------------------------------
+ * Function:  Run_all
+ * Purpose:   Sort copies of the list with each of the sorts, and
+ *            print the run times.  Check that each sort gets the
+ *            same result as the merge sort.
+ * In args:   a, n
+ */
+void Run_all(int a[], int n) {
+   void (*sorts[])(int[], int) = {Merge_sort, Block_odd_even, Odd_even,
+      Odd_even_sort, Bubble_sort};
+   char* names[] = {"Parallel merge sort", "Block odd-even",
+      "omp_odd_even2", "Serial odd-even", "Bubble sort"};
+   int sort_count = sizeof(sorts)/sizeof(sorts[0]);
+   int* sorted = malloc(n*sizeof(int));
+   int* b = malloc(n*sizeof(int));
+   int s, slow;
+   double start, finish;
+
+   printf("n = %d, %d threads\n", n, thread_count);
+   for (s = 0; s < sort_count; s++) {
+      slow = (sorts[s] == Odd_even || sorts[s] == Odd_even_sort
+            || sorts[s] == Bubble_sort);
+      if (slow && n > SLOW_MAX) {
+         printf("%-20s  skipped, n > %d\n", names[s], SLOW_MAX);
+         continue;
+      }
+      memcpy(b, a, n*sizeof(int));
+      start = omp_get_wtime();
+      sorts[s](b, n);
+      finish = omp_get_wtime();
+      if (s == 0) memcpy(sorted, b, n*sizeof(int));
+      printf("%-20s  %e seconds%s\n", names[s], finish - start,
+            memcmp(b, sorted, n*sizeof(int)) == 0 ? "" : "  WRONG");
+   }
+
+   free(b);
+   free(sorted);
+}  /* Run_all */
@@ -0,0 +1,247 @@
+/* File:
+ *    omp_tokenize_bulk.c
+ *
+ * Purpose:
+ *    Use OpenMP threads to tokenize a text file.  Unlike
+ *    omp_tokenize_r.c, there are no limits on the number or the length
+ *    of the lines, and the text isn't copied:  the file is mapped into
+ *    memory, and each thread tokenizes a chunk of it.
+ *
+ * Compile:
+ *    gcc -g -Wall -O2 -fopenmp -I../ch4 -o omp_tokenize_bulk
+ *       omp_tokenize_bulk.c ../ch4/tokens.c ../ch4/word_freq.c
+ * Usage:
+ *    omp_tokenize_bulk <thread_count> <file> [p | f <k>]
+ *
+ * Input:
+ *    A text file
+ * Output:
+ *    The number of bytes, tokens and lines, and the time and
+ *    bandwidth of tokenizing and of merging the threads' lists.
+ *    With 'p', also each line's number and its tokens.  With 'f k',
+ *    the k most frequent tokens, their counts, and the times of
+ *    counting and of combining the counts.
+ *
+ * Algorithm:
+ *    The file is split into thread_count chunks that start at the
+ *    beginnings of lines (see ../ch4/tokens.c).  Each thread stores
+ *    the offsets and lengths of the tokens in its chunk in its own
+ *    list.  Then the lists are concatenated in order of thread rank,
+ *    which gives the tokens in the order of the file:  each thread
+ *    copies its own list to its place in the merged list.
+ *
+ *    Word frequencies (see ../ch4/word_freq.c):  each thread counts
+ *    the tokens in its own list with thread_count hash maps, one for
+ *    each partition of the hash values.  After a barrier, thread q adds
+ *    up partition q of all the threads' maps, and finds the k most
+ *    frequent tokens in it.  Last, one thread finds the k most frequent
+ *    of these.
+ *
+ * IPP:  Section 5.10 (p. 258)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "tokens.h"
+#include "word_freq.h"
+
+void Usage(char* prog_name);
+void Tokenize(char* text, long size, token_list_t lists[],
+      int thread_count);
+void Merge(token_list_t lists[], token_list_t* all, int thread_count);
+void Print_tokens(char* text, token_list_t* all);
+void Word_freq(char* text, token_list_t lists[], int k,
+      int thread_count);
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int thread_count, t, k = 0;
+   char* text;
+   long size;
+   token_list_t* lists;
+   token_list_t all;
+   double start, finish, tok_time, merge_time;
+
+   if (argc < 3 || argc > 5) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   if (thread_count <= 0) Usage(argv[0]);
+   if (argc == 5 && argv[3][0] == 'f') {
+      k = strtol(argv[4], NULL, 10);
+      if (k <= 0) Usage(argv[0]);
+   } else if (argc == 5) {
+      Usage(argv[0]);
+   }
+   text = Map_text(argv[2], &size);
+   if (text == NULL) {
+      fprintf(stderr, "Can't open %s\n", argv[2]);
+      exit(1);
+   }
+   lists = malloc(thread_count*sizeof(token_list_t));
+
+   start = omp_get_wtime();
+   Tokenize(text, size, lists, thread_count);
+   finish = omp_get_wtime();
+   tok_time = finish - start;
+
+   start = omp_get_wtime();
+   Merge(lists, &all, thread_count);
+   finish = omp_get_wtime();
+   merge_time = finish - start;
+
+   if (argc == 4 && argv[3][0] == 'p')
+      Print_tokens(text, &all);
+   printf("%ld bytes, %ld tokens, %ld lines\n", size, all.count,
+         all.line_count);
+   printf("Tokenize:  %e seconds, %.3f GB/s\n", tok_time,
+         size/tok_time/1.0e9);
+   printf("Merge:     %e seconds\n", merge_time);
+   if (k > 0) Word_freq(text, lists, k, thread_count);
+
+   for (t = 0; t < thread_count; t++)
+      Token_list_free(&lists[t]);
+   Token_list_free(&all);
+   Unmap_text(text, size);
+   free(lists);
+   return 0;
+}  /* main */
+
+
+/*--------------------------------------------------------------------
+ * Function:    Usage
+ * Purpose:     Print command line for function and terminate
+ * In arg:      prog_name
+ */
+void Usage(char* prog_name) {
+
+   fprintf(stderr, "usage: %s <number of threads> <file> [p | f <k>]\n",
+         prog_name);
+   fprintf(stderr, "   p:  print the tokens of each line\n");
+   fprintf(stderr, "   f:  print the k most frequent tokens\n");
+   exit(0);
+}  /* Usage */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Tokenize
+ * Purpose:     Tokenize the text:  each thread tokenizes one chunk
+ * In args:     text, size, thread_count
+ * Out arg:     lists:  lists[t] has the tokens of chunk t
+ */
+void Tokenize(char* text, long size, token_list_t lists[],
+      int thread_count) {
+
+#  pragma omp parallel num_threads(thread_count) default(none) \
+      shared(text, size, lists, thread_count)
+   {
+      int my_rank = omp_get_thread_num();
+      long my_first = Chunk_first(text, size, my_rank, thread_count);
+      long my_last = Chunk_first(text, size, my_rank + 1, thread_count);
+
+      /* Guess about 1 token per 8 bytes */
+      Token_list_init(&lists[my_rank], (my_last - my_first)/8);
+      Tokenize_chunk(text, my_first, my_last, &lists[my_rank]);
+   }
+}  /* Tokenize */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Merge
+ * Purpose:     Concatenate the threads' lists in order of rank
+ * In args:     lists, thread_count
+ * Out arg:     all
+ */
+void Merge(token_list_t lists[], token_list_t* all, int thread_count) {
+   int l;
+
+   Merge_alloc(lists, thread_count, all);
+#  pragma omp parallel for num_threads(thread_count) default(none) \
+      shared(lists, all, thread_count)
+   for (l = 0; l < thread_count; l++)
+      Merge_copy(lists, l, all);
+}  /* Merge */
+
+
+/*--------------------------------------------------------------------
+ * Function:    Print_tokens
+ * Purpose:     Print the tokens of each line
+ * In args:     text, all
+ */
+void Print_tokens(char* text, token_list_t* all) {
+   long line, t, last;
+
+   for (line = 0; line < all->line_count; line++) {
+      last = (line + 1 < all->line_count) ?
+         all->line_first[line+1] : all->count;
+      for (t = all->line_first[line]; t < last; t++)
+         printf("Line %ld > string %ld = %.*s\n", line + 1,
+               t - all->line_first[line] + 1, all->spans[t].length,
+               text + all->spans[t].offset);
+   }
+}  /* Print_tokens */
+
+
+/*--------------------------------------------------------------------
+ * Function:    Word_freq
+ * Purpose:     Count the tokens in the threads' lists and print the k
+ *              most frequent
+ * In args:     text, lists, k, thread_count
+ */
+void Word_freq(char* text, token_list_t lists[], int k,
+      int thread_count) {
+   /* maps[t*thread_count + q]:  thread t's map for partition q */
+   word_map_t* maps = malloc(thread_count*thread_count*sizeof(word_map_t));
+   /* totals[q]:  partition q of all the threads' maps */
+   word_map_t* totals = malloc(thread_count*sizeof(word_map_t));
+   /* Empty slots have count 0, so Top_k ignores them */
+   word_entry_t* tops = calloc(thread_count*k, sizeof(word_entry_t));
+   word_entry_t* top = malloc(k*sizeof(word_entry_t));
+   double start, count_time, reduce_time;
+   int i, found;
+
+   start = omp_get_wtime();
+#  pragma omp parallel num_threads(thread_count) default(none) \
+      shared(text, lists, k, thread_count, maps, totals, tops, top, \
+         found, start, count_time)
+   {
+      int my_rank = omp_get_thread_num();
+      word_map_t* my_maps = &maps[my_rank*thread_count];
+      int q;
+
+      /* Guess about 1 distinct token per 16 tokens */
+      for (q = 0; q < thread_count; q++)
+         Word_map_init(&my_maps[q], lists[my_rank].count/16/thread_count);
+      Count_tokens(text, &lists[my_rank], my_maps, thread_count);
+#     pragma omp barrier
+#     pragma omp single
+      {
+         count_time = omp_get_wtime() - start;
+         start = omp_get_wtime();
+      }
+
+      Merge_partition(text, maps, thread_count, my_rank, thread_count,
+            &totals[my_rank]);
+      Top_k(totals[my_rank].entries, totals[my_rank].capacity, k,
+            &tops[my_rank*k]);
+#     pragma omp barrier
+#     pragma omp single
+      found = Top_k(tops, (long) thread_count*k, k, top);
+   }
+   reduce_time = omp_get_wtime() - start;
+
+   for (i = 0; i < found; i++)
+      printf("%8ld  %.*s\n", top[i].count, top[i].length,
+            text + top[i].offset);
+   printf("Count:     %e seconds\n", count_time);
+   printf("Reduce:    %e seconds\n", reduce_time);
+
+   for (i = 0; i < thread_count*thread_count; i++)
+      Word_map_free(&maps[i]);
+   for (i = 0; i < thread_count; i++)
+      Word_map_free(&totals[i]);
+   free(top);
+   free(tops);
+   free(totals);
+   free(maps);
+}  /* Word_freq */
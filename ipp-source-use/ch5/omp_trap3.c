@@ -4,9 +4,11 @@
  *
  * Input:   a, b, n
  * Output:  estimate of integral from a to b of f(x)
- *          using n trapezoids.
+ *          using n trapezoids.  On stderr, the time for Trap
+ *          (see ../ch3/prof.h)
  *
- * Compile: gcc -g -Wall -fopenmp -o omp_trap3 omp_trap3.c
+ * Compile: gcc -g -Wall -fopenmp -I../ch3 -o omp_trap3 omp_trap3.c
+ *             ../ch3/prof.c -lpthread
  * Usage:   ./omp_trap3 <number of threads>
  *
  * Notes:   
@@ -21,6 +23,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <omp.h>
+#include "prof.h"
 
 void Usage(char* prog_name);
 double f(double x);    /* Function we're integrating */
@@ -37,11 +40,15 @@ int main(int argc, char* argv[]) {
    printf("Enter a, b, and n\n");
    scanf("%lf %lf %d", &a, &b, &n);
 
+   PROF_BEGIN("trap");
    global_result = Trap(a, b, n, thread_count);
+   PROF_END("trap");
 
    printf("With n = %d trapezoids, our estimate\n", n);
    printf("of the integral from %f to %f = %.14e\n",
       a, b, global_result);
+
+   PROF_REPORT();
    return 0;
 }  /* main */
 
@@ -0,0 +1,214 @@
+/* File:    omp_trap_simd.c
+ * Purpose: Estimate definite integrals using the trapezoidal rule with
+ *          kernels that are specialised on the integrand (trap_simd.h),
+ *          so the integrand is inlined and the sums are vectorised.
+ *          Compare the number of points per second with the Trap
+ *          function from omp_trap3.c, and also integrate a batch of k
+ *          integrands in one pass over the points.
+ *
+ * Input:   a, b, n, k
+ * Output:  For each of omp_trap3's Trap, the specialised kernel and
+ *          the batch kernel:  the estimates of the integrals from a to
+ *          b, the run time and the points evaluated per second.
+ *
+ * Compile: gcc -g -Wall -O3 -fopenmp -I../ch3 -o omp_trap_simd
+ *             omp_trap_simd.c
+ * Usage:   ./omp_trap_simd <number of threads>
+ *
+ * Notes:
+ *   1.  The functions are hardwired.  f(x) = x^2, as in omp_trap3.c,
+ *       and the c-th integrand of the batch is g(x, c) = x^2 + c*x.
+ *   2.  omp_trap3's Trap can't be vectorised, since the compiler
+ *       mustn't reorder the additions into approx.  The simd
+ *       directives in the kernels allow this.
+ *   3.  It's not necessary for n to be evenly divisible by
+ *       thread_count.  The points are divided among the threads
+ *       the runtime actually starts, which may be fewer than
+ *       thread_count.
+ *   4.  The kernels are shared with ch3/mpi_trap_simd.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "trap_simd.h"
+
+/* Integrands for the kernels */
+#define F(x) ((x)*(x))
+#define G(x, p) ((x)*(x) + (p)*(x))
+
+TRAP_KERNEL(Sum_f, F)
+TRAP_BATCH_KERNEL(Sum_g, G)
+
+void Usage(char* prog_name);
+double f(double x);    /* Function we're integrating */
+double Trap(double a, double b, long n, int thread_count);
+double Trap_simd(double a, double b, long n, int thread_count);
+void Trap_batch(double a, double b, long n, const double p[], int k,
+      double approx[], int thread_count);
+
+int main(int argc, char* argv[]) {
+   double  a, b;                 /* Left and right endpoints      */
+   long    n;                    /* Total number of trapezoids    */
+   int     k;                    /* Number of integrands in batch */
+   int     thread_count, c;
+   double  result, start, elapsed;
+   double  *p, *approx;
+
+   if (argc != 2) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   printf("Enter a, b, n, and k\n");
+   if (scanf("%lf %lf %ld %d", &a, &b, &n, &k) != 4 || n <= 0 || k <= 0)
+      Usage(argv[0]);
+
+   start = omp_get_wtime();
+   result = Trap(a, b, n, thread_count);
+   elapsed = omp_get_wtime() - start;
+   printf("omp_trap3 Trap:  %.14e\n", result);
+   printf("   %e seconds, %.3e points/second\n", elapsed,
+         (n+1)/elapsed);
+
+   start = omp_get_wtime();
+   result = Trap_simd(a, b, n, thread_count);
+   elapsed = omp_get_wtime() - start;
+   printf("Specialised kernel:  %.14e\n", result);
+   printf("   %e seconds, %.3e points/second\n", elapsed,
+         (n+1)/elapsed);
+
+   p = malloc(k*sizeof(double));
+   approx = malloc(k*sizeof(double));
+   for (c = 0; c < k; c++)
+      p[c] = c;
+   start = omp_get_wtime();
+   Trap_batch(a, b, n, p, k, approx, thread_count);
+   elapsed = omp_get_wtime() - start;
+   printf("Batch kernel, %d integrands:\n", k);
+   printf("   c = 0:  %.14e, exact = %.14e\n", approx[0],
+         (b*b*b - a*a*a)/3.0);
+   printf("   c = %d:  %.14e, exact = %.14e\n", k-1, approx[k-1],
+         (b*b*b - a*a*a)/3.0 + p[k-1]*(b*b - a*a)/2.0);
+   printf("   %e seconds, %.3e points/second\n", elapsed,
+         (double) (n+1)*k/elapsed);
+
+   free(approx);
+   free(p);
+   return 0;
+}  /* main */
+
+/*--------------------------------------------------------------------
+ * Function:    Usage
+ * Purpose:     Print command line for function and terminate
+ * In arg:      prog_name
+ */
+void Usage(char* prog_name) {
+
+   fprintf(stderr, "usage: %s <number of threads>\n", prog_name);
+   fprintf(stderr, "   then enter a, b, n > 0, and k > 0\n");
+   exit(0);
+}  /* Usage */
+
+/*------------------------------------------------------------------
+ * Function:    f
+ * Purpose:     Compute value of function to be integrated
+ * Input arg:   x
+ * Return val:  f(x)
+ */
+double f(double x) {
+   double return_val;
+
+   return_val = x*x;
+   return return_val;
+}  /* f */
+
+/*------------------------------------------------------------------
+ * Function:    Trap
+ * Purpose:     Use trapezoidal rule to estimate definite integral.
+ *              This is the version in omp_trap3.c.
+ * Input args:
+ *    a: left endpoint
+ *    b: right endpoint
+ *    n: number of trapezoids
+ * Return val:
+ *    approx:  estimate of integral from a to b of f(x)
+ */
+double Trap(double a, double b, long n, int thread_count) {
+   double  h, approx;
+   long  i;
+
+   h = (b-a)/n;
+   approx = (f(a) + f(b))/2.0;
+#  pragma omp parallel for num_threads(thread_count) \
+      reduction(+: approx)
+   for (i = 1; i <= n-1; i++)
+     approx += f(a + i*h);
+   approx = h*approx;
+
+   return approx;
+}  /* Trap */
+
+/*------------------------------------------------------------------
+ * Function:    Trap_simd
+ * Purpose:     Use trapezoidal rule to estimate definite integral,
+ *              with each thread summing a block of the points with
+ *              the specialised kernel
+ * Input args:
+ *    a: left endpoint
+ *    b: right endpoint
+ *    n: number of trapezoids
+ * Return val:
+ *    approx:  estimate of integral from a to b of F(x)
+ */
+double Trap_simd(double a, double b, long n, int thread_count) {
+   double  h, approx;
+
+   h = (b-a)/n;
+   approx = (F(a) + F(b))/2.0;
+#  pragma omp parallel num_threads(thread_count) \
+      reduction(+: approx)
+   {
+      int my_rank = omp_get_thread_num();
+      int team_size = omp_get_num_threads();
+      long my_first = 1 + my_rank*(n-1)/team_size;
+      long my_last = 1 + (my_rank+1)*(n-1)/team_size;
+
+      approx += Sum_f(a, h, my_first, my_last);
+   }
+   approx = h*approx;
+
+   return approx;
+}  /* Trap_simd */
+
+/*------------------------------------------------------------------
+ * Function:    Trap_batch
+ * Purpose:     Use trapezoidal rule to estimate the definite integrals
+ *              of G(x, p[0]), ..., G(x, p[k-1]) in one pass over the
+ *              points
+ * Input args:
+ *    a: left endpoint
+ *    b: right endpoint
+ *    n: number of trapezoids
+ *    p: the k parameters
+ * Output arg:
+ *    approx:  approx[c] is the estimate of the integral of G(x, p[c])
+ */
+void Trap_batch(double a, double b, long n, const double p[], int k,
+      double approx[], int thread_count) {
+   double  h;
+   int     c;
+
+   h = (b-a)/n;
+   for (c = 0; c < k; c++)
+      approx[c] = (G(a, p[c]) + G(b, p[c]))/2.0;
+#  pragma omp parallel num_threads(thread_count) \
+      reduction(+: approx[:k])
+   {
+      int my_rank = omp_get_thread_num();
+      int team_size = omp_get_num_threads();
+      long my_first = 1 + my_rank*(n-1)/team_size;
+      long my_last = 1 + (my_rank+1)*(n-1)/team_size;
+
+      Sum_g(a, h, my_first, my_last, p, k, approx);
+   }
+   for (c = 0; c < k; c++)
+      approx[c] *= h;
+}  /* Trap_batch */
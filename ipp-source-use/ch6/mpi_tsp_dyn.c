@@ -14,10 +14,12 @@
  *           "new_frac" implementation of fractions.  All energy is
  *           represented by the log of the denominator (numerator is
  *           1) except total returned energy on 0, which is
- *           represented by a frac_t.
+ *           represented by a frac_t.  The small control messages
+ *           -- best tour costs, work requests, rejects and energy --
+ *           are coalesced by the aggregation layer in msg_agg.c.
  *
- * Compile:  mpicc -g -Wall -o mpi_tsp_dyn mpi_tsp_dyn.c frac.c
- *           Needs frac.h
+ * Compile:  mpicc -g -Wall -o mpi_tsp_dyn mpi_tsp_dyn.c frac.c msg_agg.c
+ *           Needs frac.h and msg_agg.h
  *        
  * Usage:    mpiexec -n <proc count> mpi_tsp_dyn <matrix_file> 
  *              <min split size> <split cut off>
@@ -43,7 +45,14 @@
  *     a one-dimensional array:  digraph[i][j] is computed as
  *     digraph[i*n + j]
  * 6.  Define STATS at compile time to get some info on broadcasts
- *     of best tour costs.
+ *     of best tour costs, and on the number of control messages and
+ *     of the MPI messages that carried them.  Without aggregation each
+ *     control message would be a separate MPI message.
+ * 7.  A buffer of control messages is sent when it's full, when its
+ *     oldest message is AGG_MAX_AGE seconds old, or when the process
+ *     runs out of work and is about to wait for a reply to a work
+ *     request.  Work (FULFILL_REQ_TAG) and termination (TERM_TAG)
+ *     messages are still sent directly.
  *
  * IPP:  Section 6.2.12 (pp. 327 and ff.)
  */
@@ -52,6 +61,7 @@
 #include <string.h>
 #include <mpi.h>
 #include "frac.h"
+#include "msg_agg.h"
 
 const int INFINITY = 1000000;
 const int NO_CITY = -1;
@@ -64,7 +74,9 @@ const int FULFILL_REQ_TAG = 3;
 const int REJECT_REQ_TAG = 4;
 const int TERM_TAG = 5;
 const int ENERGY_TAG = 6;
-const int INIT_COST_MSGS = 100;
+const int AGG_TAG = 7;
+const int AGG_BUF_INTS = 256;       // 1 KB:  small enough to be sent eagerly
+const double AGG_MAX_AGE = 1.0e-4;  // seconds
 
 typedef int city_t;
 typedef int cost_t;
@@ -102,18 +114,6 @@ typedef queue_struct* my_queue_t;
    (queue->list[(queue->head + (i)) % queue->list_alloc])
 
 
-typedef struct {
-   cost_t* msgs;
-   MPI_Request* reqs;
-   int alloc;
-   int avail;
-} cost_msg_struct;
-typedef cost_msg_struct* cost_msg_t;
-#define Cost_msg(cost_msgs, offset) (cost_msgs->msgs[(offset)])
-#define Cost_req(cost_msgs, offset, dest) \
-   (cost_msgs->reqs[(offset)*comm_sz + (dest)])
-
-
 /* Global Vars: */
 int n;  /* Number of cities in the problem */
 int my_rank;
@@ -125,7 +125,7 @@ city_t home_town = 0;
 tour_t loc_best_tour;
 cost_t best_tour_cost;
 MPI_Datatype tour_arr_mpi_t;  // For storing the list of cities
-cost_msg_t cost_msgs;
+agg_t agg;  // Aggregation layer for control messages
 int min_split_sz;
 int split_cutoff;
 unsigned my_energy;        // log base 2 of denominator -- numerator is 1
@@ -146,6 +146,8 @@ int msgs_cancelled = 0;
 int work_reqs_fulfilled = 0;
 int work_reqs_sent = 0;
 int total_reqs_fulfilled = 0;
+long total_ctrl_msgs = 0;
+long total_ctrl_mpi_msgs = 0;
 #endif
 
 void Usage(char* prog_name);
@@ -174,9 +176,6 @@ void Init_tour(tour_t tour, cost_t cost);
 tour_t Alloc_tour(my_stack_t avail);
 void Free_tour(tour_t tour, my_stack_t avail);
 
-void Init_cost_msgs(void);
-int Get_cost_msg(cost_t tour_cost);
-void Free_cost_msgs(void);
 void Look_for_best_tours(void);
 void Bcast_tour_cost(cost_t tour_cost);
 
@@ -267,7 +266,7 @@ int main(int argc, char* argv[]) {
    printf("Cost = %d\n\n", Tour_cost(loc_best_tour));
 #  endif
    best_tour_cost = INFINITY;
-   Init_cost_msgs();
+   agg = Agg_init(comm, AGG_TAG, AGG_BUF_INTS, AGG_MAX_AGE);
 
    MPI_Type_contiguous(n+1, MPI_INT, &tour_arr_mpi_t);
    MPI_Type_commit(&tour_arr_mpi_t);
@@ -305,11 +304,18 @@ int main(int argc, char* argv[]) {
 //       my_rank, work_reqs_fulfilled, work_reqs_sent);
    MPI_Reduce(&work_reqs_fulfilled, &total_reqs_fulfilled, 1, MPI_INT,
          MPI_SUM, 0, comm);
-   if (my_rank == 0)
+   MPI_Reduce(&agg->msgs_sent, &total_ctrl_msgs, 1, MPI_LONG,
+         MPI_SUM, 0, comm);
+   MPI_Reduce(&agg->mpi_sent, &total_ctrl_mpi_msgs, 1, MPI_LONG,
+         MPI_SUM, 0, comm);
+   if (my_rank == 0) {
       printf("Total requests fulfilled = %d\n", total_reqs_fulfilled);
+      printf("Control messages = %ld, sent in %ld MPI messages\n",
+            total_ctrl_msgs, total_ctrl_mpi_msgs);
+   }
 #  endif
    MPI_Type_free(&tour_arr_mpi_t);
-   Free_cost_msgs();
+   Agg_free(agg);
    if (my_rank == 0) Free_frac(total_energy_recd);
    free(loc_best_tour->cities);
    free(loc_best_tour);
@@ -735,19 +741,14 @@ int Best_tour(tour_t tour) {
  * Global In/out:
  *    best_tour_cost
  * Note:
- *    Tour costs are probed for and received as long as there are
- *    messages with TOUR_TAG.
+ *    Tour costs are received as long as there are messages with
+ *    TOUR_TAG in the aggregation layer's queue.
  */
 void Look_for_best_tours(void) {
-   int done = FALSE, msg_avail, tour_cost;
-   MPI_Status status;
+   int done = FALSE, tour_cost;
 
    while(!done) {
-      MPI_Iprobe(MPI_ANY_SOURCE, TOUR_TAG, comm, &msg_avail, 
-            &status);
-      if (msg_avail) {
-         MPI_Recv(&tour_cost, 1, MPI_INT, status.MPI_SOURCE, TOUR_TAG,
-               comm, MPI_STATUS_IGNORE);
+      if (Agg_recv(agg, MPI_ANY_SOURCE, TOUR_TAG, &tour_cost, 1, NULL)) {
 #        ifdef STATS
          best_costs_received++;
 //       printf("Proc %d > received cost %d\n", my_rank, tour_cost);
@@ -790,116 +791,22 @@ void Update_best_tour(tour_t tour) {
 }  /* Update_best_tour */
 
 
-/*------------------------------------------------------------------
- * Function:  Init_cost_msgs
- * Purpose:   Initialize the cost_msgs struct
- * Global in:
- *    comm_sz
- * Global out:
- *    cost_msgs
- */
-void Init_cost_msgs(void) {
-
-   cost_msgs = malloc(sizeof(cost_msg_struct));
-   cost_msgs->msgs = malloc(INIT_COST_MSGS*sizeof(cost_t));
-   cost_msgs->reqs = malloc(INIT_COST_MSGS*comm_sz*sizeof(MPI_Request));
-   cost_msgs->alloc = INIT_COST_MSGS;
-   cost_msgs->avail = 0;
-
-}  /* Init_cost_msgs */
- 
-/*------------------------------------------------------------------
- * Function:  Get_cost_msg
- * Purpose:   Return buffer space and requests for the broadcast of
- *            a tour's cost
- * Ret val:
- *    offset into msgs array for buffering cost.  Note that this
- *       offset*comm_sz also gives the offset into a block of
- *       requests
- * In/out global:
- *    cost_msgs:  the tour cost is copied into the msgs array
- */
-int Get_cost_msg(cost_t tour_cost) {
-   int offset, msgs_completed;
-
-   if (cost_msgs->avail >= 0 && cost_msgs->avail < cost_msgs->alloc) {
-      offset = cost_msgs->avail;
-      (cost_msgs->avail)++;
-      Cost_msg(cost_msgs,offset) = tour_cost;
-      return offset;
-   } else {  // No available buffer:  look for one.
-      for (offset = 0; offset < cost_msgs->alloc; offset++) {
-         MPI_Testall(comm_sz, cost_msgs->reqs + offset*comm_sz, 
-               &msgs_completed, MPI_STATUSES_IGNORE);
-         if (msgs_completed) {
-            Cost_msg(cost_msgs,offset) = tour_cost;
-            return offset;
-         }
-      }
-   } 
-   
-   // Can't find any available buffer:  realloc
-   cost_msgs->msgs = 
-      realloc(cost_msgs->msgs, 2*(cost_msgs->alloc)*sizeof(cost_t));
-   cost_msgs->reqs = 
-      realloc(cost_msgs->reqs, 
-            2*(cost_msgs->alloc)*comm_sz*sizeof(MPI_Request));
-   offset = cost_msgs->alloc;
-   cost_msgs->alloc *= 2;
-
-   Cost_msg(cost_msgs,offset) = tour_cost;
-   cost_msgs->avail = offset+1;
-   return offset;
-}  /* Get_cost_msg */
-
-/*------------------------------------------------------------------
- * Function:  Free_cost_msgs
- * Purpose:   Complete/cancel any outstanding communications and
- *            free the data structures
- * in Global:
- *    comm_sz
- * in/out Global:
- *    cost_msgs
- */
-void Free_cost_msgs(void) {
-   int msg, dest, msg_completed;
-
-   for (msg = 0; msg < cost_msgs->avail; msg++) 
-      for (dest = 0; dest < comm_sz; dest++)
-         if (dest != my_rank) 
-            if (Cost_req(cost_msgs, msg, dest) != MPI_REQUEST_NULL) {
-               MPI_Test(&Cost_req(cost_msgs, msg, dest), &msg_completed,
-                     MPI_STATUS_IGNORE);
-               if (!msg_completed) {
-                  MPI_Cancel(&Cost_req(cost_msgs, msg, dest));
-#                 ifdef STATS
-                  msgs_cancelled++;
-#                 endif
-                  MPI_Wait(&Cost_req(cost_msgs, msg, dest), MPI_STATUS_IGNORE);
-               }
-            }
-
-   free(cost_msgs->msgs);
-   free(cost_msgs->reqs);
-}  /* Free_cost_msgs */
-
-
 /*------------------------------------------------------------------
  * Function:   Bcast_tour_cost
  * Purpose:    Asynchronous broadcast of tour cost
  *
  * Note:
  *    MPI_Bcast is a point of synchronization for the processes.
- *    So it can't be used.
+ *    So it can't be used.  Instead the cost is added to the
+ *    aggregation buffer for each process, so a burst of improvements
+ *    costs one MPI message per process.
  */
 void Bcast_tour_cost(int tour_cost) {
-   int offset = Get_cost_msg(tour_cost);
    int dest;
 
    for (dest = 0; dest < comm_sz; dest++)
       if (dest != my_rank)
-         MPI_Isend(&Cost_msg(cost_msgs,offset), 1, MPI_INT, dest,
-               TOUR_TAG, comm, &Cost_req(cost_msgs, offset, dest));
+         Agg_send(agg, dest, TOUR_TAG, &tour_cost, 1);
 #  ifdef STATS
    best_costs_bcast++;
 #  endif
@@ -1369,6 +1276,7 @@ int Terminated(my_stack_t stack, my_stack_t avail) {
 #  ifdef TERM_DEBUG
 // Print_stack(stack, "In Terminated");
 #  endif
+   Agg_progress(agg);
    if (tour_count > min_split_sz) {
       Fulfill_request(stack, tour_count, avail);
       return FALSE;
@@ -1385,6 +1293,7 @@ int Terminated(my_stack_t stack, my_stack_t avail) {
                my_rank);
 #        endif
          while (1) {
+            Agg_progress(agg);
             Send_rejects();
             Look_for_best_tours();  // Get them out of the message queue
             if (Term_msg()) {
@@ -1399,6 +1308,9 @@ int Terminated(my_stack_t stack, my_stack_t avail) {
             } else if (!work_request_sent) {
                Send_work_request();
                work_request_sent = TRUE;
+               /* We're going to wait for a reply, so don't make the
+                * request, our energy or any rejects wait */
+               Agg_flush_all(agg);
 #              ifdef TERM_DEBUG
                printf("Proc %d > Sent work request to %d\n",
                      my_rank, work_req_dest);
@@ -1451,14 +1363,10 @@ int Short_tour_count(my_stack_t stack) {
  */
 void Fulfill_request(my_stack_t stack, int tour_count,
       my_stack_t avail) {
-   int request_recd, buf = 0, dest;
-   MPI_Status status;
+   int buf = 0, dest;
 
-   MPI_Iprobe(MPI_ANY_SOURCE, WORK_REQ_TAG, comm, &request_recd,
-         &status);
-   if (!request_recd) return;
-   dest = status.MPI_SOURCE;
-   MPI_Recv(&buf, 0, MPI_INT, dest, WORK_REQ_TAG, comm, MPI_STATUS_IGNORE);
+   if (!Agg_recv(agg, MPI_ANY_SOURCE, WORK_REQ_TAG, &buf, 0, &dest))
+      return;
    Send_work(stack, dest, tour_count, avail);
 
    Send_rejects();
@@ -1572,21 +1480,13 @@ void Split_stack(my_stack_t stack, int tour_count, int* pack_size_p,
  *            work
  */
 void Send_rejects(void) {
-   int req_recd, buf = 0;
-   MPI_Status status;
+   int buf = 0, source;
 
-   MPI_Iprobe(MPI_ANY_SOURCE, WORK_REQ_TAG, comm, &req_recd,
-         &status);
-   while (req_recd) {
-      MPI_Recv(&buf, 0, MPI_INT, status.MPI_SOURCE, WORK_REQ_TAG,
-            comm, MPI_STATUS_IGNORE);
-      MPI_Send(&buf, 0, MPI_INT, status.MPI_SOURCE, REJECT_REQ_TAG, 
-            comm);
+   while (Agg_recv(agg, MPI_ANY_SOURCE, WORK_REQ_TAG, &buf, 0, &source)) {
+      Agg_send(agg, source, REJECT_REQ_TAG, &buf, 0);
 #     ifdef TERM_DEBUG
-      printf("Proc %d > Sent reject to %d\n", my_rank, status.MPI_SOURCE);
+      printf("Proc %d > Sent reject to %d\n", my_rank, source);
 #     endif
-      MPI_Iprobe(MPI_ANY_SOURCE, WORK_REQ_TAG, comm, &req_recd,
-            &status);
    }
 }  /* Send_rejects */
 
@@ -1598,6 +1498,8 @@ void Send_rejects(void) {
  * In/out global: my_energy 
  */
 void Send_energy(void) {
+   int energy;
+
    if (my_rank == 0)  {
       Add(total_energy_recd, my_energy);
 #     ifdef TERM_DEBUG
@@ -1611,7 +1513,8 @@ void Send_energy(void) {
       printf("Proc %d > Out of work, sending 1/2^%u to 0\n",
             my_rank, my_energy);
 #     endif
-      MPI_Send(&my_energy, 1, MPI_UNSIGNED, 0, ENERGY_TAG, comm);
+      energy = my_energy;
+      Agg_send(agg, 0, ENERGY_TAG, &energy, 1);
    }
 }  /* Send_energy */
 
@@ -1628,7 +1531,7 @@ void Send_work_request(void) {
    work_req_dest = (work_req_dest + 1) % comm_sz;
    if (work_req_dest == my_rank) 
       work_req_dest = (work_req_dest + 1) % comm_sz;
-   MPI_Send(&buf, 0, MPI_INT, work_req_dest, WORK_REQ_TAG, comm);
+   Agg_send(agg, work_req_dest, WORK_REQ_TAG, &buf, 0);
 #  ifdef STATS
    work_reqs_sent++;
 #  endif
@@ -1656,6 +1559,8 @@ void Send_work_request(void) {
  *     which will be placed in the message queue *ahead* of a reject
  *     or a work fulfillment, and the work fulfillment may never be
  *     received.
+ * 2.  Rejects come through the aggregation layer and work doesn't,
+ *     so the reject can't be ahead of anything in the MPI queue.
  */
 void Check_for_work(int* work_request_sent_p, int* work_avail_p) {
    int msg_recd, buf = 0;
@@ -1669,10 +1574,8 @@ void Check_for_work(int* work_request_sent_p, int* work_avail_p) {
 #     endif
       *work_avail_p = TRUE;
    } else { /* We didn't get work */
-      MPI_Iprobe(work_req_dest, REJECT_REQ_TAG, comm, &msg_recd, &status);
-      if (msg_recd) {  /* We got a reject */
-         MPI_Recv(&buf, 0, MPI_INT, work_req_dest, REJECT_REQ_TAG, comm,
-               MPI_STATUS_IGNORE);
+      if (Agg_recv(agg, work_req_dest, REJECT_REQ_TAG, &buf, 0, NULL)) {
+         /* We got a reject */
 #        ifdef TERM_DEBUG
          printf("Proc %d > Probed for work from %d, got reject\n",
                my_rank, work_req_dest);
@@ -1746,24 +1649,20 @@ void Receive_work(my_stack_t stack, my_stack_t avail) {
  * Global in/out:  total_energy_recd (on process 0 only)
  */
 int Term_msg(void) {
-   int msg_recd, buf = 0;
+   int msg_recd, buf = 0, recd_frac, source;
    MPI_Status status;
-   unsigned recd_frac;
 
    if (my_rank == 0) {
-      MPI_Iprobe(MPI_ANY_SOURCE, ENERGY_TAG, comm, &msg_recd, &status);
-      while (msg_recd) {
-         MPI_Recv(&recd_frac, 1, MPI_UNSIGNED, status.MPI_SOURCE,
-               ENERGY_TAG, comm, MPI_STATUS_IGNORE);
+      while (Agg_recv(agg, MPI_ANY_SOURCE, ENERGY_TAG, &recd_frac, 1,
+               &source)) {
          Add(total_energy_recd, recd_frac);
 #        ifdef TERM_DEBUG
-         printf("Proc %d > Received energy = 1/2^%u from %d\n", 
-               my_rank, recd_frac, status.MPI_SOURCE);
+         printf("Proc %d > Received energy = 1/2^%d from %d\n", 
+               my_rank, recd_frac, source);
          Print_frac(total_energy_recd, my_rank, "total_energy_recd");
          Debug_print_frac(total_energy_recd);
          fflush(stdout);
 #        endif
-         MPI_Iprobe(MPI_ANY_SOURCE, ENERGY_TAG, comm, &msg_recd, &status);
       }
       if (Equals(total_energy_recd, total_energy)) {
 #        ifdef TERM_DEBUG
@@ -1813,13 +1712,17 @@ void Cleanup_msg_queue(void) {
    char string[MAX_STRING];
 #  endif
    char string1[MAX_STRING];
-   int counts[7] = {0,0,0,0,0,0,0};
+   int counts[8] = {0,0,0,0,0,0,0,0};
 
    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &msg_recd, &status);
    while (msg_recd) {
-      /* Just receive the message . . . */
-      MPI_Recv(work_buf, work_buf_alloc, MPI_BYTE, 
-            status.MPI_SOURCE, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
+      /* Just receive the message . . . Aggregated messages may be
+       * bigger than work_buf */
+      if (status.MPI_TAG == AGG_TAG)
+         Agg_receive(agg);
+      else
+         MPI_Recv(work_buf, work_buf_alloc, MPI_BYTE, 
+               status.MPI_SOURCE, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
 #     ifdef VERBOSE
       sprintf(string, "Proc %d > Cleanup:  from %d received a ", my_rank,
             status.MPI_SOURCE);
@@ -1861,6 +1764,12 @@ void Cleanup_msg_queue(void) {
 #           endif
             counts[6]++;
             break;
+         case 7:  //AGG_TAG:
+#           ifdef VERBOSE
+            sprintf(string + strlen(string), "batch of control messages");
+#           endif
+            counts[7]++;
+            break;
          default:
 #           ifdef VERBOSE
             sprintf(string + strlen(string), "unknown message type");
@@ -1873,9 +1782,9 @@ void Cleanup_msg_queue(void) {
 #     endif
       MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &msg_recd, &status);
    }
-   sprintf(string1, "Unknown = %d, Tour = %d, Req = %d,Fulfil = %d, Reject = %d, Term = %d, Energy = %d",
+   sprintf(string1, "Unknown = %d, Tour = %d, Req = %d,Fulfil = %d, Reject = %d, Term = %d, Energy = %d, Aggregated = %d",
          counts[0], counts[1], counts[2], 
-         counts[3], counts[4], counts[5], counts[6]);
+         counts[3], counts[4], counts[5], counts[6], counts[7]);
 // printf("Proc %d > %s\n", my_rank, string1);
 }  /* Cleanup_msg_queue */
 
@@ -0,0 +1,308 @@
+/* File:     msg_agg.c
+ * Purpose:  Coalesce small tagged messages so that a program that
+ *           sends many of them pays the per-message cost of MPI
+ *           (latency, matching, progress) once per batch instead of
+ *           once per message.
+ *
+ *           Agg_send appends a message (tag, count, data) to a buffer
+ *           for its destination.  A buffer is sent as a single MPI
+ *           message with tag agg_tag
+ *
+ *              - when the next message doesn't fit in it,
+ *              - by Agg_progress, once its oldest message has waited
+ *                max_age seconds, or
+ *              - when the program calls Agg_flush or Agg_flush_all,
+ *                e.g., just before it waits for a reply.
+ *
+ *           On the receiving side Agg_receive (or Agg_progress)
+ *           receives every aggregated message that has arrived and
+ *           splits it into its small messages, which are appended to
+ *           a local queue.  Agg_recv takes the first message in the
+ *           queue with a given tag and source (or MPI_ANY_SOURCE).
+ *
+ * Representation:
+ *    A buffer is a sequence of ints:
+ *
+ *       tag0, count0, data0[0], ..., data0[count0-1], tag1, count1, ...
+ *
+ * Compile:  mpicc -g -Wall -c msg_agg.c
+ *
+ * Notes:
+ * 1.  Messages from one process to another are received in the order
+ *     in which they were passed to Agg_send, just as with MPI.  There
+ *     is no ordering between aggregated messages and messages that
+ *     the program sends directly with MPI.
+ * 2.  Each destination has two buffers:  one can be filled while the
+ *     other is being sent.  Before a buffer is reused, the send of
+ *     its previous contents is completed with MPI_Wait.  So buf_ints
+ *     should be small enough that the MPI implementation sends a full
+ *     buffer eagerly.
+ * 3.  Agg_recv only looks at the local queue.  The program should
+ *     call Agg_progress regularly, e.g., once per iteration of its
+ *     main loop.
+ * 4.  Agg_free cancels sends that haven't completed and discards the
+ *     contents of unflushed buffers and of the queue.
+ *
+ * IPP:  Section 6.2.12 (pp. 327 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "msg_agg.h"
+
+static const int HEADER_INTS = 2;  // tag, count
+
+static void Enqueue_msg(agg_t agg, int source, int tag, int data[],
+      int count);
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_init
+ * Purpose:   Allocate and initialize an aggregation layer
+ * In args:   comm:      communicator for all the messages
+ *            agg_tag:   tag for the aggregated messages.  It shouldn't
+ *                       be used by any other message on comm
+ *            buf_ints:  capacity of each send buffer in ints
+ *            max_age:   seconds a message can wait in a buffer before
+ *                       Agg_progress sends it
+ */
+agg_t Agg_init(MPI_Comm comm, int agg_tag, int buf_ints, double max_age) {
+   int dest;
+   agg_t agg = malloc(sizeof(agg_struct));
+
+   agg->comm = comm;
+   MPI_Comm_size(comm, &agg->comm_sz);
+   agg->agg_tag = agg_tag;
+   agg->buf_ints = buf_ints;
+   agg->max_age = max_age;
+   agg->dests = malloc(agg->comm_sz*sizeof(agg_dest_struct));
+   for (dest = 0; dest < agg->comm_sz; dest++) {
+      agg->dests[dest].bufs[0] = malloc(buf_ints*sizeof(int));
+      agg->dests[dest].bufs[1] = malloc(buf_ints*sizeof(int));
+      agg->dests[dest].reqs[0] = agg->dests[dest].reqs[1] =
+         MPI_REQUEST_NULL;
+      agg->dests[dest].curr = 0;
+      agg->dests[dest].size = 0;
+      agg->dests[dest].first_time = 0.0;
+   }
+   agg->pending = 0;
+   agg->recv_buf = malloc(buf_ints*sizeof(int));
+   agg->head = agg->tail = NULL;
+   agg->msgs_sent = agg->mpi_sent = 0;
+
+   return agg;
+}  /* Agg_init */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_send
+ * Purpose:   Add a message of count ints to the buffer for dest.  If
+ *            it doesn't fit, flush the buffer first.
+ * In args:   dest, tag, data, count
+ * In/out:    agg
+ */
+void Agg_send(agg_t agg, int dest, int tag, int data[], int count) {
+   agg_dest_struct* d = &agg->dests[dest];
+   int* buf;
+
+   if (HEADER_INTS + count > agg->buf_ints) {
+      fprintf(stderr, "Agg_send:  message of %d ints won't fit in a buffer of %d ints\n",
+            count, agg->buf_ints);
+      MPI_Abort(agg->comm, -1);
+   }
+   if (d->size + HEADER_INTS + count > agg->buf_ints)
+      Agg_flush(agg, dest);
+
+   if (d->size == 0) {
+      d->first_time = MPI_Wtime();
+      agg->pending++;
+   }
+   buf = d->bufs[d->curr] + d->size;
+   buf[0] = tag;
+   buf[1] = count;
+   memcpy(buf + HEADER_INTS, data, count*sizeof(int));
+   d->size += HEADER_INTS + count;
+   agg->msgs_sent++;
+}  /* Agg_send */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_flush
+ * Purpose:   Start the send of the buffer for dest, if it isn't empty,
+ *            and switch to dest's other buffer
+ * In arg:    dest
+ * In/out:    agg
+ */
+void Agg_flush(agg_t agg, int dest) {
+   agg_dest_struct* d = &agg->dests[dest];
+
+   if (d->size == 0) return;
+
+   MPI_Isend(d->bufs[d->curr], d->size, MPI_INT, dest, agg->agg_tag,
+         agg->comm, &d->reqs[d->curr]);
+   agg->mpi_sent++;
+   agg->pending--;
+   d->size = 0;
+   d->curr = 1 - d->curr;
+
+   /* Make sure the previous send from the new buffer is done */
+   MPI_Wait(&d->reqs[d->curr], MPI_STATUS_IGNORE);
+}  /* Agg_flush */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_flush_all
+ * Purpose:   Flush the buffers for every destination
+ * In/out:    agg
+ */
+void Agg_flush_all(agg_t agg) {
+   int dest;
+
+   for (dest = 0; dest < agg->comm_sz && agg->pending > 0; dest++)
+      Agg_flush(agg, dest);
+}  /* Agg_flush_all */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_receive
+ * Purpose:   Receive every aggregated message that has arrived and
+ *            append its small messages to the queue
+ * In/out:    agg
+ */
+void Agg_receive(agg_t agg) {
+   int msg_avail, count, i;
+   MPI_Status status;
+
+   MPI_Iprobe(MPI_ANY_SOURCE, agg->agg_tag, agg->comm, &msg_avail,
+         &status);
+   while (msg_avail) {
+      MPI_Recv(agg->recv_buf, agg->buf_ints, MPI_INT, status.MPI_SOURCE,
+            agg->agg_tag, agg->comm, &status);
+      MPI_Get_count(&status, MPI_INT, &count);
+      for (i = 0; i < count; i += HEADER_INTS + agg->recv_buf[i+1])
+         Enqueue_msg(agg, status.MPI_SOURCE, agg->recv_buf[i],
+               agg->recv_buf + i + HEADER_INTS, agg->recv_buf[i+1]);
+      MPI_Iprobe(MPI_ANY_SOURCE, agg->agg_tag, agg->comm, &msg_avail,
+            &status);
+   }
+}  /* Agg_receive */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_progress
+ * Purpose:   Receive any aggregated messages that have arrived, and
+ *            flush the buffers whose oldest message has waited at
+ *            least max_age seconds
+ * In/out:    agg
+ */
+void Agg_progress(agg_t agg) {
+   int dest;
+   double now;
+
+   Agg_receive(agg);
+
+   if (agg->pending == 0) return;
+   now = MPI_Wtime();
+   for (dest = 0; dest < agg->comm_sz; dest++)
+      if (agg->dests[dest].size > 0 &&
+            now - agg->dests[dest].first_time >= agg->max_age)
+         Agg_flush(agg, dest);
+}  /* Agg_progress */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_recv
+ * Purpose:   Remove the first message in the queue with tag and
+ *            source from the queue
+ * In args:   source:     a rank or MPI_ANY_SOURCE
+ *            tag
+ *            max_count:  capacity of data.  Any additional ints
+ *                        in the message are discarded
+ * Out args:  data
+ *            source_p:   the source of the message.  May be NULL
+ * Ret val:   1 if there was a matching message, 0 otherwise
+ * In/out:    agg
+ */
+int Agg_recv(agg_t agg, int source, int tag, int data[], int max_count,
+      int* source_p) {
+   agg_msg_struct* prev = NULL;
+   agg_msg_struct* msg = agg->head;
+
+   while (msg != NULL && (msg->tag != tag ||
+            (source != MPI_ANY_SOURCE && msg->source != source))) {
+      prev = msg;
+      msg = msg->next;
+   }
+   if (msg == NULL) return 0;
+
+   if (prev == NULL)
+      agg->head = msg->next;
+   else
+      prev->next = msg->next;
+   if (agg->tail == msg) agg->tail = prev;
+
+   memcpy(data, msg->data,
+         (msg->count < max_count ? msg->count : max_count)*sizeof(int));
+   if (source_p != NULL) *source_p = msg->source;
+   free(msg);
+   return 1;
+}  /* Agg_recv */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Agg_free
+ * Purpose:   Complete or cancel any outstanding sends and free the
+ *            aggregation layer
+ * In/out:    agg
+ */
+void Agg_free(agg_t agg) {
+   int dest, b, completed;
+   agg_msg_struct* msg;
+
+   for (dest = 0; dest < agg->comm_sz; dest++) {
+      for (b = 0; b < 2; b++) {
+         if (agg->dests[dest].reqs[b] != MPI_REQUEST_NULL) {
+            MPI_Test(&agg->dests[dest].reqs[b], &completed,
+                  MPI_STATUS_IGNORE);
+            if (!completed) {
+               MPI_Cancel(&agg->dests[dest].reqs[b]);
+               MPI_Wait(&agg->dests[dest].reqs[b], MPI_STATUS_IGNORE);
+            }
+         }
+         free(agg->dests[dest].bufs[b]);
+      }
+   }
+   while (agg->head != NULL) {
+      msg = agg->head;
+      agg->head = msg->next;
+      free(msg);
+   }
+   free(agg->dests);
+   free(agg->recv_buf);
+   free(agg);
+}  /* Agg_free */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Enqueue_msg
+ * Purpose:   Append a copy of a received message to the queue
+ * In args:   source, tag, data, count
+ * In/out:    agg
+ */
+static void Enqueue_msg(agg_t agg, int source, int tag, int data[],
+      int count) {
+   agg_msg_struct* msg =
+      malloc(sizeof(agg_msg_struct) + count*sizeof(int));
+
+   msg->source = source;
+   msg->tag = tag;
+   msg->count = count;
+   msg->next = NULL;
+   memcpy(msg->data, data, count*sizeof(int));
+   if (agg->tail == NULL)
+      agg->head = msg;
+   else
+      agg->tail->next = msg;
+   agg->tail = msg;
+}  /* Enqueue_msg */
@@ -0,0 +1,57 @@
+/* File:     msg_agg.h
+ * Purpose:  Header file for msg_agg.c, which coalesces small tagged
+ *           messages of ints into one MPI message per destination
+ *           and demultiplexes them on the receiving side
+ *
+ * IPP:      Section 6.2.12  (pp. 327 and ff.)
+ */
+#ifndef _MSG_AGG_H_
+#define _MSG_AGG_H_
+
+#include <mpi.h>
+
+/* A received message waiting in the local queue */
+typedef struct agg_msg_struct {
+   int source;
+   int tag;
+   int count;
+   struct agg_msg_struct* next;
+   int data[];
+}  agg_msg_struct;
+
+/* Per-destination send buffers.  While one buffer is being sent,
+ * messages are added to the other one */
+typedef struct {
+   int*        bufs[2];
+   MPI_Request reqs[2];
+   int         curr;        // buffer that's currently being filled
+   int         size;        // ints in bufs[curr]
+   double      first_time;  // when the oldest message in bufs[curr] was added
+}  agg_dest_struct;
+
+typedef struct {
+   MPI_Comm         comm;
+   int              comm_sz;
+   int              agg_tag;     // tag of the aggregated MPI messages
+   int              buf_ints;    // capacity of each send buffer
+   double           max_age;     // flush a buffer after this many seconds
+   agg_dest_struct* dests;
+   int              pending;     // number of nonempty send buffers
+   int*             recv_buf;
+   agg_msg_struct*  head;        // queue of received messages
+   agg_msg_struct*  tail;
+   long             msgs_sent;   // small messages passed to Agg_send
+   long             mpi_sent;    // MPI messages actually sent
+}  agg_struct;
+typedef agg_struct* agg_t;
+
+agg_t Agg_init(MPI_Comm comm, int agg_tag, int buf_ints, double max_age);
+void Agg_send(agg_t agg, int dest, int tag, int data[], int count);
+void Agg_flush(agg_t agg, int dest);
+void Agg_flush_all(agg_t agg);
+void Agg_receive(agg_t agg);
+void Agg_progress(agg_t agg);
+int  Agg_recv(agg_t agg, int source, int tag, int data[], int max_count,
+      int* source_p);
+void Agg_free(agg_t agg);
+#endif
@@ -0,0 +1,509 @@
+/* File:     omp_tsp_rec.c
+ * Purpose:  Use recursive depth-first search and OpenMP tasks to solve
+ *           an instance of the travelling salesman problem.  Near the
+ *           root of the tree, each feasible child of a tour is
+ *           searched by a new task;  below a cutoff the search is
+ *           the serial recursion of tsp_rec.c.  The OpenMP run-time
+ *           system balances the load:  idle threads steal queued
+ *           tasks.
+ *
+ * Compile:  gcc -g -Wall -fopenmp -o omp_tsp_rec omp_tsp_rec.c
+ * Usage:    omp_tsp_rec <thread count> <matrix_file> [task depth]
+ *
+ * Input:    From a user-specified file, the number of cities
+ *           followed by the costs of travelling between the
+ *           cities organized as a matrix:  the cost of
+ *           travelling from city i to city j is the ij entry.
+ *           Costs are nonnegative ints.  Diagonal entries are 0.
+ * Output:   The best tour found by the program and the cost
+ *           of the tour.
+ *
+ * Notes:
+ * 1.  Costs and cities are non-negative ints.
+ * 2.  Program assumes the cost of travelling from a city to
+ *     itself is zero, and the cost of travelling from one
+ *     city to another city is positive.
+ * 3.  Note that costs may not be symmetric:  the cost of travelling
+ *     from A to B, may, in general, be different from the cost
+ *     of travelling from B to A.
+ * 4.  Salesperson's home town is 0.
+ * 5.  The digraph is stored as an adjacency matrix, which is
+ *     a one-dimensional array:  digraph[i][j] is computed as
+ *     digraph[i*n + j]
+ * 6.  A tour with fewer than task depth cities (default 4), and
+ *     more than MIN_TASK_CITIES cities still to visit, creates a
+ *     task for each feasible child.  Each task gets its own copy of
+ *     the child tour.  A larger depth gives more, smaller tasks:
+ *     better balance, but more overhead.
+ * 7.  The cost of the best tour is also kept in best_cost, which is
+ *     read and written with atomics, so that the bound tests don't
+ *     need a lock.  Only replacing the best tour is a critical
+ *     section.
+ * 8.  Unlike omp_tsp_stat and omp_tsp_dyn, there's no explicit stack,
+ *     initial partition or termination detection:  the search is
+ *     done when all the tasks are done, at the implicit barrier at
+ *     the end of the parallel region.
+ * 9.  The tsp group of ../benchmarks.txt runs this program and
+ *     omp_tsp_dyn on random 12, 13 and 16 city matrices.  The 12 and
+ *     13 city searches take under 0.1 s, so only the 16 city one
+ *     says much about the two.  On the matrices benchmark.sh makes
+ *     (srand(n)), with 2 threads on a 1-core box, gcc -O2:
+ *
+ *        n    cost   tsp_iter2   omp_tsp_dyn (8)   omp_tsp_rec
+ *        16   188      5.41 s        6.46 s           5.63 s
+ *        18   196     52.2 s        72.7 s           30.4 s
+ *
+ *     With one core these measure overhead and search order, not
+ *     speedup, and the order depends on the matrix:  on another
+ *     random 18 city matrix omp_tsp_dyn was faster.  Rerun with more
+ *     cores before drawing conclusions about scaling.  18 cities is
+ *     too slow for the default suite.
+ *
+ * IPP:  Sections 6.2.1 (pp. 302 and ff.) and 6.2.9 (pp. 316 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+const int INFINITY = 1000000;
+const int NO_CITY = -1;
+const int FALSE = 0;
+const int TRUE = 1;
+const int DEFAULT_TASK_DEPTH = 4;
+const int MIN_TASK_CITIES = 6;
+
+typedef int city_t;
+typedef int cost_t;
+typedef struct {
+   city_t* cities; /* Cities in partial tour           */
+   int count;      /* Number of cities in partial tour */
+   cost_t cost;    /* Cost of partial tour             */
+} tour_struct;
+typedef tour_struct* tour_t;
+#define City_count(tour) (tour->count)
+#define Tour_cost(tour) (tour->cost)
+#define Last_city(tour) (tour->cities[(tour->count)-1])
+#define Tour_city(tour,i) (tour->cities[(i)])
+
+/* Global Vars:  Except for best_tour and best_cost, all are constant
+ * after initialization */
+int n;  /* Number of cities in the problem */
+int thread_count;
+int task_depth;
+cost_t* digraph;
+city_t home_town = 0;
+tour_t best_tour;
+cost_t best_cost;
+#define Cost(city1, city2) (digraph[city1*n + city2])
+#ifdef DEBUG
+long task_count = 0;
+#endif
+
+void Usage(char* prog_name);
+void Read_digraph(FILE* digraph_file);
+void Print_digraph(void);
+
+void Depth_first_search(tour_t tour);
+void Search_task(tour_t tour);
+cost_t Best_cost(void);
+void Print_tour(tour_t tour, char* title);
+int  Best_tour(tour_t tour);
+void Update_best_tour(tour_t tour);
+void Copy_tour(tour_t tour1, tour_t tour2);
+void Add_city(tour_t tour, city_t);
+void Remove_last_city(tour_t tour);
+int  Feasible(tour_t tour, city_t city);
+int  Visited(tour_t tour, city_t city);
+tour_t Alloc_tour(void);
+void Init_tour(tour_t tour, cost_t cost);
+void Free_tour(tour_t tour);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   FILE* digraph_file;
+   tour_t tour;
+   double start, finish;
+
+   if (argc != 3 && argc != 4) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   if (thread_count <= 0) {
+      fprintf(stderr, "Thread count must be positive\n");
+      Usage(argv[0]);
+   }
+   task_depth = (argc == 4) ? strtol(argv[3], NULL, 10)
+                            : DEFAULT_TASK_DEPTH;
+   if (task_depth < 1) {
+      fprintf(stderr, "Task depth must be positive\n");
+      Usage(argv[0]);
+   }
+   digraph_file = fopen(argv[2], "r");
+   if (digraph_file == NULL) {
+      fprintf(stderr, "Can't open %s\n", argv[2]);
+      Usage(argv[0]);
+   }
+   Read_digraph(digraph_file);
+   fclose(digraph_file);
+#  ifdef DEBUG
+   Print_digraph();
+#  endif
+
+   best_tour = Alloc_tour();
+   Init_tour(best_tour, INFINITY);
+   best_cost = INFINITY;
+   tour = Alloc_tour();
+   Init_tour(tour, 0);
+
+   start = omp_get_wtime();
+#  pragma omp parallel num_threads(thread_count)
+#  pragma omp single
+   Depth_first_search(tour);
+   finish = omp_get_wtime();
+
+   Print_tour(best_tour, "Best tour");
+   printf("Cost = %d\n", best_tour->cost);
+   printf("Elapsed time = %e seconds\n", finish-start);
+#  ifdef DEBUG
+   printf("Tasks = %ld\n", task_count);
+#  endif
+
+   Free_tour(best_tour);
+   Free_tour(tour);
+   free(digraph);
+   return 0;
+}  /* main */
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Inform user how to start program and exit
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <digraph file> [task depth]\n",
+         prog_name);
+   exit(0);
+}  /* Usage */
+
+/*------------------------------------------------------------------
+ * Function:  Read_digraph
+ * Purpose:   Read in the number of cities and the digraph of costs
+ * In arg:    digraph_file
+ * Globals out:
+ *    n:        the number of cities
+ *    digraph:  the matrix file
+ */
+void Read_digraph(FILE* digraph_file) {
+   int i, j;
+
+   fscanf(digraph_file, "%d", &n);
+   if (n <= 0) {
+      fprintf(stderr, "Number of vertices in digraph must be positive\n");
+      exit(-1);
+   }
+   digraph = malloc(n*n*sizeof(cost_t));
+
+   for (i = 0; i < n; i++)
+      for (j = 0; j < n; j++) {
+         fscanf(digraph_file, "%d", &digraph[i*n + j]);
+         if (i == j && digraph[i*n + j] != 0) {
+            fprintf(stderr, "Diagonal entries must be zero\n");
+            exit(-1);
+         } else if (i != j && digraph[i*n + j] <= 0) {
+            fprintf(stderr, "Off-diagonal entries must be positive\n");
+            fprintf(stderr, "diagraph[%d,%d] = %d\n", i, j, digraph[i*n+j]);
+            exit(-1);
+         }
+      }
+}  /* Read_digraph */
+
+
+/*------------------------------------------------------------------
+ * Function:  Print_digraph
+ * Purpose:   Print the number of cities and the digraphrix of costs
+ * Globals in:
+ *    n:        number of cities
+ *    digraph:  digraph of costs
+ */
+void Print_digraph(void) {
+   int i, j;
+
+   printf("Order = %d\n", n);
+   printf("Matrix = \n");
+   for (i = 0; i < n; i++) {
+      for (j = 0; j < n; j++)
+         printf("%2d ", digraph[i*n+j]);
+      printf("\n");
+   }
+   printf("\n");
+}  /* Print_digraph */
+
+
+/*------------------------------------------------------------------
+ * Function:    Depth_first_search
+ * Purpose:     Recursively search for a least-cost tour
+ * In arg:
+ *    tour:     partial tour of cities visited so far.
+ * Globals in:
+ *    n:           total number of cities in the problem
+ *    task_depth:  tours with fewer cities create tasks
+ * Notes:
+ * 1. The input tour is modified during execution of search,
+ *    but returned to its original state before returning.
+ * 2. A task searches a copy of the child tour, and frees it, so
+ *    the parent doesn't wait for its tasks.
+ */
+void Depth_first_search(tour_t tour) {
+   city_t nbr;
+   tour_t child;
+
+   if (City_count(tour) == n) {
+      if (Best_tour(tour))
+         Update_best_tour(tour);
+   } else if (City_count(tour) < task_depth &&
+         n - City_count(tour) > MIN_TASK_CITIES) {
+      for (nbr = 1; nbr < n; nbr++)
+         if (Feasible(tour, nbr)) {
+            child = Alloc_tour();
+            Copy_tour(tour, child);
+            Add_city(child, nbr);
+#           pragma omp task firstprivate(child)
+            Search_task(child);
+         }
+   } else {
+      for (nbr = 1; nbr < n; nbr++)
+         if (Feasible(tour, nbr)) {
+            Add_city(tour, nbr);
+            Depth_first_search(tour);
+            Remove_last_city(tour);
+         }
+   }
+}  /* Depth_first_search */
+
+
+/*------------------------------------------------------------------
+ * Function:    Search_task
+ * Purpose:     Body of a task:  search the subtree rooted at tour,
+ *              unless a better tour has been found since the task
+ *              was created, and free tour
+ * In/out arg:
+ *    tour
+ */
+void Search_task(tour_t tour) {
+#  ifdef DEBUG
+#  pragma omp atomic
+   task_count++;
+#  endif
+   if (Tour_cost(tour) < Best_cost())
+      Depth_first_search(tour);
+   Free_tour(tour);
+}  /* Search_task */
+
+
+/*------------------------------------------------------------------
+ * Function:    Best_cost
+ * Purpose:     Atomically read the cost of the best tour
+ * Global in:
+ *    best_cost
+ */
+cost_t Best_cost(void) {
+   cost_t cost;
+
+#  pragma omp atomic read
+   cost = best_cost;
+   return cost;
+}  /* Best_cost */
+
+/*------------------------------------------------------------------
+ * Function:    Best_tour
+ * Purpose:     Determine whether addition of the hometown to the
+ *              n-city input tour will lead to a best tour.
+ * In arg:
+ *    tour:     tour visiting all n cities
+ * Ret val:
+ *    TRUE if best tour, FALSE otherwise
+ */
+int Best_tour(tour_t tour) {
+   cost_t cost_so_far = Tour_cost(tour);
+   city_t last_city = Last_city(tour);
+
+   if (cost_so_far + Cost(last_city, home_town) < Best_cost())
+      return TRUE;
+   else
+      return FALSE;
+}  /* Best_tour */
+
+/*------------------------------------------------------------------
+ * Function:    Update_best_tour
+ * Purpose:     Replace the existing best tour with the input tour +
+ *              hometown
+ * In arg:
+ *    tour:     tour that's visited all n-cities
+ * Globals out:
+ *    best_tour:  the current best tour
+ *    best_cost:  its cost
+ * Notes:
+ * 1. The input tour hasn't had the home_town added as the last
+ *    city before the call to Update_best_tour.  So we call
+ *    Add_city(best_tour, hometown) before returning.
+ * 2. Need the extra check of Best_tour in case another thread
+ *    updated best_cost between the time the thread first
+ *    checked and entered the critical section
+ */
+void Update_best_tour(tour_t tour) {
+#  pragma omp critical
+   if (Best_tour(tour)) {
+      Copy_tour(tour, best_tour);
+      Add_city(best_tour, home_town);
+#     pragma omp atomic write
+      best_cost = Tour_cost(best_tour);
+   }
+}  /* Update_best_tour */
+
+
+/*------------------------------------------------------------------
+ * Function:   Copy_tour
+ * Purpose:    Copy tour1 into tour2
+ * In arg:
+ *    tour1
+ * Out arg:
+ *    tour2
+ */
+void Copy_tour(tour_t tour1, tour_t tour2) {
+   memcpy(tour2->cities, tour1->cities, (n+1)*sizeof(city_t));
+   tour2->count = tour1->count;
+   tour2->cost = tour1->cost;
+}  /* Copy_tour */
+
+/*------------------------------------------------------------------
+ * Function:  Add_city
+ * Purpose:   Add city to the end of tour
+ * In arg:
+ *    city
+ * In/out arg:
+ *    tour
+ */
+void Add_city(tour_t tour, city_t new_city) {
+   city_t old_last_city = Last_city(tour);
+   tour->cities[tour->count] = new_city;
+   (tour->count)++;
+   tour->cost += Cost(old_last_city,new_city);
+}  /* Add_city */
+
+/*------------------------------------------------------------------
+ * Function:  Remove_last_city
+ * Purpose:   Remove last city from end of tour
+ * In/out arg:
+ *    tour
+ * Note:
+ *    Function assumes there are at least two cities on the tour --
+ *    i.e., the hometown in tour->cities[0] won't be removed.
+ */
+void Remove_last_city(tour_t tour) {
+   city_t old_last_city = Last_city(tour);
+   city_t new_last_city;
+
+   tour->cities[tour->count-1] = NO_CITY;
+   (tour->count)--;
+   new_last_city = Last_city(tour);
+   tour->cost -= Cost(new_last_city,old_last_city);
+}  /* Remove_last_city */
+
+/*------------------------------------------------------------------
+ * Function:  Feasible
+ * Purpose:   Check whether nbr could possibly lead to a better
+ *            solution if it is added to the current tour.  The
+ *            function checks whether nbr has already been visited
+ *            in the current tour, and, if not, whether adding the
+ *            edge from the current city to nbr will result in
+ *            a cost less than the current best cost.
+ * In args:   All
+ * Global in:
+ *    best_cost
+ * Return:    TRUE if the nbr can be added to the current tour.
+ *            FALSE otherwise
+ */
+int Feasible(tour_t tour, city_t city) {
+   city_t last_city = Last_city(tour);
+
+   if (!Visited(tour, city) &&
+        Tour_cost(tour) + Cost(last_city,city) < Best_cost())
+      return TRUE;
+   else
+      return FALSE;
+}  /* Feasible */
+
+
+/*------------------------------------------------------------------
+ * Function:   Visited
+ * Purpose:    Use linear search to determine whether city has already
+ *             been visited on the current tour.
+ * In args:    All
+ * Return val: TRUE if city has already been visited.
+ *             FALSE otherwise
+ */
+int Visited(tour_t tour, city_t city) {
+   int i;
+
+   for (i = 0; i < City_count(tour); i++)
+      if ( Tour_city(tour,i) == city ) return TRUE;
+   return FALSE;
+}  /* Visited */
+
+
+/*------------------------------------------------------------------
+ * Function:  Print_tour
+ * Purpose:   Print a tour
+ * In args:   All
+ */
+void Print_tour(tour_t tour, char* title) {
+   int i;
+
+   printf("%s:\n", title);
+   for (i = 0; i < City_count(tour); i++)
+      printf("%d ", Tour_city(tour,i));
+   printf("\n");
+}  /* Print_tour */
+
+/*------------------------------------------------------------------
+ * Function:  Alloc_tour
+ * Purpose:   Allocate memory for a tour and its members
+ * Global in: n, number of cities
+ * Ret val:   Pointer to a tour_struct with storage allocated for its
+ *            members
+ */
+tour_t Alloc_tour(void) {
+   tour_t tmp = malloc(sizeof(tour_struct));
+   tmp->cities = malloc((n+1)*sizeof(city_t));
+   return tmp;
+}  /* Alloc_tour */
+
+/*------------------------------------------------------------------
+ * Function:  Init_tour
+ * Purpose:   Initialize the data members of allocated tour
+ * In args:
+ *    cost:   initial cost of tour
+ * Global in:
+ *    n:      number of cities in TSP
+ * Out arg:
+ *    tour
+ */
+void Init_tour(tour_t tour, cost_t cost) {
+   int i;
+
+   tour->cities[0] = 0;
+   for (i = 1; i <= n; i++) {
+      tour->cities[i] = NO_CITY;
+   }
+   tour->cost = cost;
+   tour->count = 1;
+}  /* Init_tour */
+
+/*------------------------------------------------------------------
+ * Function:  Free_tour
+ * Purpose:   Free a tour
+ * Out arg:   tour
+ */
+void Free_tour(tour_t tour) {
+   free(tour->cities);
+   free(tour);
+}  /* Free_tour */
@@ -5,10 +5,12 @@
  *           partitions the search tree using breadth-first search.
  *           Then each thread searches its assigned subtree.  There
  *           is no reassignment of tree nodes.  This version attempts
- *           to reuse deallocated tours.
+ *           to reuse deallocated tours.  Optionally, the tree can be
+ *           partitioned into many more subtrees than threads, which
+ *           the threads claim one at a time (see Note 6).
  *
  * Compile:  gcc -g -Wall -fopenmp -o omp_tsp_stat omp_tsp_stat.c
- * Usage:    omp_tsp_stat <thread count> <matrix_file>
+ * Usage:    omp_tsp_stat <thread count> <matrix_file> [frontier factor]
  *
  * Input:    From a user-specified file, the number of cities
  *           followed by the costs of travelling between the
@@ -30,6 +32,16 @@
  * 5.  The digraph is stored as an adjacency matrix, which is
  *     a one-dimensional array:  digraph[i][j] is computed as
  *     digraph[i*n + j]
+ * 6.  With a frontier factor f > 0, the threads together expand the
+ *     tree breadth-first until there are at least f*thread_count
+ *     tours (or the tours are complete).  The tours are sorted by
+ *     cost, and each time a thread's stack is empty, it claims the
+ *     cheapest unclaimed tour with an atomic increment of an index.
+ *     This balances the load nearly as well as omp_tsp_dyn, without
+ *     its stack splitting, and cheap tours, which are more likely to
+ *     lead to good bounds, are searched first.  f = 64 works well.
+ *     Without f, or with f = 0, each thread gets a fixed block of the
+ *     first level of the tree that has at least thread_count tours.
  *
  * IPP:  Section 6.2.9 (pp. 316 and ff.)
  */
@@ -89,6 +101,11 @@ tour_t best_tour;
 my_queue_t queue;
 int queue_size;
 int init_tour_count;
+int frontier_factor = 0;  /* 0:  static partition                  */
+tour_t* frontier;         /* Tours the threads claim, cheapest first */
+tour_t* next_frontier;    /* Next level of the tree, while building  */
+int frontier_sz;
+int next_tour;            /* Index of the next unclaimed tour        */
 
 void Usage(char* prog_name);
 void Read_digraph(FILE* digraph_file);
@@ -99,6 +116,9 @@ void Partition_tree(int my_rank, my_stack_t stack);
 void Set_init_tours(int my_rank, int* my_first_tour_p,
       int* my_last_tour_p);
 void Build_initial_queue(void);
+void Build_frontier(void);
+int  Compare_tours(const void* a_p, const void* b_p);
+int  Claim_tour(my_stack_t stack, my_stack_t avail);
 void Print_tour(int my_rank, tour_t tour, char* title);
 int  Best_tour(tour_t tour); 
 void Update_best_tour(tour_t tour);
@@ -134,12 +154,17 @@ int main(int argc, char* argv[]) {
    FILE* digraph_file;
    double start, finish;
 
-   if (argc != 3) Usage(argv[0]);
+   if (argc != 3 && argc != 4) Usage(argv[0]);
    thread_count = strtol(argv[1], NULL, 10);
    if (thread_count <= 0) {
       fprintf(stderr, "Thread count must be positive\n");
       Usage(argv[0]);
    }
+   if (argc == 4) frontier_factor = strtol(argv[3], NULL, 10);
+   if (frontier_factor < 0) {
+      fprintf(stderr, "Frontier factor can't be negative\n");
+      Usage(argv[0]);
+   }
    digraph_file = fopen(argv[2], "r");
    if (digraph_file == NULL) {
       fprintf(stderr, "Can't open %s\n", argv[2]);
@@ -202,7 +227,8 @@ void Init_tour(tour_t tour, cost_t cost) {
  * In arg:    prog_name
  */
 void Usage(char* prog_name) {
-   fprintf(stderr, "usage: %s <thread_count> <digraph file>\n", prog_name);
+   fprintf(stderr, "usage: %s <thread_count> <digraph file> "
+         "[frontier factor]\n", prog_name);
    exit(0);
 }  /* Usage */
 
@@ -270,6 +296,8 @@ void Print_digraph(void) {
  * Notes:
  * 1. The Update_best_tour function will modify the global var
  *    best_tour
+ * 2. With a frontier, a thread claims another tour each time its
+ *    stack is empty
  */
 void Par_tree_search(void) {
    int my_rank = omp_get_thread_num();
@@ -280,9 +308,12 @@ void Par_tree_search(void) {
 
    avail = Init_stack();
    stack = Init_stack();
-   Partition_tree(my_rank, stack);
+   if (frontier_factor > 0)
+      Build_frontier();
+   else
+      Partition_tree(my_rank, stack);
 
-   while (!Empty_stack(stack)) {
+   while (!Empty_stack(stack) || Claim_tour(stack, avail)) {
       curr_tour = Pop(stack);
 #     ifdef DEBUG
       Print_tour(my_rank, curr_tour, "Popped");
@@ -309,7 +340,12 @@ void Par_tree_search(void) {
    Free_stack(avail);
 #  pragma omp barrier
 #  pragma omp master
-   Free_queue(queue);
+   {
+      if (frontier_factor > 0)
+         free(frontier);
+      else
+         Free_queue(queue);
+   }
 
 }  /* Par_tree_search */
 
@@ -436,6 +472,134 @@ void Build_initial_queue(void) {
 #  endif
 }  /* Build_initial_queue */
 
+/*------------------------------------------------------------------
+ * Function:  Build_frontier
+ * Purpose:   Use all the threads to expand the tree breadth-first
+ *            until there are at least frontier_factor*thread_count
+ *            tours, or the tours are complete, and sort the tours by
+ *            cost
+ * Globals out:
+ *    frontier, frontier_sz, next_tour
+ * Global scratch:
+ *    next_frontier
+ *
+ * Notes:
+ * 1. All the tours on a level have the same number of children,
+ *    kids = n - count, so the children of tour j go in slots j*kids,
+ *    j*kids + 1, ... of the next level, and the iterations of the
+ *    for loop are independent.
+ * 2. Must be called by all the threads in the team
+ */
+void Build_frontier(void) {
+   int target = frontier_factor*thread_count;
+   int kids, j, k;
+   city_t nbr;
+   tour_t tour;
+
+#  pragma omp single
+   {
+      frontier = malloc(sizeof(tour_t));
+      frontier[0] = Alloc_tour(NULL);
+      Init_tour(frontier[0], 0);
+      frontier_sz = 1;
+   }
+
+   while (frontier_sz < target && City_count(frontier[0]) < n) {
+      kids = n - City_count(frontier[0]);
+#     pragma omp single
+      next_frontier = malloc(frontier_sz*kids*sizeof(tour_t));
+
+#     pragma omp for
+      for (j = 0; j < frontier_sz; j++) {
+         tour = frontier[j];
+         k = j*kids;
+         for (nbr = 1; nbr < n; nbr++)
+            if (!Visited(tour, nbr)) {
+               Add_city(tour, nbr);
+               next_frontier[k] = Alloc_tour(NULL);
+               Copy_tour(tour, next_frontier[k]);
+               k++;
+               Remove_last_city(tour);
+            }
+         Free_tour(tour, NULL);
+      }
+
+#     pragma omp single
+      {
+         free(frontier);
+         frontier = next_frontier;
+         frontier_sz *= kids;
+      }
+   }
+
+#  pragma omp single
+   {
+      qsort(frontier, frontier_sz, sizeof(tour_t), Compare_tours);
+      next_tour = 0;
+#     ifdef DEBUG
+      printf("Th %d > frontier_sz = %d, cheapest = %d, dearest = %d\n",
+            omp_get_thread_num(), frontier_sz, Tour_cost(frontier[0]),
+            Tour_cost(frontier[frontier_sz-1]));
+#     endif
+   }
+}  /* Build_frontier */
+
+
+/*------------------------------------------------------------------
+ * Function:  Compare_tours
+ * Purpose:   qsort comparison:  order tours by increasing cost, and
+ *            tours with the same cost by their cities, so that the
+ *            order doesn't depend on qsort
+ */
+int Compare_tours(const void* a_p, const void* b_p) {
+   tour_t a = *((tour_t*) a_p);
+   tour_t b = *((tour_t*) b_p);
+   int i;
+
+   if (Tour_cost(a) != Tour_cost(b))
+      return Tour_cost(a) < Tour_cost(b) ? -1 : 1;
+   for (i = 1; i < City_count(a); i++)
+      if (Tour_city(a,i) != Tour_city(b,i))
+         return Tour_city(a,i) < Tour_city(b,i) ? -1 : 1;
+   return 0;
+}  /* Compare_tours */
+
+
+/*------------------------------------------------------------------
+ * Function:  Claim_tour
+ * Purpose:   Claim the cheapest unclaimed tour in the frontier and
+ *            push a copy of it onto the thread's stack.  Tours that
+ *            cost at least as much as the best tour are skipped.
+ * In/out args:
+ *    stack, avail
+ * Globals in:
+ *    frontier, frontier_sz
+ * Global in/out:
+ *    next_tour
+ * Return val:  TRUE if a tour was pushed, FALSE if the frontier is
+ *    exhausted or there is no frontier
+ */
+int Claim_tour(my_stack_t stack, my_stack_t avail) {
+   int i;
+   tour_t tour;
+
+   if (frontier_factor == 0) return FALSE;
+#  pragma omp atomic capture
+   i = next_tour++;
+   while (i < frontier_sz) {
+      tour = frontier[i];
+      if (Tour_cost(tour) < Tour_cost(best_tour))
+         Push_copy(stack, tour, avail);
+      /* A copy, so that the number of tours in avail doesn't grow */
+      Free_tour(tour, NULL);
+      if (!Empty_stack(stack)) return TRUE;
+#     pragma omp atomic capture
+      i = next_tour++;
+   }
+   return FALSE;
+}  /* Claim_tour */
+
+
 /*------------------------------------------------------------------
  * Function:    Best_tour
  * Purpose:     Determine whether addition of the hometown to the 
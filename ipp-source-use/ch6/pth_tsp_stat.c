@@ -5,11 +5,13 @@
  *           partitions the search tree using breadth-first search.
  *           Then each thread searches its assigned subtree.  There
  *           is no reassignment of tree nodes.  This version attempts
- *           to reuse deallocated tours.
+ *           to reuse deallocated tours.  Optionally, the tree can be
+ *           partitioned into many more subtrees than threads, which
+ *           the threads claim one at a time (see Note 6).
  *
  * Compile:  gcc -g -Wall -o pth_tsp_stat pth_tsp_stat.c -lpthread
  *           Needs timer.h
- * Usage:    pth_tsp_stat <thread count> <matrix_file>
+ * Usage:    pth_tsp_stat <thread count> <matrix_file> [frontier factor]
  *
  * Input:    From a user-specified file, the number of cities
  *           followed by the costs of travelling between the
@@ -31,6 +33,16 @@
  * 5.  The digraph is stored as an adjacency matrix, which is
  *     a one-dimensional array:  digraph[i][j] is computed as
  *     digraph[i*n + j]
+ * 6.  With a frontier factor f > 0, the threads together expand the
+ *     tree breadth-first until there are at least f*thread_count
+ *     tours (or the tours are complete).  The tours are sorted by
+ *     cost, and each time a thread's stack is empty, it claims the
+ *     cheapest unclaimed tour by atomically incrementing an index.
+ *     So a thread that has a deep subtree doesn't leave the others
+ *     idle, and cheap tours, which are more likely to lead to good
+ *     bounds, are searched first.  f = 64 works well.  Without f, or
+ *     with f = 0, each thread gets a fixed block of the first level
+ *     of the tree that has at least thread_count tours.
  *
  * IPP:  Section 6.2.6 (pp. 309 and ff.)
  */
@@ -38,6 +50,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include "timer.h"
 
 const int INFINITY = 1000000;
@@ -100,6 +113,11 @@ my_queue_t queue;
 int queue_size;
 int init_tour_count;
 my_barrier_t bar_str;
+int frontier_factor = 0;  /* 0:  static partition                  */
+tour_t* frontier;         /* Tours the threads claim, cheapest first */
+tour_t* next_frontier;    /* Next level of the tree, while building  */
+int frontier_sz;
+atomic_int next_tour;     /* Index of the next unclaimed tour        */
 
 void Usage(char* prog_name);
 void Read_digraph(FILE* digraph_file);
@@ -110,6 +128,9 @@ void Partition_tree(long my_rank, my_stack_t stack);
 void Set_init_tours(long my_rank, int* my_first_tour_p,
       int* my_last_tour_p);
 void Build_initial_queue(void);
+void Build_frontier(long my_rank);
+int  Compare_tours(const void* a_p, const void* b_p);
+int  Claim_tour(my_stack_t stack, my_stack_t avail);
 void Print_tour(long my_rank, tour_t tour, char* title);
 int  Best_tour(tour_t tour); 
 void Update_best_tour(tour_t tour);
@@ -152,12 +173,17 @@ int main(int argc, char* argv[]) {
    long thread;
    pthread_t* thread_handles;
 
-   if (argc != 3) Usage(argv[0]);
+   if (argc != 3 && argc != 4) Usage(argv[0]);
    thread_count = strtol(argv[1], NULL, 10);
    if (thread_count <= 0) {
       fprintf(stderr, "Thread count must be positive\n");
       Usage(argv[0]);
    }
+   if (argc == 4) frontier_factor = strtol(argv[3], NULL, 10);
+   if (frontier_factor < 0) {
+      fprintf(stderr, "Frontier factor can't be negative\n");
+      Usage(argv[0]);
+   }
    digraph_file = fopen(argv[2], "r");
    if (digraph_file == NULL) {
       fprintf(stderr, "Can't open %s\n", argv[2]);
@@ -231,7 +257,8 @@ void Init_tour(tour_t tour, cost_t cost) {
  * In arg:    prog_name
  */
 void Usage(char* prog_name) {
-   fprintf(stderr, "usage: %s <thread_count> <digraph file>\n", prog_name);
+   fprintf(stderr, "usage: %s <thread_count> <digraph file> "
+         "[frontier factor]\n", prog_name);
    exit(0);
 }  /* Usage */
 
@@ -299,6 +326,8 @@ void Print_digraph(void) {
  * Notes:
  * 1. The Update_best_tour function will modify the global var
  *    best_tour
+ * 2. With a frontier, a thread claims another tour each time its
+ *    stack is empty
  */
 void* Par_tree_search(void* rank) {
    long my_rank = (long) rank;
@@ -309,9 +338,12 @@ void* Par_tree_search(void* rank) {
 
    avail = Init_stack();
    stack = Init_stack();
-   Partition_tree(my_rank, stack);
+   if (frontier_factor > 0)
+      Build_frontier(my_rank);
+   else
+      Partition_tree(my_rank, stack);
 
-   while (!Empty_stack(stack)) {
+   while (!Empty_stack(stack) || Claim_tour(stack, avail)) {
       curr_tour = Pop(stack);
 #     ifdef DEBUG
       Print_tour(my_rank, curr_tour, "Popped");
@@ -336,7 +368,12 @@ void* Par_tree_search(void* rank) {
    Free_stack(stack);
    Free_stack(avail);
    My_barrier(bar_str);
-   if (my_rank == 0) Free_queue(queue);
+   if (my_rank == 0) {
+      if (frontier_factor > 0)
+         free(frontier);
+      else
+         Free_queue(queue);
+   }
 
    return NULL;
 }  /* Par_tree_search */
@@ -460,6 +497,133 @@ void Build_initial_queue(void) {
 #  endif
 }  /* Build_initial_queue */
 
+/*------------------------------------------------------------------
+ * Function:  Build_frontier
+ * Purpose:   Use all the threads to expand the tree breadth-first
+ *            until there are at least frontier_factor*thread_count
+ *            tours, or the tours are complete, and sort the tours by
+ *            cost
+ * In arg:    my_rank
+ * Globals out:
+ *    frontier, frontier_sz, next_tour
+ * Global scratch:
+ *    next_frontier, init_tour_count
+ *
+ * Note:  All the tours on a level have the same number of children,
+ *    kids = n - count, so the children of tour j go in slots j*kids,
+ *    j*kids + 1, ... of the next level, and each thread can expand
+ *    its block of the level without synchronizing.
+ */
+void Build_frontier(long my_rank) {
+   int target = frontier_factor*thread_count;
+   int kids, my_first_tour, my_last_tour, j, k;
+   city_t nbr;
+   tour_t tour;
+
+   if (my_rank == 0) {
+      frontier = malloc(sizeof(tour_t));
+      frontier[0] = Alloc_tour(NULL);
+      Init_tour(frontier[0], 0);
+      frontier_sz = 1;
+   }
+   My_barrier(bar_str);
+
+   while (frontier_sz < target && City_count(frontier[0]) < n) {
+      kids = n - City_count(frontier[0]);
+      if (my_rank == 0) {
+         next_frontier = malloc(frontier_sz*kids*sizeof(tour_t));
+         init_tour_count = frontier_sz;
+      }
+      My_barrier(bar_str);
+      Set_init_tours(my_rank, &my_first_tour, &my_last_tour);
+      for (j = my_first_tour; j <= my_last_tour; j++) {
+         tour = frontier[j];
+         k = j*kids;
+         for (nbr = 1; nbr < n; nbr++)
+            if (!Visited(tour, nbr)) {
+               Add_city(tour, nbr);
+               next_frontier[k] = Alloc_tour(NULL);
+               Copy_tour(tour, next_frontier[k]);
+               k++;
+               Remove_last_city(tour);
+            }
+         Free_tour(tour, NULL);
+      }
+      My_barrier(bar_str);
+      if (my_rank == 0) {
+         free(frontier);
+         frontier = next_frontier;
+         frontier_sz *= kids;
+      }
+      My_barrier(bar_str);
+   }
+
+   if (my_rank == 0) {
+      qsort(frontier, frontier_sz, sizeof(tour_t), Compare_tours);
+      atomic_store(&next_tour, 0);
+#     ifdef DEBUG
+      printf("Th 0 > frontier_sz = %d, cheapest = %d, dearest = %d\n",
+            frontier_sz, Tour_cost(frontier[0]),
+            Tour_cost(frontier[frontier_sz-1]));
+#     endif
+   }
+   My_barrier(bar_str);
+}  /* Build_frontier */
+
+
+/*------------------------------------------------------------------
+ * Function:  Compare_tours
+ * Purpose:   qsort comparison:  order tours by increasing cost, and
+ *            tours with the same cost by their cities, so that the
+ *            order doesn't depend on qsort
+ */
+int Compare_tours(const void* a_p, const void* b_p) {
+   tour_t a = *((tour_t*) a_p);
+   tour_t b = *((tour_t*) b_p);
+   int i;
+
+   if (Tour_cost(a) != Tour_cost(b))
+      return Tour_cost(a) < Tour_cost(b) ? -1 : 1;
+   for (i = 1; i < City_count(a); i++)
+      if (Tour_city(a,i) != Tour_city(b,i))
+         return Tour_city(a,i) < Tour_city(b,i) ? -1 : 1;
+   return 0;
+}  /* Compare_tours */
+
+
+/*------------------------------------------------------------------
+ * Function:  Claim_tour
+ * Purpose:   Claim the cheapest unclaimed tour in the frontier and
+ *            push a copy of it onto the thread's stack.  Tours that
+ *            cost at least as much as the best tour are skipped.
+ * In/out args:
+ *    stack, avail
+ * Globals in:
+ *    frontier, frontier_sz
+ * Global in/out:
+ *    next_tour
+ * Return val:  TRUE if a tour was pushed, FALSE if the frontier is
+ *    exhausted or there is no frontier
+ */
+int Claim_tour(my_stack_t stack, my_stack_t avail) {
+   int i;
+   tour_t tour;
+
+   if (frontier_factor == 0) return FALSE;
+   i = atomic_fetch_add(&next_tour, 1);
+   while (i < frontier_sz) {
+      tour = frontier[i];
+      if (Tour_cost(tour) < Tour_cost(best_tour))
+         Push_copy(stack, tour, avail);
+      /* A copy, so that the number of tours in avail doesn't grow */
+      Free_tour(tour, NULL);
+      if (!Empty_stack(stack)) return TRUE;
+      i = atomic_fetch_add(&next_tour, 1);
+   }
+   return FALSE;
+}  /* Claim_tour */
+
+
 /*------------------------------------------------------------------
  * Function:    Best_tour
  * Purpose:     Determine whether addition of the hometown to the 
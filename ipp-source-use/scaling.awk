@@ -0,0 +1,173 @@
+# File:     scaling.awk
+# Purpose:  Summarize the raw.csv written by benchmark.sh:  for each
+#           program, size and thread/process count p, the number of
+#           runs, the minimum and median times, and the speedup,
+#           efficiency and Karp-Flatt metric.
+#
+# Usage:    awk -f scaling.awk [-v format=text|csv]
+#              [-v baseline=summary.csv] [-v tolerance=percent] raw.csv
+#
+# Output:   format=text (default):  a table for each group
+#           format=csv:  one line for each program, size and p
+#
+# Notes:
+# 1.  The serial time for a group and size is the median time of the
+#     group's serial program at that size, or, if the group doesn't
+#     have one, of the program itself with p = 1.  Then
+#        speedup     S = T_serial/T_p
+#        efficiency  E = S/p
+#        Karp-Flatt  e = (1/S - 1/p)/(1 - 1/p), for p > 1
+#     e is the experimentally determined serial fraction:  if it grows
+#     with p, the overhead of parallelism is growing, rather than
+#     there being a fixed serial part.
+# 2.  With a baseline (a summary.csv from an earlier run), each
+#     program, size and p whose median time is more than tolerance
+#     (default 10) percent higher than in the baseline is printed on
+#     stderr, and the exit status is 1.
+# 3.  Times are only compared if they were measured with the same timer
+#     (the timer column of raw.csv:  prof, elapsed or wall), since the
+#     wall clock time also includes the start up and the I/O.  So
+#     there's no speedup if a program and its serial time were timed
+#     differently, and a configuration isn't checked against a baseline
+#     that was timed differently.  A configuration whose runs used more
+#     than one timer has timer "mixed", and isn't compared at all.
+
+BEGIN {
+   FS = ","
+   if (format == "") format = "text"
+   if (tolerance == "") tolerance = 10
+}
+
+NR == 1 { next }
+
+{
+   key = $2 SUBSEP $4 SUBSEP $5
+   if (!(key in group)) {
+      keys[++key_count] = key
+      group[key] = $1
+      name[key] = $2
+      model[key] = $3
+      size[key] = $4
+      p[key] = $5
+      runs[key] = failed[key] = 0
+   }
+   if ($9 == "ok") {
+      times[key, ++runs[key]] = $8 + 0
+      if (!(key in timer))
+         timer[key] = $7
+      else if (timer[key] != $7)
+         timer[key] = "mixed"
+   } else
+      failed[key]++
+}
+
+END {
+   for (i = 1; i <= key_count; i++) {
+      key = keys[i]
+      n = runs[key]
+      if (n == 0) continue
+      Sort_times(key, n)
+      min[key] = times[key, 1]
+      if (n % 2 == 1)
+         median[key] = times[key, (n + 1)/2]
+      else
+         median[key] = (times[key, n/2] + times[key, n/2 + 1])/2
+      if (model[key] == "serial" && !((group[key], size[key]) in serial)) {
+         serial[group[key], size[key]] = median[key]
+         serial_timer[group[key], size[key]] = timer[key]
+      }
+      if (p[key] == 1) {
+         one[name[key], size[key]] = median[key]
+         one_timer[name[key], size[key]] = timer[key]
+      }
+   }
+
+   if (format == "csv")
+      print "group,name,model,size,p,runs,failed,min_s,median_s,speedup,efficiency,karp_flatt,timer"
+   for (i = 1; i <= key_count; i++) {
+      key = keys[i]
+      Metrics(key)
+      if (format == "csv") {
+         printf "%s,%s,%s,%s,%d,%d,%d,%s,%s,%s,%s,%s,%s\n", group[key],
+            name[key], model[key], size[key], p[key], runs[key],
+            failed[key], Fmt(min[key], "%.6e"), Fmt(median[key], "%.6e"),
+            Fmt(speedup, "%.4f"), Fmt(efficiency, "%.4f"),
+            Fmt(karp_flatt, "%.4f"), Fmt(timer[key], "%s")
+      } else {
+         if (group[key] != last_group) {
+            printf "%s%s\n", last_group == "" ? "" : "\n", group[key]
+            printf "%-22s %10s %4s %5s %12s %12s %8s %6s %10s %7s\n",
+               "program", "size", "p", "runs", "min (s)", "median (s)",
+               "speedup", "eff", "Karp-Flatt", "timer"
+            last_group = group[key]
+         }
+         printf "%-22s %10s %4d %5s %12s %12s %8s %6s %10s %7s\n", name[key],
+            size[key], p[key],
+            runs[key] (failed[key] > 0 ? "!" : ""), Fmt(min[key], "%.4e"),
+            Fmt(median[key], "%.4e"), Fmt(speedup, "%.2f"),
+            Fmt(efficiency, "%.2f"), Fmt(karp_flatt, "%.4f"),
+            Fmt(timer[key], "%s")
+      }
+   }
+   if (format == "text")
+      print "\n! = some runs failed;  speedup is relative to the group's serial program, if it has one,\nand only computed if both were timed with the same timer"
+
+   if (baseline != "") exit Compare(baseline)
+}
+
+# Insertion sort of times[key, 1..n]
+function Sort_times(key, n,    i, j, x) {
+   for (i = 2; i <= n; i++) {
+      x = times[key, i]
+      for (j = i - 1; j >= 1 && times[key, j] > x; j--)
+         times[key, j + 1] = times[key, j]
+      times[key, j + 1] = x
+   }
+}
+
+# Set the globals speedup, efficiency and karp_flatt for key, or "" if
+# they can't be computed
+function Metrics(key,    base, base_timer) {
+   speedup = efficiency = karp_flatt = ""
+   if (runs[key] == 0 || median[key] <= 0) return
+   if ((group[key], size[key]) in serial) {
+      base = serial[group[key], size[key]]
+      base_timer = serial_timer[group[key], size[key]]
+   } else if ((name[key], size[key]) in one) {
+      base = one[name[key], size[key]]
+      base_timer = one_timer[name[key], size[key]]
+   } else
+      return
+   if (timer[key] == "mixed" || base_timer != timer[key]) return
+   speedup = base/median[key]
+   efficiency = speedup/p[key]
+   if (p[key] > 1)
+      karp_flatt = (1/speedup - 1/p[key])/(1 - 1/p[key])
+}
+
+function Fmt(x, f) {
+   return x == "" ? "-" : sprintf(f, x)
+}
+
+# Print the configurations that are slower than in file, and return
+# 1 if there are any.  Baselines without a timer column are compared
+# whatever the timer.
+function Compare(file,    line, count, fields, key, regressions) {
+   regressions = 0
+   while ((getline line < file) > 0) {
+      count = split(line, fields, ",")
+      if (count < 9 || fields[1] == "group") continue
+      key = fields[2] SUBSEP fields[4] SUBSEP fields[5]
+      if (!(key in median) || fields[9] == "-") continue
+      if (timer[key] == "mixed" || (count >= 13 && fields[13] != timer[key]))
+         continue
+      if (median[key] > fields[9]*(1 + tolerance/100)) {
+         printf "REGRESSION %s size %s p %s:  %.4e s, was %.4e s (%+.1f%%)\n",
+            fields[2], fields[4], fields[5], median[key], fields[9],
+            100*(median[key]/fields[9] - 1) > "/dev/stderr"
+         regressions++
+      }
+   }
+   close(file)
+   return regressions > 0
+}
@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# Compara os motores de Fibonacci de c/fibonacci.c (compilado com e sem
+# otimizacao) e de java/Main.java.  Cada programa mede cada motor no
+# proprio processo, com aquecimento (importante para o JIT da JVM), e
+# imprime o minimo, a mediana e o percentil 99 dos tempos em CSV.
+#
+# Uso:  ./benchmark.sh [n] [repeticoes] [aquecimento] > resultados.csv
+#       (padrao: n = 35, 200 repeticoes, 20 de aquecimento)
+#
+# Os motores recursivo e paralelo fazem O(fib(n)) chamadas:  com n
+# perto de 50, cada repeticao leva minutos.  Sem javac e java no PATH,
+# so o C e medido.
+
+set -e
+
+N=${1:-35}
+REPETICOES=${2:-200}
+AQUECIMENTO=${3:-20}
+DIR=$(cd "$(dirname "$0")" && pwd)
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+gcc -O0 -fopenmp -o "$BUILD/fibonacci-O0" "$DIR/c/fibonacci.c"
+gcc -O2 -fopenmp -o "$BUILD/fibonacci-O2" "$DIR/c/fibonacci.c"
+
+"$BUILD/fibonacci-O0" bench todos "$N" "$REPETICOES" "$AQUECIMENTO"
+"$BUILD/fibonacci-O2" bench todos "$N" "$REPETICOES" "$AQUECIMENTO" | tail -n +2
+
+if command -v javac > /dev/null && command -v java > /dev/null; then
+    javac -d "$BUILD" "$DIR/java/Main.java"
+    java -cp "$BUILD" Main bench todos "$N" "$REPETICOES" "$AQUECIMENTO" | tail -n +2
+else
+    echo "javac ou java nao encontrado:  Java nao foi medido" >&2
+fi
@@ -1,16 +1,227 @@
+/*
+ * Calcula numeros de Fibonacci com varios motores:
+ *
+ *    recursivo:   recursao dupla ingenua, O(fib(n)) chamadas
+ *    iterativo:   laco com os dois ultimos valores, O(n)
+ *    memo:        recursao com tabela dos valores ja calculados, O(n)
+ *    duplicacao:  "fast doubling", O(log n):
+ *                    F(2k)   = F(k) * (2 F(k+1) - F(k))
+ *                    F(2k+1) = F(k)^2 + F(k+1)^2
+ *    paralelo:    recursao dupla com tarefas OpenMP; abaixo de
+ *                 LIMIAR_PARALELO a recursao e sequencial
+ *
+ * Compilar:  gcc -O2 -fopenmp -o fibonacci fibonacci.c
+ *            (sem -fopenmp, o motor paralelo roda sequencialmente)
+ * Uso:
+ *    ./fibonacci [motor] [limite]
+ *       imprime (i): F(i) para 0 <= i < limite (padrao: recursivo, 50)
+ *    ./fibonacci bench <motor|todos> <n> <repeticoes> <aquecimento>
+ *       calcula F(n) <aquecimento> vezes sem medir e depois
+ *       <repeticoes> vezes medindo, e imprime em CSV o minimo, a
+ *       mediana e o percentil 99 dos tempos, em nanossegundos
+ *
+ * Os valores cabem em 64 bits ate F(93); o limite e 92, como em Java.
+ * Veja ../benchmark.sh, que compara este programa com ../java/Main.java.
+ */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_MAX 92
+#define LIMIAR_PARALELO 25
+#define DESCONHECIDO ((unsigned long int) -1)
+
+#ifdef __OPTIMIZE__
+#define LINGUAGEM "c-otimizado"
+#else
+#define LINGUAGEM "c-nao-otimizado"
+#endif
+
+typedef unsigned long int (*motor_t)(int n);
+
+static unsigned long int memo[N_MAX + 1];
 
 static unsigned long int calcularFibonacci(int n)
 {
-    return (n < 2) ? n : calcularFibonacci(n - 1) + calcularFibonacci(n - 2);
+    return (n < 2) ? (unsigned long int) n : calcularFibonacci(n - 1) + calcularFibonacci(n - 2);
 }
 
-int main()
+static unsigned long int fibonacciIterativo(int n)
 {
-    for (int i = 0; i < 50; i++)
+    unsigned long int anterior = 0, atual = 1, proximo;
+
+    if (n == 0)
+        return 0;
+    for (int i = 1; i < n; i++)
     {
-        printf("(%d): %lu\n", i, calcularFibonacci(i));
+        proximo = anterior + atual;
+        anterior = atual;
+        atual = proximo;
+    }
+    return atual;
+}
+
+static unsigned long int fibonacciMemo(int n)
+{
+    if (memo[n] == DESCONHECIDO)
+        memo[n] = (n < 2) ? (unsigned long int) n : fibonacciMemo(n - 1) + fibonacciMemo(n - 2);
+    return memo[n];
+}
+
+/* A tabela e esvaziada a cada chamada, para que cada repeticao do
+ * benchmark faca o calculo todo */
+static unsigned long int fibonacciMemoizado(int n)
+{
+    memset(memo, 0xff, sizeof(memo));
+    return fibonacciMemo(n);
+}
+
+static unsigned long int fibonacciDuplicacao(int n)
+{
+    unsigned long int a = 0, b = 1, c, d; /* a = F(k), b = F(k+1) */
+
+    for (int bit = 31 - __builtin_clz(n | 1); bit >= 0; bit--)
+    {
+        c = a * (2 * b - a); /* F(2k)   */
+        d = a * a + b * b;   /* F(2k+1) */
+        if ((n >> bit) & 1)
+        {
+            a = d;
+            b = c + d;
+        }
+        else
+        {
+            a = c;
+            b = d;
+        }
+    }
+    return a;
+}
+
+static unsigned long int fibonacciTarefas(int n)
+{
+    unsigned long int x, y;
+
+    if (n < LIMIAR_PARALELO)
+        return calcularFibonacci(n);
+#pragma omp task shared(x)
+    x = fibonacciTarefas(n - 1);
+    y = fibonacciTarefas(n - 2);
+#pragma omp taskwait
+    return x + y;
+}
+
+static unsigned long int fibonacciParalelo(int n)
+{
+    unsigned long int resultado;
+
+#pragma omp parallel
+#pragma omp single
+    resultado = fibonacciTarefas(n);
+    return resultado;
+}
+
+static const char *nomes[] = {"recursivo", "iterativo", "memo", "duplicacao",
+                              "paralelo"};
+static const motor_t motores[] = {calcularFibonacci, fibonacciIterativo,
+                                  fibonacciMemoizado, fibonacciDuplicacao,
+                                  fibonacciParalelo};
+#define N_MOTORES ((int) (sizeof(motores) / sizeof(motores[0])))
+
+static int acharMotor(const char *nome)
+{
+    for (int m = 0; m < N_MOTORES; m++)
+        if (strcmp(nome, nomes[m]) == 0)
+            return m;
+    return -1;
+}
+
+static long int agoraNs(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static int compararLong(const void *a, const void *b)
+{
+    long int x = *(const long int *) a, y = *(const long int *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* Imprime uma linha de CSV:  linguagem,motor,n,repeticoes,min_ns,
+ * mediana_ns,p99_ns,resultado */
+static void medir(int m, int n, int repeticoes, int aquecimento)
+{
+    long int *tempos = malloc(repeticoes * sizeof(long int));
+    unsigned long int resultado = 0;
+    long int inicio;
+
+    for (int r = 0; r < aquecimento; r++)
+        resultado = motores[m](n);
+    for (int r = 0; r < repeticoes; r++)
+    {
+        inicio = agoraNs();
+        resultado = motores[m](n);
+        tempos[r] = agoraNs() - inicio;
+    }
+    qsort(tempos, repeticoes, sizeof(long int), compararLong);
+    printf("%s,%s,%d,%d,%ld,%ld,%ld,%lu\n", LINGUAGEM, nomes[m], n,
+           repeticoes, tempos[0], tempos[repeticoes / 2],
+           tempos[(99L * repeticoes + 99) / 100 - 1], resultado);
+    free(tempos);
+}
+
+static void uso(const char *programa)
+{
+    fprintf(stderr, "uso: %s [motor] [limite]\n", programa);
+    fprintf(stderr, "     %s bench <motor|todos> <n> <repeticoes> "
+                    "<aquecimento>\n", programa);
+    fprintf(stderr, "motores: recursivo iterativo memo duplicacao paralelo\n");
+    fprintf(stderr, "0 <= n <= %d, limite <= %d\n", N_MAX, N_MAX + 1);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int m = 0, limite = 50, n, repeticoes, aquecimento;
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        if (argc != 6)
+            uso(argv[0]);
+        n = atoi(argv[3]);
+        repeticoes = atoi(argv[4]);
+        aquecimento = atoi(argv[5]);
+        m = strcmp(argv[2], "todos") == 0 ? N_MOTORES : acharMotor(argv[2]);
+        if (m < 0 || n < 0 || n > N_MAX || repeticoes <= 0 || aquecimento < 0)
+            uso(argv[0]);
+        printf("linguagem,motor,n,repeticoes,min_ns,mediana_ns,p99_ns,"
+               "resultado\n");
+        if (m == N_MOTORES)
+            for (m = 0; m < N_MOTORES; m++)
+                medir(m, n, repeticoes, aquecimento);
+        else
+            medir(m, n, repeticoes, aquecimento);
+        return 0;
+    }
+
+    if (argc > 3)
+        uso(argv[0]);
+    if (argc > 1 && (m = acharMotor(argv[1])) < 0)
+        uso(argv[0]);
+    if (argc > 2)
+        limite = atoi(argv[2]);
+    if (limite < 0 || limite > N_MAX + 1)
+        uso(argv[0]);
+
+    for (int i = 0; i < limite; i++)
+    {
+        printf("(%d): %lu\n", i, motores[m](i));
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,12 +1,188 @@
+import java.util.Arrays;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.RecursiveTask;
+import java.util.function.IntToLongFunction;
+
+/*
+ * Calcula numeros de Fibonacci com os mesmos motores de
+ * ../c/fibonacci.c:  recursivo, iterativo, memo, duplicacao ("fast
+ * doubling", O(log n)) e paralelo (recursao dupla com tarefas do
+ * ForkJoinPool; abaixo de LIMIAR_PARALELO a recursao e sequencial).
+ *
+ * Compilar:  javac Main.java
+ * Uso:
+ *    java Main [motor] [limite]
+ *       imprime (i):F(i) para 0 <= i < limite (padrao: recursivo, 50)
+ *    java Main bench <motor|todos> <n> <repeticoes> <aquecimento>
+ *       calcula F(n) <aquecimento> vezes sem medir, para que o JIT
+ *       compile o motor, e depois <repeticoes> vezes medindo, e imprime
+ *       em CSV o minimo, a mediana e o percentil 99 dos tempos, em
+ *       nanossegundos
+ *
+ * Os valores cabem em um long ate F(92).
+ */
 public class Main {
 
+    static final int N_MAX = 92;
+    static final int LIMIAR_PARALELO = 25;
+
+    static final String[] NOMES = {"recursivo", "iterativo", "memo", "duplicacao", "paralelo"};
+    static final IntToLongFunction[] MOTORES = {
+        Main::calcularFibonacci, Main::fibonacciIterativo, Main::fibonacciMemoizado,
+        Main::fibonacciDuplicacao, Main::fibonacciParalelo
+    };
+
+    static final long[] memo = new long[N_MAX + 1];
+
     static long calcularFibonacci(int n) {
         return (n < 2) ? n : calcularFibonacci(n - 1) + calcularFibonacci(n - 2);
     }
 
-    public static void main() {
-        for (int i = 0; i < 50; i++) {
-            System.out.println("(" + i + "):" + calcularFibonacci(i));
+    static long fibonacciIterativo(int n) {
+        long anterior = 0, atual = 1, proximo;
+
+        if (n == 0) {
+            return 0;
+        }
+        for (int i = 1; i < n; i++) {
+            proximo = anterior + atual;
+            anterior = atual;
+            atual = proximo;
+        }
+        return atual;
+    }
+
+    static long fibonacciMemo(int n) {
+        if (memo[n] < 0) {
+            memo[n] = (n < 2) ? n : fibonacciMemo(n - 1) + fibonacciMemo(n - 2);
+        }
+        return memo[n];
+    }
+
+    /* A tabela e esvaziada a cada chamada, para que cada repeticao do
+     * benchmark faca o calculo todo */
+    static long fibonacciMemoizado(int n) {
+        Arrays.fill(memo, -1);
+        return fibonacciMemo(n);
+    }
+
+    static long fibonacciDuplicacao(int n) {
+        long a = 0, b = 1, c, d; /* a = F(k), b = F(k+1) */
+
+        for (int bit = 31 - Integer.numberOfLeadingZeros(n | 1); bit >= 0; bit--) {
+            c = a * (2 * b - a); /* F(2k)   */
+            d = a * a + b * b;   /* F(2k+1) */
+            if (((n >> bit) & 1) != 0) {
+                a = d;
+                b = c + d;
+            } else {
+                a = c;
+                b = d;
+            }
+        }
+        return a;
+    }
+
+    static class Tarefa extends RecursiveTask<Long> {
+        final int n;
+
+        Tarefa(int n) {
+            this.n = n;
+        }
+
+        @Override
+        protected Long compute() {
+            if (n < LIMIAR_PARALELO) {
+                return calcularFibonacci(n);
+            }
+            Tarefa x = new Tarefa(n - 1);
+            x.fork();
+            long y = new Tarefa(n - 2).compute();
+            return x.join() + y;
+        }
+    }
+
+    static long fibonacciParalelo(int n) {
+        return ForkJoinPool.commonPool().invoke(new Tarefa(n));
+    }
+
+    static int acharMotor(String nome) {
+        for (int m = 0; m < NOMES.length; m++) {
+            if (NOMES[m].equals(nome)) {
+                return m;
+            }
+        }
+        return -1;
+    }
+
+    /* Imprime uma linha de CSV:  linguagem,motor,n,repeticoes,min_ns,
+     * mediana_ns,p99_ns,resultado */
+    static void medir(int m, int n, int repeticoes, int aquecimento) {
+        long[] tempos = new long[repeticoes];
+        long resultado = 0, inicio;
+
+        for (int r = 0; r < aquecimento; r++) {
+            resultado = MOTORES[m].applyAsLong(n);
+        }
+        for (int r = 0; r < repeticoes; r++) {
+            inicio = System.nanoTime();
+            resultado = MOTORES[m].applyAsLong(n);
+            tempos[r] = System.nanoTime() - inicio;
+        }
+        Arrays.sort(tempos);
+        System.out.println("java," + NOMES[m] + "," + n + "," + repeticoes + ","
+                + tempos[0] + "," + tempos[repeticoes / 2] + ","
+                + tempos[(int) ((99L * repeticoes + 99) / 100 - 1)] + "," + resultado);
+    }
+
+    static void uso() {
+        System.err.println("uso: java Main [motor] [limite]");
+        System.err.println("     java Main bench <motor|todos> <n> <repeticoes> <aquecimento>");
+        System.err.println("motores: recursivo iterativo memo duplicacao paralelo");
+        System.err.println("0 <= n <= " + N_MAX + ", limite <= " + (N_MAX + 1));
+        System.exit(1);
+    }
+
+    public static void main(String[] args) {
+        int m = 0, limite = 50;
+
+        if (args.length > 0 && args[0].equals("bench")) {
+            if (args.length != 5) {
+                uso();
+            }
+            int n = Integer.parseInt(args[2]);
+            int repeticoes = Integer.parseInt(args[3]);
+            int aquecimento = Integer.parseInt(args[4]);
+            m = args[1].equals("todos") ? MOTORES.length : acharMotor(args[1]);
+            if (m < 0 || n < 0 || n > N_MAX || repeticoes <= 0 || aquecimento < 0) {
+                uso();
+            }
+            System.out.println("linguagem,motor,n,repeticoes,min_ns,mediana_ns,p99_ns,resultado");
+            if (m == MOTORES.length) {
+                for (m = 0; m < MOTORES.length; m++) {
+                    medir(m, n, repeticoes, aquecimento);
+                }
+            } else {
+                medir(m, n, repeticoes, aquecimento);
+            }
+            return;
+        }
+
+        if (args.length > 2) {
+            uso();
+        }
+        if (args.length > 0 && (m = acharMotor(args[0])) < 0) {
+            uso();
+        }
+        if (args.length > 1) {
+            limite = Integer.parseInt(args[1]);
+        }
+        if (limite < 0 || limite > N_MAX + 1) {
+            uso();
+        }
+
+        for (int i = 0; i < limite; i++) {
+            System.out.println("(" + i + "):" + MOTORES[m].applyAsLong(i));
         }
     }
-}
\ No newline at end of file
+}
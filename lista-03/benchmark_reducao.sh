@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Compara, com 1, 2, 4, ..., 64 processos, a distribuicao da entrada e a
+# soma global da regra do trapezio feitas de tres formas (veja
+# ipp-source-use/ch3/mpi_trap_hier.c):
+#
+#    flat     MPI_Bcast e MPI_Reduce em MPI_COMM_WORLD, como em
+#             mpi_trap3.c
+#    hier     em dois niveis:  memoria compartilhada entre os processos
+#             de um no, e MPI entre um lider por no
+#    ireduce  MPI_Ireduce de cada pedaco do intervalo, sobreposto ao
+#             calculo dos pedacos seguintes
+#
+# Uso:  ./benchmark_reducao.sh [n] [repeticoes] [max. processos] > resultados.csv
+#       (padrao: n = 500*2^20, como em mpi_trap3.c, 1000 repeticoes de
+#       cada reducao isolada, ate 64 processos)
+#
+# Imprime em CSV, para cada numero de processos e metodo, o tempo total
+# (do processo mais lento), o tempo de reducao exposto (depois do
+# ultimo Trap), o tempo medio de uma reducao isolada e a integral.
+# Com mais processos que nucleos, os processos disputam os nucleos:
+# compare os metodos com o mesmo numero de processos.  Para rodar em
+# varios nos, defina MPIEXEC, por exemplo
+#    MPIEXEC="mpiexec --hostfile hosts" ./benchmark_reducao.sh
+
+set -e
+
+N=${1:-524288000}
+REPETICOES=${2:-1000}
+MAX_PROCESSOS=${3:-64}
+MPIEXEC=${MPIEXEC:-"mpiexec --oversubscribe"}
+DIR=$(cd "$(dirname "$0")" && pwd)
+CH3="$DIR/../ipp-source-use/ch3"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+mpicc -O2 -o "$BUILD/mpi_trap_hier" "$CH3/mpi_trap_hier.c" "$CH3/hier_coll.c"
+
+echo "processos,nos,metodo,tempo_s,exposto_s,reducao_s,integral"
+P=1
+while [ "$P" -le "$MAX_PROCESSOS" ]; do
+    $MPIEXEC -n "$P" "$BUILD/mpi_trap_hier" "$N" "$REPETICOES" | awk '
+        NR == 1 { split($0, campos, /[=,] */); p = campos[4]; nos = campos[6] }
+        NR > 2  { printf "%s,%s,%s,%s,%s,%s,%s\n", p, nos, $1, $2, $3, $4, $5 }'
+    P=$((P*2))
+done
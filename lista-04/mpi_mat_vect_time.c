@@ -7,12 +7,20 @@
  *           generates a random matrix A and a random vector x.
  *           It prints out the run-time.
  *
- * Compile:  mpicc -g -Wall -o mpi_mat_vect_time mpi_mat_vect_time.c
+ * Compile:  mpicc -g -Wall -DUSE_MPI -I../ipp-source-use/ch3 -o mpi_mat_vect_time
+ *              mpi_mat_vect_time.c ../ipp-source-use/ch3/prof.c
  * Run:      mpiexec -n <number of processes> ./mpi_mat_vect_time
  *
  * Input:    Dimensions of the matrix (m = number of rows, n
  *              = number of columns)
- * Output:   Elapsed time for execution of the multiplication
+ * Output:   On stdout, the elapsed time of each of the EXECUCOES
+ *           multiplications (the maximum over the processes) and their
+ *           mean.  On stderr, the prof.h report of the region
+ *           "mat_vect":  the minimum, median and maximum over the
+ *           processes of the total time, and the fastest multiplication
+ *           (see ../ipp-source-use/ch3/prof.h).  The mean time of a
+ *           multiplication on a process is its total/calls.
+ *           PROF_FORMAT=csv or json changes the format of the report.
  *
  * Notes:
  *    1. Number of processes should evenly divide both m and n
@@ -24,6 +32,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include "prof.h"
+
+#define EXECUCOES 5
 
 void Check_for_error(int local_ok, char fname[], char message[], MPI_Comm comm);
 void Allocate_arrays(double** local_A_pp, double** local_x_pp,
@@ -47,7 +58,7 @@ int main(void) {
 
       MPI_Init(NULL, NULL);
 
-      for (int i = 0; i < 5; i++)
+      for (int i = 0; i < EXECUCOES; i++)
       {
             comm = MPI_COMM_WORLD;
             MPI_Comm_size(comm, &comm_sz);
@@ -67,7 +78,9 @@ int main(void) {
 
             MPI_Barrier(comm);
             start = MPI_Wtime();
+            PROF_BEGIN("mat_vect");
             Mat_vect_mult(local_A, local_x, local_y, local_m, n, local_n, comm);
+            PROF_END("mat_vect");
             finish = MPI_Wtime();
             loc_elapsed = finish - start;
             MPI_Reduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
@@ -83,9 +96,11 @@ int main(void) {
       }
 
       if (my_rank == 0) {
-            printf("[Media] Elapsed time = %.3f milliseconds\n", aggregatedElapsed / 5 * 1000);
+            printf("[Media] Elapsed time = %.3f milliseconds\n", aggregatedElapsed / EXECUCOES * 1000);
       }
 
+      PROF_REPORT();
+
       MPI_Finalize();
 
       return 0;
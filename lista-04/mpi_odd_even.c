@@ -5,43 +5,58 @@
  * Input:
  *    A:     elements of array (optional)
  * Output:
- *    A:     elements of A after sorting
+ *    For each of 5 runs:  the time, the number of phases run, and
+ *    the number of bytes sent, compared with p phases of full
+ *    exchanges
  *
- * Compile:  mpicc -g -Wall -o mpi_odd_even mpi_odd_even.c
+ * Compile:  mpicc -g -Wall -O3 -march=native -I../ipp-source-use/ch3 
+ *              -I../ipp-source-use/ch4
+ *              -o mpi_odd_even mpi_odd_even.c ../ipp-source-use/ch3/local_sort.c
  * Run:
- *    mpiexec -n <p> mpi_odd_even <g|i> <global_n>
+ *    mpiexec -n <p> mpi_odd_even [g|s]
  *       - p: the number of processes
- *       - g: generate random, distributed list
- *       - i: user will input list on process 0
- *       - global_n: number of elements in global list
+ *       - g: generate random, distributed list (default)
+ *       - s: generate nearly sorted list
  *
  * Notes:
- * 1.  global_n must be evenly divisible by p
+ * 1.  global_n = 10000000 must be evenly divisible by p
  * 2.  Except for debug output, process 0 does all I/O
  * 3.  Optional -DDEBUG compile flag for verbose output
+ * 4.  A merge-split only sends the keys that are out of order between
+ *     the two processes (see Merge_split), and the sort stops when an
+ *     even and an odd phase in a row change nothing.
+ * 5.  The local sort is the radix sort, and the merges are the SIMD
+ *     merges, in ipp-source-use/ch3/local_sort.c.  A merge-split writes
+ *     its result to temp_C, and then local_A and temp_C are swapped.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <mpi.h>
+#include "local_sort.h"
 
 const int RANDOM_NUMBER_UPPER_BOUND = 100;
 
+/* Keys sent in each chunk of a merge-split */
+const int CHUNK_KEYS = 8192;
+
 /* Local functions */
 void Usage(char* program);
-void Merge_low(int local_A[], int temp_B[], int temp_C[],
-   int local_n);
-void Merge_high(int local_A[], int temp_B[], int temp_C[],
-   int local_n);
 void Generate_list(int local_A[], int local_n, int my_rank);
-int  Compare(const void* a_p, const void* b_p);
+void Generate_nearly_sorted_list(int local_A[], int local_n, int my_rank,
+   int global_n);
 
 /* Functions involving communication */
 void Sort(int local_A[], int local_n, int my_rank,
-   int p, MPI_Comm comm);
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
+   int p, MPI_Comm comm, int* phases_p, long* bytes_p);
+int  Odd_even_iter(int** local_A_p, int temp_B[], int** temp_C_p,
    int local_n, int phase, int even_partner, int odd_partner,
-   int my_rank, int p, MPI_Comm comm);
+   int my_rank, MPI_Comm comm, long* bytes_p);
+int  Merge_split(int** local_A_p, int temp_B[], int** temp_C_p,
+   int local_n, int partner, int keep_low, MPI_Comm comm, long* bytes_p);
+void Post_chunk(int local_A[], int temp_B[], int local_n, int c,
+   int partner, int keep_low, MPI_Comm comm, MPI_Request reqs[],
+   long* bytes_p);
 
 
 /*-------------------------------------------------------------------*/
@@ -51,10 +66,22 @@ int main(int argc, char* argv[]) {
    int global_n;
    int local_n;
    MPI_Comm comm;
+   int phases, q, active;
+   long loc_bytes, bytes, full_bytes;
+   char list_type = 'g';
    double start, finish, loc_elapsed, elapsed, aggregatedElapsed = 0.0;
 
    MPI_Init(&argc, &argv);
 
+   /* Argumento opcional:  g (aleatoria, o padrao) ou s (quase ordenada) */
+   if (argc > 1) list_type = argv[1][0];
+   if (argc > 2 || (list_type != 'g' && list_type != 's')) {
+      MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+      if (my_rank == 0) Usage(argv[0]);
+      MPI_Finalize();
+      return 0;
+   }
+
    for (int i = 0; i < 5; i++)
    {
       comm = MPI_COMM_WORLD;
@@ -65,19 +92,31 @@ int main(int argc, char* argv[]) {
       local_n = global_n / p;
       local_A = (int*)malloc(local_n * sizeof(int));
 
-      Generate_list(local_A, local_n, my_rank);
+      if (list_type == 's')
+         Generate_nearly_sorted_list(local_A, local_n, my_rank, global_n);
+      else
+         Generate_list(local_A, local_n, my_rank);
 
       MPI_Barrier(comm);
       start = MPI_Wtime();
 
-      Sort(local_A, local_n, my_rank, p, comm);
+      Sort(local_A, local_n, my_rank, p, comm, &phases, &loc_bytes);
 
       finish = MPI_Wtime();
       loc_elapsed = finish - start;
       MPI_Reduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+      MPI_Reduce(&loc_bytes, &bytes, 1, MPI_LONG, MPI_SUM, 0, comm);
 
       if (my_rank == 0) {
-         printf("[Execucao %d] Elapsed: %.3f milliseconds\n", i, elapsed * 1000);
+         /* Bytes that p phases of full exchanges would send */
+         full_bytes = 0;
+         for (q = 0; q < p; q++) {
+            active = (q % 2 == 0) ? p / 2 * 2 : (p - 1) / 2 * 2;
+            full_bytes += (long)active * local_n * sizeof(int);
+         }
+         printf("[Execucao %d] Elapsed: %.3f milliseconds, %d de %d fases, "
+            "%.1f MB enviados (troca completa: %.1f MB)\n", i, elapsed * 1000,
+            phases, p, bytes / 1.0e6, full_bytes / 1.0e6);
          aggregatedElapsed += elapsed;
       }
 
@@ -109,6 +148,25 @@ void Generate_list(int local_A[], int local_n, int my_rank) {
 
 }  /* Generate_list */
 
+/*-------------------------------------------------------------------
+ * Function:   Generate_nearly_sorted_list
+ * Purpose:    Fill list with the ints my_rank*local_n, ...,
+ *             (my_rank+1)*local_n - 1, except that about one in a
+ *             thousand is replaced by a random int in [0, global_n)
+ * Input Args: local_n, my_rank, global_n
+ * Output Arg: local_A
+ */
+void Generate_nearly_sorted_list(int local_A[], int local_n, int my_rank,
+   int global_n) {
+   int i;
+
+   srandom(my_rank + 1);
+   for (i = 0; i < local_n; i++)
+      local_A[i] = (random() % 1000 == 0) ? random() % global_n
+         : my_rank * local_n + i;
+
+}  /* Generate_nearly_sorted_list */
+
 /*-------------------------------------------------------------------
  * Function:  Usage
  * Purpose:   Print command line to start program
@@ -116,45 +174,29 @@ void Generate_list(int local_A[], int local_n, int my_rank) {
  * Note:      Purely local, run only by process 0;
  */
 void Usage(char* program) {
-   fprintf(stderr, "usage:  mpirun -np <p> %s <g|i> <global_n>\n",
+   fprintf(stderr, "usage:  mpirun -np <p> %s [g|s]\n",
       program);
    fprintf(stderr, "   - p: the number of processes \n");
-   fprintf(stderr, "   - g: generate random, distributed list\n");
-   fprintf(stderr, "   - i: user will input list on process 0\n");
-   fprintf(stderr, "   - global_n: number of elements in global list");
-   fprintf(stderr, " (must be evenly divisible by p)\n");
+   fprintf(stderr, "   - g: generate random, distributed list (default)\n");
+   fprintf(stderr, "   - s: generate nearly sorted list\n");
    fflush(stderr);
 }  /* Usage */
 
-/*-------------------------------------------------------------------
- * Function:    Compare
- * Purpose:     Compare 2 ints, return -1, 0, or 1, respectively, when
- *              the first int is less than, equal, or greater than
- *              the second.  Used by qsort.
- */
-int Compare(const void* a_p, const void* b_p) {
-   int a = *((int*)a_p);
-   int b = *((int*)b_p);
-
-   if (a < b)
-      return -1;
-   else if (a == b)
-      return 0;
-   else /* a > b */
-      return 1;
-}  /* Compare */
-
 /*-------------------------------------------------------------------
  * Function:    Sort
  * Purpose:     Sort local list, use odd-even sort to sort
- *              global list.
+ *              global list.  Stops as soon as an even and an odd
+ *              phase in a row don't change any list, since then the
+ *              global list is sorted.
  * Input args:  local_n, my_rank, p, comm
  * In/out args: local_A
+ * Output args: phases_p:  number of phases run
+ *              bytes_p:  number of bytes this process sent
  */
 void Sort(int local_A[], int local_n, int my_rank,
-   int p, MPI_Comm comm) {
-   int phase;
-   int* temp_B, * temp_C;
+   int p, MPI_Comm comm, int* phases_p, long* bytes_p) {
+   int phase, changed, quiet;
+   int* keys, * temp_B, * temp_C;
    int even_partner;  /* phase is even or left-looking */
    int odd_partner;   /* phase is odd or right-looking */
 
@@ -174,18 +216,30 @@ void Sort(int local_A[], int local_n, int my_rank,
       odd_partner = my_rank - 1;
    }
 
-   /* Sort local list using built-in quick sort */
-   qsort(local_A, local_n, sizeof(int), Compare);
+   /* Sort local list using radix sort */
+   Local_sort(local_A, local_n);
 
 #  ifdef DEBUG
    printf("Proc %d > before loop in sort\n", my_rank);
    fflush(stdout);
 #  endif
 
-   for (phase = 0; phase < p; phase++)
-      Odd_even_iter(local_A, temp_B, temp_C, local_n, phase,
-         even_partner, odd_partner, my_rank, p, comm);
+   *bytes_p = 0;
+   quiet = 0;  /* Number of phases in a row that changed nothing */
+   keys = local_A;
+   for (phase = 0; phase < p && quiet < 2; phase++) {
+      changed = Odd_even_iter(&keys, temp_B, &temp_C, local_n, phase,
+         even_partner, odd_partner, my_rank, comm, bytes_p);
+      MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_LOR, comm);
+      quiet = changed ? 0 : quiet + 1;
+   }
+   *phases_p = phase;
 
+   /* keys may be the block malloc'ed for temp_C */
+   if (keys != local_A) {
+      memcpy(local_A, keys, local_n * sizeof(int));
+      temp_C = keys;
+   }
    free(temp_B);
    free(temp_C);
 }  /* Sort */
@@ -194,96 +248,138 @@ void Sort(int local_A[], int local_n, int my_rank,
 /*-------------------------------------------------------------------
  * Function:    Odd_even_iter
  * Purpose:     One iteration of Odd-even transposition sort
- * In args:     local_n, phase, my_rank, p, comm
- * In/out args: local_A
- * Scratch:     temp_B, temp_C
+ * In args:     local_n, phase, my_rank, comm
+ * In/out args: local_A_p, temp_C_p:  swapped if the keys change
+ *              bytes_p
+ * Scratch:     temp_B
+ * Ret val:     1 if the keys changed, 0 otherwise
  */
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
+int Odd_even_iter(int** local_A_p, int temp_B[], int** temp_C_p,
    int local_n, int phase, int even_partner, int odd_partner,
-   int my_rank, int p, MPI_Comm comm) {
-   MPI_Status status;
+   int my_rank, MPI_Comm comm, long* bytes_p) {
 
    if (phase % 2 == 0) {
-      if (even_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, even_partner, 0,
-            temp_B, local_n, MPI_INT, even_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_high(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_low(local_A, temp_B, temp_C, local_n);
-      }
+      if (even_partner >= 0)
+         return Merge_split(local_A_p, temp_B, temp_C_p, local_n,
+            even_partner, my_rank % 2 == 0, comm, bytes_p);
    }
    else { /* odd phase */
-      if (odd_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, odd_partner, 0,
-            temp_B, local_n, MPI_INT, odd_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_low(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_high(local_A, temp_B, temp_C, local_n);
-      }
+      if (odd_partner >= 0)
+         return Merge_split(local_A_p, temp_B, temp_C_p, local_n,
+            odd_partner, my_rank % 2 != 0, comm, bytes_p);
    }
+   return 0;
 }  /* Odd_even_iter */
 
 /*-------------------------------------------------------------------
- * Function:    Merge_low
- * Purpose:     Merge the smallest local_n elements in my_keys
- *              and recv_keys into temp_keys.  Then copy temp_keys
- *              back into my_keys.
- * In args:     local_n, recv_keys
- * In/out args: my_keys
- * Scratch:     temp_keys
+ * Function:    Merge_split
+ * Purpose:     Split the keys of this process and partner, so that the
+ *              process with keep_low = 1 gets the smallest local_n
+ *              keys.  Only the keys that overlap are sent:
+ *              1.  The processes exchange their largest (keep_low) or
+ *                  smallest key.  If they're in order, we're done.
+ *              2.  Otherwise the low process sends its keys from the
+ *                  largest down, and the high process sends its keys
+ *                  from the smallest up, in chunks of CHUNK_KEYS.  The
+ *                  next chunk is sent while the current one is
+ *                  checked.  Both processes stop at the first k with
+ *                  low[local_n-1-k] <= high[k]:  the low process's
+ *                  top k keys then change places with the high
+ *                  process's bottom k keys.
+ *              The new keys are merged into *temp_C_p, which is
+ *              then swapped with *local_A_p.
+ * In args:     local_n, partner, keep_low, comm
+ * In/out args: local_A_p, temp_C_p, bytes_p
+ * Scratch:     temp_B
+ * Ret val:     1 if the keys changed, 0 otherwise
  */
-void Merge_low(
-   int  my_keys[],     /* in/out    */
-   int  recv_keys[],   /* in        */
-   int  temp_keys[],   /* scratch   */
-   int  local_n        /* = n/p, in */) {
-   int m_i, r_i, t_i;
-
-   m_i = r_i = t_i = 0;
-   while (t_i < local_n) {
-      if (my_keys[m_i] <= recv_keys[r_i]) {
-         temp_keys[t_i] = my_keys[m_i];
-         t_i++; m_i++;
+int Merge_split(int** local_A_p, int temp_B[], int** temp_C_p,
+   int local_n, int partner, int keep_low, MPI_Comm comm,
+   long* bytes_p) {
+   int* local_A = *local_A_p;
+   int* temp_C = *temp_C_p;
+   int my_bound, partner_bound;
+   int chunk_count, c, next, k, i, lo, hi;
+   int low_key, high_key;
+   MPI_Request reqs[2][2];
+
+   if (local_n == 0) return 0;
+   my_bound = keep_low ? local_A[local_n - 1] : local_A[0];
+   MPI_Sendrecv(&my_bound, 1, MPI_INT, partner, 0, &partner_bound, 1,
+      MPI_INT, partner, 0, comm, MPI_STATUS_IGNORE);
+   *bytes_p += sizeof(int);
+   if (keep_low ? my_bound <= partner_bound : partner_bound <= my_bound)
+      return 0;
+
+   /* Chunk c is overlap positions c*CHUNK_KEYS, ..., hi-1:  position
+    * i is low[local_n-1-i] and high[i].  The partner's keys are
+    * received into the same places in temp_B. */
+   chunk_count = (local_n + CHUNK_KEYS - 1) / CHUNK_KEYS;
+   for (next = 0; next < 2 && next < chunk_count; next++)
+      Post_chunk(local_A, temp_B, local_n, next, partner, keep_low, comm,
+         reqs[next % 2], bytes_p);
+
+   k = -1;
+   for (c = 0; k < 0; c++) {
+      MPI_Waitall(2, reqs[c % 2], MPI_STATUSES_IGNORE);
+      lo = c * CHUNK_KEYS;
+      hi = (lo + CHUNK_KEYS < local_n) ? lo + CHUNK_KEYS : local_n;
+      for (i = lo; i < hi; i++) {
+         low_key = keep_low ? local_A[local_n - 1 - i] : temp_B[local_n - 1 - i];
+         high_key = keep_low ? temp_B[i] : local_A[i];
+         if (low_key <= high_key) break;
       }
-      else {
-         temp_keys[t_i] = recv_keys[r_i];
-         t_i++; r_i++;
+      if (i < hi || hi == local_n)
+         k = i;
+      else if (next < chunk_count) {
+         Post_chunk(local_A, temp_B, local_n, next, partner, keep_low,
+            comm, reqs[next % 2], bytes_p);
+         next++;
       }
    }
+   /* The chunk after the last one we needed may be on its way */
+   if (next > c)
+      MPI_Waitall(2, reqs[c % 2], MPI_STATUSES_IGNORE);
+
+   if (keep_low)
+      Merge_simd(local_A, local_n - k, temp_B, k, temp_C);
+   else
+      Merge_simd(temp_B + local_n - k, k, local_A + k, local_n - k, temp_C);
+   *local_A_p = temp_C;
+   *temp_C_p = local_A;
 
-   memcpy(my_keys, temp_keys, local_n * sizeof(int));
-}  /* Merge_low */
+   return 1;
+}  /* Merge_split */
 
 /*-------------------------------------------------------------------
- * Function:    Merge_high
- * Purpose:     Merge the largest local_n elements in local_A
- *              and temp_B into temp_C.  Then copy temp_C
- *              back into local_A.
- * In args:     local_n, temp_B
- * In/out args: local_A
- * Scratch:     temp_C
+ * Function:    Post_chunk
+ * Purpose:     Start sending chunk c of this process's keys to
+ *              partner and receiving chunk c of partner's keys into
+ *              temp_B (see Merge_split)
+ * In args:     local_A, local_n, c, partner, keep_low, comm
+ * Out args:    temp_B, reqs
+ * In/out arg:  bytes_p
  */
-void Merge_high(int local_A[], int temp_B[], int temp_C[],
-   int local_n) {
-   int ai, bi, ci;
-
-   ai = local_n - 1;
-   bi = local_n - 1;
-   ci = local_n - 1;
-   while (ci >= 0) {
-      if (local_A[ai] >= temp_B[bi]) {
-         temp_C[ci] = local_A[ai];
-         ci--; ai--;
-      }
-      else {
-         temp_C[ci] = temp_B[bi];
-         ci--; bi--;
-      }
+void Post_chunk(int local_A[], int temp_B[], int local_n, int c,
+   int partner, int keep_low, MPI_Comm comm, MPI_Request reqs[],
+   long* bytes_p) {
+   int lo = c * CHUNK_KEYS;
+   int hi = (lo + CHUNK_KEYS < local_n) ? lo + CHUNK_KEYS : local_n;
+   int count = hi - lo;
+
+   if (keep_low) {
+      /* Send my keys local_n-hi, ..., local_n-lo-1, get the partner's
+       * keys lo, ..., hi-1 */
+      MPI_Isend(local_A + local_n - hi, count, MPI_INT, partner, c + 1,
+         comm, &reqs[0]);
+      MPI_Irecv(temp_B + lo, count, MPI_INT, partner, c + 1, comm,
+         &reqs[1]);
    }
-
-   memcpy(local_A, temp_C, local_n * sizeof(int));
-}  /* Merge_high */
\ No newline at end of file
+   else {
+      MPI_Isend(local_A + lo, count, MPI_INT, partner, c + 1, comm,
+         &reqs[0]);
+      MPI_Irecv(temp_B + local_n - hi, count, MPI_INT, partner, c + 1,
+         comm, &reqs[1]);
+   }
+   *bytes_p += count * sizeof(int);
+}  /* Post_chunk */
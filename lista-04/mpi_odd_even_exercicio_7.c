@@ -1,7 +1,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <mpi.h>
+#include "local_sort.h"  /* Em ../ipp-source-use/ch3:  compilar com
+                             * -I../ipp-source-use/ch3,
+                             * -I../ipp-source-use/ch4 e
+                             * ../ipp-source-use/ch3/local_sort.c */
 
 char* INPUT_FILE_NAME = "mpi_odd_even_exercicio_7_input.txt";
 char* OUTPUT_FILE_NAME = "mpi_odd_even_exercicio_7_output.txt";
@@ -10,22 +23,23 @@ const int RANDOM_NUMBER_UPPER_BOUND = 100000;
 const int ELEMENTS_IN_SOURCE_VECTOR = 16000000;
 
 /* Local functions */
-void Read_vector_from_input_file(int* global_A, int global_n);
+void Read_vector_from_input_file(char file_name[], int local_A[],
+   int local_n, int my_rank, int p, long* bytes_p, MPI_Comm comm);
+void Read_vector_from_binary_file(char file_name[], int local_A[],
+   int local_n, int my_rank, long* bytes_p, MPI_Comm comm);
+int  Get_binary_n(char file_name[], int p, MPI_Comm comm);
+long Parse_ints(const char* text, long len, int vals[]);
+int  Overlap(long a, long b, long c, long d);
 void Write_vector_to_output_file(int A[]);
 
 void Usage(char* program);
-void Merge_low(int local_A[], int temp_B[], int temp_C[],
-   int local_n);
-void Merge_high(int local_A[], int temp_B[], int temp_C[],
-   int local_n);
 void Generate_list(int local_A[], int local_n, int my_rank);
-int  Compare(const void* a_p, const void* b_p);
 
 /* Functions involving communication */
 void Sort(int local_A[], int local_n, int my_rank, int p, MPI_Comm comm);
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
+void Odd_even_iter(int** keys_p, int temp_B[], int** temp_C_p,
    int local_n, int phase, int even_partner, int odd_partner,
-   int my_rank, int p, MPI_Comm comm);
+   int my_rank, MPI_Comm comm);
 
 void Print_global_list(int local_A[], int local_n, int my_rank, int p, MPI_Comm comm);
 
@@ -33,9 +47,12 @@ void Print_global_list(int local_A[], int local_n, int my_rank, int p, MPI_Comm
 /*-------------------------------------------------------------------*/
 int main(int argc, char* argv[]) {
    int my_rank, p;
-   int* local_A, * global_A;
+   int* local_A;
    int global_n;
    int local_n;
+   char* file_name = INPUT_FILE_NAME;
+   char format = 't';
+   long loc_bytes = 0, bytes;
    MPI_Comm comm;
    double start, finish, loc_elapsed, elapsed, file_read_elapsed, aggregated_elapsed = 0.0;
 
@@ -45,25 +62,51 @@ int main(int argc, char* argv[]) {
    MPI_Comm_size(comm, &p);
    MPI_Comm_rank(comm, &my_rank);
 
-   global_n = ELEMENTS_IN_SOURCE_VECTOR;
+   /* Argumentos opcionais:  [arquivo] [t|b] */
+   if (argc > 1) file_name = argv[1];
+   if (argc > 2) format = argv[2][0];
+   if (argc > 3 || (format != 't' && format != 'b')) {
+      if (my_rank == 0) Usage(argv[0]);
+      MPI_Finalize();
+      exit(0);
+   }
+
+   /* No arquivo binario, o tamanho do vetor vem do tamanho do arquivo */
+   if (format == 'b')
+      global_n = Get_binary_n(file_name, p, comm);
+   else
+      global_n = ELEMENTS_IN_SOURCE_VECTOR;
    local_n = global_n / p;
 
-   global_A = (int*)malloc(global_n * sizeof(int));
+   /* Nenhum processo guarda o vetor inteiro:  cada um le (ou recebe)
+    * apenas o seu bloco de local_n elementos.  Mas o bloco inteiro fica
+    * na memoria durante o sort, entao o vetor tem que caber na memoria
+    * somada dos p processos:  a leitura e feita em partes, o sort nao
+    * e out-of-core. */
    local_A = (int*)malloc(local_n * sizeof(int));
 
-   if (my_rank == 0) {
-      start = MPI_Wtime();
-      Read_vector_from_input_file(global_A, global_n);
-      finish = MPI_Wtime();
-      file_read_elapsed = finish - start;
-      printf("Tempo para leitura do vetor (nao-paralelizavel): %.3fms\n", file_read_elapsed * 1000);
-   }
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   if (format == 'b')
+      Read_vector_from_binary_file(file_name, local_A, local_n, my_rank,
+         &loc_bytes, comm);
+   else
+      Read_vector_from_input_file(file_name, local_A, local_n, my_rank, p,
+         &loc_bytes, comm);
+   finish = MPI_Wtime();
+   loc_elapsed = finish - start;
+   MPI_Reduce(&loc_elapsed, &file_read_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+   MPI_Reduce(&loc_bytes, &bytes, 1, MPI_LONG, MPI_SUM, 0, comm);
+
+   if (my_rank == 0)
+      printf("Tempo para leitura do vetor (%-16s):   %.3fms, %ld bytes, %.1f MB/s\n",
+         (format == 'b') ? "MPI-IO, paralela" : "texto, paralela",
+         file_read_elapsed * 1000, bytes,
+         (file_read_elapsed > 0.0) ? bytes / file_read_elapsed / 1.0e6 : 0.0);
 
    MPI_Barrier(comm);
    start = MPI_Wtime();
-   MPI_Scatter(global_A, local_n, MPI_INT, local_A, local_n, MPI_INT, 0, comm);
    Sort(local_A, local_n, my_rank, p, comm);
-   MPI_Gather(local_A, local_n, MPI_INT, global_A, local_n, MPI_INT, 0, comm);
    finish = MPI_Wtime();
 
    loc_elapsed = finish - start;
@@ -71,7 +114,7 @@ int main(int argc, char* argv[]) {
 
    if (my_rank == 0) {
       // printf("[Execucao %d] Elapsed: %.3f milliseconds\n", i, elapsed * 1000);
-      printf("Tempo para scatter/gather/sort (paralelizado):   %.3fms\n", elapsed * 1000);
+      printf("Tempo para sort (paralelizado):                  %.3fms\n", elapsed * 1000);
       printf("Tempo total:                                     %.3fms\n", (elapsed + file_read_elapsed) * 1000);
       // aggregated_elapsed += elapsed;
    }
@@ -92,24 +135,306 @@ int main(int argc, char* argv[]) {
    return 0;
 }  /* main */
 
-void Read_vector_from_input_file(int* global_A, int global_n) {
+/*-------------------------------------------------------------------
+ * Function:   Read_vector_from_input_file
+ * Purpose:    Read a text file of ints in parallel.  Every process
+ *             mmaps the file and parses 1/p of its bytes with
+ *             Parse_ints, starting and stopping at white space, so a
+ *             number belongs to the process that has its first digit.
+ *             The parsed numbers are then moved with MPI_Alltoallv so
+ *             that process q gets numbers q*local_n, ...,
+ *             (q+1)*local_n - 1 of the file, as with MPI_Scatter.
+ * In args:    file_name, local_n, my_rank, p, comm
+ * Out args:   local_A, bytes_p (bytes parsed by this process)
+ */
+void Read_vector_from_input_file(char file_name[], int local_A[],
+   int local_n, int my_rank, int p, long* bytes_p, MPI_Comm comm) {
+   int fd, q, ok;
+   struct stat st;
+   char* text;
+   long size, my_start, my_end, my_count, my_first, total, need;
+   long* counts;
+   int* vals;
+   int* send_counts, * send_displs, * recv_counts, * recv_displs;
+
+   fd = open(file_name, O_RDONLY);
+   ok = (fd >= 0 && fstat(fd, &st) == 0);
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      if (my_rank == 0)
+         printf("ERRO. O arquivo %s nao foi encontrado.\n", file_name);
+      MPI_Finalize();
+      exit(-1);
+   }
+   size = st.st_size;
+   text = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+   ok = (text != MAP_FAILED);
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      if (my_rank == 0)
+         printf("ERRO. Nao foi possivel mapear o arquivo %s.\n", file_name);
+      MPI_Finalize();
+      exit(-1);
+   }
 
-   FILE* file_ptr = fopen(INPUT_FILE_NAME, "r");
-   if (file_ptr == NULL) {
-      printf("ERRO. O arquivo %s nao foi encontrado.\n", INPUT_FILE_NAME);
+   /* My block of bytes, moved forward to the end of a number */
+   my_start = size * my_rank / p;
+   my_end = size * (my_rank + 1) / p;
+   while (my_start > 0 && my_start < size && !isspace((unsigned char)text[my_start - 1]))
+      my_start++;
+   while (my_end > 0 && my_end < size && !isspace((unsigned char)text[my_end - 1]))
+      my_end++;
+   if (my_end < my_start) my_end = my_start;
+
+   /* A number takes at least 2 bytes (a digit and a separator),
+    * except possibly the last one */
+   need = (my_end - my_start) / 2 + 1;
+   vals = (int*)malloc(need * sizeof(int));
+   my_count = Parse_ints(text + my_start, my_end - my_start, vals);
+   *bytes_p = my_end - my_start;
+
+   /* Global index of my first number, and everyone's counts */
+   counts = (long*)malloc(p * sizeof(long));
+   MPI_Allgather(&my_count, 1, MPI_LONG, counts, 1, MPI_LONG, comm);
+   my_first = total = 0;
+   for (q = 0; q < p; q++) {
+      if (q < my_rank) my_first += counts[q];
+      total += counts[q];
+   }
+   if (total < (long)local_n * p) {
+      if (my_rank == 0)
+         printf("ERRO. O arquivo %s tem apenas %ld numeros.\n", file_name,
+            total);
+      MPI_Finalize();
       exit(-1);
    }
 
-   for (
-      int i = 0, retval = 1;
-      i < global_n && retval == 1;
-      i++)
-   {
-      retval = fscanf(file_ptr, "%d", &global_A[i]);
+   /* Numbers i with q*local_n <= i < (q+1)*local_n go to process q */
+   send_counts = (int*)malloc(4 * p * sizeof(int));
+   send_displs = send_counts + p;
+   recv_counts = send_counts + 2 * p;
+   recv_displs = send_counts + 3 * p;
+   for (q = 0; q < p; q++) {
+      send_counts[q] = Overlap(my_first, my_first + my_count,
+         (long)q * local_n, (long)(q + 1) * local_n);
+      send_displs[q] = (q == 0) ? 0 : send_displs[q - 1] + send_counts[q - 1];
+   }
+   for (q = 0, my_first = 0; q < p; my_first += counts[q], q++) {
+      recv_counts[q] = Overlap(my_first, my_first + counts[q],
+         (long)my_rank * local_n, (long)(my_rank + 1) * local_n);
+      recv_displs[q] = (q == 0) ? 0 : recv_displs[q - 1] + recv_counts[q - 1];
    }
+   MPI_Alltoallv(vals, send_counts, send_displs, MPI_INT,
+      local_A, recv_counts, recv_displs, MPI_INT, comm);
 
-   fclose(file_ptr);
-}
+   free(send_counts);
+   free(counts);
+   free(vals);
+   if (text != NULL) munmap(text, size);
+   close(fd);
+}  /* Read_vector_from_input_file */
+
+/*-------------------------------------------------------------------
+ * Function:   Overlap
+ * Purpose:    Return the number of ints in [a, b) that are also in
+ *             [c, d)
+ */
+int Overlap(long a, long b, long c, long d) {
+   long lo = (a > c) ? a : c;
+   long hi = (b < d) ? b : d;
+
+   return (hi > lo) ? hi - lo : 0;
+}  /* Overlap */
+
+#ifdef __SSE2__
+/*-------------------------------------------------------------------
+ * Function:   Masks_64
+ * Purpose:    Find the digits and the minus signs in 64 bytes
+ * In arg:     p
+ * Out args:   digits_p:  bit i is 1 iff p[i] is a decimal digit
+ *             minus_p:   bit i is 1 iff p[i] is '-'
+ */
+static inline void Masks_64(const char* p, unsigned long long* digits_p,
+   unsigned long long* minus_p) {
+   const __m128i below_0 = _mm_set1_epi8('0' - 1);
+   const __m128i above_9 = _mm_set1_epi8('9' + 1);
+   const __m128i minus = _mm_set1_epi8('-');
+   unsigned long long digits = 0, minuses = 0;
+   __m128i v, is_digit;
+   int k;
+
+   for (k = 0; k < 4; k++) {
+      v = _mm_loadu_si128((const __m128i*)(p + 16 * k));
+      is_digit = _mm_and_si128(_mm_cmpgt_epi8(v, below_0),
+         _mm_cmplt_epi8(v, above_9));
+      digits |= (unsigned long long)
+         (unsigned)_mm_movemask_epi8(is_digit) << (16 * k);
+      minuses |= (unsigned long long)
+         (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, minus)) << (16 * k);
+   }
+   *digits_p = digits;
+   *minus_p = minuses;
+}  /* Masks_64 */
+
+/*-------------------------------------------------------------------
+ * Function:   Digits8
+ * Purpose:    Look at the 8 bytes at text as one 64-bit word (SWAR):
+ *             return the number of decimal digits they start with, and
+ *             in *val_p the value of those digits
+ * Note:       The digits are combined in pairs, then pairs of 2-digit
+ *             numbers, then pairs of 4-digit numbers:  three
+ *             multiplications instead of one per digit.  x86 is
+ *             little-endian, so text[0] is the low byte of the word.
+ */
+static inline int Digits8(const char* text, unsigned* val_p) {
+   uint64_t w, non_digit;
+   int count;
+
+   memcpy(&w, text, 8);
+   w ^= 0x3030303030303030ULL;   /* Digits are now 0, ..., 9 */
+   non_digit = (((w & 0x7f7f7f7f7f7f7f7fULL) + 0x7676767676767676ULL) | w)
+      & 0x8080808080808080ULL;
+   count = non_digit ? __builtin_ctzll(non_digit) / 8 : 8;
+   if (count == 0) {
+      *val_p = 0;
+      return 0;
+   }
+
+   /* Move the digits to the high bytes, so the bytes below them,
+    * which are worth more, are zeros */
+   w <<= 8 * (8 - count);
+   w = (w * 10 + (w >> 8)) & 0x00ff00ff00ff00ffULL;
+   w = (w * 100 + (w >> 16)) & 0x0000ffff0000ffffULL;
+   w = (w * 10000 + (w >> 32)) & 0x00000000ffffffffULL;
+   *val_p = (unsigned)w;
+   return count;
+}  /* Digits8 */
+
+/*-------------------------------------------------------------------
+ * Function:   Parse_at
+ * Purpose:    Convert the int that starts at p:  an optional '-' and
+ *             the digits that follow it, up to end
+ * Ret val:    the int
+ */
+static inline int Parse_at(const char* p, const char* end) {
+   int neg = (*p == '-');
+   unsigned v = 0;
+
+   p += neg;
+   if (end - p >= 8 && Digits8(p, &v) < 8)
+      return neg ? -(int)v : (int)v;
+   v = 0;
+   while (p < end && (unsigned)(*p - '0') < 10) {
+      v = v * 10 + (unsigned)(*p - '0');
+      p++;
+   }
+   return neg ? -(int)v : (int)v;
+}  /* Parse_at */
+#endif
+
+
+/*-------------------------------------------------------------------
+ * Function:   Parse_ints
+ * Purpose:    Convert the decimal ints in text[0..len-1], separated
+ *             by white space, to ints.  Replaces sscanf/fscanf:  there
+ *             is no locale or format handling.
+ * In args:    text, len
+ * Out arg:    vals
+ * Ret val:    the number of ints stored in vals
+ * Note:       With SSE2, the text is classified 64 bytes at a time:
+ *             an int starts at a '-', or at a digit that doesn't
+ *             follow a digit or a '-'.  The starts are found with bit
+ *             operations on the masks, and the ints are converted
+ *             8 digits at a time by Digits8.  So there's no branch on
+ *             each byte, and the conversions of different ints don't
+ *             depend on each other.  The rest of the text, or all of it
+ *             without SSE2, is converted a byte at a time.
+ */
+long Parse_ints(const char* text, long len, int vals[]) {
+   const char* p;
+   const char* end = text + len;
+   long pos = 0, count = 0;
+   int neg;
+   unsigned v;
+#  ifdef __SSE2__
+   int prev = 0;   /* 1 iff the byte before pos is a digit or a '-' */
+   unsigned long long digits, minus, before, starts;
+
+   for (; pos + 64 <= len; pos += 64) {
+      Masks_64(text + pos, &digits, &minus);
+      /* Bit i of before is 1 iff byte pos+i-1 is a digit or a '-' */
+      before = ((digits | minus) << 1) | prev;
+      starts = minus | (digits & ~before);
+      while (starts != 0) {
+         vals[count++] = Parse_at(text + pos + __builtin_ctzll(starts), end);
+         starts &= starts - 1;
+      }
+      prev = (int)((digits | minus) >> 63);
+   }
+   /* Skip the rest of an int that's already been converted */
+   if (prev)
+      while (pos < len && (unsigned)(text[pos] - '0') < 10) pos++;
+#  endif
+
+   p = text + pos;
+   while (1) {
+      while (p < end && (*p < '0' || *p > '9') && *p != '-') p++;
+      if (p == end) break;
+      neg = (*p == '-');
+      p += neg;
+      v = 0;
+      while (p < end && (unsigned)(*p - '0') < 10) {
+         v = v * 10 + (unsigned)(*p - '0');
+         p++;
+      }
+      vals[count++] = neg ? -(int)v : (int)v;
+   }
+   return count;
+}  /* Parse_ints */
+
+/*-------------------------------------------------------------------
+ * Function:   Get_binary_n
+ * Purpose:    Find the number of ints in a binary file, rounded down
+ *             to a multiple of p
+ * In args:    file_name, p, comm
+ * Ret val:    global_n
+ */
+int Get_binary_n(char file_name[], int p, MPI_Comm comm) {
+   MPI_File fh;
+   MPI_Offset size;
+   int my_rank;
+
+   MPI_Comm_rank(comm, &my_rank);
+   if (MPI_File_open(comm, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL,
+         &fh) != MPI_SUCCESS) {
+      if (my_rank == 0)
+         printf("ERRO. O arquivo %s nao foi encontrado.\n", file_name);
+      MPI_Finalize();
+      exit(-1);
+   }
+   MPI_File_get_size(fh, &size);
+   MPI_File_close(&fh);
+
+   return (int)(size / sizeof(int) / p * p);
+}  /* Get_binary_n */
+
+/*-------------------------------------------------------------------
+ * Function:   Read_vector_from_binary_file
+ * Purpose:    Each process reads its own block of a binary file of
+ *             ints (native byte order, no header) with MPI-IO
+ * In args:    file_name, local_n, my_rank, comm
+ * Out args:   local_A, bytes_p
+ */
+void Read_vector_from_binary_file(char file_name[], int local_A[],
+   int local_n, int my_rank, long* bytes_p, MPI_Comm comm) {
+   MPI_File fh;
+
+   MPI_File_open(comm, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+   MPI_File_read_at_all(fh, (MPI_Offset)my_rank * local_n * sizeof(int),
+      local_A, local_n, MPI_INT, MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+   *bytes_p = (long)local_n * sizeof(int);
+}  /* Read_vector_from_binary_file */
 
 void Write_vector_to_output_file(int A[]) {
 
@@ -168,34 +493,19 @@ void Generate_list(int local_A[], int local_n, int my_rank) {
  * Note:      Purely local, run only by process 0;
  */
 void Usage(char* program) {
-   fprintf(stderr, "usage:  mpirun -np <p> %s <g|i> <global_n>\n",
+   fprintf(stderr, "usage:  mpirun -np <p> %s [arquivo] [t|b]\n",
       program);
    fprintf(stderr, "   - p: the number of processes \n");
-   fprintf(stderr, "   - g: generate random, distributed list\n");
-   fprintf(stderr, "   - i: user will input list on process 0\n");
-   fprintf(stderr, "   - global_n: number of elements in global list");
-   fprintf(stderr, " (must be evenly divisible by p)\n");
+   fprintf(stderr, "   - arquivo: input file (default %s)\n",
+      INPUT_FILE_NAME);
+   fprintf(stderr, "   - t: text file of %d ints, each process parses",
+      ELEMENTS_IN_SOURCE_VECTOR);
+   fprintf(stderr, " part of it (default)\n");
+   fprintf(stderr, "   - b: binary file of ints, each process reads");
+   fprintf(stderr, " its own block with MPI-IO\n");
    fflush(stderr);
 }  /* Usage */
 
-/*-------------------------------------------------------------------
- * Function:    Compare
- * Purpose:     Compare 2 ints, return -1, 0, or 1, respectively, when
- *              the first int is less than, equal, or greater than
- *              the second.  Used by qsort.
- */
-int Compare(const void* a_p, const void* b_p) {
-   int a = *((int*)a_p);
-   int b = *((int*)b_p);
-
-   if (a < b)
-      return -1;
-   else if (a == b)
-      return 0;
-   else /* a > b */
-      return 1;
-}  /* Compare */
-
 /*-------------------------------------------------------------------
  * Function:    Sort
  * Purpose:     Sort local list, use odd-even sort to sort
@@ -205,7 +515,7 @@ int Compare(const void* a_p, const void* b_p) {
  */
 void Sort(int local_A[], int local_n, int my_rank, int p, MPI_Comm comm) {
    int phase;
-   int* temp_B, * temp_C;
+   int* keys, * temp_B, * temp_C;
    int even_partner;  /* phase is even or left-looking */
    int odd_partner;   /* phase is odd or right-looking */
 
@@ -225,18 +535,25 @@ void Sort(int local_A[], int local_n, int my_rank, int p, MPI_Comm comm) {
       odd_partner = my_rank - 1;
    }
 
-   /* Sort local list using built-in quick sort */
-   qsort(local_A, local_n, sizeof(int), Compare);
+   /* Sort local list using radix sort (../ipp-source-use/ch3/local_sort.c) */
+   Local_sort(local_A, local_n);
 
 #  ifdef DEBUG
    printf("Proc %d > before loop in sort\n", my_rank);
    fflush(stdout);
 #  endif
 
+   /* The merges write to temp_C, and then keys and temp_C are
+    * swapped, so keys may end up pointing to the malloc'ed block */
+   keys = local_A;
    for (phase = 0; phase < p; phase++)
-      Odd_even_iter(local_A, temp_B, temp_C, local_n, phase,
-         even_partner, odd_partner, my_rank, p, comm);
+      Odd_even_iter(&keys, temp_B, &temp_C, local_n, phase,
+         even_partner, odd_partner, my_rank, comm);
 
+   if (keys != local_A) {
+      memcpy(local_A, keys, local_n * sizeof(int));
+      temp_C = keys;
+   }
    free(temp_B);
    free(temp_C);
 }  /* Sort */
@@ -245,96 +562,36 @@ void Sort(int local_A[], int local_n, int my_rank, int p, MPI_Comm comm) {
 /*-------------------------------------------------------------------
  * Function:    Odd_even_iter
  * Purpose:     One iteration of Odd-even transposition sort
- * In args:     local_n, phase, my_rank, p, comm
- * In/out args: local_A
- * Scratch:     temp_B, temp_C
+ * In args:     local_n, phase, my_rank, comm
+ * In/out args: keys_p:  the sorted local keys.  After a merge-split,
+ *                 *keys_p and *temp_C_p are swapped.
+ * Scratch:     temp_B, *temp_C_p
  */
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
+void Odd_even_iter(int** keys_p, int temp_B[], int** temp_C_p,
    int local_n, int phase, int even_partner, int odd_partner,
-   int my_rank, int p, MPI_Comm comm) {
+   int my_rank, MPI_Comm comm) {
    MPI_Status status;
+   int partner, keep_low;
+   int* tmp;
 
    if (phase % 2 == 0) {
-      if (even_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, even_partner, 0,
-            temp_B, local_n, MPI_INT, even_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_high(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_low(local_A, temp_B, temp_C, local_n);
-      }
+      partner = even_partner;
+      keep_low = (my_rank % 2 == 0);
    }
    else { /* odd phase */
-      if (odd_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, odd_partner, 0,
-            temp_B, local_n, MPI_INT, odd_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_low(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_high(local_A, temp_B, temp_C, local_n);
-      }
+      partner = odd_partner;
+      keep_low = (my_rank % 2 != 0);
    }
-}  /* Odd_even_iter */
-
-/*-------------------------------------------------------------------
- * Function:    Merge_low
- * Purpose:     Merge the smallest local_n elements in my_keys
- *              and recv_keys into temp_keys.  Then copy temp_keys
- *              back into my_keys.
- * In args:     local_n, recv_keys
- * In/out args: my_keys
- * Scratch:     temp_keys
- */
-void Merge_low(
-   int  my_keys[],     /* in/out    */
-   int  recv_keys[],   /* in        */
-   int  temp_keys[],   /* scratch   */
-   int  local_n        /* = n/p, in */) {
-   int m_i, r_i, t_i;
-
-   m_i = r_i = t_i = 0;
-   while (t_i < local_n) {
-      if (my_keys[m_i] <= recv_keys[r_i]) {
-         temp_keys[t_i] = my_keys[m_i];
-         t_i++; m_i++;
-      }
-      else {
-         temp_keys[t_i] = recv_keys[r_i];
-         t_i++; r_i++;
-      }
-   }
-
-   memcpy(my_keys, temp_keys, local_n * sizeof(int));
-}  /* Merge_low */
-
-/*-------------------------------------------------------------------
- * Function:    Merge_high
- * Purpose:     Merge the largest local_n elements in local_A
- *              and temp_B into temp_C.  Then copy temp_C
- *              back into local_A.
- * In args:     local_n, temp_B
- * In/out args: local_A
- * Scratch:     temp_C
- */
-void Merge_high(int local_A[], int temp_B[], int temp_C[],
-   int local_n) {
-   int ai, bi, ci;
-
-   ai = local_n - 1;
-   bi = local_n - 1;
-   ci = local_n - 1;
-   while (ci >= 0) {
-      if (local_A[ai] >= temp_B[bi]) {
-         temp_C[ci] = local_A[ai];
-         ci--; ai--;
-      }
-      else {
-         temp_C[ci] = temp_B[bi];
-         ci--; bi--;
-      }
-   }
-
-   memcpy(local_A, temp_C, local_n * sizeof(int));
-}  /* Merge_high */
\ No newline at end of file
+   if (partner < 0) return;
+
+   MPI_Sendrecv(*keys_p, local_n, MPI_INT, partner, 0,
+      temp_B, local_n, MPI_INT, partner, 0, comm,
+      &status);
+   if (keep_low)
+      Merge_low_simd(*keys_p, temp_B, *temp_C_p, local_n);
+   else
+      Merge_high_simd(*keys_p, temp_B, *temp_C_p, local_n);
+   tmp = *keys_p;
+   *keys_p = *temp_C_p;
+   *temp_C_p = tmp;
+}  /* Odd_even_iter */
\ No newline at end of file
@@ -6,6 +6,7 @@
 const int ARRAY_SIZE = 16000000;
 const int RANDOM_NUMBER_UPPER_BOUND = 100000;
 char* OUTPUT_FILE_NAME = "mpi_odd_even_exercicio_7_input.txt";
+char* OUTPUT_BINARY_FILE_NAME = "mpi_odd_even_exercicio_7_input.bin";
 
 void Generate_list(int array[]) {
 	int i;
@@ -30,11 +31,36 @@ void Write_vector_to_output_file(int array[]) {
 	fclose(file_ptr);
 }
 
-void main() {
+/* Mesmos numeros em binario (ints na ordem de bytes nativa, sem
+ * cabecalho), para "mpirun -np <p> ./mpi_odd_even_exercicio_7
+ * mpi_odd_even_exercicio_7_input.bin b" */
+void Write_vector_to_binary_file(int array[]) {
+
+	FILE* file_ptr = fopen(OUTPUT_BINARY_FILE_NAME, "wb");
+	if (file_ptr == NULL) {
+		printf("ERRO. O arquivo %s nao pode ser criado.\n", OUTPUT_BINARY_FILE_NAME);
+		exit(-1);
+	}
+
+	if (fwrite(array, sizeof(int), ARRAY_SIZE, file_ptr) != ARRAY_SIZE) {
+		printf("ERRO. Falha ao escrever %s.\n", OUTPUT_BINARY_FILE_NAME);
+		exit(-1);
+	}
+
+	fclose(file_ptr);
+}
+
+/* Uso: ./preencher [t|b]  (t: texto, o padrao; b: binario) */
+int main(int argc, char* argv[]) {
 
 
 	int* array = (int*)malloc(ARRAY_SIZE * sizeof(int));
 	Generate_list(array);
-	Write_vector_to_output_file(array);
+	if (argc > 1 && argv[1][0] == 'b')
+		Write_vector_to_binary_file(array);
+	else
+		Write_vector_to_output_file(array);
 
+	free(array);
+	return 0;
 }
\ No newline at end of file